@@ -637,6 +637,8 @@ namespace Microsoft.Research.Dryad.GraphManager
                         dynamicMerge.SetGroupingSettings(0, 0);
                         dynamicMerge.SetMachineGroupingSettings(2, aggFilterThreshold);
                         dynamicMerge.SetDataGroupingSettings(lowDataThreshold, highDataThreshold, maxSingleDataThreshold);
+                        dynamicMerge.SetCostSettings(parameters.m_aggregateVertexOverhead,
+                                                     parameters.m_aggregateCrossPodBytesPerSecond);
                         dynamicMerge.SetSplitAfterGrouping(true);
 
                         foreach (Predecessor p in v.info.predecessors)
@@ -673,6 +675,8 @@ namespace Microsoft.Research.Dryad.GraphManager
                             dynamicMerge.SetDataGroupingSettings(lowDataThreshold,
                                 highDataThreshold,
                                 maxSingleDataThreshold);
+                            dynamicMerge.SetCostSettings(parameters.m_aggregateVertexOverhead,
+                                                         parameters.m_aggregateCrossPodBytesPerSecond);
                             dynamicMerge.SetMaxAggregationLevel(v.dynamicManager.aggregationLevels);						 
                         }
                         
@@ -722,6 +726,7 @@ namespace Microsoft.Research.Dryad.GraphManager
                         copyVertex.AddArgument(cpyVertexName);
                         
                         DrDynamicBroadcastManager bcast = new DrDynamicBroadcastManager(copyVertex);
+                        bcast.SetFanOut(parameters.m_broadcastFanOut);
                         newManager.AddDynamicConnectionManager(graphStageMap[v.info.predecessors[0].uniqueId].stageManager, bcast);
                     }
                     else if (v.dynamicManager.type != DynamicManager.Type.NONE)
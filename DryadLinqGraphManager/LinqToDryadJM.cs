@@ -296,6 +296,48 @@ namespace Microsoft.Research.Dryad.GraphManager
             }
         }
 
+        //
+        // Hash the query plan and the content of every job resource, which include the generated
+        // vertex DLL. Vertex arguments name only the DLL, class and method, so without this two
+        // different queries with the same shape over the same input would share cache entries.
+        // Returns 0 if a resource can't be read, in which case the graph manager keeps the cache
+        // to this job.
+        //
+        internal UInt64 ComputeOutputCacheScope(string queryPlanFileName, Query query)
+        {
+            string planDirectory = Path.GetDirectoryName(Path.GetFullPath(queryPlanFileName));
+
+            List<string> files = new List<string>();
+            files.Add(queryPlanFileName);
+            foreach (string resource in query.resources)
+            {
+                string path = Path.Combine(planDirectory, resource);
+                if (!File.Exists(path))
+                {
+                    path = Path.Combine(Environment.CurrentDirectory, resource);
+                }
+                if (!File.Exists(path))
+                {
+                    DryadLogger.LogWarning(String.Format("Can't find job resource {0} to scope the output cache", resource));
+                    return 0;
+                }
+                files.Add(path);
+            }
+
+            using (System.Security.Cryptography.SHA256 sha = System.Security.Cryptography.SHA256.Create())
+            {
+                foreach (string file in files)
+                {
+                    byte[] name = System.Text.Encoding.UTF8.GetBytes(Path.GetFileName(file).ToLowerInvariant());
+                    sha.TransformBlock(name, 0, name.Length, null, 0);
+                    byte[] content = File.ReadAllBytes(file);
+                    sha.TransformBlock(content, 0, content.Length, null, 0);
+                }
+                sha.TransformFinalBlock(new byte[0], 0, 0);
+                return BitConverter.ToUInt64(sha.Hash, 0);
+            }
+        }
+
         internal bool ConsumeSingleArgument(string arg, ref string[] args)
         {
             List<string> temp = new List<string>();
@@ -423,6 +465,45 @@ namespace Microsoft.Research.Dryad.GraphManager
                 p.m_reporters.Add(reporter);
             }
             p.m_intermediateCompressionMode = query.intermediateDataCompression;
+
+            // keep completed vertex outputs for reuse by later runs of the same computation
+            string outputCache = Environment.GetEnvironmentVariable("DRYAD_OUTPUT_CACHE");
+            if (outputCache != null)
+            {
+                UInt64 outputCacheMB = 10 * 1024;
+                string outputCacheSize = Environment.GetEnvironmentVariable("DRYAD_OUTPUT_CACHE_MB");
+                if (outputCacheSize != null)
+                {
+                    outputCacheMB = UInt64.Parse(outputCacheSize);
+                }
+                p.SetOutputCache(outputCache, outputCacheMB * 1024 * 1024, ComputeOutputCacheScope(args[1], query));
+            }
+
+            // keep finished vertex hosts warm for later cohorts on the same computer
+            string idleVertexHosts = Environment.GetEnvironmentVariable("DRYAD_IDLE_VERTEX_HOSTS_PER_COMPUTER");
+            if (idleVertexHosts != null)
+            {
+                p.m_maxIdleVertexHostsPerComputer = Int32.Parse(idleVertexHosts);
+            }
+
+            // costs used to plan the shape of dynamic aggregation trees
+            string aggregateVertexOverhead = Environment.GetEnvironmentVariable("DRYAD_AGGREGATE_VERTEX_OVERHEAD_SECONDS");
+            if (aggregateVertexOverhead != null)
+            {
+                p.m_aggregateVertexOverhead = TimeSpan.FromSeconds(Double.Parse(aggregateVertexOverhead)).Ticks;
+            }
+            string aggregateCrossPodRate = Environment.GetEnvironmentVariable("DRYAD_AGGREGATE_CROSS_POD_MB_PER_SECOND");
+            if (aggregateCrossPodRate != null)
+            {
+                p.m_aggregateCrossPodBytesPerSecond = UInt64.Parse(aggregateCrossPodRate) * 1024 * 1024;
+            }
+
+            // a fixed fan-out for broadcast trees instead of one sized from the data
+            string broadcastFanOut = Environment.GetEnvironmentVariable("DRYAD_BROADCAST_FAN_OUT");
+            if (broadcastFanOut != null)
+            {
+                p.m_broadcastFanOut = Int32.Parse(broadcastFanOut);
+            }
             DrGraphExecutor graphExecutor = new DrGraphExecutor();
             DrGraph graph = graphExecutor.Initialize(p);
             if (graph == null)
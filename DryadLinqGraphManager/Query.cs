@@ -158,6 +158,7 @@ namespace Microsoft.Research.Dryad.GraphManager
         public int intermediateDataCompression = 0;  //YARN       // compression scheme for intermediate data
         public SortedDictionary<int, Vertex> queryPlan = new SortedDictionary<int, Vertex>();          // DAG of numbered vertices
         public bool enableSpeculativeDuplication = true;
+        public string[] resources = new string[0];   // file names of the job resources, e.g. the vertex DLL
     };
 
 } // namespace DryadLINQ
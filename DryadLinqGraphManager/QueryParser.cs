@@ -146,6 +146,20 @@ namespace Microsoft.Research.Dryad.GraphManager
             {
                 query.xmlExecHostArgs[index] = nodes[index].InnerText;
             }
+
+            //
+            // Job resources
+            //
+            XmlNode resourcesNode = root.SelectSingleNode("Resources");
+            if (resourcesNode != null)
+            {
+                nodes = resourcesNode.ChildNodes;
+                query.resources = new string[nodes.Count];
+                for (int index=0; index<nodes.Count; index++)
+                {
+                    query.resources[index] = nodes[index].InnerText;
+                }
+            }
             
             // 
             // Get Speculative duplication flag - default is enabled (true)
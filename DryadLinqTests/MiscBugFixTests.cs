@@ -60,6 +60,7 @@ namespace DryadLinqTests
                   {"Bug15159_NotOperatorForNullableBool", () => Bug15159_NotOperatorForNullableBool(context) },
                   {"Bug15371_NoDataMembersForSerialization", () => Bug15371_NoDataMembersForSerialization(context) },
                   {"Bug15570_GetHashCodeAndEqualsForNullableFieldsOfAnonymousTypes", () => Bug15570_GetHashCodeAndEqualsForNullableFieldsOfAnonymousTypes(context) },
+                  {"WorkStealingQueue_MoreBlockedChannelsThanThreads", () => WorkStealingQueue_MoreBlockedChannelsThanThreads(context) },
               };
 
             foreach (var test in tests)
@@ -963,5 +964,53 @@ namespace DryadLinqTests
             return passed;
         }
 
+        public static bool WorkStealingQueue_MoreBlockedChannelsThanThreads(DryadLinqContext context)
+        {
+            string testName = "WorkStealingQueue_MoreBlockedChannelsThanThreads";
+            TestLog.TestStart(testName);
+
+            bool passed = true;
+            try
+            {
+                // The merge vertex reads many more channels than the vertex host
+                // has work queue threads, so most of its channel requests block
+                // waiting for reads that are queued behind them. The work-stealing
+                // queue has to let other workers run while they do.
+                int partitionCount = 8 * Environment.ProcessorCount;
+                int[] clusterResult, localResult;
+                context.JobEnvironmentVariables["DRYAD_WORK_STEALING"] = "1";
+                try
+                {
+                    context.LocalDebug = false;
+                    IQueryable<int> pt1 = DataGenerator.GetSimpleFileSets(context);
+                    clusterResult = pt1.HashPartition(x => x, partitionCount)
+                                       .Apply(x => x) // force a merge
+                                       .ToArray();
+                }
+                finally
+                {
+                    context.JobEnvironmentVariables.Remove("DRYAD_WORK_STEALING");
+                }
+
+                // local
+                {
+                    context.LocalDebug = true;
+                    IQueryable<int> pt1 = DataGenerator.GetSimpleFileSets(context);
+                    localResult = pt1.HashPartition(x => x, partitionCount)
+                                     .Apply(x => x)
+                                     .ToArray();
+                }
+
+                passed &= clusterResult.OrderBy(x => x).SequenceEqual(localResult.OrderBy(x => x));
+            }
+            catch (Exception Ex)
+            {
+                TestLog.Message("Error: " + Ex.Message);
+                passed &= false;
+            }
+
+            TestLog.LogResult(new TestResult(testName, context, passed));
+            return passed;
+        }
     }
 }
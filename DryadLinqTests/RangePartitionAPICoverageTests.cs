@@ -50,6 +50,10 @@ namespace DryadLinqTests
                   {"RP_singlePartition_autoSeparators", () => RP_singlePartition_autoSeparators(context) },
                   {"RP_rangeSeparators_customComparer", () => RP_rangeSeparators_customComparer(context) },
                   {"RP_rangeSeparators_nullCustomComparer", () => RP_rangeSeparators_nullCustomComparer(context) },
+                  {"RP_skewAwareSeparators_heavyKey", () => RP_skewAwareSeparators_heavyKey(context) },
+                  {"RP_skewAwareSeparators_heavyKey_isDescending", () => RP_skewAwareSeparators_heavyKey_isDescending(context) },
+                  {"RP_skewAwareSeparators_duplicateHeavy", () => RP_skewAwareSeparators_duplicateHeavy(context) },
+                  {"RP_skewAwareSeparators_noHeavyKeys", () => RP_skewAwareSeparators_noHeavyKeys(context) },
               };
 
             foreach (var test in tests)
@@ -807,6 +811,121 @@ namespace DryadLinqTests
             return passed;
         }
 
+        // keys 0..99 once each, with key 50 repeated so it makes up most of the samples
+        public static IEnumerable<int> SkewedSamples()
+        {
+            for (int i = 0; i < 100; i++)
+            {
+                yield return i;
+            }
+            for (int i = 0; i < 400; i++)
+            {
+                yield return 50;
+            }
+        }
+
+        public static bool CheckSeparators(IEnumerable<int> samples, bool isDescending, int pcount, int[] expected)
+        {
+            int[] separators = DryadLinqSampler.RangeSamplerCore(samples, Comparer<int>.Default, isDescending, pcount).ToArray();
+            if (!separators.SequenceEqual(expected))
+            {
+                TestLog.Message(String.Format("Error: separators [{0}], expected [{1}]",
+                                              String.Join(",", separators), String.Join(",", expected)));
+                return false;
+            }
+            return true;
+        }
+
+        public static bool RP_skewAwareSeparators_heavyKey(DryadLinqContext context)
+        {
+            string testName = "RP_skewAwareSeparators_heavyKey";
+            TestLog.TestStart(testName);
+
+            bool passed = true;
+            try
+            {
+                // the heavy key 50 is bounded by 49 and itself, so it has a partition of its
+                // own, and the light keys either side of it are split evenly
+                passed &= CheckSeparators(SkewedSamples(), false, 5, new int[] { 23, 47, 49, 50 });
+            }
+            catch (Exception Ex)
+            {
+                TestLog.Message("Error: " + Ex.Message);
+                passed &= false;
+            }
+
+            TestLog.LogResult(new TestResult(testName, context, passed));
+            return passed;
+        }
+
+        public static bool RP_skewAwareSeparators_heavyKey_isDescending(DryadLinqContext context)
+        {
+            string testName = "RP_skewAwareSeparators_heavyKey_isDescending";
+            TestLog.TestStart(testName);
+
+            bool passed = true;
+            try
+            {
+                passed &= CheckSeparators(SkewedSamples(), true, 5, new int[] { 76, 52, 51, 50 });
+            }
+            catch (Exception Ex)
+            {
+                TestLog.Message("Error: " + Ex.Message);
+                passed &= false;
+            }
+
+            TestLog.LogResult(new TestResult(testName, context, passed));
+            return passed;
+        }
+
+        public static bool RP_skewAwareSeparators_duplicateHeavy(DryadLinqContext context)
+        {
+            string testName = "RP_skewAwareSeparators_duplicateHeavy";
+            TestLog.TestStart(testName);
+
+            bool passed = true;
+            try
+            {
+                // only four distinct keys, three of them heavy: each heavy key gets its own
+                // partition rather than a key being picked as several separators in a row
+                List<int> samples = new List<int>();
+                samples.AddRange(Enumerable.Repeat(1, 300));
+                samples.AddRange(Enumerable.Repeat(2, 300));
+                samples.AddRange(Enumerable.Repeat(3, 300));
+                samples.AddRange(Enumerable.Repeat(4, 100));
+                passed &= CheckSeparators(samples, false, 4, new int[] { 1, 2, 3 });
+            }
+            catch (Exception Ex)
+            {
+                TestLog.Message("Error: " + Ex.Message);
+                passed &= false;
+            }
+
+            TestLog.LogResult(new TestResult(testName, context, passed));
+            return passed;
+        }
+
+        public static bool RP_skewAwareSeparators_noHeavyKeys(DryadLinqContext context)
+        {
+            string testName = "RP_skewAwareSeparators_noHeavyKeys";
+            TestLog.TestStart(testName);
+
+            bool passed = true;
+            try
+            {
+                // without heavy keys the separators stay evenly spaced
+                passed &= CheckSeparators(Enumerable.Range(0, 1000), false, 4, new int[] { 250, 500, 750 });
+            }
+            catch (Exception Ex)
+            {
+                TestLog.Message("Error: " + Ex.Message);
+                passed &= false;
+            }
+
+            TestLog.LogResult(new TestResult(testName, context, passed));
+            return passed;
+        }
+
         public static bool TestRangePartitioned(IQueryable<int> pt, int expectedPCount, IComparer<int> comparer, bool expectedIsDescending)
         {
             bool passed = true;
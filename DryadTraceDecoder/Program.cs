@@ -0,0 +1,272 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace Microsoft.Research.Dryad.TraceDecoder
+{
+    /// <summary>
+    /// Turns a binary vertex host trace (written when DRYAD_TRACE_FILE is set) into text. The
+    /// file carries its own event name table, so the decoder doesn't need to match the build
+    /// that wrote it.
+    /// </summary>
+    class Program
+    {
+        const string Magic = "DRTRACE1";
+        const uint Version = 1;
+
+        class EventName
+        {
+            public string name;
+            public string arg0Name;
+            public string arg1Name;
+        }
+
+        struct Record
+        {
+            public ulong timestamp;
+            public ushort id;
+            public uint threadId;
+            public ulong arg0;
+            public ulong arg1;
+        }
+
+        class Trace
+        {
+            public uint processId;
+            public ulong counterFrequency;
+            public ulong counterStart;
+            public DateTime startTime;
+            public Dictionary<ushort, EventName> events = new Dictionary<ushort, EventName>();
+            public List<Record> records = new List<Record>();
+        }
+
+        static void Usage()
+        {
+            Console.Error.WriteLine(
+                "usage: Microsoft.Research.Dryad.DryadTraceDecoder.exe [options] <tracefile>\n" +
+                "  --summary              print per-event counts instead of the records\n" +
+                "  --unsorted             print records in file order rather than by time");
+        }
+
+        static string ReadName(BinaryReader reader, int length)
+        {
+            return Encoding.ASCII.GetString(reader.ReadBytes(length));
+        }
+
+        static Trace Read(string path)
+        {
+            Trace trace = new Trace();
+
+            using (BinaryReader reader = new BinaryReader(File.OpenRead(path)))
+            {
+                string magic = Encoding.ASCII.GetString(reader.ReadBytes(8));
+                if (magic != Magic)
+                {
+                    throw new InvalidDataException(path + " is not a Dryad trace file");
+                }
+
+                uint version = reader.ReadUInt32();
+                if (version != Version)
+                {
+                    throw new InvalidDataException("Unsupported trace file version " + version);
+                }
+
+                trace.processId = reader.ReadUInt32();
+                trace.counterFrequency = reader.ReadUInt64();
+                trace.counterStart = reader.ReadUInt64();
+                trace.startTime = DateTime.FromFileTimeUtc((long)reader.ReadUInt64()).ToLocalTime();
+                uint eventCount = reader.ReadUInt32();
+                uint recordSize = reader.ReadUInt32();
+
+                for (uint i = 0; i < eventCount; ++i)
+                {
+                    ushort id = reader.ReadUInt16();
+                    int nameLength = reader.ReadUInt16();
+                    int arg0NameLength = reader.ReadUInt16();
+                    int arg1NameLength = reader.ReadUInt16();
+
+                    EventName e = new EventName();
+                    e.name = ReadName(reader, nameLength);
+                    e.arg0Name = ReadName(reader, arg0NameLength);
+                    e.arg1Name = ReadName(reader, arg1NameLength);
+                    trace.events[id] = e;
+                }
+
+                Stream stream = reader.BaseStream;
+                while (stream.Length - stream.Position >= recordSize)
+                {
+                    long start = stream.Position;
+
+                    Record r;
+                    r.timestamp = reader.ReadUInt64();
+                    r.id = reader.ReadUInt16();
+                    reader.ReadUInt16();
+                    r.threadId = reader.ReadUInt32();
+                    r.arg0 = reader.ReadUInt64();
+                    r.arg1 = reader.ReadUInt64();
+                    trace.records.Add(r);
+
+                    // skip anything a later writer appended to the record
+                    stream.Position = start + recordSize;
+                }
+
+                if (stream.Position != stream.Length)
+                {
+                    Console.Error.WriteLine("Ignoring {0} trailing bytes; the trace was not closed cleanly", stream.Length - stream.Position);
+                }
+            }
+
+            return trace;
+        }
+
+        static EventName Lookup(Trace trace, ushort id)
+        {
+            EventName e;
+            if (!trace.events.TryGetValue(id, out e))
+            {
+                e = new EventName();
+                e.name = "Event" + id;
+                e.arg0Name = "arg0";
+                e.arg1Name = "arg1";
+                trace.events[id] = e;
+            }
+            return e;
+        }
+
+        static void PrintRecords(Trace trace)
+        {
+            foreach (Record r in trace.records)
+            {
+                double ticks = (double)((long)(r.timestamp - trace.counterStart));
+                double ms = ticks * 1000.0 / trace.counterFrequency;
+                DateTime when = trace.startTime.AddMilliseconds(ms);
+
+                EventName e = Lookup(trace, r.id);
+                StringBuilder line = new StringBuilder();
+                line.AppendFormat("{0:MM/dd/yyyy HH:mm:ss.ffffff}, +{1:F3}ms, TID={2}, {3}", when, ms, r.threadId, e.name);
+                if (e.arg0Name.Length > 0)
+                {
+                    line.AppendFormat(", {0}={1}", e.arg0Name, (long)r.arg0);
+                }
+                if (e.arg1Name.Length > 0)
+                {
+                    line.AppendFormat(", {0}={1}", e.arg1Name, (long)r.arg1);
+                }
+
+                Console.WriteLine(line.ToString());
+            }
+        }
+
+        static void PrintSummary(Trace trace)
+        {
+            SortedDictionary<ushort, long> counts = new SortedDictionary<ushort, long>();
+            HashSet<uint> threads = new HashSet<uint>();
+            ulong first = ulong.MaxValue, last = 0;
+
+            foreach (Record r in trace.records)
+            {
+                long count;
+                counts.TryGetValue(r.id, out count);
+                // a RecordsDropped record stands for the records it reports
+                counts[r.id] = count + ((r.id == 0) ? (long)r.arg0 : 1);
+                threads.Add(r.threadId);
+                first = Math.Min(first, r.timestamp);
+                last = Math.Max(last, r.timestamp);
+            }
+
+            Console.WriteLine("Process {0}, started {1}", trace.processId, trace.startTime);
+            Console.WriteLine("{0} records from {1} threads", trace.records.Count, threads.Count);
+            if (trace.records.Count > 0)
+            {
+                Console.WriteLine("Span {0:F3}ms", (double)(last - first) * 1000.0 / trace.counterFrequency);
+            }
+
+            foreach (KeyValuePair<ushort, long> c in counts)
+            {
+                Console.WriteLine("  {0,-32} {1,12}", Lookup(trace, c.Key).name, c.Value);
+            }
+        }
+
+        static int Main(string[] args)
+        {
+            bool summary = false;
+            bool sorted = true;
+            string path = null;
+
+            foreach (string arg in args)
+            {
+                if (arg == "--summary")
+                {
+                    summary = true;
+                }
+                else if (arg == "--unsorted")
+                {
+                    sorted = false;
+                }
+                else if (arg.StartsWith("--") || path != null)
+                {
+                    Usage();
+                    return 1;
+                }
+                else
+                {
+                    path = arg;
+                }
+            }
+
+            if (path == null)
+            {
+                Usage();
+                return 1;
+            }
+
+            Trace trace;
+            try
+            {
+                trace = Read(path);
+            }
+            catch (Exception e)
+            {
+                Console.Error.WriteLine("Can't read {0}: {1}", path, e.Message);
+                return 1;
+            }
+
+            if (summary)
+            {
+                PrintSummary(trace);
+                return 0;
+            }
+
+            if (sorted)
+            {
+                // records are written one ring at a time, so threads interleave by flush, not by time
+                List<Record> records = trace.records;
+                records.Sort((a, b) => a.timestamp.CompareTo(b.timestamp));
+            }
+
+            PrintRecords(trace);
+            return 0;
+        }
+    }
+}
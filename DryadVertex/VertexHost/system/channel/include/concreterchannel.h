@@ -42,6 +42,7 @@ public:
     static bool IsAzureBlob(const char* uri);
     static bool IsUncPath(const char* uri);
     static bool IsFifo(const char* uri);
+    static bool IsSharedMemory(const char* uri);
     static bool IsNull(const char* uri);
     static bool IsNamedPipe(const char* uri);
     static bool IsTidyFSStream(const char* uri);
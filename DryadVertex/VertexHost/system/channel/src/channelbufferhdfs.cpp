@@ -33,7 +33,85 @@ const char* RChannelBufferHdfsWriter::s_wasbFilePrefix = "wasb://";
 static long s_readBufferSize = 2 * 1024 * 1024;
 static long s_writeBufferSize = 256 * 1024;
 static LONG s_maxBuffersOut = 4;
-static UInt32 s_maxBuffersToBlockWriter = 4;
+
+//
+// Bytes a writer may have queued or uploading before the marshaler is
+// told to block. Can be overridden with DRYAD_HDFS_WRITE_INFLIGHT_MB
+//
+static const UInt64 s_defaultMaxWriteBytesInFlight = 8*1024*1024;
+
+//
+// The serialized writer resumes marshaling once this many of its
+// buffers are outstanding, so a stall is counted as over at the same
+// point
+//
+static const UInt32 s_writerUnblockEntries = 2;
+
+static UInt64 GetMaxWriteBytesInFlight()
+{
+    static bool s_initialized = false;
+    static UInt64 s_maxBytesInFlight = 0;
+
+    if (!s_initialized)
+    {
+        UInt64 maxBytes = s_defaultMaxWriteBytesInFlight;
+
+        char envValue[32];
+        DWORD ret = ::GetEnvironmentVariableA("DRYAD_HDFS_WRITE_INFLIGHT_MB",
+                                              envValue, sizeof(envValue));
+        if (ret > 0 && ret < sizeof(envValue))
+        {
+            UInt32 valueMB;
+            if (DrStringToUInt32(envValue, &valueMB) == DrError_OK &&
+                valueMB > 0)
+            {
+                maxBytes = (UInt64) valueMB * 1024 * 1024;
+            }
+        }
+
+        s_maxBytesInFlight = maxBytes;
+        s_initialized = true;
+        DrLogI("Hdfs writer in-flight limit %I64u bytes", s_maxBytesInFlight);
+    }
+
+    return s_maxBytesInFlight;
+}
+
+//
+// Partitions longer than this many read buffers are read over several
+// streams at once. The number of streams defaults to
+// s_defaultReadStreams and can be set with DRYAD_HDFS_READ_STREAMS;
+// 1 turns parallel reads off
+//
+static const Int64 s_minBuffersForParallelRead = 4;
+static const UInt32 s_defaultReadStreams = 4;
+static const UInt32 s_maxReadStreams = 16;
+
+static UInt32 GetNumberOfReadStreams()
+{
+    static LONG s_readStreams = 0;
+
+    if (s_readStreams == 0)
+    {
+        UInt32 streams = s_defaultReadStreams;
+        char envValue[32];
+        DWORD ret = ::GetEnvironmentVariableA("DRYAD_HDFS_READ_STREAMS",
+                                              envValue, sizeof(envValue));
+        if (ret > 0 && ret < sizeof(envValue))
+        {
+            UInt32 value;
+            if (DrStringToUInt32(envValue, &value) == DrError_OK &&
+                value > 0)
+            {
+                streams = (value > s_maxReadStreams) ? s_maxReadStreams : value;
+            }
+        }
+
+        ::InterlockedExchange(&s_readStreams, (LONG) streams);
+    }
+
+    return (UInt32) s_readStreams;
+}
 
 static bool
 ExtractHdfsReadUri(DrStr64 uri,
@@ -121,6 +199,15 @@ RChannelBufferHdfsReader::RChannelBufferHdfsReader(const char* uri)
                                        s_maxBuffersOut,
                                        NULL);
 
+    m_numberOfRangeThreads = 0;
+    m_rangeThread = NULL;
+    m_rangeRequest = NULL;
+    m_rangeQueue = NULL;
+    m_rangeQueueHead = 0;
+    m_rangeQueueLength = 0;
+    m_rangeSemaphore = INVALID_HANDLE_VALUE;
+    m_rangeShutdownEvent = INVALID_HANDLE_VALUE;
+
     /* it's important to initialize here since these are called
        sequentially so there's no race on the hdfs
        initialization code. Then we need to connect to the server,
@@ -155,6 +242,7 @@ RChannelBufferHdfsReader::RChannelBufferHdfsReader(const char* uri)
 
 RChannelBufferHdfsReader::~RChannelBufferHdfsReader()
 {
+    LogAssert(m_rangeThread == NULL);
     if (m_readThread != INVALID_HANDLE_VALUE)
     {
         CloseHandle(m_readThread);
@@ -445,6 +533,27 @@ ReadDataBuffer(Hdfs::ReaderAccessor& ra,
                const char* fileName,
                Int64 offset,
                Int64 endOffset)
+{
+    RChannelBuffer* buffer;
+    offset = ReadRange(ra, fileName, offset, endOffset, &buffer);
+
+    SendBuffer(buffer, false);
+
+    return offset;
+}
+
+//
+// Read the next buffer of the range starting at offset. The data
+// buffer, or an error buffer if the read failed, is returned in
+// pBuffer and not sent. Returns the offset after the data read, or -1
+// on error
+//
+Int64 RChannelBufferHdfsReader::
+ReadRange(Hdfs::ReaderAccessor& ra,
+          const char* fileName,
+          Int64 offset,
+          Int64 endOffset,
+          RChannelBuffer** pBuffer)
 {
     Int32 sizeToRead = s_readBufferSize;
     Int64 sizeLeft = endOffset - offset;
@@ -524,7 +633,316 @@ ReadDataBuffer(Hdfs::ReaderAccessor& ra,
         offset += bytesRead;
     }
 
-    SendBuffer(buffer, false);
+    *pBuffer = buffer;
+
+    return offset;
+}
+
+unsigned __stdcall RChannelBufferHdfsReader::RangeThreadFunc(void* arg)
+{
+    RChannelBufferHdfsReader* self = (RChannelBufferHdfsReader *) arg;
+    self->RangeThread();
+    return 0;
+}
+
+//
+// Each range thread has its own HDFS reader, opened when the thread
+// gets its first range, and reads whichever range is next in the
+// queue
+//
+void RChannelBufferHdfsReader::RangeThread()
+{
+    bool initialized = HadoopNative::Initialize();
+
+    Hdfs::Instance* bridge = NULL;
+    Hdfs::Reader* reader = NULL;
+    bool opened = false;
+    DrStr64 openError;
+
+    //
+    // the shutdown event comes first so it wins over any ranges still
+    // counted in the semaphore
+    //
+    HANDLE waitHandles[2];
+    waitHandles[0] = m_rangeShutdownEvent;
+    waitHandles[1] = m_rangeSemaphore;
+
+    for (;;)
+    {
+        DWORD dRet = WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE);
+        LogAssert(dRet == WAIT_OBJECT_0 || dRet == WAIT_OBJECT_0 + 1);
+
+        if (dRet == WAIT_OBJECT_0)
+        {
+            break;
+        }
+
+        UInt32 slot;
+        {
+            AutoCriticalSection acs(&m_cs);
+
+            LogAssert(m_rangeQueueLength > 0);
+            slot = m_rangeQueue[m_rangeQueueHead];
+            m_rangeQueueHead = (m_rangeQueueHead + 1) % m_numberOfRangeThreads;
+            --m_rangeQueueLength;
+        }
+
+        RangeRequest* request = &(m_rangeRequest[slot]);
+
+        if (!opened && openError.GetLength() == 0)
+        {
+            if (!initialized)
+            {
+                openError.Set("Can't initialize HDFS bridge");
+            }
+            else if (!Hdfs::OpenInstance(m_rangeSchemeAndAuthority.GetString(), &bridge))
+            {
+                openError.SetF("Can't open HDFS Bridge '%s'",
+                               m_rangeSchemeAndAuthority.GetString());
+                bridge = NULL;
+            }
+            else
+            {
+                Hdfs::InstanceAccessor ia(bridge);
+                if (ia.OpenReader(m_rangeFilePath.GetString(), &reader))
+                {
+                    opened = true;
+                }
+                else
+                {
+                    char* errorMsg = ia.GetExceptionMessage();
+                    openError.SetF("Can't open HDFS file '%s': %s",
+                                   m_uri.GetString(), errorMsg);
+                    HadoopNative::DisposeString(errorMsg);
+                    ia.Discard();
+                    bridge = NULL;
+                }
+            }
+
+            if (!opened)
+            {
+                DrLogI("%s", openError.GetString());
+            }
+        }
+
+        if (opened)
+        {
+            Hdfs::ReaderAccessor ra(reader);
+            request->m_nextOffset =
+                ReadRange(ra, m_uri.GetString(),
+                          request->m_offset, request->m_endOffset,
+                          &(request->m_buffer));
+        }
+        else
+        {
+            request->m_buffer =
+                MakeErrorBuffer(DryadError_ChannelOpenError,
+                                openError.GetString(),
+                                this);
+            request->m_nextOffset = -1;
+        }
+
+        BOOL bRet = SetEvent(request->m_completeEvent);
+        LogAssert(bRet != 0);
+    }
+
+    if (opened)
+    {
+        Hdfs::ReaderAccessor ra(reader);
+        ra.Discard();
+        Hdfs::InstanceAccessor ia(bridge);
+        ia.Discard();
+    }
+}
+
+void RChannelBufferHdfsReader::StartRangeThreads(const char* schemeAndAuthority,
+                                                 const char* filePath)
+{
+    LogAssert(m_rangeThread == NULL);
+
+    m_rangeSchemeAndAuthority.Set(schemeAndAuthority);
+    m_rangeFilePath.Set(filePath);
+
+    m_numberOfRangeThreads = GetNumberOfReadStreams();
+    m_rangeRequest = new RangeRequest[m_numberOfRangeThreads];
+    m_rangeQueue = new UInt32[m_numberOfRangeThreads];
+    m_rangeQueueHead = 0;
+    m_rangeQueueLength = 0;
+    m_rangeSemaphore = CreateSemaphore(NULL, 0, m_numberOfRangeThreads, NULL);
+    LogAssert(m_rangeSemaphore != NULL);
+    m_rangeShutdownEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    LogAssert(m_rangeShutdownEvent != NULL);
+
+    m_rangeThread = new HANDLE[m_numberOfRangeThreads];
+    for (UInt32 i=0; i<m_numberOfRangeThreads; ++i)
+    {
+        m_rangeRequest[i].m_buffer = NULL;
+        m_rangeRequest[i].m_completeEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+        LogAssert(m_rangeRequest[i].m_completeEvent != NULL);
+
+        m_rangeThread[i] =
+            (HANDLE) ::_beginthreadex(NULL,
+                                      0,
+                                      RChannelBufferHdfsReader::RangeThreadFunc,
+                                      this,
+                                      0,
+                                      NULL);
+        LogAssert(m_rangeThread[i] != 0);
+    }
+
+    DrLogI("Started %u HDFS range readers for %s",
+           m_numberOfRangeThreads, m_uri.GetString());
+}
+
+//
+// Wait for the range threads to finish whatever they are reading and
+// exit, then throw away any buffers that were never sent. Shutdown is
+// signalled with a separate event rather than by releasing the
+// semaphore, which may already be holding counts for queued ranges
+//
+void RChannelBufferHdfsReader::StopRangeThreads()
+{
+    BOOL bRet = SetEvent(m_rangeShutdownEvent);
+    LogAssert(bRet != 0);
+
+    DWORD dRet = WaitForMultipleObjects(m_numberOfRangeThreads, m_rangeThread,
+                                        TRUE, INFINITE);
+    LogAssert(dRet < WAIT_OBJECT_0 + m_numberOfRangeThreads);
+
+    for (UInt32 i=0; i<m_numberOfRangeThreads; ++i)
+    {
+        if (m_rangeRequest[i].m_buffer != NULL)
+        {
+            m_rangeRequest[i].m_buffer->DecRef();
+        }
+        CloseHandle(m_rangeRequest[i].m_completeEvent);
+        CloseHandle(m_rangeThread[i]);
+    }
+
+    CloseHandle(m_rangeSemaphore);
+    m_rangeSemaphore = INVALID_HANDLE_VALUE;
+    CloseHandle(m_rangeShutdownEvent);
+    m_rangeShutdownEvent = INVALID_HANDLE_VALUE;
+
+    delete [] m_rangeThread;
+    m_rangeThread = NULL;
+    delete [] m_rangeRequest;
+    m_rangeRequest = NULL;
+    delete [] m_rangeQueue;
+    m_rangeQueue = NULL;
+    m_numberOfRangeThreads = 0;
+}
+
+void RChannelBufferHdfsReader::QueueRange(UInt32 slot)
+{
+    {
+        AutoCriticalSection acs(&m_cs);
+
+        LogAssert(m_rangeQueueLength < m_numberOfRangeThreads);
+        UInt32 tail = (m_rangeQueueHead + m_rangeQueueLength) % m_numberOfRangeThreads;
+        m_rangeQueue[tail] = slot;
+        ++m_rangeQueueLength;
+    }
+
+    BOOL bRet = ReleaseSemaphore(m_rangeSemaphore, 1, NULL);
+    LogAssert(bRet != 0);
+}
+
+//
+// Keep one range outstanding per range thread and send the results in
+// stream order. The start of the partition has already been aligned
+// by AdjustStartOffset; the end is extended by AdjustEndOffset once
+// everything before it has been sent, exactly as in the sequential
+// loop. Returns the final offset, or -1 if the read stopped early and
+// any termination has already been sent
+//
+Int64 RChannelBufferHdfsReader::
+ReadRangesInParallel(Hdfs::Reader* reader,
+                     const char* fileName,
+                     Int64 offset,
+                     Int64 offsetStart,
+                     Int64 offsetEnd,
+                     bool scannedFinal)
+{
+    Int64 issueOffset = offset;
+    UInt32 issueSlot = 0;
+    UInt32 deliverSlot = 0;
+    UInt32 outstanding = 0;
+
+    while (offset >= 0 && offset < offsetEnd)
+    {
+        while (outstanding < m_numberOfRangeThreads && issueOffset < offsetEnd)
+        {
+            Int64 sizeToRead = offsetEnd - issueOffset;
+            if (sizeToRead > s_readBufferSize)
+            {
+                sizeToRead = s_readBufferSize;
+            }
+
+            RangeRequest* request = &(m_rangeRequest[issueSlot]);
+            LogAssert(request->m_buffer == NULL);
+            request->m_offset = issueOffset;
+            request->m_endOffset = issueOffset + sizeToRead;
+            request->m_nextOffset = -1;
+
+            QueueRange(issueSlot);
+
+            issueOffset += sizeToRead;
+            issueSlot = (issueSlot + 1) % m_numberOfRangeThreads;
+            ++outstanding;
+        }
+
+        RangeRequest* request = &(m_rangeRequest[deliverSlot]);
+
+        HANDLE h[2];
+        h[0] = m_abortHandle;
+        h[1] = request->m_completeEvent;
+
+        DWORD dRet = WaitForMultipleObjects(2, h, FALSE, INFINITE);
+        if (dRet == WAIT_OBJECT_0)
+        {
+            /* we should exit */
+            offset = -1;
+            break;
+        }
+        else
+        {
+            LogAssert(dRet == WAIT_OBJECT_0+1);
+        }
+
+        RChannelBuffer* buffer = request->m_buffer;
+        request->m_buffer = NULL;
+        LogAssert(buffer != NULL);
+        deliverSlot = (deliverSlot + 1) % m_numberOfRangeThreads;
+        --outstanding;
+
+        LogAssert(request->m_nextOffset < 0 ||
+                  request->m_nextOffset == request->m_endOffset);
+        offset = request->m_nextOffset;
+
+        SendBuffer(buffer, true);
+
+        if (offset >= 0)
+        {
+            AutoCriticalSection acs(&m_cs);
+
+            m_processedLength = offset - offsetStart;
+        }
+
+        if (offset == offsetEnd && !scannedFinal)
+        {
+            offsetEnd = AdjustEndOffset(reader, fileName, offsetEnd);
+            if (offsetEnd < 0)
+            {
+                /* there was a read error: AdjustEndOffset already
+                   sent the termination item */
+                offset = -1;
+                break;
+            }
+
+            scannedFinal = true;
+        }
+    }
 
     return offset;
 }
@@ -644,6 +1062,29 @@ void RChannelBufferHdfsReader::ReadThread()
 
     Hdfs::ReaderAccessor ra(reader);
 
+    UInt32 readStreams = GetNumberOfReadStreams();
+    if (readStreams > 1 &&
+        offsetEnd - offset > s_minBuffersForParallelRead * s_readBufferSize)
+    {
+        StartRangeThreads(schemeAndAuthority.GetString(),
+                          filePath.GetString());
+        offset = ReadRangesInParallel(reader, m_uri.GetString(),
+                                      offset, offsetStart, offsetEnd,
+                                      scannedFinal);
+        StopRangeThreads();
+
+        ra.Discard();
+
+        if (offset >= 0)
+        {
+            RChannelBuffer* buffer = MakeEndOfStreamBuffer(this);
+            SendBuffer(buffer, true);
+        }
+
+        ia.Discard();
+        return;
+    }
+
     while (offset >=0 && offset < offsetEnd)
     {
         HANDLE h[2];
@@ -904,6 +1345,19 @@ RChannelBufferHdfsWriter::RChannelBufferHdfsWriter(const char* uri)
     m_queueHandle = INVALID_HANDLE_VALUE;
     m_writeThread = INVALID_HANDLE_VALUE;
     m_queueLength = 0;
+    m_processedLength = 0;
+
+    /* called here rather than from Start since writers are
+       constructed sequentially */
+    m_maxBytesInFlight = GetMaxWriteBytesInFlight();
+    m_bytesInFlight = 0;
+    m_peakBytesInFlight = 0;
+    m_entriesInFlight = 0;
+    m_stalled = false;
+    m_stallStart = DrTimeStamp_Never;
+    m_stallTime = DrTimeInterval_Zero;
+    m_numberOfStalls = 0;
+    m_uploadTime = DrTimeInterval_Zero;
 
     /* it's important to initialize here since these are called
        sequentially so there's no race on the hdfs
@@ -986,6 +1440,13 @@ void RChannelBufferHdfsWriter::Start()
         AutoCriticalSection acs(&m_cs);
 
         m_processedLength = 0;
+        LogAssert(m_entriesInFlight == 0);
+        LogAssert(m_bytesInFlight == 0);
+        m_peakBytesInFlight = 0;
+        m_stalled = false;
+        m_stallTime = DrTimeInterval_Zero;
+        m_numberOfStalls = 0;
+        m_uploadTime = DrTimeInterval_Zero;
     }
 
     m_queueHandle = ::CreateEvent(NULL, TRUE, FALSE, NULL);
@@ -1139,14 +1600,21 @@ void RChannelBufferHdfsWriter::WriteThread()
                         GetDataAddress(0, &dataSize, NULL);
                     Size_t dataToWrite = entry->m_buffer->GetAvailableSize();
                     LogAssert(dataToWrite <= dataSize);
+                    LogAssert(dataToWrite == entry->m_size);
+
+                    DrTimeStamp uploadStart = DrGetCurrentTimeStamp();
                     bool ret =
                         wa.WriteBlock((unsigned char *)dataAddr, (long) dataToWrite,
                                       entry->m_flush);
+                    DrTimeInterval uploadTime =
+                        DrGetElapsedTime(uploadStart, DrGetCurrentTimeStamp());
+
                     if (ret)
                     {
                         AutoCriticalSection acs(&m_cs);
 
                         m_processedLength += dataToWrite;
+                        m_uploadTime += uploadTime;
                     }
                     else
                     {
@@ -1204,10 +1672,15 @@ void RChannelBufferHdfsWriter::WriteThread()
                 LogAssert(status != RChannelItem_Data);
             }
 
-            entry->m_handler->ProcessWriteCompleted(status);
-            delete entry;
+            RChannelBufferWriterHandler* handler = entry->m_handler;
+            RetireEntry(entry);
             entry = NULL;
 
+            /* the handler may resume marshaling as a result of this
+               call, so the accounting above must already be up to
+               date */
+            handler->ProcessWriteCompleted(status);
+
             if (status == RChannelItem_Data)
             {
                 /* we haven't had an error or termination, so see if
@@ -1243,6 +1716,30 @@ void RChannelBufferHdfsWriter::WriteThread()
     }
 }
 
+//
+// Take a finished entry out of the in-flight accounting and free it
+//
+void RChannelBufferHdfsWriter::RetireEntry(WriteEntry* entry)
+{
+    {
+        AutoCriticalSection acs(&m_cs);
+
+        LogAssert(m_entriesInFlight > 0);
+        LogAssert(m_bytesInFlight >= entry->m_size);
+        --m_entriesInFlight;
+        m_bytesInFlight -= entry->m_size;
+
+        if (m_stalled && m_entriesInFlight <= s_writerUnblockEntries)
+        {
+            m_stallTime += DrGetElapsedTime(m_stallStart,
+                                            DrGetCurrentTimeStamp());
+            m_stalled = false;
+        }
+    }
+
+    delete entry;
+}
+
 bool RChannelBufferHdfsWriter::AddToQueue(WriteEntry* entry)
 {
     {
@@ -1253,6 +1750,13 @@ bool RChannelBufferHdfsWriter::AddToQueue(WriteEntry* entry)
         m_queue.InsertAsTail(m_queue.CastIn(entry));
         ++m_queueLength;
 
+        ++m_entriesInFlight;
+        m_bytesInFlight += entry->m_size;
+        if (m_bytesInFlight > m_peakBytesInFlight)
+        {
+            m_peakBytesInFlight = m_bytesInFlight;
+        }
+
         if (wasEmpty)
         {
             LogAssert(m_queueLength == 1);
@@ -1260,8 +1764,18 @@ bool RChannelBufferHdfsWriter::AddToQueue(WriteEntry* entry)
             LogAssert(bRet != 0);
         }
 
-        /* should block if the queue gets too deep */
-        return (m_queueLength > s_maxBuffersToBlockWriter);
+        /* the marshaler should block once the uploader falls too far
+           behind; it is released from ProcessWriteCompleted as
+           entries drain */
+        bool shouldBlock = (m_bytesInFlight > m_maxBytesInFlight);
+        if (shouldBlock && !m_stalled)
+        {
+            m_stalled = true;
+            m_stallStart = DrGetCurrentTimeStamp();
+            ++m_numberOfStalls;
+        }
+
+        return shouldBlock;
     }
 }
 
@@ -1272,6 +1786,7 @@ WriteBuffer(DryadFixedMemoryBuffer* buffer,
 {
     WriteEntry* entry = new WriteEntry;
     entry->m_buffer.Attach(buffer);
+    entry->m_size = buffer->GetAvailableSize();
     entry->m_flush = flushAfter;
     entry->m_type = RChannelItem_Data;
     entry->m_handler = handler;
@@ -1291,6 +1806,7 @@ WriteTermination(RChannelItemType reasonCode,
 {
     WriteEntry* entry = new WriteEntry;
     /* NULL entry->m_buffer */
+    entry->m_size = 0;
     entry->m_flush = false;
     entry->m_type = reasonCode;
     entry->m_handler = handler;
@@ -1298,12 +1814,50 @@ WriteTermination(RChannelItemType reasonCode,
     AddToQueue(entry);
 }
 
+//
+// Report the upload and stall counters in the channel metadata
+// alongside the length, replacing the values from any earlier status.
+// A stall still in progress is counted up to now
+//
 void RChannelBufferHdfsWriter::FillInStatus(DryadChannelDescription* status)
 {
     AutoCriticalSection acs(&m_cs);
 
     status->SetChannelTotalLength(0);
     status->SetChannelProcessedLength(m_processedLength);
+
+    DryadMetaDataRef metaData = status->GetChannelMetaData();
+    if (metaData == NULL)
+    {
+        DryadMetaData::Create(&metaData);
+        status->SetChannelMetaData(metaData, false);
+    }
+
+    DrTimeInterval stallTime = m_stallTime;
+    if (m_stalled)
+    {
+        stallTime += DrGetElapsedTime(m_stallStart, DrGetCurrentTimeStamp());
+    }
+
+    UInt16 tags[] = {
+        Prop_Dryad_ChannelUploadTime,
+        Prop_Dryad_ChannelPeakBytesInFlight,
+        Prop_Dryad_ChannelStallCount,
+        Prop_Dryad_ChannelStallTime
+    };
+    for (size_t i=0; i<sizeof(tags)/sizeof(tags[0]); ++i)
+    {
+        DryadMTag* oldTag = metaData->LookUpTag(tags[i]);
+        if (oldTag != NULL)
+        {
+            metaData->Remove(oldTag);
+        }
+    }
+
+    metaData->AppendTimeInterval(Prop_Dryad_ChannelUploadTime, m_uploadTime, false);
+    metaData->AppendUInt64(Prop_Dryad_ChannelPeakBytesInFlight, m_peakBytesInFlight, false);
+    metaData->AppendUInt32(Prop_Dryad_ChannelStallCount, m_numberOfStalls, false);
+    metaData->AppendTimeInterval(Prop_Dryad_ChannelStallTime, stallTime, false);
 }
 
 void RChannelBufferHdfsWriter::Drain(RChannelItemRef* pReturnItem)
@@ -1316,6 +1870,18 @@ void RChannelBufferHdfsWriter::Drain(RChannelItemRef* pReturnItem)
     LogAssert(m_queue.IsEmpty());
     LogAssert(m_queueLength == 0);
 
+    {
+        AutoCriticalSection acs(&m_cs);
+
+        LogAssert(m_entriesInFlight == 0);
+        DrLogI("Hdfs writer %s wrote %I64u bytes: upload time %u ms, "
+               "peak in flight %I64u bytes, %u stalls totalling %u ms",
+               m_uri.GetString(), m_processedLength,
+               DrGetTimerMsFromInterval(m_uploadTime),
+               m_peakBytesInFlight, m_numberOfStalls,
+               DrGetTimerMsFromInterval(m_stallTime));
+    }
+
     /* and that's it, nothing more to do */
     LogAssert(m_completionItem != NULL);
     *pReturnItem = m_completionItem;
@@ -59,7 +59,19 @@ private:
                               Int64 startOffset, Int64 endOffset,
                               RChannelBuffer** pErrorBuffer) = 0;
 
+    /* one range being fetched by a range thread. Ranges are handed
+       out in stream order and collected in the same order */
+    struct RangeRequest
+    {
+        Int64                  m_offset;
+        Int64                  m_endOffset;
+        Int64                  m_nextOffset;
+        RChannelBuffer*        m_buffer;
+        HANDLE                 m_completeEvent;
+    };
+
     static unsigned __stdcall ThreadFunc(void* a);
+    static unsigned __stdcall RangeThreadFunc(void* a);
     void SendBuffer(RChannelBuffer* buffer, bool getSemaphore);
     Int64 AdjustStartOffset(Hdfs::Reader* reader,
                             const char* fileName,
@@ -72,6 +84,22 @@ private:
                          const char* fileName,
                          Int64 offset,
                          Int64 endOffset);
+    Int64 ReadRange(Hdfs::ReaderAccessor& ra,
+                    const char* fileName,
+                    Int64 offset,
+                    Int64 endOffset,
+                    RChannelBuffer** pBuffer);
+    Int64 ReadRangesInParallel(Hdfs::Reader* reader,
+                               const char* fileName,
+                               Int64 offset,
+                               Int64 offsetStart,
+                               Int64 offsetEnd,
+                               bool scannedFinal);
+    void StartRangeThreads(const char* schemeAndAuthority,
+                           const char* filePath);
+    void StopRangeThreads();
+    void QueueRange(UInt32 slot);
+    void RangeThread();
     void ReadThread();
 
     DrStr64                        m_uri;
@@ -83,6 +111,19 @@ private:
     UInt64                         m_totalLength;
     UInt64                         m_processedLength;
     UInt32                         m_buffersOut;
+
+    /* state for reading a large partition over several streams */
+    DrStr64                        m_rangeSchemeAndAuthority;
+    DrStr64                        m_rangeFilePath;
+    UInt32                         m_numberOfRangeThreads;
+    HANDLE*                        m_rangeThread;
+    RangeRequest*                  m_rangeRequest;
+    UInt32*                        m_rangeQueue;
+    UInt32                         m_rangeQueueHead;
+    UInt32                         m_rangeQueueLength;
+    HANDLE                         m_rangeSemaphore;
+    HANDLE                         m_rangeShutdownEvent;
+
     CRITSEC                        m_cs;
 };
 
@@ -138,6 +179,7 @@ private:
     struct WriteEntry
     {
         DrRef<DryadFixedMemoryBuffer>  m_buffer;
+        Size_t                         m_size;
         bool                           m_flush;
         RChannelItemType               m_type;
         RChannelBufferWriterHandler*   m_handler;
@@ -148,6 +190,7 @@ private:
     void WriteThread();
     bool Open(Hdfs::Instance** pInstance, Hdfs::Writer** pWriter);
     bool AddToQueue(WriteEntry* entry);
+    void RetireEntry(WriteEntry* entry);
 
     DrStr64                        m_user;
     DrStr64                        m_uri;
@@ -157,5 +200,18 @@ private:
     HANDLE                         m_writeThread;
     RChannelItemRef                m_completionItem;
     UInt64                         m_processedLength;
+
+    /* pipeline accounting: entries and bytes queued or being
+       uploaded, and how long the marshaler has been held back
+       waiting for the uploader */
+    UInt64                         m_maxBytesInFlight;
+    UInt64                         m_bytesInFlight;
+    UInt64                         m_peakBytesInFlight;
+    UInt32                         m_entriesInFlight;
+    bool                           m_stalled;
+    DrTimeStamp                    m_stallStart;
+    DrTimeInterval                 m_stallTime;
+    UInt32                         m_numberOfStalls;
+    DrTimeInterval                 m_uploadTime;
     CRITSEC                        m_cs;
 };
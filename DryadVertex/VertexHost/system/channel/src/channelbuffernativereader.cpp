@@ -30,6 +30,71 @@ limitations under the License.
 
 #pragma unmanaged
 
+//
+// The prefetch window of an adaptive reader may grow to this multiple
+// of its initial size, subject to the process-wide budget
+//
+static const UInt32 s_maxPrefetchGrowthFactor = 8;
+
+//
+// Number of consecutive dispatches that find every buffer in the window
+// held by the parser before the window is shrunk
+//
+static const UInt32 s_prefetchShrinkThreshold = 4;
+
+//
+// Process-wide budget for read-ahead buffers held beyond each reader's
+// initial prefetch count. Can be overridden with
+// DRYAD_READ_PREFETCH_BUDGET_MB
+//
+static const UInt64 s_defaultPrefetchBudget = 256*1024*1024;
+static CRITSEC s_prefetchBudgetCS;
+static bool s_prefetchBudgetInitialized = false;
+static UInt64 s_prefetchBudget = 0;
+static UInt64 s_prefetchBytesReserved = 0;
+
+static bool ReservePrefetchBytes(UInt64 numBytes)
+{
+    AutoCriticalSection acs(&s_prefetchBudgetCS);
+
+    if (!s_prefetchBudgetInitialized)
+    {
+        s_prefetchBudget = s_defaultPrefetchBudget;
+
+        char budgetString[32];
+        DWORD ret = ::GetEnvironmentVariableA("DRYAD_READ_PREFETCH_BUDGET_MB",
+                                              budgetString,
+                                              sizeof(budgetString));
+        if (ret > 0 && ret < sizeof(budgetString))
+        {
+            UInt32 budgetMB;
+            if (DrStringToUInt32(budgetString, &budgetMB) == DrError_OK)
+            {
+                s_prefetchBudget = (UInt64) budgetMB * 1024 * 1024;
+            }
+        }
+
+        DrLogI("Read prefetch budget %I64u bytes", s_prefetchBudget);
+        s_prefetchBudgetInitialized = true;
+    }
+
+    if (s_prefetchBytesReserved + numBytes > s_prefetchBudget)
+    {
+        return false;
+    }
+
+    s_prefetchBytesReserved += numBytes;
+    return true;
+}
+
+static void ReleasePrefetchBytes(UInt64 numBytes)
+{
+    AutoCriticalSection acs(&s_prefetchBudgetCS);
+
+    LogAssert(s_prefetchBytesReserved >= numBytes);
+    s_prefetchBytesReserved -= numBytes;
+}
+
 
 //
 // Create a new generic read handle
@@ -90,6 +155,15 @@ DryadAlignedReadBlock* RChannelBufferReaderNative::ReadHandler::GetBlock()
     return m_block;
 }
 
+//
+// Return the block whose contents are sent to the parser
+//
+DryadLockedMemoryBuffer* RChannelBufferReaderNative::ReadHandler::
+    GetDataBlock()
+{
+    return GetBlock();
+}
+
 void RChannelBufferReaderNative::ReadHandler::
     SetChannelBuffer(RChannelBuffer* buffer)
 {
@@ -133,6 +207,10 @@ RChannelBufferReaderNative::
                                bool supportsLazyOpen)
 {
     m_prefetchBuffers = prefetchBuffers;
+    m_minPrefetchBuffers = prefetchBuffers;
+    m_maxPrefetchBuffers = prefetchBuffers;
+    m_prefetchBufferSize = 0;
+    m_laggingDispatches = 0;
     m_port = port;
     m_workQueue = workQueue;
     m_openThrottler = openThrottler;
@@ -628,7 +706,7 @@ void RChannelBufferReaderNative::DispatchBuffer(ReadHandler* handler,
                         //
                         m_nextStreamOffsetToProcess +=
                             (UInt64)
-                            nextHandler->GetBlock()->GetAvailableSize();
+                            nextHandler->GetDataBlock()->GetAvailableSize();
 
                         if (nextHandler->IsLastDataBuffer())
                         {
@@ -694,6 +772,25 @@ void RChannelBufferReaderNative::DispatchBuffer(ReadHandler* handler,
                 performedClose = FinishUsingFile();
             }
 
+            //
+            // If every buffer in the window is sitting with the parser and
+            // this keeps happening, the parser is the bottleneck and the
+            // read-ahead is wasted memory
+            //
+            if (m_outstandingBuffers >= m_prefetchBuffers)
+            {
+                ++m_laggingDispatches;
+                if (m_laggingDispatches >= s_prefetchShrinkThreshold)
+                {
+                    ShrinkPrefetchWindow();
+                    m_laggingDispatches = 0;
+                }
+            }
+            else
+            {
+                m_laggingDispatches = 0;
+            }
+
             UInt32 buffersInFlight =
                 m_outstandingBuffers + m_outstandingHandlers;
             if (makeNewHandler)
@@ -1056,6 +1153,8 @@ void RChannelBufferReaderNative::DrainNativeReader()
         m_handlerReturnEvent = INVALID_HANDLE_VALUE;
         m_handler = NULL;
 
+        ResetPrefetchWindow();
+
         LogAssert(m_state == S_Stopping);
         LogAssert(m_openState == OS_OpenError ||
                   m_openState == OS_Stopped);
@@ -1067,7 +1166,71 @@ void RChannelBufferReaderNative::DrainNativeReader()
 
 void RChannelBufferReaderNative::SetPrefetchBufferCount(UInt32 numberOfBuffers)
 {
+    //
+    // An explicit count turns off adaptation
+    //
+    ResetPrefetchWindow();
     m_prefetchBuffers = numberOfBuffers;
+    m_minPrefetchBuffers = numberOfBuffers;
+    m_maxPrefetchBuffers = numberOfBuffers;
+    m_prefetchBufferSize = 0;
+}
+
+void RChannelBufferReaderNative::EnableAdaptivePrefetch(UInt32 bufferSize)
+{
+    LogAssert(m_prefetchBuffers == m_minPrefetchBuffers);
+    m_prefetchBufferSize = bufferSize;
+    m_maxPrefetchBuffers = m_minPrefetchBuffers * s_maxPrefetchGrowthFactor;
+}
+
+//
+// Add a buffer to the prefetch window if the process budget allows it
+//
+/* called with baseDR held */
+void RChannelBufferReaderNative::GrowPrefetchWindow()
+{
+    if (m_prefetchBufferSize == 0 ||
+        m_prefetchBuffers >= m_maxPrefetchBuffers)
+    {
+        return;
+    }
+
+    if (ReservePrefetchBytes(m_prefetchBufferSize))
+    {
+        ++m_prefetchBuffers;
+        DrLogD("Grew read prefetch window to %u buffers", m_prefetchBuffers);
+    }
+}
+
+//
+// Remove a buffer from the prefetch window. Reads already in flight
+// are unaffected; fewer new reads are issued as buffers come back
+//
+/* called with baseDR held */
+void RChannelBufferReaderNative::ShrinkPrefetchWindow()
+{
+    if (m_prefetchBuffers > m_minPrefetchBuffers)
+    {
+        --m_prefetchBuffers;
+        ReleasePrefetchBytes(m_prefetchBufferSize);
+        DrLogD("Shrank read prefetch window to %u buffers", m_prefetchBuffers);
+    }
+}
+
+//
+// Return the window to its initial size and give back any budget held
+//
+/* called with baseDR held */
+void RChannelBufferReaderNative::ResetPrefetchWindow()
+{
+    LogAssert(m_prefetchBuffers >= m_minPrefetchBuffers);
+    UInt32 extraBuffers = m_prefetchBuffers - m_minPrefetchBuffers;
+    if (extraBuffers > 0)
+    {
+        ReleasePrefetchBytes((UInt64) extraBuffers * m_prefetchBufferSize);
+    }
+    m_prefetchBuffers = m_minPrefetchBuffers;
+    m_laggingDispatches = 0;
 }
 
 UInt32 RChannelBufferReaderNative::GetPrefetchBufferCount()
@@ -1197,6 +1360,20 @@ void RChannelBufferReaderNative::ReturnBuffer(RChannelBuffer* buffer)
         }
         else
         {
+            //
+            // If the parser has handed back everything it had while reads
+            // are still outstanding at the disk, it is starved: widen the
+            // window so more reads are in flight next time
+            //
+            if (m_state == S_Running &&
+                m_fetching == true &&
+                m_outstandingBuffers == 0 &&
+                m_outstandingHandlers > 0 &&
+                m_reorderMap.empty())
+            {
+                GrowPrefetchWindow();
+            }
+
             //
             // If not done, enumerate buffers still being processed and create a read handle if
             // number of buffers currently working is less than number of prefetch buffers allowed
@@ -1393,6 +1570,145 @@ void RChannelBufferReaderNativeFile::FileReadHandler::
 }
 
 
+//
+// Create a handler for a mapped file. No block is allocated: the data
+// is a view of the mapped file made when the read is queued
+//
+RChannelBufferReaderNativeFile::MappedReadHandler::
+    MappedReadHandler(HANDLE mappingHandle,
+                      UInt64 fileLength,
+                      bool detailsPresent,
+                      UInt64 streamOffset,
+                      UInt32 dataSize,
+                      RChannelBufferReaderNativeFile* parent) :
+        RChannelBufferReaderNative::ReadHandler(streamOffset, streamOffset,
+                                                0, 0)
+{
+    m_parent = parent;
+    m_mappingHandle = mappingHandle;
+    m_fileLength = fileLength;
+    m_dataSize = dataSize;
+    m_detailsPresent = detailsPresent;
+    m_view = NULL;
+    m_mapError = DrError_OK;
+}
+
+RChannelBufferReaderNativeFile::MappedReadHandler::~MappedReadHandler()
+{
+    if (m_view != NULL)
+    {
+        m_view->DecRef();
+    }
+}
+
+void RChannelBufferReaderNativeFile::MappedReadHandler::
+    SetMapping(HANDLE h, UInt64 fileLength)
+{
+    m_mappingHandle = h;
+    m_fileLength = fileLength;
+    LogAssert(m_detailsPresent == false);
+    m_detailsPresent = true;
+}
+
+void* RChannelBufferReaderNativeFile::MappedReadHandler::GetData()
+{
+    LogAssert(m_view != NULL);
+    return m_view->GetData();
+}
+
+DryadLockedMemoryBuffer* RChannelBufferReaderNativeFile::MappedReadHandler::
+    GetDataBlock()
+{
+    LogAssert(m_view != NULL);
+    return m_view;
+}
+
+//
+// Map the next section of the file and post the completion to the
+// port, so the buffer is dispatched on a port thread exactly as an
+// overlapped read would be. A handler past the end of the file (or
+// on a file that couldn't be opened) completes with zero bytes
+//
+void RChannelBufferReaderNativeFile::MappedReadHandler::
+    QueueRead(DryadNativePort* port)
+{
+    if (m_detailsPresent == false)
+    {
+        bool waitForThrottledOpen = m_parent->EnsureOpenForRead(this);
+        if (waitForThrottledOpen)
+        {
+            return;
+        }
+        else
+        {
+            LogAssert(m_detailsPresent);
+        }
+    }
+
+    UInt32 numBytes = 0;
+    UInt64 streamOffset = GetStreamOffset();
+
+    if (m_mappingHandle != NULL && streamOffset < m_fileLength)
+    {
+        UInt64 remaining = m_fileLength - streamOffset;
+        numBytes = (remaining < (UInt64) m_dataSize) ?
+            (UInt32) remaining : m_dataSize;
+
+        m_view = new DryadMappedReadBlock(m_mappingHandle,
+                                          streamOffset, numBytes);
+        if (!m_view->IsMapped())
+        {
+            m_mapError = DrGetLastError();
+            m_view->DecRef();
+            m_view = NULL;
+            numBytes = 0;
+        }
+    }
+
+    port->QueueCompletion(this, numBytes);
+}
+
+void RChannelBufferReaderNativeFile::MappedReadHandler::
+    ProcessIO(DrError /*unused cse*/, UInt32 numBytes)
+{
+    bool makeNewHandler = false;
+
+    if (m_mapError != DrError_OK)
+    {
+        LogAssert(numBytes == 0);
+        SetChannelBuffer(m_parent->
+                         MakeErrorBuffer(GetStreamOffset(), m_mapError));
+    }
+    else if (m_view == NULL)
+    {
+        //
+        // Nothing was mapped: this is the end of the file, or the file
+        // failed to open
+        //
+        LogAssert(numBytes == 0);
+        SetChannelBuffer(m_parent->MakeFinalBuffer(GetStreamOffset()));
+    }
+    else
+    {
+        LogAssert(numBytes == m_view->GetAvailableSize());
+
+        SetChannelBuffer(m_parent->
+                         MakeDataBuffer(GetStreamOffset(), m_view));
+
+        if (GetStreamOffset() + numBytes < m_fileLength)
+        {
+            makeNewHandler = true;
+        }
+        else
+        {
+            SignalLastDataBuffer();
+        }
+    }
+
+    m_parent->DispatchBuffer(this, makeNewHandler, NULL);
+}
+
+
 RChannelBufferReaderNativeFile::
     RChannelBufferReaderNativeFile(UInt32 bufferSize,
                                    size_t bufferAlignment,
@@ -1412,11 +1728,14 @@ RChannelBufferReaderNativeFile::
     m_fileNameW = new wchar_t[MAX_PATH];
     m_wideFileName = false;
     m_fileIsPipe = false;
+    m_mappedRead = false;
+    m_mappingHandle = NULL;
 }
 
 RChannelBufferReaderNativeFile::~RChannelBufferReaderNativeFile()
 {
     LogAssert(m_fileHandle == INVALID_HANDLE_VALUE);
+    LogAssert(m_mappingHandle == NULL);
     delete [] m_fileNameA;
     delete [] m_fileNameW;
 }
@@ -1438,6 +1757,14 @@ bool RChannelBufferReaderNativeFile::LazyOpenFile()
     {
         flags = FILE_FLAG_OVERLAPPED;
     }
+    else if (m_mappedRead)
+    {
+        //
+        // Mapped files are read through the cache manager, not with
+        // overlapped reads on the port
+        //
+        flags = FILE_FLAG_SEQUENTIAL_SCAN;
+    }
     else
     {
         flags = FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED;
@@ -1520,13 +1847,44 @@ bool RChannelBufferReaderNativeFile::LazyOpenFile()
 //             "Filename %s (%swide-char)", m_fileNameA,
 //             m_wideFileName ? "" : "not ");
 
-            m_fileHandle = h;
-
             LARGE_INTEGER fileSize;
-            BOOL bRet = ::GetFileSizeEx(m_fileHandle, &fileSize);
+            BOOL bRet = ::GetFileSizeEx(h, &fileSize);
             LogAssert(bRet != 0);
 
-            AssociateHandleWithPort(h);
+            if (m_mappedRead)
+            {
+                //
+                // An empty file can't be mapped, and doesn't need to be:
+                // every handler will complete at end of stream
+                //
+                if (fileSize.QuadPart > 0)
+                {
+                    m_mappingHandle = ::CreateFileMappingA(h, NULL,
+                                                           PAGE_READONLY,
+                                                           0, 0, NULL);
+                    if (m_mappingHandle == NULL)
+                    {
+                        DrError err = DrGetLastError();
+                        DrLogI( "Native file mapping failed. Filename %s", m_fileNameA);
+
+                        bRet = ::CloseHandle(h);
+                        LogAssert(bRet != 0);
+
+                        DrStr64 description;
+                        description.SetF("Can't map native file '%s' to read",
+                                         m_fileNameA);
+                        m_openErrorBuffer.Attach(MakeOpenErrorBuffer(err, description));
+
+                        return false;
+                    }
+                }
+            }
+            else
+            {
+                AssociateHandleWithPort(h);
+            }
+
+            m_fileHandle = h;
             SetTotalLength(fileSize.QuadPart);
 
             return true;
@@ -1545,11 +1903,31 @@ void RChannelBufferReaderNativeFile::EagerCloseFile()
     DrLogI( "Closing native file. Name %s (%swide-char)", m_fileNameA,
         m_wideFileName ? "" : "not ");
 
-    BOOL bRet = ::CloseHandle(m_fileHandle);
+    BOOL bRet;
+    if (m_mappingHandle != NULL)
+    {
+        //
+        // views that are still held by the parser keep the section
+        // alive after the mapping handle is closed
+        //
+        bRet = ::CloseHandle(m_mappingHandle);
+        LogAssert(bRet != 0);
+        m_mappingHandle = NULL;
+    }
+
+    bRet = ::CloseHandle(m_fileHandle);
     LogAssert(bRet != 0);
     m_fileHandle = INVALID_HANDLE_VALUE;
 }
 
+void RChannelBufferReaderNativeFile::SetMappedRead(bool mappedRead)
+{
+    AutoCriticalSection acs(GetBaseDR());
+
+    LogAssert(m_fileHandle == INVALID_HANDLE_VALUE);
+    m_mappedRead = mappedRead;
+}
+
 bool RChannelBufferReaderNativeFile::OpenA(const char* pathName)
 {
     {
@@ -1581,6 +1959,28 @@ bool RChannelBufferReaderNativeFile::OpenA(const char* pathName)
                 m_bufferAlignment = bufferAlignment;
                 DrLogI("Reduced input buffer size for pipe. Size now %u", m_bufferSize);
             }
+
+            m_mappedRead = false;
+        }
+
+        if (m_mappedRead)
+        {
+            //
+            // Views must start on an allocation granularity boundary,
+            // so round the buffer size up to a multiple of it
+            //
+            SYSTEM_INFO sysInfo;
+            ::GetSystemInfo(&sysInfo);
+            UInt32 granularity = sysInfo.dwAllocationGranularity;
+            m_bufferSize =
+                ((m_bufferSize + granularity - 1) / granularity) * granularity;
+            DrLogI("Using mapped reads for native file %s. Buffer size %u",
+                   m_fileNameA, m_bufferSize);
+        }
+
+        if (!m_fileIsPipe)
+        {
+            EnableAdaptivePrefetch(m_bufferSize);
         }
 
         OpenNativeReader();
@@ -1704,12 +2104,26 @@ RChannelBufferReaderNative::ReadHandler*
         //
         // Create a read handler 
         //
-        handler = new FileReadHandler(m_fileHandle,
-                                      lazyOpenDone,
-                                      m_nextOffsetToRequest,
-                                      m_bufferSize,
-                                      m_bufferAlignment,
-                                      this);
+        if (m_mappedRead)
+        {
+            UInt64 fileLength;
+            GetTotalLength(&fileLength);
+            handler = new MappedReadHandler(m_mappingHandle,
+                                            fileLength,
+                                            lazyOpenDone,
+                                            m_nextOffsetToRequest,
+                                            m_bufferSize,
+                                            this);
+        }
+        else
+        {
+            handler = new FileReadHandler(m_fileHandle,
+                                          lazyOpenDone,
+                                          m_nextOffsetToRequest,
+                                          m_bufferSize,
+                                          m_bufferAlignment,
+                                          this);
+        }
         m_nextOffsetToRequest += m_bufferSize;
     }
 
@@ -1739,6 +2153,17 @@ RChannelBuffer* RChannelBufferReaderNativeFile::
 
 void RChannelBufferReaderNativeFile::FillInOpenedDetails(ReadHandler* h)
 {
+    if (m_mappedRead)
+    {
+        MappedReadHandler* mappedHandler =
+            dynamic_cast<MappedReadHandler*>(h);
+
+        UInt64 fileLength;
+        GetTotalLength(&fileLength);
+        mappedHandler->SetMapping(m_mappingHandle, fileLength);
+        return;
+    }
+
     FileReadHandler* handler = dynamic_cast<FileReadHandler*>(h);
 
     if (m_openErrorBuffer == NULL)
@@ -44,6 +44,7 @@ public:
         UInt64 GetStreamOffset();
         void* GetData();
         DryadAlignedReadBlock* GetBlock();
+        virtual DryadLockedMemoryBuffer* GetDataBlock();
         RChannelBuffer* TransferChannelBuffer();
         bool IsLastDataBuffer();
 
@@ -86,6 +87,13 @@ protected:
     void SetPrefetchBufferCount(UInt32 numberOfBuffers);
     UInt32 GetPrefetchBufferCount();
 
+    /* let the prefetch window grow past the count set at construction
+       when the parser is starved for data, and shrink back when the
+       parser falls behind. bufferSize is charged against a
+       process-wide read-ahead budget for each buffer above the
+       initial count */
+    void EnableAdaptivePrefetch(UInt32 bufferSize);
+
     void AssociateHandleWithPort(HANDLE h);
     void SetTotalLength(UInt64 totalLength);
     bool GetTotalLength(UInt64* pLen);
@@ -138,8 +146,19 @@ private:
     bool FinishUsingFile();
     virtual ReadHandler* GetNextReadHandler(bool lazyOpenDone) = 0;
 
+    /* called with baseDR held */
+    void GrowPrefetchWindow();
+    /* called with baseDR held */
+    void ShrinkPrefetchWindow();
+    /* called with baseDR held */
+    void ResetPrefetchWindow();
+
 
     UInt32                                   m_prefetchBuffers;
+    UInt32                                   m_minPrefetchBuffers;
+    UInt32                                   m_maxPrefetchBuffers;
+    UInt32                                   m_prefetchBufferSize;
+    UInt32                                   m_laggingDispatches;
 
     RChannelBufferReaderHandler*             m_handler;
     DryadNativePort*                         m_port;
@@ -193,6 +212,35 @@ public:
         RChannelBufferReaderNativeFile*    m_parent;
     };
 
+    /* a handler that hands out a read-only view of a memory-mapped
+       file rather than copying the data into an aligned block */
+    class MappedReadHandler : public RChannelBufferReaderNative::ReadHandler
+    {
+    public:
+        MappedReadHandler(HANDLE mappingHandle,
+                          UInt64 fileLength,
+                          bool detailsPresent,
+                          UInt64 streamOffset,
+                          UInt32 dataSize,
+                          RChannelBufferReaderNativeFile* parent);
+        ~MappedReadHandler();
+
+        void ProcessIO(DrError cse, UInt32 numBytes);
+        void SetMapping(HANDLE h, UInt64 fileLength);
+        void* GetData();
+        DryadLockedMemoryBuffer* GetDataBlock();
+        void QueueRead(DryadNativePort* port);
+
+    private:
+        HANDLE                             m_mappingHandle;
+        UInt64                             m_fileLength;
+        UInt32                             m_dataSize;
+        bool                               m_detailsPresent;
+        DryadMappedReadBlock*              m_view;
+        DrError                            m_mapError;
+        RChannelBufferReaderNativeFile*    m_parent;
+    };
+
     RChannelBufferReaderNativeFile(UInt32 bufferSize,
                                    size_t bufferAlignment,
                                    UInt32 prefetchBuffers,
@@ -203,6 +251,11 @@ public:
 
     virtual void FillInStatus(DryadChannelDescription* status);
 
+    /* must be called before OpenA. Files that are read mapped hand
+       the parser views of the mapped pages instead of copies; named
+       pipes always use overlapped reads */
+    void SetMappedRead(bool mappedRead);
+
     bool OpenA(const char* pathName);
 //JC    bool OpenW(const wchar_t* pathName);
 
@@ -232,9 +285,12 @@ private:
     char*                        m_fileNameA;
     size_t                       m_fileNameLength;
     bool                         m_fileIsPipe;
+    bool                         m_mappedRead;
+    HANDLE                       m_mappingHandle;
     wchar_t*                     m_fileNameW;
     bool                         m_wideFileName;
     DrRef<RChannelBuffer>        m_openErrorBuffer;
 
     friend class FileReadHandler;
+    friend class MappedReadHandler;
 };
@@ -750,19 +750,28 @@ bool RChannelBufferWriterNative::
     }
     else
     {
-        DrBListEntry* listEntry = processList.GetHead();
-        while (listEntry != NULL)
-        {
-            WriteHandler* processHandler = processList.CastOut(listEntry);
-            listEntry = processList.GetNext(listEntry);
-            processList.Remove(processList.CastIn(processHandler));
-            processHandler->QueueWrite(m_port);
-        }
+        QueueWriteList(&processList);
     }
 
     return shouldBlock;
 }
 
+//
+// Send each handler in the list to the port in order. Derived classes
+// may combine handlers into fewer I/Os
+//
+void RChannelBufferWriterNative::QueueWriteList(WriteHandlerList* writeList)
+{
+    DrBListEntry* listEntry = writeList->GetHead();
+    while (listEntry != NULL)
+    {
+        WriteHandler* processHandler = writeList->CastOut(listEntry);
+        listEntry = writeList->GetNext(listEntry);
+        writeList->Remove(writeList->CastIn(processHandler));
+        processHandler->QueueWrite(m_port);
+    }
+}
+
 void RChannelBufferWriterNative::
     WriteTermination(RChannelItemType reasonCode,
                      RChannelBufferWriterHandler* handler)
@@ -1146,14 +1155,7 @@ RChannelItemType RChannelBufferWriterNative::
         handler->DecRef();
     }
 
-    listEntry = processList.GetHead();
-    while (listEntry != NULL)
-    {
-        WriteHandler* handler = processList.CastOut(listEntry);
-        listEntry = processList.GetNext(listEntry);
-        processList.Remove(processList.CastIn(handler));
-        handler->QueueWrite(m_port);
-    }
+    QueueWriteList(&processList);
 
     return statusCode;
 }
@@ -1281,6 +1283,15 @@ RChannelBufferWriterNativeFile::
     m_bufferAlignment = bufferAlignment;
     LogAssert(m_bufferSize >= m_bufferAlignment);
 
+    m_maxCoalescedWriteSize = 0;
+    SYSTEM_INFO sysInfo;
+    ::GetSystemInfo(&sysInfo);
+    m_pageSize = sysInfo.dwPageSize;
+
+    m_heldRunLength = 0;
+    m_heldRunEnd = 0;
+    m_sentWrites = 0;
+
     m_rawFileHandle = INVALID_HANDLE_VALUE;
     m_bufferedFileHandle = INVALID_HANDLE_VALUE;
     m_fileNameA = new char[MAX_PATH];
@@ -2343,6 +2354,9 @@ void RChannelBufferWriterNativeFile::
 /* called with baseDR held */
 void RChannelBufferWriterNativeFile::DrainConcreteWriter()
 {
+    LogAssert(m_heldRun.IsEmpty());
+    LogAssert(m_sentWrites == 0);
+
     m_realignmentSize = 0;
     m_nextOffsetToWrite = 0;
 }
@@ -2408,12 +2422,164 @@ void RChannelBufferWriterNativeFile::
     block->DecRef();
 }
 
+//
+// Any run held back while this write was in flight is sent before the
+// completion is processed, so a held run is never left waiting with
+// nothing outstanding to release it
+//
 void RChannelBufferWriterNativeFile::ReceiveBuffer(WriteHandler* writeHandler,
                                                    DrError errorCode)
 {
+    WriteHandlerList run;
+    UInt32 runLength = 0;
+
+    {
+        AutoCriticalSection acs(GetBaseDR());
+
+        LogAssert(m_sentWrites > 0);
+        --m_sentWrites;
+
+        TakeHeldRun(&run, &runLength);
+    }
+
+    SendRun(&run, runLength);
+
     ReceiveBufferInternal(writeHandler, errorCode);
 }
 
+void RChannelBufferWriterNativeFile::SetMaxCoalescedWriteSize(UInt32 maxWriteSize)
+{
+    AutoCriticalSection acs(GetBaseDR());
+
+    m_maxCoalescedWriteSize = maxWriteSize;
+}
+
+//
+// Send the list in order. While earlier writes are still in flight,
+// unbuffered writes that continue the held run are added to it rather
+// than sent, so writes queued one at a time are combined as well as
+// those released together when the writer unblocks. Anything else
+// sends the held run first and then goes on its own
+//
+void RChannelBufferWriterNativeFile::QueueWriteList(WriteHandlerList* writeList)
+{
+    while (writeList->IsEmpty() == false)
+    {
+        FileWriteHandler* handler = dynamic_cast<FileWriteHandler*>
+            (writeList->CastOut(writeList->RemoveHead()));
+        WriteHandlerList run;
+        UInt32 runLength = 0;
+        WriteHandlerList fullRun;
+        UInt32 fullRunLength = 0;
+        bool sendAlone = false;
+
+        {
+            AutoCriticalSection acs(GetBaseDR());
+
+            if (CanHoldForCoalescing(handler))
+            {
+                if (m_heldRun.IsEmpty() == false &&
+                    (handler->GetStreamOffset() != m_heldRunEnd ||
+                     (UInt64) m_heldRunLength + handler->GetWriteLength() >
+                     m_maxCoalescedWriteSize))
+                {
+                    TakeHeldRun(&run, &runLength);
+                }
+
+                m_heldRun.InsertAsTail(m_heldRun.CastIn(handler));
+                m_heldRunLength += handler->GetWriteLength();
+                m_heldRunEnd = handler->GetStreamOffset() + handler->GetWriteLength();
+
+                if (m_heldRunLength == m_maxCoalescedWriteSize)
+                {
+                    /* nothing more can join it, so don't wait */
+                    TakeHeldRun(&fullRun, &fullRunLength);
+                }
+            }
+            else
+            {
+                TakeHeldRun(&run, &runLength);
+                ++m_sentWrites;
+                sendAlone = true;
+            }
+        }
+
+        SendRun(&run, runLength);
+        SendRun(&fullRun, fullRunLength);
+
+        if (sendAlone)
+        {
+            handler->QueueWrite(GetPort());
+        }
+    }
+
+    /* with nothing in flight no completion will come along to send
+       the held run, so send it now */
+    WriteHandlerList run;
+    UInt32 runLength = 0;
+
+    {
+        AutoCriticalSection acs(GetBaseDR());
+
+        if (m_sentWrites == 0)
+        {
+            TakeHeldRun(&run, &runLength);
+        }
+    }
+
+    SendRun(&run, runLength);
+}
+
+/* called with baseDR held */
+bool RChannelBufferWriterNativeFile::CanHoldForCoalescing(FileWriteHandler* handler)
+{
+    /* a run is sent as a gather write, which takes whole pages through
+       the unbuffered handle */
+    return (!m_fileIsPipe &&
+            m_maxCoalescedWriteSize > 0 &&
+            m_pageSize == m_bufferAlignment &&
+            handler->CanCoalesce() &&
+            !handler->IsBuffered() &&
+            handler->GetWriteLength() < m_maxCoalescedWriteSize);
+}
+
+/* called with baseDR held. The members of the run are counted as sent
+   here so a completion racing with the caller's SendRun can't see
+   m_sentWrites drop to 0 while they are still to be sent */
+void RChannelBufferWriterNativeFile::TakeHeldRun(WriteHandlerList* run,
+                                                 UInt32* pRunLength)
+{
+    m_sentWrites += m_heldRun.CountLinks();
+    run->TransitionToTail(&m_heldRun);
+    *pRunLength = m_heldRunLength;
+
+    m_heldRunLength = 0;
+    m_heldRunEnd = 0;
+}
+
+void RChannelBufferWriterNativeFile::SendRun(WriteHandlerList* run,
+                                             UInt32 runLength)
+{
+    if (run->IsEmpty())
+    {
+        return;
+    }
+
+    if (run->CountLinks() == 1)
+    {
+        WriteHandler* single = run->CastOut(run->RemoveHead());
+        single->QueueWrite(GetPort());
+        return;
+    }
+
+    FileWriteHandler* first = dynamic_cast<FileWriteHandler*>
+        (run->CastOut(run->GetHead()));
+    CoalescedWriteHandler* coalesced =
+        new CoalescedWriteHandler(run, first->GetStreamOffset(), runLength,
+                                  first->GetFileHandle(), m_pageSize);
+    coalesced->QueueWrite(GetPort());
+}
+
 bool RChannelBufferWriterNativeFile::IsAligned(UInt64 offset)
 {
     return ((offset & ((UInt64) m_bufferAlignment - 1)) == 0);
@@ -2579,6 +2745,17 @@ bool RChannelBufferWriterNativeFile::FileWriteHandler::IsBuffered()
     return m_isBuffered;
 }
 
+//
+// Only handlers whose file is open and that carry data can be
+// combined with their neighbours
+//
+bool RChannelBufferWriterNativeFile::FileWriteHandler::CanCoalesce()
+{
+    return (m_detailsPresent &&
+            m_fileHandle != INVALID_HANDLE_VALUE &&
+            GetWriteLength() > 0);
+}
+
 void RChannelBufferWriterNativeFile::FileWriteHandler::
     QueueWrite(DryadNativePort* port)
 {
@@ -2648,6 +2825,90 @@ void RChannelBufferWriterNativeFile::FileWriteHandler::
     parent->ReceiveBuffer(this, errorCode);
 }
 
+RChannelBufferWriterNativeFile::CoalescedWriteHandler::
+    CoalescedWriteHandler(WriteHandlerList* members,
+                          UInt64 streamOffset,
+                          UInt32 writeLength,
+                          HANDLE fileHandle,
+                          UInt32 pageSize)
+{
+    m_members.TransitionToTail(members);
+    m_fileHandle = fileHandle;
+
+    InitializeInternal(writeLength, streamOffset);
+
+    //
+    // One segment per page, plus the terminating NULL segment
+    //
+    LogAssert((writeLength % pageSize) == 0);
+    UInt32 numberOfPages = writeLength / pageSize;
+    m_segments = new FILE_SEGMENT_ELEMENT[numberOfPages + 1];
+
+    UInt32 page = 0;
+    DrBListEntry* listEntry = m_members.GetHead();
+    while (listEntry != NULL)
+    {
+        WriteHandler* member = m_members.CastOut(listEntry);
+        listEntry = m_members.GetNext(listEntry);
+
+        BYTE* memberData = (BYTE *) member->GetData();
+        UInt32 memberLength = member->GetWriteLength();
+        LogAssert((memberLength % pageSize) == 0);
+        for (UInt32 offset = 0; offset < memberLength; offset += pageSize)
+        {
+            m_segments[page].Buffer = PtrToPtr64(memberData + offset);
+            ++page;
+        }
+    }
+
+    LogAssert(page == numberOfPages);
+    m_segments[page].Buffer = NULL;
+}
+
+RChannelBufferWriterNativeFile::CoalescedWriteHandler::
+    ~CoalescedWriteHandler()
+{
+    LogAssert(m_members.IsEmpty());
+    delete [] m_segments;
+}
+
+/* the data is described by m_segments instead */
+void* RChannelBufferWriterNativeFile::CoalescedWriteHandler::GetData()
+{
+    return NULL;
+}
+
+void RChannelBufferWriterNativeFile::CoalescedWriteHandler::
+    QueueWrite(DryadNativePort* port)
+{
+    port->QueueNativeGatherWrite(m_fileHandle, this, m_segments);
+}
+
+//
+// Complete every member in offset order with the result of the
+// combined write, then discard this handler
+//
+void RChannelBufferWriterNativeFile::CoalescedWriteHandler::
+    ProcessIO(DrError errorCode, UInt32 numBytes)
+{
+    if (errorCode == DrError_OK)
+    {
+        UInt32 requested = (UInt32) (*GetNumberOfBytesToTransferPtr());
+        LogAssert(numBytes == requested);
+    }
+
+    while (m_members.IsEmpty() == false)
+    {
+        FileWriteHandler* member = dynamic_cast<FileWriteHandler*>
+            (m_members.CastOut(m_members.RemoveHead()));
+        UInt32 memberBytes =
+            (errorCode == DrError_OK) ? member->GetWriteLength() : 0;
+        member->ProcessIO(errorCode, memberBytes);
+    }
+
+    delete this;
+}
+
 #ifdef TIDYFS
 RChannelBufferWriterNativeTidyFSStream::
     RChannelBufferWriterNativeTidyFSStream(UInt32 bufferSize,
@@ -123,6 +123,9 @@ protected:
                                 UInt32 outstandingWritesHighWatermark);
     void SetOpenErrorItem(RChannelItem* errorItem);
     bool OpenError();
+    /* called without baseDR held to send handlers that have been
+       added to the write queue to the port */
+    virtual void QueueWriteList(WriteHandlerList* writeList);
 
 private:
     enum State {
@@ -230,6 +233,7 @@ public:
         void SetFileHandle(HANDLE h);
         HANDLE GetFileHandle();
         bool IsBuffered();
+        bool CanCoalesce();
 
         void ProcessIO(DrError errorCode, UInt32 numBytes);
 
@@ -241,6 +245,30 @@ public:
         bool                               m_isBuffered;
     };
 
+    /* a single gather write standing in for a run of unbuffered
+       FileWriteHandlers at contiguous offsets, sent straight from the
+       members' blocks. When it completes each member is completed in
+       offset order as though it had been written on its own */
+    class CoalescedWriteHandler : public DryadNativePort::Handler
+    {
+    public:
+        CoalescedWriteHandler(WriteHandlerList* members,
+                              UInt64 streamOffset,
+                              UInt32 writeLength,
+                              HANDLE fileHandle,
+                              UInt32 pageSize);
+        ~CoalescedWriteHandler();
+
+        void* GetData();
+        void ProcessIO(DrError errorCode, UInt32 numBytes);
+        void QueueWrite(DryadNativePort* port);
+
+    private:
+        WriteHandlerList                   m_members;
+        HANDLE                             m_fileHandle;
+        FILE_SEGMENT_ELEMENT*              m_segments;
+    };
+
     RChannelBufferWriterNativeFile(UInt32 bufferSize,
                                    size_t bufferAlignment,
                                    UInt32 outstandingWritesLowWatermark,
@@ -251,6 +279,12 @@ public:
 
     DrError SetMetaData(DryadMetaData* metaData);
 
+    /* unbuffered writes at contiguous offsets that are queued while
+       an earlier write is still in flight are held back and combined
+       into a single gather write of up to this many bytes, which is
+       sent when the next write completes. 0 turns coalescing off */
+    void SetMaxCoalescedWriteSize(UInt32 maxWriteSize);
+
     bool OpenA(const char* pathName);
 //JC    bool OpenW(const wchar_t* pathName);
 
@@ -284,11 +318,26 @@ private:
     bool IsAligned(UInt64 offset);
     UInt32 AlignmentGap(UInt64 offset);
     void ReceiveBuffer(WriteHandler* writeHandler, DrError errorCode);
+    void QueueWriteList(WriteHandlerList* writeList);
+    bool CanHoldForCoalescing(FileWriteHandler* handler);
+    void TakeHeldRun(WriteHandlerList* run, UInt32* pRunLength);
+    void SendRun(WriteHandlerList* run, UInt32 runLength);
 
     static bool TryToSetPrivilege();
 
     UInt32                       m_bufferSize;
     size_t                       m_bufferAlignment;
+    UInt32                       m_maxCoalescedWriteSize;
+    UInt32                       m_pageSize;
+
+    /* the run of writes being held back for coalescing, and the
+       number of writes that have been sent to the port and not yet
+       completed. A run is only held while m_sentWrites > 0, since
+       the next completion is what sends it */
+    WriteHandlerList             m_heldRun;
+    UInt32                       m_heldRunLength;
+    UInt64                       m_heldRunEnd;
+    UInt32                       m_sentWrites;
 
     HANDLE                       m_rawFileHandle;
     HANDLE                       m_bufferedFileHandle;
@@ -312,6 +361,7 @@ private:
     static CRITSEC               s_privilegeDR;
 
     friend class FileWriteHandler;
+    friend class CoalescedWriteHandler;
 };
 
 #ifdef TIDYFS
@@ -0,0 +1,1194 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include "channelbuffershm.h"
+
+#include <process.h>
+
+#pragma unmanaged
+
+const char* RChannelBufferShmReader::s_shmPrefix = "shm://";
+
+static const LONG s_shmRingMagic = 0x4d485344; /* "DSHM" */
+static const UInt32 s_shmRingVersion = 2;
+
+//
+// The ring starts a page after the header so that it is page aligned
+//
+static const UInt64 s_shmHeaderSize = 4096;
+
+//
+// Size of the ring made by whichever end opens the channel first. Can
+// be overridden with DRYAD_SHM_CHANNEL_MB
+//
+static const UInt64 s_defaultShmRingSize = 16*1024*1024;
+
+//
+// How long the second end waits for the first to finish setting up
+// the section before giving up
+//
+static const DWORD s_shmAttachTimeoutMs = 30*1000;
+
+//
+// How often a blocked end wakes up to see whether the process at the
+// other end has attached or exited
+//
+static const DWORD s_shmPeerCheckIntervalMs = 1000;
+
+static long s_shmWriteBufferSize = 256 * 1024;
+static LONG s_maxBuffersOut = 4;
+static UInt32 s_maxBuffersToBlockWriter = 4;
+
+static UInt64 GetShmRingSize()
+{
+    static bool s_initialized = false;
+    static UInt64 s_ringSize = 0;
+
+    if (!s_initialized)
+    {
+        UInt64 ringSize = s_defaultShmRingSize;
+
+        char envValue[32];
+        DWORD ret = ::GetEnvironmentVariableA("DRYAD_SHM_CHANNEL_MB",
+                                              envValue, sizeof(envValue));
+        if (ret > 0 && ret < sizeof(envValue))
+        {
+            UInt32 valueMB;
+            if (DrStringToUInt32(envValue, &valueMB) == DrError_OK &&
+                valueMB > 0)
+            {
+                ringSize = (UInt64) valueMB * 1024 * 1024;
+            }
+        }
+
+        s_ringSize = ringSize;
+        s_initialized = true;
+        DrLogI("Shared memory channel ring size %I64u bytes", s_ringSize);
+    }
+
+    return s_ringSize;
+}
+
+RChannelShmRing::RChannelShmRing()
+{
+    m_isWriter = false;
+    m_section = NULL;
+    m_dataEvent = NULL;
+    m_spaceEvent = NULL;
+    m_peerProcess = NULL;
+    m_waitingForPeer = false;
+    m_peerWaitStart = 0;
+    m_header = NULL;
+    m_ring = NULL;
+    m_capacity = 0;
+}
+
+RChannelShmRing::~RChannelShmRing()
+{
+    Close();
+}
+
+bool RChannelShmRing::Open(const char* uri, bool isWriter,
+                           DrStr64& errorDescription)
+{
+    LogAssert(m_section == NULL);
+
+    m_isWriter = isWriter;
+
+    size_t prefixLen = ::strlen(RChannelBufferShmReader::s_shmPrefix);
+    if (_strnicmp(uri, RChannelBufferShmReader::s_shmPrefix, prefixLen) != 0 ||
+        uri[prefixLen] == '\0')
+    {
+        errorDescription.SetF("Can't parse shared memory URI '%s'", uri);
+        return false;
+    }
+
+    /* kernel object names can't contain backslashes after the
+       namespace prefix */
+    DrStr64 baseName;
+    baseName.Set("Local\\Dryad_");
+    for (const char* c = uri + prefixLen; *c != '\0'; ++c)
+    {
+        baseName.Append((*c == '\\' || *c == '/') ? '_' : *c);
+    }
+
+    UInt64 ringSize = GetShmRingSize();
+    UInt64 sectionSize = s_shmHeaderSize + ringSize;
+
+    m_section = ::CreateFileMappingA(INVALID_HANDLE_VALUE,
+                                     NULL,
+                                     PAGE_READWRITE,
+                                     (DWORD) (sectionSize >> 32),
+                                     (DWORD) (sectionSize & 0xffffffff),
+                                     baseName.GetString());
+    if (m_section == NULL)
+    {
+        errorDescription.SetF("Can't create shared memory section '%s': %s",
+                              baseName.GetString(),
+                              DRERRORSTRING(DrGetLastError()));
+        return false;
+    }
+    bool created = (::GetLastError() != ERROR_ALREADY_EXISTS);
+
+    /* the section keeps the size it was created with, so map the
+       whole of it and read the capacity from the header */
+    m_header = (RChannelShmRingHeader *)
+        ::MapViewOfFile(m_section, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (m_header == NULL)
+    {
+        errorDescription.SetF("Can't map shared memory section '%s': %s",
+                              baseName.GetString(),
+                              DRERRORSTRING(DrGetLastError()));
+        Close();
+        return false;
+    }
+
+    if (created)
+    {
+        m_header->m_version = s_shmRingVersion;
+        m_header->m_capacity = ringSize;
+        m_header->m_writeOffset = 0;
+        m_header->m_readOffset = 0;
+        m_header->m_readerClosed = 0;
+        m_header->m_writerClosed = 0;
+        m_header->m_dataWritten = 0;
+        m_header->m_readerProcessId = 0;
+        m_header->m_writerProcessId = 0;
+        ::InterlockedExchange(&(m_header->m_magic), s_shmRingMagic);
+    }
+    else
+    {
+        DWORD waited = 0;
+        while (m_header->m_magic != s_shmRingMagic &&
+               waited < s_shmAttachTimeoutMs)
+        {
+            ::Sleep(10);
+            waited += 10;
+        }
+
+        if (m_header->m_magic != s_shmRingMagic ||
+            m_header->m_version != s_shmRingVersion)
+        {
+            errorDescription.SetF("Shared memory section '%s' was never "
+                                  "initialized or has version %u",
+                                  baseName.GetString(),
+                                  m_header->m_version);
+            Close();
+            return false;
+        }
+    }
+
+    m_capacity = m_header->m_capacity;
+    m_ring = ((unsigned char *) m_header) + s_shmHeaderSize;
+
+    ::InterlockedExchange((isWriter) ?
+                          &(m_header->m_writerProcessId) :
+                          &(m_header->m_readerProcessId),
+                          (LONG) ::GetCurrentProcessId());
+
+    DrStr64 eventName;
+    eventName.SetF("%s_data", baseName.GetString());
+    m_dataEvent = ::CreateEventA(NULL, FALSE, FALSE, eventName.GetString());
+    eventName.SetF("%s_space", baseName.GetString());
+    m_spaceEvent = ::CreateEventA(NULL, FALSE, FALSE, eventName.GetString());
+    if (m_dataEvent == NULL || m_spaceEvent == NULL)
+    {
+        errorDescription.SetF("Can't create events for shared memory "
+                              "section '%s': %s",
+                              baseName.GetString(),
+                              DRERRORSTRING(DrGetLastError()));
+        Close();
+        return false;
+    }
+
+    DrLogI("%s shared memory ring %s capacity %I64u",
+           (created) ? "Created" : "Attached to",
+           baseName.GetString(), m_capacity);
+
+    return true;
+}
+
+void RChannelShmRing::Close()
+{
+    if (m_header != NULL)
+    {
+        BOOL bRet = ::UnmapViewOfFile(m_header);
+        LogAssert(bRet != 0);
+        m_header = NULL;
+        m_ring = NULL;
+    }
+    if (m_section != NULL)
+    {
+        ::CloseHandle(m_section);
+        m_section = NULL;
+    }
+    if (m_dataEvent != NULL)
+    {
+        ::CloseHandle(m_dataEvent);
+        m_dataEvent = NULL;
+    }
+    if (m_spaceEvent != NULL)
+    {
+        ::CloseHandle(m_spaceEvent);
+        m_spaceEvent = NULL;
+    }
+    if (m_peerProcess != NULL)
+    {
+        ::CloseHandle(m_peerProcess);
+        m_peerProcess = NULL;
+    }
+    m_capacity = 0;
+}
+
+HANDLE RChannelShmRing::GetDataEvent()
+{
+    return m_dataEvent;
+}
+
+HANDLE RChannelShmRing::GetSpaceEvent()
+{
+    return m_spaceEvent;
+}
+
+RChannelShmWaitResult RChannelShmRing::WaitForPeer(HANDLE event,
+                                                   HANDLE abortHandle)
+{
+    if (m_peerProcess == NULL)
+    {
+        /* the other end may not have attached yet, in which case
+           there's nothing to watch until it does */
+        LONG peerId = (m_isWriter) ?
+            m_header->m_readerProcessId : m_header->m_writerProcessId;
+        if (peerId == 0)
+        {
+            /* a peer that never attaches would otherwise leave this
+               end polling for ever */
+            if (!m_waitingForPeer)
+            {
+                m_waitingForPeer = true;
+                m_peerWaitStart = ::GetTickCount();
+            }
+            else if (::GetTickCount() - m_peerWaitStart >= s_shmAttachTimeoutMs)
+            {
+                DrLogE("Shared memory %s process didn't attach within %u ms",
+                       (m_isWriter) ? "reader" : "writer",
+                       s_shmAttachTimeoutMs);
+                return SWR_PeerGone;
+            }
+        }
+        else
+        {
+            m_peerProcess = ::OpenProcess(SYNCHRONIZE, FALSE, (DWORD) peerId);
+            if (m_peerProcess == NULL)
+            {
+                DrError err = DrGetLastError();
+                if (err == DrErrorFromWin32(ERROR_INVALID_PARAMETER))
+                {
+                    DrLogW("Shared memory %s process %d has already exited",
+                           (m_isWriter) ? "reader" : "writer", peerId);
+                    return SWR_PeerGone;
+                }
+
+                /* keep going on the timeout alone and try again next
+                   time */
+                DrLogW("Can't watch shared memory %s process %d: %s",
+                       (m_isWriter) ? "reader" : "writer", peerId,
+                       DRERRORSTRING(err));
+            }
+        }
+    }
+
+    HANDLE h[3];
+    DWORD numberOfHandles = 0;
+    h[numberOfHandles++] = abortHandle;
+    h[numberOfHandles++] = event;
+    if (m_peerProcess != NULL)
+    {
+        h[numberOfHandles++] = m_peerProcess;
+    }
+
+    /* the event comes before the process so that anything the other
+       end published just before exiting is still seen */
+    DWORD dRet = ::WaitForMultipleObjects(numberOfHandles, h, FALSE,
+                                          s_shmPeerCheckIntervalMs);
+    if (dRet == WAIT_OBJECT_0)
+    {
+        return SWR_Aborted;
+    }
+    else if (dRet == WAIT_OBJECT_0+2)
+    {
+        DrLogW("Shared memory %s process exited",
+               (m_isWriter) ? "reader" : "writer");
+        return SWR_PeerGone;
+    }
+
+    LogAssert(dRet == WAIT_OBJECT_0+1 || dRet == WAIT_TIMEOUT);
+    return SWR_Ready;
+}
+
+UInt64 RChannelShmRing::GetCapacity()
+{
+    return m_capacity;
+}
+
+UInt64 RChannelShmRing::GetReadOffset()
+{
+    return (UInt64) m_header->m_readOffset;
+}
+
+UInt64 RChannelShmRing::GetWriteOffset()
+{
+    return (UInt64) m_header->m_writeOffset;
+}
+
+UInt64 RChannelShmRing::GetDataWritten()
+{
+    return (UInt64) m_header->m_dataWritten;
+}
+
+UInt64 RChannelShmRing::GetReadable()
+{
+    UInt64 readOffset = GetReadOffset();
+    UInt64 writeOffset = GetWriteOffset();
+    LogAssert(writeOffset >= readOffset);
+    return writeOffset - readOffset;
+}
+
+UInt64 RChannelShmRing::GetWritable()
+{
+    UInt64 readOffset = GetReadOffset();
+    UInt64 writeOffset = GetWriteOffset();
+    LogAssert(writeOffset - readOffset <= m_capacity);
+    return m_capacity - (writeOffset - readOffset);
+}
+
+void RChannelShmRing::CopyIn(UInt64 offset, const void* src, Size_t length)
+{
+    LogAssert(length <= m_capacity);
+
+    Size_t start = (Size_t) (offset % m_capacity);
+    Size_t firstPart = (Size_t) (m_capacity - start);
+    if (firstPart > length)
+    {
+        firstPart = length;
+    }
+
+    ::memcpy(m_ring + start, src, firstPart);
+    ::memcpy(m_ring, ((const unsigned char *) src) + firstPart,
+             length - firstPart);
+}
+
+void RChannelShmRing::CopyOut(UInt64 offset, void* dst, Size_t length)
+{
+    LogAssert(length <= m_capacity);
+
+    Size_t start = (Size_t) (offset % m_capacity);
+    Size_t firstPart = (Size_t) (m_capacity - start);
+    if (firstPart > length)
+    {
+        firstPart = length;
+    }
+
+    ::memcpy(dst, m_ring + start, firstPart);
+    ::memcpy(((unsigned char *) dst) + firstPart, m_ring,
+             length - firstPart);
+}
+
+void RChannelShmRing::PublishWrite(UInt64 offset, UInt64 dataWritten)
+{
+    /* the interlocked exchanges order the copies above them before
+       the new offset becomes visible. The data count goes first so
+       the reader never sees more data than the total */
+    ::InterlockedExchange64(&(m_header->m_dataWritten), (LONGLONG) dataWritten);
+    ::InterlockedExchange64(&(m_header->m_writeOffset), (LONGLONG) offset);
+    BOOL bRet = ::SetEvent(m_dataEvent);
+    LogAssert(bRet != 0);
+}
+
+void RChannelShmRing::PublishRead(UInt64 offset)
+{
+    ::InterlockedExchange64(&(m_header->m_readOffset), (LONGLONG) offset);
+    BOOL bRet = ::SetEvent(m_spaceEvent);
+    LogAssert(bRet != 0);
+}
+
+void RChannelShmRing::SetReaderClosed()
+{
+    ::InterlockedExchange(&(m_header->m_readerClosed), 1);
+    BOOL bRet = ::SetEvent(m_spaceEvent);
+    LogAssert(bRet != 0);
+}
+
+bool RChannelShmRing::IsReaderClosed()
+{
+    return (m_header->m_readerClosed != 0);
+}
+
+void RChannelShmRing::SetWriterClosed()
+{
+    ::InterlockedExchange(&(m_header->m_writerClosed), 1);
+    BOOL bRet = ::SetEvent(m_dataEvent);
+    LogAssert(bRet != 0);
+}
+
+bool RChannelShmRing::IsWriterClosed()
+{
+    return (m_header->m_writerClosed != 0);
+}
+
+
+static RChannelItem*
+MakeErrorItem(DrError errorCode, const char* description)
+{
+    RChannelItem* item =
+        RChannelMarkerItem::Create(RChannelItem_Abort, true);
+    DryadMetaData* metaData = item->GetMetaData();
+    metaData->AddErrorWithDescription(errorCode, description);
+
+    return item;
+}
+
+static RChannelBuffer*
+MakeErrorBuffer(DrError errorCode, const char* description,
+                RChannelBufferDefaultHandler* handler)
+{
+    RChannelItem* item = MakeErrorItem(errorCode, description);
+
+    RChannelBuffer* errorBuffer =
+        RChannelBufferMarkerDefault::Create(RChannelBuffer_Abort,
+                                            item,
+                                            handler);
+    DryadMetaData* metaData = errorBuffer->GetMetaData();
+    metaData->AddErrorWithDescription(errorCode, description);
+
+    return errorBuffer;
+}
+
+//
+// Make the buffer for a termination frame sent by the writer
+//
+static RChannelBuffer*
+MakeTerminationBuffer(RChannelItemType type,
+                      RChannelBufferDefaultHandler* handler)
+{
+    RChannelBufferType bufferType;
+    switch (type)
+    {
+    case RChannelItem_EndOfStream:
+        bufferType = RChannelBuffer_EndOfStream;
+        break;
+
+    case RChannelItem_Restart:
+        bufferType = RChannelBuffer_Restart;
+        break;
+
+    default:
+        LogAssert(type == RChannelItem_Abort);
+        bufferType = RChannelBuffer_Abort;
+        break;
+    }
+
+    RChannelItem* item =
+        RChannelMarkerItem::Create(type, (type != RChannelItem_EndOfStream));
+
+    return RChannelBufferMarkerDefault::Create(bufferType, item, handler);
+}
+
+static RChannelBufferData*
+MakeDataBuffer(UInt64 streamOffset, size_t blockSize,
+               RChannelBufferDefaultHandler* handler)
+{
+    DryadAlignedReadBlock* block =
+        new DryadAlignedReadBlock(blockSize, 0);
+    RChannelBufferData* dataBuffer =
+        RChannelBufferDataDefault::Create(block,
+                                          streamOffset,
+                                          handler);
+
+    DryadMetaData* metaData = dataBuffer->GetMetaData();
+    DryadMTagRef tag;
+    tag.Attach(DryadMTagUInt64::Create(Prop_Dryad_BufferLength,
+                                       block->GetAvailableSize()));
+    metaData->Append(tag, false);
+
+    return dataBuffer;
+}
+
+
+RChannelBufferShmReader::RChannelBufferShmReader(const char* uri)
+{
+    m_uri.Set(uri);
+    m_handler = NULL;
+    m_readThread = INVALID_HANDLE_VALUE;
+    m_abortHandle = INVALID_HANDLE_VALUE;
+    m_processedLength = 0;
+    m_totalLength = 0;
+
+    m_blockSemaphore = CreateSemaphore(NULL,
+                                       s_maxBuffersOut,
+                                       s_maxBuffersOut,
+                                       NULL);
+    LogAssert(m_blockSemaphore != NULL);
+
+    DrLogI("Made shared memory reader %s", uri);
+}
+
+RChannelBufferShmReader::~RChannelBufferShmReader()
+{
+    if (m_readThread != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_readThread);
+    }
+    if (m_abortHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_abortHandle);
+    }
+    CloseHandle(m_blockSemaphore);
+}
+
+void RChannelBufferShmReader::
+Start(RChannelBufferPrefetchInfo* /*unused prefetchCookie*/,
+      RChannelBufferReaderHandler* handler)
+{
+    LogAssert(m_handler == NULL);
+    m_handler = handler;
+
+    LogAssert(m_readThread == INVALID_HANDLE_VALUE);
+    LogAssert(m_abortHandle == INVALID_HANDLE_VALUE);
+
+    {
+        AutoCriticalSection acs(&m_cs);
+
+        m_processedLength = 0;
+        m_totalLength = 0;
+    }
+
+    m_abortHandle = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    LogAssert(m_abortHandle != NULL);
+
+    m_readThread =
+        (HANDLE) ::_beginthreadex(NULL,
+                                  0,
+                                  RChannelBufferShmReader::ThreadFunc,
+                                  this,
+                                  0,
+                                  NULL);
+    LogAssert(m_readThread != 0);
+}
+
+void RChannelBufferShmReader::Interrupt()
+{
+    /* tell the read thread to stop reading */
+    BOOL bRet = ::SetEvent(m_abortHandle);
+    LogAssert(bRet != 0);
+
+    /* then wait for it to exit */
+    DWORD dRet = ::WaitForSingleObject(m_readThread, INFINITE);
+    LogAssert(dRet == WAIT_OBJECT_0);
+}
+
+void RChannelBufferShmReader::Drain(RChannelItem* /* unused drainItem */)
+{
+    Interrupt();
+
+    for (LONG i=0; i<s_maxBuffersOut; ++i)
+    {
+        DWORD dRet = WaitForSingleObject(m_blockSemaphore, INFINITE);
+        LogAssert(dRet == WAIT_OBJECT_0);
+    }
+
+    BOOL bRet = ReleaseSemaphore(m_blockSemaphore, s_maxBuffersOut, NULL);
+    LogAssert(bRet != 0);
+
+    bRet = CloseHandle(m_abortHandle);
+    LogAssert(bRet != 0);
+    m_abortHandle = INVALID_HANDLE_VALUE;
+
+    bRet = CloseHandle(m_readThread);
+    LogAssert(bRet != 0);
+    m_readThread = INVALID_HANDLE_VALUE;
+
+    m_handler = NULL;
+}
+
+void RChannelBufferShmReader::Close()
+{
+}
+
+void RChannelBufferShmReader::FillInStatus(DryadChannelDescription* s)
+{
+    AutoCriticalSection acs(&m_cs);
+
+    s->SetChannelTotalLength(m_totalLength);
+    s->SetChannelProcessedLength(m_processedLength);
+}
+
+bool RChannelBufferShmReader::GetTotalLength(UInt64* pLen)
+{
+    /* the length isn't known until the writer finishes */
+    *pLen = 0;
+
+    return false;
+}
+
+void RChannelBufferShmReader::ReturnBuffer(RChannelBuffer* buffer)
+{
+    /* discard buffer */
+    buffer->DecRef();
+
+    BOOL bRet = ReleaseSemaphore(m_blockSemaphore, 1, NULL);
+    LogAssert(bRet != 0);
+}
+
+unsigned __stdcall RChannelBufferShmReader::ThreadFunc(void* arg)
+{
+    RChannelBufferShmReader* self = (RChannelBufferShmReader *) arg;
+    self->ReadThread();
+    return 0;
+}
+
+//
+// Wait until at least length bytes are in the ring. Returns false if
+// the reader was interrupted or the writer closed or exited first
+//
+bool RChannelBufferShmReader::WaitForReadable(UInt64 length)
+{
+    while (m_ring.GetReadable() < length)
+    {
+        if (m_ring.IsWriterClosed())
+        {
+            return false;
+        }
+
+        RChannelShmWaitResult r =
+            m_ring.WaitForPeer(m_ring.GetDataEvent(), m_abortHandle);
+        if (r != SWR_Ready)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//
+// Take a slot for one more buffer outstanding to the handler. Returns
+// false if the reader was interrupted first
+//
+bool RChannelBufferShmReader::WaitForSemaphore()
+{
+    HANDLE h[2];
+    h[0] = m_abortHandle;
+    h[1] = m_blockSemaphore;
+
+    DWORD dRet = WaitForMultipleObjects(2, h, FALSE, INFINITE);
+    if (dRet == WAIT_OBJECT_0)
+    {
+        return false;
+    }
+    LogAssert(dRet == WAIT_OBJECT_0+1);
+
+    return true;
+}
+
+void RChannelBufferShmReader::SendError(DrError errorCode,
+                                        const char* description)
+{
+    DrLogE("%s", description);
+
+    if (WaitForSemaphore())
+    {
+        m_handler->ProcessBuffer(MakeErrorBuffer(errorCode, description, this));
+    }
+}
+
+void RChannelBufferShmReader::ReadThread()
+{
+    DrStr64 description;
+    if (!m_ring.Open(m_uri.GetString(), false, description))
+    {
+        SendError(DryadError_ChannelOpenError, description.GetString());
+        return;
+    }
+
+    UInt64 streamOffset = 0;
+    bool terminated = false;
+
+    while (!terminated)
+    {
+        RChannelShmFrameHeader frame;
+        if (!WaitForReadable(sizeof(frame)))
+        {
+            break;
+        }
+
+        UInt64 readOffset = m_ring.GetReadOffset();
+        m_ring.CopyOut(readOffset, &frame, sizeof(frame));
+
+        /* the writer publishes a frame only once all of it is in the
+           ring */
+        LogAssert(m_ring.GetReadable() >= sizeof(frame) + frame.m_length);
+
+        if (!WaitForSemaphore())
+        {
+            break;
+        }
+
+        RChannelBuffer* buffer;
+        RChannelItemType type = (RChannelItemType) frame.m_type;
+        if (type == RChannelItem_Data)
+        {
+            RChannelBufferData* dataBuffer =
+                MakeDataBuffer(streamOffset, frame.m_length, this);
+
+            DrMemoryBuffer* block = dataBuffer->GetData();
+            Size_t available;
+            void* dst = block->GetDataAddress(0, &available, NULL);
+            LogAssert(available >= frame.m_length);
+            m_ring.CopyOut(readOffset + sizeof(frame), dst, frame.m_length);
+
+            streamOffset += frame.m_length;
+            buffer = dataBuffer;
+
+            AutoCriticalSection acs(&m_cs);
+
+            m_processedLength = streamOffset;
+            m_totalLength = m_ring.GetDataWritten();
+        }
+        else
+        {
+            LogAssert(frame.m_length == 0);
+            DrLogI("Got shared memory termination item type %u",
+                   frame.m_type);
+            buffer = MakeTerminationBuffer(type, this);
+            terminated = true;
+        }
+
+        m_ring.PublishRead(readOffset + sizeof(frame) + frame.m_length);
+
+        m_handler->ProcessBuffer(buffer);
+    }
+
+    if (!terminated)
+    {
+        DWORD dRet = WaitForSingleObject(m_abortHandle, 0);
+        if (dRet == WAIT_TIMEOUT)
+        {
+            /* the writer went away without sending a termination
+               frame */
+            description.SetF("Shared memory channel '%s' writer closed "
+                             "or exited without terminating the stream",
+                             m_uri.GetString());
+            SendError(DryadError_ChannelReadError, description.GetString());
+        }
+
+        /* let a blocked writer know there is no one left to read */
+        m_ring.SetReaderClosed();
+    }
+
+    m_ring.Close();
+}
+
+
+RChannelBufferShmWriter::RChannelBufferShmWriter(const char* uri)
+{
+    m_uri.Set(uri);
+    m_queueHandle = INVALID_HANDLE_VALUE;
+    m_abortHandle = INVALID_HANDLE_VALUE;
+    m_writeThread = INVALID_HANDLE_VALUE;
+    m_queueLength = 0;
+    m_processedLength = 0;
+
+    DrLogI("Made shared memory writer %s", uri);
+}
+
+DryadFixedMemoryBuffer* RChannelBufferShmWriter::GetNextWriteBuffer()
+{
+    return GetCustomWriteBuffer(s_shmWriteBufferSize);
+}
+
+DryadFixedMemoryBuffer* RChannelBufferShmWriter::
+GetCustomWriteBuffer(Size_t bufferSize)
+{
+    return new DryadAlignedWriteBlock(bufferSize, 0);
+}
+
+void RChannelBufferShmWriter::Start()
+{
+    LogAssert(m_writeThread == INVALID_HANDLE_VALUE);
+    LogAssert(m_queueHandle == INVALID_HANDLE_VALUE);
+    LogAssert(m_queue.IsEmpty());
+    LogAssert(m_queueLength == 0);
+
+    {
+        AutoCriticalSection acs(&m_cs);
+
+        m_processedLength = 0;
+    }
+
+    m_queueHandle = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    LogAssert(m_queueHandle != NULL);
+
+    LogAssert(m_abortHandle == INVALID_HANDLE_VALUE);
+    m_abortHandle = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    LogAssert(m_abortHandle != NULL);
+
+    m_writeThread =
+        (HANDLE) ::_beginthreadex(NULL,
+                                  0,
+                                  RChannelBufferShmWriter::ThreadFunc,
+                                  this,
+                                  0,
+                                  NULL);
+    LogAssert(m_writeThread != 0);
+}
+
+unsigned __stdcall RChannelBufferShmWriter::ThreadFunc(void* arg)
+{
+    RChannelBufferShmWriter* self = (RChannelBufferShmWriter *) arg;
+    self->WriteThread();
+    return 0;
+}
+
+//
+// Wait until there is room for length bytes in the ring. Returns
+// false if the reader has closed or exited, or the writer is being
+// aborted
+//
+bool RChannelBufferShmWriter::WaitForWritable(UInt64 length)
+{
+    LogAssert(length <= m_ring.GetCapacity());
+
+    while (m_ring.GetWritable() < length)
+    {
+        if (m_ring.IsReaderClosed())
+        {
+            return false;
+        }
+
+        RChannelShmWaitResult r =
+            m_ring.WaitForPeer(m_ring.GetSpaceEvent(), m_abortHandle);
+        if (r != SWR_Ready)
+        {
+            return false;
+        }
+    }
+
+    return !m_ring.IsReaderClosed();
+}
+
+//
+// Copy one frame into the ring and publish it. Data larger than half
+// the ring is split into several frames so that the writer never
+// needs the reader to have emptied the ring completely
+//
+bool RChannelBufferShmWriter::WriteFrame(RChannelItemType type,
+                                         const void* data,
+                                         UInt32 length)
+{
+    UInt64 maxPayload = m_ring.GetCapacity() / 2;
+
+    do
+    {
+        RChannelShmFrameHeader frame;
+        frame.m_type = (UInt32) type;
+        frame.m_length = (length > maxPayload) ? (UInt32) maxPayload : length;
+
+        if (!WaitForWritable(sizeof(frame) + frame.m_length))
+        {
+            return false;
+        }
+
+        /* only this end updates the data count, so it can be read
+           back and added to */
+        UInt64 dataWritten = m_ring.GetDataWritten() + frame.m_length;
+
+        UInt64 writeOffset = m_ring.GetWriteOffset();
+        m_ring.CopyIn(writeOffset, &frame, sizeof(frame));
+        m_ring.CopyIn(writeOffset + sizeof(frame), data, frame.m_length);
+        m_ring.PublishWrite(writeOffset + sizeof(frame) + frame.m_length,
+                            dataWritten);
+
+        data = ((const unsigned char *) data) + frame.m_length;
+        length -= frame.m_length;
+    } while (length > 0);
+
+    return true;
+}
+
+//
+// After the termination frame is written, the section has to stay
+// alive until the reader has consumed it
+//
+bool RChannelBufferShmWriter::WaitForReaderDrain()
+{
+    return WaitForWritable(m_ring.GetCapacity());
+}
+
+void RChannelBufferShmWriter::WriteThread()
+{
+    DrStr64 description;
+    bool opened = m_ring.Open(m_uri.GetString(), true, description);
+    if (!opened)
+    {
+        DrLogE("%s", description.GetString());
+        m_completionItem.Attach(MakeErrorItem(DryadError_ChannelOpenError,
+                                              description.GetString()));
+    }
+
+    do
+    {
+        DWORD dRet = WaitForSingleObject(m_queueHandle, INFINITE);
+        LogAssert(dRet == WAIT_OBJECT_0);
+
+        WriteEntry* entry = NULL;
+        {
+            AutoCriticalSection acs(&m_cs);
+
+            entry = m_queue.CastOut(m_queue.RemoveHead());
+            /* the event shouldn't have been signaled unless the queue
+               is non-empty */
+            LogAssert(entry != NULL);
+            LogAssert(m_queueLength > 0);
+            --m_queueLength;
+        }
+
+        do
+        {
+            if (m_completionItem != NULL)
+            {
+                /* we've had a write error: we'll just reply below
+                   with another error */
+                LogAssert(m_completionItem->GetType() !=
+                          RChannelItem_EndOfStream);
+            }
+            else if (entry->m_type == RChannelItem_Data)
+            {
+                LogAssert(entry->m_buffer != NULL);
+
+                size_t dataSize;
+                void *dataAddr = entry->m_buffer->
+                    GetDataAddress(0, &dataSize, NULL);
+                Size_t dataToWrite = entry->m_buffer->GetAvailableSize();
+                LogAssert(dataToWrite <= dataSize);
+
+                if (WriteFrame(RChannelItem_Data, dataAddr, (UInt32) dataToWrite))
+                {
+                    AutoCriticalSection acs(&m_cs);
+
+                    m_processedLength += dataToWrite;
+                }
+                else
+                {
+                    description.SetF("Shared memory channel '%s' reader "
+                                     "closed or exited during write",
+                                     m_uri.GetString());
+                    DrLogE("%s", description.GetString());
+                    m_completionItem.Attach(MakeErrorItem(DryadError_ChannelWriteError,
+                                                          description.GetString()));
+                }
+            }
+            else
+            {
+                LogAssert(entry->m_buffer == NULL);
+
+                DrLogI("Got shared memory termination item");
+
+                if (WriteFrame(entry->m_type, NULL, 0) && WaitForReaderDrain())
+                {
+                    DrLogI("Shared memory reader consumed stream");
+                    m_completionItem.Attach(RChannelMarkerItem::Create(entry->m_type, false));
+                }
+                else
+                {
+                    description.SetF("Shared memory channel '%s' reader "
+                                     "closed or exited before end of stream",
+                                     m_uri.GetString());
+                    DrLogE("%s", description.GetString());
+                    m_completionItem.Attach(MakeErrorItem(DryadError_ChannelWriteError,
+                                                          description.GetString()));
+                }
+            }
+
+            RChannelItemType status;
+            if (m_completionItem == NULL)
+            {
+                status = RChannelItem_Data;
+            }
+            else
+            {
+                status = m_completionItem->GetType();
+                LogAssert(status != RChannelItem_Data);
+            }
+
+            entry->m_handler->ProcessWriteCompleted(status);
+            delete entry;
+            entry = NULL;
+
+            if (status == RChannelItem_Data)
+            {
+                /* we haven't had an error or termination, so see if
+                   there's another entry in the queue */
+                AutoCriticalSection acs(&m_cs);
+
+                entry = m_queue.CastOut(m_queue.RemoveHead());
+                if (entry == NULL)
+                {
+                    /* go to sleep until someone puts another buffer
+                       in the queue */
+                    LogAssert(m_queueLength == 0);
+                    BOOL bRet = ResetEvent(m_queueHandle);
+                    LogAssert(bRet != 0);
+                }
+                else
+                {
+                    LogAssert(m_queueLength > 0);
+                    --m_queueLength;
+                }
+            }
+        } while (entry != NULL);
+    } while (m_completionItem == NULL);
+
+    if (opened)
+    {
+        if (m_completionItem->GetType() != RChannelItem_EndOfStream)
+        {
+            /* don't leave the reader waiting for data that won't
+               come */
+            m_ring.SetWriterClosed();
+        }
+        m_ring.Close();
+    }
+}
+
+bool RChannelBufferShmWriter::AddToQueue(WriteEntry* entry)
+{
+    {
+        AutoCriticalSection acs(&m_cs);
+
+        BOOL wasEmpty = m_queue.IsEmpty();
+
+        m_queue.InsertAsTail(m_queue.CastIn(entry));
+        ++m_queueLength;
+
+        if (wasEmpty)
+        {
+            LogAssert(m_queueLength == 1);
+            BOOL bRet = SetEvent(m_queueHandle);
+            LogAssert(bRet != 0);
+        }
+
+        /* should block if the queue gets too deep */
+        return (m_queueLength > s_maxBuffersToBlockWriter);
+    }
+}
+
+bool RChannelBufferShmWriter::
+WriteBuffer(DryadFixedMemoryBuffer* buffer,
+            bool /* unused flushAfter */,
+            RChannelBufferWriterHandler* handler)
+{
+    WriteEntry* entry = new WriteEntry;
+    entry->m_buffer.Attach(buffer);
+    entry->m_type = RChannelItem_Data;
+    entry->m_handler = handler;
+
+    return AddToQueue(entry);
+}
+
+void RChannelBufferShmWriter::
+ReturnUnusedBuffer(DryadFixedMemoryBuffer* buffer)
+{
+    buffer->DecRef();
+}
+
+void RChannelBufferShmWriter::
+WriteTermination(RChannelItemType reasonCode,
+                 RChannelBufferWriterHandler* handler)
+{
+    WriteEntry* entry = new WriteEntry;
+    /* NULL entry->m_buffer */
+    entry->m_type = reasonCode;
+    entry->m_handler = handler;
+
+    if (reasonCode != RChannelItem_EndOfStream)
+    {
+        /* nothing more is going to be written, so don't leave the
+           write thread blocked on a full ring waiting for a reader
+           that may never drain it */
+        BOOL bRet = ::SetEvent(m_abortHandle);
+        LogAssert(bRet != 0);
+    }
+
+    AddToQueue(entry);
+}
+
+void RChannelBufferShmWriter::FillInStatus(DryadChannelDescription* status)
+{
+    AutoCriticalSection acs(&m_cs);
+
+    status->SetChannelTotalLength(m_processedLength);
+    status->SetChannelProcessedLength(m_processedLength);
+}
+
+void RChannelBufferShmWriter::Drain(RChannelItemRef* pReturnItem)
+{
+    /* Drain shouldn't have been called unless a termination item has
+       been sent, so eventually the writer thread will exit once the
+       reader has consumed everything */
+    DWORD dRet = WaitForSingleObject(m_writeThread, INFINITE);
+    LogAssert(dRet == WAIT_OBJECT_0);
+
+    LogAssert(m_queue.IsEmpty());
+    LogAssert(m_queueLength == 0);
+
+    LogAssert(m_completionItem != NULL);
+    *pReturnItem = m_completionItem;
+    m_completionItem = NULL;
+}
+
+void RChannelBufferShmWriter::Close()
+{
+    LogAssert(m_queueHandle != INVALID_HANDLE_VALUE);
+    LogAssert(m_writeThread != INVALID_HANDLE_VALUE);
+
+    BOOL bRetval = CloseHandle(m_queueHandle);
+    LogAssert(bRetval != 0);
+    m_queueHandle = INVALID_HANDLE_VALUE;
+
+    bRetval = CloseHandle(m_abortHandle);
+    LogAssert(bRetval != 0);
+    m_abortHandle = INVALID_HANDLE_VALUE;
+
+    bRetval = CloseHandle(m_writeThread);
+    LogAssert(bRetval != 0);
+    m_writeThread = INVALID_HANDLE_VALUE;
+
+    LogAssert(m_completionItem == NULL);
+}
+
+UInt64 RChannelBufferShmWriter::GetInitialSizeHint()
+{
+    return 0;
+}
+
+void RChannelBufferShmWriter::SetInitialSizeHint(UInt64 /*hint*/)
+{
+}
@@ -0,0 +1,222 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+
+#include "channelreader.h"
+#include "channelwriter.h"
+
+/*
+  A shm:// channel connects a writer and a reader in different
+  processes on the same computer through a ring buffer in a named
+  pagefile-backed section. Whichever end opens the channel first
+  creates the section; the other end attaches to it. The writer
+  copies each buffer into the ring as one or more frames and the
+  reader copies frames out into data buffers, so data never touches
+  the disk. Both ends must be running at the same time: a writer
+  blocks once the ring is full, and does not finish draining until
+  the reader has consumed the termination frame. Each end records its
+  process id in the header so the other end can stop waiting, and fail
+  the channel, if it exits.
+*/
+
+/* lives at the start of the shared section */
+struct RChannelShmRingHeader
+{
+    volatile LONG         m_magic;
+    UInt32                m_version;
+    UInt64                m_capacity;
+    volatile LONGLONG     m_writeOffset;
+    volatile LONGLONG     m_readOffset;
+    volatile LONG         m_readerClosed;
+    volatile LONG         m_writerClosed;
+    /* data bytes written, not counting frame headers */
+    volatile LONGLONG     m_dataWritten;
+    volatile LONG         m_readerProcessId;
+    volatile LONG         m_writerProcessId;
+};
+
+enum RChannelShmWaitResult {
+    SWR_Ready,
+    SWR_Aborted,
+    SWR_PeerGone
+};
+
+/* precedes each frame in the ring */
+struct RChannelShmFrameHeader
+{
+    UInt32                m_type;
+    UInt32                m_length;
+};
+
+class RChannelShmRing
+{
+public:
+    RChannelShmRing();
+    ~RChannelShmRing();
+
+    /* create or attach to the section named by uri. On failure
+       returns false and fills in a description of the error */
+    bool Open(const char* uri, bool isWriter, DrStr64& errorDescription);
+    void Close();
+
+    HANDLE GetDataEvent();
+    HANDLE GetSpaceEvent();
+
+    /* wait a bounded time for event. Returns SWR_Ready if it was
+       signaled or the wait timed out, so the caller should check the
+       ring again, SWR_Aborted if abortHandle was signaled, and
+       SWR_PeerGone if the process at the other end has exited or
+       hasn't attached within the attach timeout */
+    RChannelShmWaitResult WaitForPeer(HANDLE event, HANDLE abortHandle);
+
+    UInt64 GetCapacity();
+    UInt64 GetReadable();
+    UInt64 GetWritable();
+    UInt64 GetReadOffset();
+    UInt64 GetWriteOffset();
+    UInt64 GetDataWritten();
+
+    /* copy to or from the ring at a stream offset, wrapping at the
+       end of the ring */
+    void CopyIn(UInt64 offset, const void* src, Size_t length);
+    void CopyOut(UInt64 offset, void* dst, Size_t length);
+
+    /* make everything before offset visible to the other end and
+       wake it */
+    void PublishWrite(UInt64 offset, UInt64 dataWritten);
+    void PublishRead(UInt64 offset);
+
+    void SetReaderClosed();
+    bool IsReaderClosed();
+    void SetWriterClosed();
+    bool IsWriterClosed();
+
+private:
+    bool                           m_isWriter;
+    HANDLE                         m_section;
+    HANDLE                         m_dataEvent;
+    HANDLE                         m_spaceEvent;
+    HANDLE                         m_peerProcess;
+    bool                           m_waitingForPeer;
+    DWORD                          m_peerWaitStart;
+    RChannelShmRingHeader*         m_header;
+    unsigned char*                 m_ring;
+    UInt64                         m_capacity;
+};
+
+class RChannelBufferShmReader
+    : public RChannelBufferReader, public RChannelBufferDefaultHandler
+{
+public:
+    static const char* s_shmPrefix;
+
+    RChannelBufferShmReader(const char* uri);
+    virtual ~RChannelBufferShmReader();
+
+    void Start(RChannelBufferPrefetchInfo* prefetchCookie,
+               RChannelBufferReaderHandler* handler);
+
+    void Interrupt();
+
+    void FillInStatus(DryadChannelDescription* status);
+
+    void Drain(RChannelItem* drainItem);
+
+    void Close();
+
+    bool GetTotalLength(UInt64* pLen);
+
+    /* the RChannelBufferDefaultHandler interface */
+    void ReturnBuffer(RChannelBuffer* buffer);
+
+private:
+    static unsigned __stdcall ThreadFunc(void* a);
+    bool WaitForReadable(UInt64 length);
+    bool WaitForSemaphore();
+    void SendError(DrError errorCode, const char* description);
+    void ReadThread();
+
+    DrStr64                        m_uri;
+    RChannelShmRing                m_ring;
+    RChannelBufferReaderHandler*   m_handler;
+    HANDLE                         m_readThread;
+    HANDLE                         m_abortHandle;
+    HANDLE                         m_blockSemaphore;
+    UInt64                         m_processedLength;
+    UInt64                         m_totalLength;
+    CRITSEC                        m_cs;
+};
+
+class RChannelBufferShmWriter : public RChannelBufferWriter
+{
+public:
+    RChannelBufferShmWriter(const char* uri);
+
+    DryadFixedMemoryBuffer* GetNextWriteBuffer();
+    DryadFixedMemoryBuffer* GetCustomWriteBuffer(Size_t bufferSize);
+
+    void Start();
+
+    bool WriteBuffer(DryadFixedMemoryBuffer* buffer,
+                     bool flushAfter,
+                     RChannelBufferWriterHandler* handler);
+
+    void ReturnUnusedBuffer(DryadFixedMemoryBuffer* buffer);
+
+    void WriteTermination(RChannelItemType reasonCode,
+                          RChannelBufferWriterHandler* handler);
+
+    void FillInStatus(DryadChannelDescription* status);
+
+    void Drain(RChannelItemRef* pReturnItem);
+
+    void Close();
+
+    UInt64 GetInitialSizeHint();
+    void SetInitialSizeHint(UInt64 hint);
+
+private:
+    struct WriteEntry
+    {
+        DrRef<DryadFixedMemoryBuffer>  m_buffer;
+        RChannelItemType               m_type;
+        RChannelBufferWriterHandler*   m_handler;
+        DrBListEntry                   m_listPtr;
+    };
+
+    static unsigned __stdcall ThreadFunc(void* arg);
+    bool WaitForWritable(UInt64 length);
+    bool WriteFrame(RChannelItemType type, const void* data, UInt32 length);
+    bool WaitForReaderDrain();
+    void WriteThread();
+    bool AddToQueue(WriteEntry* entry);
+
+    DrStr64                        m_uri;
+    RChannelShmRing                m_ring;
+    DryadBList<WriteEntry>         m_queue;
+    UInt32                         m_queueLength;
+    HANDLE                         m_queueHandle;
+    HANDLE                         m_abortHandle;
+    HANDLE                         m_writeThread;
+    RChannelItemRef                m_completionItem;
+    UInt64                         m_processedLength;
+    CRITSEC                        m_cs;
+};
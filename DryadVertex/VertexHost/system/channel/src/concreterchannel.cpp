@@ -27,6 +27,7 @@ limitations under the License.
 #include <workqueue.h>
 #include <concreterchannelhelpers.h>
 #include <channelbufferhdfs.h>
+#include <channelbuffershm.h>
 #include <managedchannel.h>
 #ifdef TIDYFS
 #include <mdclient.h>
@@ -49,11 +50,22 @@ static const char* s_tidyfsPrefix = "tidyfs://";
 static const char* s_dscStreamPrefix = "hpcdsc://";
 static const char* s_dscPartitionPrefix = "hpcdscpt://";
 
+//
+// Option appended to a file:/// URI to read it through a memory
+// mapping instead of overlapped reads into aligned buffers
+//
+static const char* s_fileMappedReadOption = "?mmap=true";
+
 //
 // Use 6 to match up with retry count used between GM and VS
 //
 static const int s_dscRetryMax = 6;
 
+//
+// Largest single write that queued native file writes are combined into
+//
+static const UInt32 s_maxCoalescedFileWriteSize = 4*1024*1024;
+
 //
 // Check if channel URI is reading from an on-premise NTFS file
 //
@@ -126,6 +138,16 @@ bool ConcreteRChannel::IsFifo(const char* uri)
     return (_strnicmp(uri, s_fifoPrefix, ::strlen(s_fifoPrefix)) == 0);
 }
 
+//
+// Check if the channel URI is a shared-memory ring by comparing prefix to shm://
+//
+bool ConcreteRChannel::IsSharedMemory(const char* uri)
+{
+    return (_strnicmp(uri,
+                      RChannelBufferShmReader::s_shmPrefix,
+                      ::strlen(RChannelBufferShmReader::s_shmPrefix)) == 0);
+}
+
 //
 // Check if the channel URI is a null channel by comparing prefix to null://
 //
@@ -281,7 +303,8 @@ static RChannelBufferReader*
                            const char* fileName,
                            DryadMetaData* metaData,
                            DVErrorReporter* errorReporter,
-                           LPDWORD localInputChannels)
+                           LPDWORD localInputChannels,
+                           bool mappedRead)
 {
     UInt32 blockSize = 4*1024;
     UInt32 numberOfBlocksPerBuffer = 64 / numberOfReaders;
@@ -299,6 +322,8 @@ static RChannelBufferReader*
     {
         return NULL;
     }
+
+    fileReader->SetMappedRead(mappedRead);
 	
     //
     // Open the specified file
@@ -426,7 +451,7 @@ CreateTidyFSStreamReader(UInt32 numberOfReaders,
     } 
     DrLogI( "CreateTidyFSStreamReader", "Path: %s", path);
     delete client;
-    return CreateNativeFileReader(numberOfReaders, openThrottler, workQueue, path, metaData, errorReporter);
+    return CreateNativeFileReader(numberOfReaders, openThrottler, workQueue, path, metaData, errorReporter, NULL, false);
 }
 #endif
 
@@ -547,6 +572,8 @@ static RChannelBufferWriter*
         return NULL;
     }
 
+    fileWriter->SetMaxCoalescedWriteSize(s_maxCoalescedFileWriteSize);
+
     if (!fileWriter->OpenA(fileName))
     {
         delete fileWriter;
@@ -1165,11 +1192,22 @@ bool RChannelBufferedReaderHolder::
     else if (ConcreteRChannel::IsNTFSFile(channelURI))
     {
         //
-        // If URI is on-premise NTFS file, create the file reader right away
+        // If URI is on-premise NTFS file, create the file reader right away.
+        // Strip the mapped read option, if any, before converting to a path
         //
+        DrStr channelFileURI(channelURI);
+        bool mappedRead = false;
+        const char* option = ::strstr(channelURI, s_fileMappedReadOption);
+        if (option != NULL &&
+            option[::strlen(s_fileMappedReadOption)] == '\0')
+        {
+            channelFileURI.Set(channelURI, option - channelURI);
+            mappedRead = true;
+        }
+
 		char channelPath[MAX_PATH];
 		DWORD numChars = MAX_PATH;
-		HRESULT res = PathCreateFromUrlA(channelURI, channelPath, &numChars, NULL);
+		HRESULT res = PathCreateFromUrlA(channelFileURI.GetString(), channelPath, &numChars, NULL);
 		if (res != S_OK)
 		{
 			errorReporter->ReportError(DryadError_InvalidChannelURI, 
@@ -1183,7 +1221,8 @@ bool RChannelBufferedReaderHolder::
             CreateNativeFileReader(numberOfReaders, openThrottler,
                                    workQueue,
                                    channelPath,
-                                   metaData, errorReporter, localInputChannels);
+                                   metaData, errorReporter, localInputChannels,
+                                   mappedRead);
         lazyStart = true;
     }
     else if (ConcreteRChannel::IsHdfsPartition(channelURI))
@@ -1191,6 +1230,11 @@ bool RChannelBufferedReaderHolder::
         m_bufferReader = CreateHdfsBlockReader(channelURI);
         lazyStart = false;
     }
+    else if (ConcreteRChannel::IsSharedMemory(channelURI))
+    {
+        m_bufferReader = new RChannelBufferShmReader(channelURI);
+        lazyStart = false;
+    }
     else if (ConcreteRChannel::IsFifo(channelURI))
     {
         //
@@ -1218,12 +1262,13 @@ bool RChannelBufferedReaderHolder::
         //
         errorReporter->ReportError(DryadError_InvalidChannelURI,
                                    "Can't open channel '%s' to read --- "
-                                   "unknown prefix (must be %s, %s, %s, %s, %s, %s or %s)",
+                                   "unknown prefix (must be %s, %s, %s, %s, %s, %s, %s or %s)",
                                    channelURI,
                                    s_filePrefix, s_tidyfsPrefix, s_fifoPrefix, 
                                    s_dscPartitionPrefix,
                                    RChannelBufferHdfsReader::s_hdfsPartitionPrefix,
                                    RChannelBufferHdfsReader::s_wasbPartitionPrefix,
+                                   RChannelBufferShmReader::s_shmPrefix,
                                    s_nullPrefix);
     }
 
@@ -1354,6 +1399,10 @@ void RChannelBufferedWriterHolder::
     {
         m_bufferWriter = CreateHdfsFileWriter(channelURI);
     }
+    else if (ConcreteRChannel::IsSharedMemory(channelURI))
+    {
+        m_bufferWriter = new RChannelBufferShmWriter(channelURI);
+    }
     else if (ConcreteRChannel::IsFifo(channelURI))
     {
         errorReporter->ReportError(DryadError_InvalidChannelURI,
@@ -1365,9 +1414,10 @@ void RChannelBufferedWriterHolder::
     {
         errorReporter->ReportError(DryadError_InvalidChannelURI,
                                    "Can't open channel '%s' to write --- "
-                                   "unknown prefix (must be %s, %s or %s)",
+                                   "unknown prefix (must be %s, %s, %s or %s)",
                                    channelURI, s_filePrefix,
-                                   s_tidyfsPrefix, s_fifoPrefix);
+                                   s_tidyfsPrefix, s_fifoPrefix,
+                                   RChannelBufferShmReader::s_shmPrefix);
     }
 
     if (m_bufferWriter == NULL && errorReporter->NoError())
@@ -164,8 +164,8 @@ RChannelBuffer* ManagedHelpers::MakeEndOfStreamBuffer(RChannelBufferDefaultHandl
 RChannelBufferData* ManagedHelpers::MakeDataBuffer(UInt64 streamOffset, size_t blockSize,
                                                    RChannelBufferDefaultHandler* handler)
 {
-    DryadAlignedReadBlock* block =
-        new DryadAlignedReadBlock(blockSize, 0);
+    ManagedArenaReadBlock* block =
+        new ManagedArenaReadBlock(blockSize);
     RChannelBufferDataSettableOffset* dataBuffer =
         RChannelBufferDataSettableOffset::Create(block,
                                                  handler);
@@ -179,3 +179,81 @@ RChannelBufferData* ManagedHelpers::MakeDataBuffer(UInt64 streamOffset, size_t b
 
     return dataBuffer;
 }
+
+//
+// Point a managed Buffer at the arena array behind a lent block, so the
+// managed side can use it in place
+//
+void ManagedHelpers::LendToBuffer(Buffer^ b, int arenaHandle)
+{
+    b->data = BufferArena::Shared->Data(arenaHandle);
+    b->arenaHandle = arenaHandle;
+}
+
+//
+// Report the arena high-water mark in the channel metadata. The arena
+// is shared by every managed channel in the process, so the value is
+// the same for all of them
+//
+void ManagedHelpers::FillInArenaStatus(DryadChannelDescription* status)
+{
+    DryadMetaDataRef metaData = status->GetChannelMetaData();
+    if (metaData == NULL)
+    {
+        DryadMetaData::Create(&metaData);
+        status->SetChannelMetaData(metaData, false);
+    }
+
+    DryadMTag* oldTag = metaData->LookUpTag(Prop_Dryad_ChannelBufferArenaHighWater);
+    if (oldTag != NULL)
+    {
+        metaData->Remove(oldTag);
+    }
+    metaData->AppendUInt64(Prop_Dryad_ChannelBufferArenaHighWater,
+                           (UInt64) BufferArena::Shared->HighWaterMark,
+                           false);
+}
+
+
+ManagedArenaReadBlock::ManagedArenaReadBlock(size_t size)
+{
+    LogAssert(size < 0x80000000);
+    m_arenaHandle = BufferArena::Shared->Lend((int) size);
+    void* data = BufferArena::Shared->Address(m_arenaHandle).ToPointer();
+    this->Init((BYTE *) data, size);
+}
+
+ManagedArenaReadBlock::~ManagedArenaReadBlock()
+{
+    BufferArena::Shared->Return(m_arenaHandle);
+}
+
+void ManagedArenaReadBlock::Trim(Size_t numBytes)
+{
+    LogAssert(numBytes <= GetAvailableSize());
+    InternalSetAvailableSize(numBytes);
+}
+
+int ManagedArenaReadBlock::GetArenaHandle()
+{
+    return m_arenaHandle;
+}
+
+
+ManagedArenaWriteBlock::ManagedArenaWriteBlock(size_t size)
+{
+    LogAssert(size < 0x80000000);
+    m_arenaHandle = BufferArena::Shared->Lend((int) size);
+    void* data = BufferArena::Shared->Address(m_arenaHandle).ToPointer();
+    this->Init((BYTE *) data, size, 0);
+}
+
+ManagedArenaWriteBlock::~ManagedArenaWriteBlock()
+{
+    BufferArena::Shared->Return(m_arenaHandle);
+}
+
+int ManagedArenaWriteBlock::GetArenaHandle()
+{
+    return m_arenaHandle;
+}
@@ -76,6 +76,36 @@ private:
     void LogWithType(LogLevel type, System::String^ message, System::String^ file, System::String^ function, int line);
 };
 
+/* Channel blocks whose memory is a pinned array lent from the managed
+   BufferArena. The managed readers and writers fill or drain that
+   array in place, so nothing is copied between the native and managed
+   sides; the array goes back to the arena when the last native
+   reference to the block is released. */
+class ManagedArenaReadBlock : public DryadLockedMemoryBuffer
+{
+public:
+    ManagedArenaReadBlock(size_t size);
+    ~ManagedArenaReadBlock();
+
+    void Trim(Size_t numBytes);
+    int GetArenaHandle();
+
+private:
+    int       m_arenaHandle;
+};
+
+class ManagedArenaWriteBlock : public DryadFixedMemoryBuffer
+{
+public:
+    ManagedArenaWriteBlock(size_t size);
+    ~ManagedArenaWriteBlock();
+
+    int GetArenaHandle();
+
+private:
+    int       m_arenaHandle;
+};
+
 class ManagedHelpers
 {
 public:
@@ -86,4 +116,6 @@ public:
     static RChannelBuffer* MakeEndOfStreamBuffer(RChannelBufferDefaultHandler* handler);
     static RChannelBufferData* MakeDataBuffer(UInt64 streamOffset, size_t blockSize,
                                               RChannelBufferDefaultHandler* handler);
+    static void LendToBuffer(Buffer^ b, int arenaHandle);
+    static void FillInArenaStatus(DryadChannelDescription* status);
 };
\ No newline at end of file
@@ -87,7 +87,7 @@ public:
     virtual void ReceiveData(Buffer^ b, bool eof)
     {
         RChannelBufferDataSettableOffset* buffer = static_cast<RChannelBufferDataSettableOffset*>(b->handle.ToPointer());
-        DryadAlignedReadBlock* block = dynamic_cast<DryadAlignedReadBlock*>(buffer->GetData());
+        ManagedArenaReadBlock* block = dynamic_cast<ManagedArenaReadBlock*>(buffer->GetData());
         block->Trim(b->size);
         buffer->SetOffset(b->offset);
         native->ReceiveData(buffer, eof);
@@ -274,6 +274,8 @@ void RChannelManagedReader::FillInStatus(DryadChannelDescription* status)
     }
 
     status->SetChannelProcessedLength(m_processedLength);
+
+    ManagedHelpers::FillInArenaStatus(status);
 }
 
 void RChannelManagedReader::Close()
@@ -283,7 +285,7 @@ void RChannelManagedReader::Close()
 
 void RChannelManagedReader::ReceiveData(RChannelBufferData* buffer, bool eof)
 {
-    DrLogI("Receiving data");
+    DrTraceEvent(TraceEvent_ManagedReaderReceiveData, buffer->GetData()->GetAvailableSize(), eof);
     if (eof)
     {
         AutoCriticalSection acs(&m_cs);
@@ -343,7 +345,7 @@ void RChannelManagedReader::SignalError(int code, const char* error)
 
 void RChannelManagedReader::ReturnBuffer(RChannelBuffer* buffer)
 {
-    DrLogI("Receiving returned buffer");
+    DrTraceEvent(TraceEvent_ManagedReaderReturnBuffer, m_outstandingBuffers, 0);
     /* discard buffer */
     buffer->DecRef();
 
@@ -376,9 +378,9 @@ void RChannelManagedReader::ReturnBuffer(RChannelBuffer* buffer)
         else
         {
             LogAssert(m_state == MCR_Opened);
-            DrLogI("Supplying buffer");
+            DrTraceEvent(TraceEvent_ManagedReaderSupplyBuffer, m_outstandingBuffers, 0);
             SupplyBuffer();
-            DrLogI("Done supplying buffer");
+            DrTraceEvent(TraceEvent_ManagedReaderSupplyBufferDone, m_outstandingBuffers, 0);
         }
     }
 
@@ -409,6 +411,11 @@ void RChannelManagedReader::SupplyBuffer()
     b->storage = System::IntPtr(buffer->GetData()->GetDataAddress(0, &s, NULL));
     b->handle = System::IntPtr(buffer);
 
+    /* the block is arena memory, so the reader can fill it in place */
+    ManagedArenaReadBlock* block = dynamic_cast<ManagedArenaReadBlock*>(buffer->GetData());
+    LogAssert(block != NULL);
+    ManagedHelpers::LendToBuffer(b, block->GetArenaHandle());
+
     Managed()->SupplyBuffer(b);
 }
 
@@ -175,7 +175,15 @@ DryadFixedMemoryBuffer* RChannelManagedWriter::GetNextWriteBuffer()
 
 DryadFixedMemoryBuffer* RChannelManagedWriter::GetCustomWriteBuffer(Size_t bufferSize)
 {
-    return new DryadAlignedWriteBlock(bufferSize, m_bufferAlignment);
+    if (m_bufferAlignment == 0 && bufferSize < 0x80000000)
+    {
+        /* lend arena memory so the writer can send it without a copy */
+        return new ManagedArenaWriteBlock(bufferSize);
+    }
+    else
+    {
+        return new DryadAlignedWriteBlock(bufferSize, m_bufferAlignment);
+    }
 }
 
 void RChannelManagedWriter::ReturnUnusedBuffer(DryadFixedMemoryBuffer* buffer)
@@ -227,6 +235,12 @@ bool RChannelManagedWriter::WriteBuffer(DryadFixedMemoryBuffer* buffer,
         m_nextOffset += dataToWrite;
     }
 
+    ManagedArenaWriteBlock* block = dynamic_cast<ManagedArenaWriteBlock*>(buffer);
+    if (block != NULL)
+    {
+        ManagedHelpers::LendToBuffer(b, block->GetArenaHandle());
+    }
+
     // the return code specifies whether the producer should block until outstanding
     // writes complete
     return Managed()->Write(b);
@@ -274,7 +288,11 @@ void RChannelManagedWriter::ReturnBuffer(Buffer^ b, DrError code, const char* er
 
     delete holder;
 
-    DrLogI("Returning buffer offset %I64d size %d code %08x error %s", b->offset, b->size, code, errorMessage);
+    DrTraceEvent(TraceEvent_ManagedWriterReturnBuffer, b->offset, b->size);
+    if (errorMessage != NULL)
+    {
+        DrLogW("Returning buffer offset %I64d size %d code %08x error %s", b->offset, b->size, code, errorMessage);
+    }
 
     RChannelItemType status = RChannelItem_Data;
     {
@@ -318,6 +336,8 @@ void RChannelManagedWriter::FillInStatus(DryadChannelDescription* status)
 
     status->SetChannelTotalLength(0);
     status->SetChannelProcessedLength(m_processedLength);
+
+    ManagedHelpers::FillInArenaStatus(status);
 }
 
 void RChannelManagedWriter::Drain(RChannelItemRef* pReturnItem)
@@ -27,6 +27,7 @@ limitations under the License.
 #include "Dryad.h"
 #include "DrErrorDef.h"
 #include "DrLogging.h"
+#include "DrTrace.h"
 #include "DrFunctions.h"
 #include "DrHash.h"
 #include "MSMutex.h"
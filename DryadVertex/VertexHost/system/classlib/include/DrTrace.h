@@ -0,0 +1,112 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+
+//
+// Binary event tracing for per-buffer hot paths, where formatting and flushing a DrLogI line
+// costs more than the work being logged. Each thread appends fixed-size records to its own
+// ring without taking a lock; a background thread drains the rings to a compact file that
+// DryadTraceDecoder turns back into text.
+//
+// Tracing is off unless DrTrace::Initialize has been called with a file name, in which case
+// DrTraceEvent costs one branch.
+//
+#define DrTraceEvent(_id,_arg0,_arg1) \
+    if (DrTrace::Enabled()) DrTrace::Event(_id,(UInt64)(_arg0),(UInt64)(_arg1))
+
+#define DeclareTraceEvent(_id,_name,_arg0Name,_arg1Name) _id
+typedef enum
+{
+#include "DrTraceEventIds.h"
+    TraceEvent_End
+} DrTraceEventId;
+#undef DeclareTraceEvent
+
+//
+// On-disk layout. The file starts with a DrTraceFileHeader, followed by eventCount
+// DrTraceEventName entries each followed by its three strings, followed by
+// DrTraceRecords until the end of the file. Records from different threads are
+// interleaved in flush order, not timestamp order.
+//
+#define DR_TRACE_FILE_MAGIC "DRTRACE1"
+#define DR_TRACE_FILE_VERSION 1
+
+#pragma pack(push, 1)
+struct DrTraceFileHeader
+{
+    char        magic[8];
+    UInt32      version;
+    UInt32      processId;
+    UInt64      counterFrequency;   // QueryPerformanceFrequency
+    UInt64      counterStart;       // QueryPerformanceCounter when the trace started
+    UInt64      fileTimeStart;      // UTC FILETIME when the trace started
+    UInt32      eventCount;
+    UInt32      recordSize;
+};
+
+struct DrTraceEventName
+{
+    UInt16      id;
+    UInt16      nameLength;         // lengths in bytes of the three strings that follow,
+    UInt16      arg0NameLength;     // without terminators
+    UInt16      arg1NameLength;
+};
+
+struct DrTraceRecord
+{
+    UInt64      timestamp;          // QueryPerformanceCounter
+    UInt16      id;
+    UInt16      reserved;
+    UInt32      threadId;
+    UInt64      arg0;
+    UInt64      arg1;
+};
+#pragma pack(pop)
+
+class DrTrace
+{
+public:
+    //
+    // Open the trace file and start the flusher. Tracing stays off if the file can't be
+    // created.
+    //
+    static void Initialize(const WCHAR* traceFileName);
+
+    static bool Enabled()
+    {
+        return s_enabled;
+    }
+
+    static void Event(DrTraceEventId id, UInt64 arg0, UInt64 arg1);
+
+    //
+    // Drain every ring to the file now rather than waiting for the flusher
+    //
+    static void Flush();
+
+    //
+    // Stop the flusher, drain what remains and close the file
+    //
+    static void Shutdown();
+
+private:
+    static volatile bool s_enabled;
+};
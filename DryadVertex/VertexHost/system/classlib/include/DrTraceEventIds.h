@@ -0,0 +1,46 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+//
+// This file lists all the binary trace events.
+//
+// This file is included twice, with DeclareTraceEvent() defined to do different things, to
+// build the DrTraceEventId enum and the name table that is written at the head of every
+// trace file, so a trace can be decoded without access to this header.
+//
+// The IDs MUST be sequential, starting with TraceEvent_RecordsDropped
+// Append new events at the end; do not reorder or reuse existing ones
+//
+// Each event carries two 64-bit arguments; the quoted strings are the event name and the
+// names the decoder prints for its arguments ("" if the argument is unused)
+//
+
+// Written by the flusher, not by callers: a thread's ring was full and this many records
+// from that thread were discarded
+DeclareTraceEvent(TraceEvent_RecordsDropped,                  "RecordsDropped",               "count",        ""),
+
+// managed channel reader buffer traffic
+DeclareTraceEvent(TraceEvent_ManagedReaderReceiveData,        "ManagedReaderReceiveData",     "size",         "eof"),
+DeclareTraceEvent(TraceEvent_ManagedReaderReturnBuffer,       "ManagedReaderReturnBuffer",    "outstanding",  ""),
+DeclareTraceEvent(TraceEvent_ManagedReaderSupplyBuffer,       "ManagedReaderSupplyBuffer",    "outstanding",  ""),
+DeclareTraceEvent(TraceEvent_ManagedReaderSupplyBufferDone,   "ManagedReaderSupplyBufferDone","outstanding",  ""),
+
+// managed channel writer buffer traffic
+DeclareTraceEvent(TraceEvent_ManagedWriterReturnBuffer,       "ManagedWriterReturnBuffer",    "offset",       "size"),
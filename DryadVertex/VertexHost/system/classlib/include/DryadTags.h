@@ -55,3 +55,5 @@ DEFINE_DRYADTAG(DryadTag_RSClientStatusRequest, 10024, "RSClientStatusRequest",
 DEFINE_DRYADTAG(DryadTag_RSClientMatch, 10025, "RSClientMatch", MetaData)
 DEFINE_DRYADTAG(DryadTag_RSRevocation, 10026, "RSRevocation", MetaData)
 DEFINE_DRYADTAG(DryadTag_RSClientCommand, 10027, "RSClientCommand", MetaData)
+DEFINE_DRYADTAG(DryadTag_VertexCommandBatch, 10028, "VertexCommandBatch", MetaData)
+DEFINE_DRYADTAG(DryadTag_VertexStatusBatch, 10029, "VertexStatusBatch", MetaData)
@@ -467,10 +467,11 @@ void DrExitProcess(UInt32 exitCode)
     }
     
     //
-    // Flush output logs
+    // Flush output logs and the binary trace
     //
     fflush(stdout);
     DrLogging::FlushLog();
+    DrTrace::Shutdown();
 
     //
     // Exit the current process
@@ -0,0 +1,364 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include "DrCommon.h"
+#include <process.h>
+
+#pragma unmanaged
+
+//
+// Records per thread. A ring is 32KB; a thread that outruns the flusher for longer than
+// one flush interval loses records rather than waiting, and the loss is recorded in the
+// trace as a RecordsDropped event.
+//
+static const UInt32 c_ringRecords = 1024;
+static const UInt32 c_ringMask = c_ringRecords - 1;
+
+//
+// How often the flusher drains the rings
+//
+static const DWORD c_flushIntervalMs = 100;
+
+//
+// A single-producer single-consumer ring. Only the owning thread advances m_head and
+// only the flusher, holding s_flushLock, advances m_tail. Both are volatile so that on
+// x86/x64 the store to m_head is ordered after the record it publishes and the store to
+// m_tail after the record has been copied out.
+//
+struct DrTraceRing
+{
+    DrTraceRing*        m_next;
+    volatile LONG       m_owned;
+    DWORD               m_threadId;
+    HANDLE              m_thread;
+    volatile UInt32     m_head;
+    volatile UInt32     m_tail;
+    volatile LONG       m_dropped;
+    DrTraceRecord       m_records[c_ringRecords];
+};
+
+#define DeclareTraceEvent(_id,_name,_arg0Name,_arg1Name) { _name, _arg0Name, _arg1Name }
+static const char* s_traceEventNames[TraceEvent_End][3] =
+{
+#include "DrTraceEventIds.h"
+};
+#undef DeclareTraceEvent
+
+volatile bool DrTrace::s_enabled = false;
+
+//
+// Rings are only ever pushed onto this list, never removed; a ring whose thread has exited
+// is released by the flusher and claimed by the next thread that starts tracing
+//
+static DrTraceRing* volatile s_rings = NULL;
+static DrTlsPtr<DrTraceRing>* s_ringTls = NULL;
+
+static FILE*  s_traceFile = NULL;
+static CRITSEC s_flushLock;
+static HANDLE s_stopEvent = NULL;
+static HANDLE s_flusherThread = NULL;
+
+//
+// Find or create the ring for the calling thread
+//
+static DrTraceRing* GetThreadRing()
+{
+    DrTraceRing* ring = *s_ringTls;
+    if (ring != NULL)
+    {
+        return ring;
+    }
+
+    bool allocated = false;
+    for (ring = s_rings; ring != NULL; ring = ring->m_next)
+    {
+        if (ring->m_owned == 0 && ::InterlockedCompareExchange(&ring->m_owned, 1, 0) == 0)
+        {
+            break;
+        }
+    }
+
+    if (ring == NULL)
+    {
+        ring = (DrTraceRing*) ::VirtualAlloc(NULL, sizeof(DrTraceRing), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (ring == NULL)
+        {
+            return NULL;
+        }
+
+        ring->m_owned = 1;
+        ring->m_head = 0;
+        ring->m_tail = 0;
+        ring->m_dropped = 0;
+        allocated = true;
+    }
+
+    ring->m_threadId = ::GetCurrentThreadId();
+
+    //
+    // Keep a real handle so the flusher can tell when this thread exits and the ring can
+    // be handed to another thread
+    //
+    HANDLE self = NULL;
+    BOOL bRet = ::DuplicateHandle(::GetCurrentProcess(), ::GetCurrentThread(),
+                                  ::GetCurrentProcess(), &self,
+                                  SYNCHRONIZE, FALSE, 0);
+    ring->m_thread = (bRet) ? self : NULL;
+
+    if (allocated)
+    {
+        DrTraceRing* head;
+        do
+        {
+            head = s_rings;
+            ring->m_next = head;
+        } while (::InterlockedCompareExchangePointer((PVOID volatile*) &s_rings, ring, head) != head);
+    }
+
+    *s_ringTls = ring;
+    return ring;
+}
+
+void DrTrace::Event(DrTraceEventId id, UInt64 arg0, UInt64 arg1)
+{
+    DrTraceRing* ring = GetThreadRing();
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    UInt32 head = ring->m_head;
+    if (head - ring->m_tail >= c_ringRecords)
+    {
+        ::InterlockedIncrement(&ring->m_dropped);
+        return;
+    }
+
+    LARGE_INTEGER now;
+    ::QueryPerformanceCounter(&now);
+
+    DrTraceRecord* record = &ring->m_records[head & c_ringMask];
+    record->timestamp = (UInt64) now.QuadPart;
+    record->id = (UInt16) id;
+    record->reserved = 0;
+    record->threadId = ring->m_threadId;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+
+    ring->m_head = head + 1;
+}
+
+//
+// Copy everything currently published in one ring to the file. Called with s_flushLock held.
+//
+static void DrainRing(DrTraceRing* ring)
+{
+    UInt32 tail = ring->m_tail;
+    UInt32 head = ring->m_head;
+
+    while (tail != head)
+    {
+        UInt32 first = tail & c_ringMask;
+        UInt32 count = head - tail;
+        if (first + count > c_ringRecords)
+        {
+            count = c_ringRecords - first;
+        }
+
+        fwrite(&ring->m_records[first], sizeof(DrTraceRecord), count, s_traceFile);
+        tail += count;
+    }
+
+    ring->m_tail = tail;
+
+    LONG dropped = ::InterlockedExchange(&ring->m_dropped, 0);
+    if (dropped > 0)
+    {
+        LARGE_INTEGER now;
+        ::QueryPerformanceCounter(&now);
+
+        DrTraceRecord record;
+        record.timestamp = (UInt64) now.QuadPart;
+        record.id = (UInt16) TraceEvent_RecordsDropped;
+        record.reserved = 0;
+        record.threadId = ring->m_threadId;
+        record.arg0 = (UInt64) dropped;
+        record.arg1 = 0;
+        fwrite(&record, sizeof(record), 1, s_traceFile);
+    }
+}
+
+static void DrainAllRings()
+{
+    AutoCriticalSection acs(&s_flushLock);
+
+    if (s_traceFile == NULL)
+    {
+        return;
+    }
+
+    for (DrTraceRing* ring = s_rings; ring != NULL; ring = ring->m_next)
+    {
+        if (ring->m_owned == 0)
+        {
+            continue;
+        }
+
+        //
+        // Sample liveness before draining so that nothing the thread wrote before exiting
+        // is left behind when the ring is released
+        //
+        bool exited = (ring->m_thread != NULL &&
+                       ::WaitForSingleObject(ring->m_thread, 0) == WAIT_OBJECT_0);
+
+        DrainRing(ring);
+
+        if (exited)
+        {
+            ::CloseHandle(ring->m_thread);
+            ring->m_thread = NULL;
+            ::InterlockedExchange(&ring->m_owned, 0);
+        }
+    }
+
+    fflush(s_traceFile);
+}
+
+static unsigned __stdcall FlusherThreadFunc(void* /*unused*/)
+{
+    while (::WaitForSingleObject(s_stopEvent, c_flushIntervalMs) == WAIT_TIMEOUT)
+    {
+        DrainAllRings();
+    }
+
+    return 0;
+}
+
+static bool WriteTraceHeader(FILE* f)
+{
+    LARGE_INTEGER frequency, counter;
+    ::QueryPerformanceFrequency(&frequency);
+    ::QueryPerformanceCounter(&counter);
+
+    FILETIME ft;
+    ::GetSystemTimeAsFileTime(&ft);
+
+    DrTraceFileHeader header;
+    memcpy(header.magic, DR_TRACE_FILE_MAGIC, sizeof(header.magic));
+    header.version = DR_TRACE_FILE_VERSION;
+    header.processId = ::GetCurrentProcessId();
+    header.counterFrequency = (UInt64) frequency.QuadPart;
+    header.counterStart = (UInt64) counter.QuadPart;
+    header.fileTimeStart = ((UInt64) ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    header.eventCount = TraceEvent_End;
+    header.recordSize = sizeof(DrTraceRecord);
+
+    if (fwrite(&header, sizeof(header), 1, f) != 1)
+    {
+        return false;
+    }
+
+    for (UInt16 i = 0; i < TraceEvent_End; ++i)
+    {
+        DrTraceEventName name;
+        name.id = i;
+        name.nameLength = (UInt16) strlen(s_traceEventNames[i][0]);
+        name.arg0NameLength = (UInt16) strlen(s_traceEventNames[i][1]);
+        name.arg1NameLength = (UInt16) strlen(s_traceEventNames[i][2]);
+
+        if (fwrite(&name, sizeof(name), 1, f) != 1 ||
+            fwrite(s_traceEventNames[i][0], 1, name.nameLength, f) != name.nameLength ||
+            fwrite(s_traceEventNames[i][1], 1, name.arg0NameLength, f) != name.arg0NameLength ||
+            fwrite(s_traceEventNames[i][2], 1, name.arg1NameLength, f) != name.arg1NameLength)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void DrTrace::Initialize(const WCHAR* traceFileName)
+{
+    LogAssert(s_traceFile == NULL);
+
+    FILE* f = _wfsopen(traceFileName, L"wb", _SH_DENYWR);
+    if (f == NULL)
+    {
+        DrLogW("Can't create trace file %ls, tracing disabled", traceFileName);
+        return;
+    }
+
+    if (!WriteTraceHeader(f))
+    {
+        DrLogW("Can't write trace file %ls, tracing disabled", traceFileName);
+        fclose(f);
+        return;
+    }
+
+    s_ringTls = new DrTlsPtr<DrTraceRing>();
+    s_traceFile = f;
+
+    s_stopEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    LogAssert(s_stopEvent != NULL);
+
+    unsigned threadAddr;
+    s_flusherThread =
+        (HANDLE) ::_beginthreadex(NULL,
+                                  0,
+                                  FlusherThreadFunc,
+                                  NULL,
+                                  0,
+                                  &threadAddr);
+    LogAssert(s_flusherThread != 0);
+
+    s_enabled = true;
+
+    DrLogI("Binary tracing to %ls", traceFileName);
+}
+
+void DrTrace::Flush()
+{
+    DrainAllRings();
+}
+
+void DrTrace::Shutdown()
+{
+    if (s_traceFile == NULL)
+    {
+        return;
+    }
+
+    //
+    // Leave s_enabled set: a thread that is still running can keep appending to its ring
+    // safely, its records just won't reach the file
+    //
+    ::SetEvent(s_stopEvent);
+    DWORD dRet = ::WaitForSingleObject(s_flusherThread, INFINITE);
+    LogAssert(dRet == WAIT_OBJECT_0);
+    ::CloseHandle(s_flusherThread);
+    s_flusherThread = NULL;
+
+    DrainAllRings();
+
+    AutoCriticalSection acs(&s_flushLock);
+    fclose(s_traceFile);
+    s_traceFile = NULL;
+}
@@ -108,6 +108,12 @@ public:
 
 typedef DrRef<DObjFactoryBase> DObjFactoryRef;
 
+/* the central tier of the pool is split by NUMA node. Objects handed
+   back by a thread go to the central cache of the node that thread is
+   running on, and threads refill their local caches only from their
+   own node, allocating fresh objects on the calling thread when the
+   node's cache is empty. maxCentralEntries is shared out between the
+   nodes. */
 class DObjPoolBase : public DObjFactoryBase
 {
 public:
@@ -126,6 +132,25 @@ protected:
     DObjFactoryBase* DetachFactory();
 
 private:
+    class NodeCache
+    {
+    public:
+        NodeCache();
+        ~NodeCache();
+
+        UInt32                   m_numberOfEntries;
+        void**                   m_array;
+
+        UInt64                   m_totalGivenOut;
+        UInt64                   m_totalReturned;
+        UInt64                   m_totalAllocated;
+        UInt64                   m_totalFreed;
+
+        CRITSEC                  m_atomic;
+    };
+
+    static UInt32 GetCurrentNode();
+
     DObjPoolCache* MakeCache();
     DObjPoolCache* FetchPrivateCache();
 
@@ -134,18 +159,13 @@ private:
     UInt32                   m_maxLocalEntries;
     UInt32                   m_localKeepEntryCount;
 
-    UInt32                   m_numberOfCentralEntries;
-    void**                   m_array;
+    UInt32                   m_numberOfNodes;
+    NodeCache*               m_node;
 
     UInt32                   m_cacheArraySize;
     UInt32                   m_numberOfCaches;
     DObjPoolCache**          m_cache;
 
-    UInt64                   m_totalGivenOut;
-    UInt64                   m_totalReturned;
-    UInt64                   m_totalAllocated;
-    UInt64                   m_totalFreed;
-
     LONGLONG                 m_key;
     CRITSEC                  m_atomic;
 };
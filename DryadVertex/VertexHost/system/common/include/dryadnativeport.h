@@ -68,6 +68,14 @@ public:
     void QueueNativeRead(HANDLE fileHandle, Handler* request);
 
     void QueueNativeWrite(HANDLE fileHandle, Handler* request);
+
+    /* segments is a NULL-terminated array of page-sized, page-aligned
+       pieces; fileHandle must have been opened unbuffered. The
+       array must remain valid until the request completes */
+    void QueueNativeGatherWrite(HANDLE fileHandle, Handler* request,
+                                FILE_SEGMENT_ELEMENT* segments);
+
+    void QueueCompletion(Handler* request, UInt32 numBytes);
 /*JC    void QueueDryadWrite(DRHANDLE streamHandle,
                           DrError* pendingStatePtr,
                           UInt64 streamOffset,
@@ -106,6 +114,7 @@ private:
 
     static unsigned __stdcall WriteFileThreadBase(void* arg);
     void WriteFileThread();
+    void AddWriteFileRequest(WriteFileRequest* wfr);
 
     BufferPortState   m_state;
 
@@ -118,14 +127,17 @@ private:
     class WriteFileRequest
     {
     public:
-        WriteFileRequest(HANDLE h, Handler* hh)
+        WriteFileRequest(HANDLE h, Handler* hh,
+                         FILE_SEGMENT_ELEMENT* segments = NULL)
         {
             m_fileHandle = h;
             m_request = hh;
+            m_segments = segments;
         }
 
         HANDLE               m_fileHandle;
         Handler*             m_request;
+        FILE_SEGMENT_ELEMENT* m_segments;
         DrBListEntry         m_listPtr;
     };
     typedef DryadBList<WriteFileRequest> DryadWriteFileList;
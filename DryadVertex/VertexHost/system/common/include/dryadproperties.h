@@ -30,6 +30,11 @@ DEFINE_DRPROPERTY(Prop_Dryad_StreamExpireTimeWhileOpen, PROP_SHORTATOM(0x4007),
 DEFINE_DRPROPERTY(Prop_Dryad_StreamExpireTimeWhileClosed, PROP_SHORTATOM(0x4008), TimeInterval, "StreamExpireTimeWhileClosed")
 DEFINE_DRPROPERTY(Prop_Dryad_ChannelErrorCode, PROP_SHORTATOM(0x4009), DrError, "ChannelErrorCode")
 DEFINE_DRPROPERTY(Prop_Dryad_ChannelErrorString, PROP_LONGATOM(0x400a), String, "ChannelErrorString")
+DEFINE_DRPROPERTY(Prop_Dryad_ChannelBufferArenaHighWater, PROP_SHORTATOM(0x400b), UInt64, "ChannelBufferArenaHighWater")
+DEFINE_DRPROPERTY(Prop_Dryad_ChannelUploadTime, PROP_SHORTATOM(0x400c), TimeInterval, "ChannelUploadTime")
+DEFINE_DRPROPERTY(Prop_Dryad_ChannelPeakBytesInFlight, PROP_SHORTATOM(0x400d), UInt64, "ChannelPeakBytesInFlight")
+DEFINE_DRPROPERTY(Prop_Dryad_ChannelStallCount, PROP_SHORTATOM(0x400e), UInt32, "ChannelStallCount")
+DEFINE_DRPROPERTY(Prop_Dryad_ChannelStallTime, PROP_SHORTATOM(0x400f), TimeInterval, "ChannelStallTime")
 
 DEFINE_DRPROPERTY(Prop_Dryad_VertexState, PROP_SHORTATOM(0x4010), DrError, "VertexState")
 DEFINE_DRPROPERTY(Prop_Dryad_VertexErrorCode, PROP_SHORTATOM(0x4011), DrError, "VertexErrorCode")
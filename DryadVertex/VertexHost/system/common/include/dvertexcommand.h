@@ -189,6 +189,7 @@ public:
     static void GetPnPropertyLabel(DrStr* pDstString,
                                    UInt32 vertexId, UInt32 vertexVersion,
                                    bool notifyWaiters);
+    static void GetPnBatchPropertyLabel(DrStr* pDstString);
 
 private:
     DrError                           m_state;
@@ -241,3 +242,29 @@ private:
     bool                              m_setBreakpointOnCommandArrival;
     UInt32                            m_nextArgumentToRead;
 };
+
+//
+// Start commands for several vertices hosted by the same process, sent by
+// the GM as a single property when a cohort starts them together
+//
+class DVertexCommandBatch : public DrPropertyParser, public DrRefCounter
+{
+public:
+    DVertexCommandBatch();
+    ~DVertexCommandBatch();
+
+    UInt32 GetNumberOfCommands();
+    DVertexCommandBlock* GetCommand(UInt32 index);
+
+    DrError OnParseProperty(DrMemoryReader *reader, UInt16 enumID,
+                            UInt32 dataLen, void *cookie);
+
+    DrError ReadFromResponseMessage(DryadPnProcessPropertyResponse* response);
+
+    static void GetPnPropertyLabel(DrStr* pDstString);
+
+private:
+    UInt32                            m_nCommands;
+    UInt32                            m_nextCommandToRead;
+    DrRef<DVertexCommandBlock>*       m_command;
+};
@@ -81,6 +81,20 @@ private:
     size_t    m_alignment;
 };
 
+class DryadMappedReadBlock : public DryadLockedMemoryBuffer
+{
+public:
+    DryadMappedReadBlock(HANDLE mappingHandle, UInt64 offset, size_t size);
+    ~DryadMappedReadBlock();
+
+    bool IsMapped();
+
+    void* GetData();
+
+private:
+    void*     m_view;
+};
+
 class DryadAlignedWriteBlock : public DryadFixedMemoryBuffer
 {
 public:
@@ -42,32 +42,97 @@ class WorkQueue {
  public:
     WorkQueue(DWORD numWorkerThreads,
               DWORD numConcurrentThreads);
-    ~WorkQueue();
+    virtual ~WorkQueue();
 
-    void Start();
-    bool EnQueue(WorkRequest* request);
+    /* returns a WorkStealingQueue if DRYAD_WORK_STEALING is set to a
+       non-zero value in the environment, otherwise a WorkQueue */
+    static WorkQueue* MakeWorkQueue(DWORD numWorkerThreads,
+                                    DWORD numConcurrentThreads);
 
-    void Clean();
-    void Stop();
+    virtual void Start();
+    virtual bool EnQueue(WorkRequest* request);
 
-private:
+    virtual void Clean();
+    virtual void Stop();
+
+protected:
     enum WorkQueueState {
         WQS_Stopped,
         WQS_Running,
         WQS_Stopping
     };
 
-    static unsigned __stdcall ThreadFunc(void* arg);
-
-    WorkRequestList   m_list; /* list of WorkRequest items */
-
-    WorkQueueState    m_state;
+    LONG volatile     m_state; /* a WorkQueueState */
 
     DWORD             m_numWorkerThreads;
     DWORD             m_numConcurrentThreads;
     HANDLE            m_completionPort;
     HANDLE*           m_threadHandle;
-    DWORD             m_numQueuedWakeUps;
 
     CRITSEC           m_baseCS;
+
+private:
+
+    static unsigned __stdcall ThreadFunc(void* arg);
+
+    WorkRequestList   m_list; /* list of WorkRequest items */
+
+    DWORD             m_numQueuedWakeUps;
+};
+
+//
+// WorkQueue with one list per worker thread. A request enqueued from a
+// worker thread goes on that worker's own list and other requests are
+// spread round-robin, so the only lock taken on the common path is the
+// per-list lock. A worker with an empty list steals from the tail of
+// another worker's list before going to sleep. Sleeping workers wait on
+// the completion port, so as with WorkQueue at most numConcurrentThreads
+// of them run at once unless one of the running workers blocks.
+//
+class WorkStealingQueue : public WorkQueue {
+ public:
+    WorkStealingQueue(DWORD numWorkerThreads,
+                      DWORD numConcurrentThreads);
+    ~WorkStealingQueue();
+
+    void Start();
+    bool EnQueue(WorkRequest* request);
+
+    void Clean();
+    void Stop();
+
+private:
+    class WorkerList
+    {
+    public:
+        WorkerList();
+
+        WorkStealingQueue*   m_parent;
+        DWORD                m_index;
+        WorkRequestList      m_list;
+        LONG volatile        m_count;
+        CRITSEC              m_cs;
+    };
+
+    static unsigned __stdcall ThreadFunc(void* arg);
+
+    bool BeginEnQueue();
+    void EndEnQueue();
+    void AddToList(WorkerList* worker, WorkRequest* request);
+    WorkRequest* TakeFromHead(WorkerList* worker);
+    WorkRequest* TakeFromTail(WorkerList* worker);
+    WorkRequest* FindWork(WorkerList* self);
+
+    WorkerList*       m_worker;
+    HANDLE            m_enQueueDoneEvent;
+    DWORD             m_tlsSlot;
+
+    LONG volatile     m_exiting;
+    LONG volatile     m_numPending;
+    LONG volatile     m_numSleeping;
+    LONG volatile     m_numPostedWakeUps;
+    /* the number of EnQueue calls adding a request, plus
+       DWORKQUEUE_STOPPING once Stop has started */
+    LONG volatile     m_numEnQueuing;
+    LONG volatile     m_nextWorker;
 };
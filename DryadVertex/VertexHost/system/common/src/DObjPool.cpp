@@ -247,22 +247,32 @@ DObjPoolBase::DObjPoolBase(DObjFactoryBase* factory,
 
     LogAssert(factory != NULL);
     m_factory = factory;
-    m_maxCentralEntries = maxCentralEntries;
     m_maxLocalEntries = maxLocalEntries;
     m_localKeepEntryCount = localKeepEntryCount;
 
-    m_array = new void* [m_maxCentralEntries];
-    m_numberOfCentralEntries = 0;
+    ULONG highestNode;
+    if (::GetNumaHighestNodeNumber(&highestNode) == 0)
+    {
+        highestNode = 0;
+    }
+    m_numberOfNodes = highestNode + 1;
+
+    /* share the central entries out between the nodes, rounding up
+       so a small pool still keeps something on every node */
+    m_maxCentralEntries =
+        (maxCentralEntries + m_numberOfNodes - 1) / m_numberOfNodes;
+
+    m_node = new NodeCache[m_numberOfNodes];
+    UInt32 i;
+    for (i=0; i<m_numberOfNodes; ++i)
+    {
+        m_node[i].m_array = new void* [m_maxCentralEntries];
+    }
 
     m_cacheArraySize = 32;
     m_cache = new DObjPoolCache* [m_cacheArraySize];
     m_numberOfCaches = 0;
 
-    m_totalGivenOut = 0;
-    m_totalReturned = 0;
-    m_totalAllocated = 0;
-    m_totalFreed = 0;
-
     /* make sure we have exactly one TLS entry for all pools */
     if (s_refPoolGlobalCritSec == NULL)
     {
@@ -296,16 +306,73 @@ DObjPoolBase::~DObjPoolBase()
     }
     delete [] m_cache;
 
-    LogAssert(m_totalGivenOut == m_totalReturned);
-    LogAssert(m_numberOfCentralEntries + m_totalFreed == m_totalAllocated);
+    /* objects can be handed out on one node and returned on another,
+       so the counts only balance when summed over all the nodes */
+    UInt64 totalGivenOut = 0;
+    UInt64 totalReturned = 0;
+    UInt64 totalAllocated = 0;
+    UInt64 totalFreed = 0;
+    UInt64 totalCentralEntries = 0;
 
-    for (i=0; i<m_numberOfCentralEntries; ++i)
+    for (i=0; i<m_numberOfNodes; ++i)
     {
-        m_factory->FreeObjectUntyped(m_array[i]);
+        NodeCache* node = &(m_node[i]);
+
+        /* objects handed out that didn't have to be allocated came from
+           the node's cache */
+        DrLogI( "Pool node statistics. Pool %p node %u hits %I64u misses %I64u",
+            this, i, node->m_totalGivenOut - node->m_totalAllocated,
+            node->m_totalAllocated);
+
+        totalGivenOut += node->m_totalGivenOut;
+        totalReturned += node->m_totalReturned;
+        totalAllocated += node->m_totalAllocated;
+        totalFreed += node->m_totalFreed;
+        totalCentralEntries += node->m_numberOfEntries;
+
+        UInt32 j;
+        for (j=0; j<node->m_numberOfEntries; ++j)
+        {
+            m_factory->FreeObjectUntyped(node->m_array[j]);
+        }
     }
+
+    LogAssert(totalGivenOut == totalReturned);
+    LogAssert(totalCentralEntries + totalFreed == totalAllocated);
+
+    delete [] m_node;
+}
+
+DObjPoolBase::NodeCache::NodeCache()
+{
+    m_numberOfEntries = 0;
+    m_array = NULL;
+    m_totalGivenOut = 0;
+    m_totalReturned = 0;
+    m_totalAllocated = 0;
+    m_totalFreed = 0;
+}
+
+DObjPoolBase::NodeCache::~NodeCache()
+{
     delete [] m_array;
 }
 
+UInt32 DObjPoolBase::GetCurrentNode()
+{
+    /* the Ex versions see processors beyond the first group of 64 */
+    PROCESSOR_NUMBER processor;
+    ::GetCurrentProcessorNumberEx(&processor);
+
+    USHORT node;
+    if (::GetNumaProcessorNodeEx(&processor, &node) == 0)
+    {
+        return 0;
+    }
+
+    return node;
+}
+
 DObjFactoryBase* DObjPoolBase::DetachFactory()
 {
     LogAssert(m_factory != NULL);
@@ -314,11 +381,18 @@ DObjFactoryBase* DObjPoolBase::DetachFactory()
 
 void DObjPoolBase::AcceptObjects(void** src, UInt32 count)
 {
+    UInt32 nodeIndex = GetCurrentNode();
+    if (nodeIndex >= m_numberOfNodes)
+    {
+        nodeIndex = 0;
+    }
+    NodeCache* node = &(m_node[nodeIndex]);
+
     UInt32 i;
     {
-        AutoCriticalSection acs(&m_atomic);
+        AutoCriticalSection acs(&(node->m_atomic));
 
-        UInt32 freeSpace = m_maxCentralEntries - m_numberOfCentralEntries;
+        UInt32 freeSpace = m_maxCentralEntries - node->m_numberOfEntries;
         if (freeSpace > count)
         {
             freeSpace = count;
@@ -327,17 +401,17 @@ void DObjPoolBase::AcceptObjects(void** src, UInt32 count)
         for (i=0; i<freeSpace; ++i)
         {
             LogAssert(src[i] != NULL);
-            m_array[m_numberOfCentralEntries + i] = src[i];
+            node->m_array[node->m_numberOfEntries + i] = src[i];
         }
-        m_numberOfCentralEntries += freeSpace;
+        node->m_numberOfEntries += freeSpace;
 
-        m_totalReturned += count;
-        m_totalFreed += (count - i);
+        node->m_totalReturned += count;
+        node->m_totalFreed += (count - i);
 
-        DrLogI( "Bulk transfer into pool. Pool %p, count %u, deleting %u, hOut: %I64u ret: %I64u all: %I64u free: %I64u",
-            this, count, count-i,
-            m_totalGivenOut, m_totalReturned,
-            m_totalAllocated, m_totalFreed);
+        DrLogI( "Bulk transfer into pool. Pool %p, node %u, count %u, deleting %u, hOut: %I64u ret: %I64u all: %I64u free: %I64u",
+            this, nodeIndex, count, count-i,
+            node->m_totalGivenOut, node->m_totalReturned,
+            node->m_totalAllocated, node->m_totalFreed);
     }
 
     for (; i<count; ++i)
@@ -348,32 +422,41 @@ void DObjPoolBase::AcceptObjects(void** src, UInt32 count)
 
 void DObjPoolBase::RemoveObjects(void** dst, UInt32 count)
 {
+    UInt32 nodeIndex = GetCurrentNode();
+    if (nodeIndex >= m_numberOfNodes)
+    {
+        nodeIndex = 0;
+    }
+    NodeCache* node = &(m_node[nodeIndex]);
+
     UInt32 i;
     {
-        AutoCriticalSection acs(&m_atomic);
+        AutoCriticalSection acs(&(node->m_atomic));
 
-        UInt32 existing = m_numberOfCentralEntries;
+        UInt32 existing = node->m_numberOfEntries;
         if (existing > count)
         {
             existing = count;
         }
-        m_numberOfCentralEntries -= existing;
+        node->m_numberOfEntries -= existing;
 
         for (i=0; i<existing; ++i)
         {
-            dst[i] = m_array[m_numberOfCentralEntries + i];
+            dst[i] = node->m_array[node->m_numberOfEntries + i];
             LogAssert(dst[i] != NULL);
         }
 
-        m_totalGivenOut += count;
-        m_totalAllocated += (count - i);
+        node->m_totalGivenOut += count;
+        node->m_totalAllocated += (count - i);
 
-        DrLogI( "Bulk transfer out of pool. Pool %p, count %u, allocating %u, hOut: %I64u ret: %I64u all: %I64u free: %I64u",
-            this, count, count-i,
-            m_totalGivenOut, m_totalReturned,
-            m_totalAllocated, m_totalFreed);
+        DrLogI( "Bulk transfer out of pool. Pool %p, node %u, count %u, allocating %u, hOut: %I64u ret: %I64u all: %I64u free: %I64u",
+            this, nodeIndex, count, count-i,
+            node->m_totalGivenOut, node->m_totalReturned,
+            node->m_totalAllocated, node->m_totalFreed);
     }
 
+    /* the new objects are allocated on the calling thread, so the
+       memory is first touched on the node that will use it */
     for (; i<count; ++i)
     {
         dst[i] = m_factory->AllocateObjectUntyped();
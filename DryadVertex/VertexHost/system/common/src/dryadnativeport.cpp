@@ -164,11 +164,23 @@ void DryadNativePort::WriteFileThread()
 
                 DWORD bytesToTransfer =
                     (DWORD) *(wfr->m_request->GetNumberOfBytesToTransferPtr());
-                BOOL bRet = ::WriteFile(wfr->m_fileHandle,
-                                        wfr->m_request->GetData(),
-                                        bytesToTransfer,
-                                        NULL,
-                                        wfr->m_request->GetOverlapped());
+                BOOL bRet;
+                if (wfr->m_segments == NULL)
+                {
+                    bRet = ::WriteFile(wfr->m_fileHandle,
+                                       wfr->m_request->GetData(),
+                                       bytesToTransfer,
+                                       NULL,
+                                       wfr->m_request->GetOverlapped());
+                }
+                else
+                {
+                    bRet = ::WriteFileGather(wfr->m_fileHandle,
+                                             wfr->m_segments,
+                                             bytesToTransfer,
+                                             NULL,
+                                             wfr->m_request->GetOverlapped());
+                }
 
                 if (bRet == 0)
                 {
@@ -618,16 +630,7 @@ void DryadNativePort::QueueNativeWrite(HANDLE fileHandle, Handler* request)
 
     WriteFileRequest* wfr = new
         WriteFileRequest(fileHandle, request);
-    {
-        AutoCriticalSection acs(&m_writeFileCS);
-
-        BOOL mustWake = m_writeFileList.IsEmpty();
-        m_writeFileList.InsertAsTail(m_writeFileList.CastIn(wfr));
-        if (mustWake)
-        {
-            SetEvent(m_writeFileEvent);
-        }
-    }
+    AddWriteFileRequest(wfr);
 
 #if 0
     DWORD bytesToTransfer =
@@ -668,6 +671,68 @@ void DryadNativePort::QueueNativeWrite(HANDLE fileHandle, Handler* request)
 #endif
 }
 
+void DryadNativePort::QueueNativeGatherWrite(HANDLE fileHandle,
+                                             Handler* request,
+                                             FILE_SEGMENT_ELEMENT* segments)
+{
+    LogAssert(request != NULL);
+    LogAssert(segments != NULL);
+
+    {
+        AutoCriticalSection acs (&m_baseCS);
+
+        LogAssert(m_state == BPS_Running);
+        ++m_outstandingRequests;
+    }
+
+    WriteFileRequest* wfr = new
+        WriteFileRequest(fileHandle, request, segments);
+    AddWriteFileRequest(wfr);
+}
+
+//
+// Hand a write to the thread that issues WriteFile calls, waking it if
+// it has nothing else to do
+//
+void DryadNativePort::AddWriteFileRequest(WriteFileRequest* wfr)
+{
+    AutoCriticalSection acs(&m_writeFileCS);
+
+    BOOL mustWake = m_writeFileList.IsEmpty();
+    m_writeFileList.InsertAsTail(m_writeFileList.CastIn(wfr));
+    if (mustWake)
+    {
+        SetEvent(m_writeFileEvent);
+    }
+}
+
+//
+// Deliver a request that has no underlying overlapped I/O (e.g. a
+// view of a memory-mapped file) to a worker thread as if it had
+// completed successfully with numBytes transferred
+//
+void DryadNativePort::QueueCompletion(Handler* request, UInt32 numBytes)
+{
+    LogAssert(request != NULL);
+
+    {
+        AutoCriticalSection acs (&m_baseCS);
+
+        LogAssert(m_state == BPS_Running);
+        ++m_outstandingRequests;
+    }
+
+    BOOL bRet = ::PostQueuedCompletionStatus(m_completionPort,
+                                             numBytes,
+                                             NULL,
+                                             request->GetOverlapped());
+    if (bRet == 0)
+    {
+        DWORD errCode = GetLastError();
+        DrLogA("DryadNativePort::QueueCompletion post completion status. error code: 0x%08x", HRESULT_FROM_WIN32(errCode));
+    }
+}
+
 /*JCvoid DryadNativePort::QueueDryadWrite(DRHANDLE streamHandle,
                                        DrError* pendingStatePtr,
                                        UInt64 streamOffset,
@@ -28,6 +28,8 @@ limitations under the License.
 
 static const char* s_StatusPropertyLabel = "DVertexStatus";
 static const char* s_CommandPropertyLabel = "DVertexCommand";
+static const char* s_CommandBatchPropertyLabel = "DVertexCommandBatch";
+static const char* s_StatusBatchPropertyLabel = "DVertexStatusBatch";
 
 DryadPnProcessPropertyRequest::~DryadPnProcessPropertyRequest()
 {
@@ -803,6 +805,14 @@ void DVertexStatus::GetPnPropertyLabel(DrStr* pDstString,
                      (notifyWaiters) ? "-update" : "");
 }
 
+//
+// Label of the property holding the status of every vertex in the process
+//
+void DVertexStatus::GetPnBatchPropertyLabel(DrStr* pDstString)
+{
+    pDstString->SetF("%s", s_StatusBatchPropertyLabel);
+}
+
 
 //
 // Create new command block with default properties
@@ -1104,3 +1114,137 @@ void DVertexCommandBlock::GetPnPropertyLabel(DrStr* pDstString,
     pDstString->SetF("%s-%u.%u",
                      s_CommandPropertyLabel, vertexId, vertexVersion);
 }
+
+//
+// Create empty command batch
+//
+DVertexCommandBatch::DVertexCommandBatch()
+{
+    m_nCommands = 0;
+    m_nextCommandToRead = 0;
+    m_command = NULL;
+}
+
+DVertexCommandBatch::~DVertexCommandBatch()
+{
+    delete [] m_command;
+}
+
+UInt32 DVertexCommandBatch::GetNumberOfCommands()
+{
+    return m_nextCommandToRead;
+}
+
+DVertexCommandBlock* DVertexCommandBatch::GetCommand(UInt32 index)
+{
+    LogAssert(index < m_nextCommandToRead);
+    return m_command[index];
+}
+
+DrError DVertexCommandBatch::OnParseProperty(DrMemoryReader *reader,
+                                             UInt16 enumID,
+                                             UInt32 dataLen,
+                                             void *cookie)
+{
+    DrError err;
+
+    switch (enumID)
+    {
+    default:
+        DrLogW(
+            "Unknown property in vertex command batch. enumID %u", (DWORD ) enumID);
+        err = reader->SkipNextPropertyOrAggregate();
+        break;
+
+    case Prop_Dryad_NumberOfVertices:
+        UInt32 nCommands;
+        err = reader->ReadNextUInt32Property(enumID, &nCommands);
+        if (err == DrError_OK)
+        {
+            if (m_command != NULL)
+            {
+                DrLogE("Command count appears twice in vertex command batch");
+                err = DrError_InvalidProperty;
+            }
+            else
+            {
+                m_nCommands = nCommands;
+                m_command = new DrRef<DVertexCommandBlock> [m_nCommands];
+                LogAssert(m_command != NULL);
+            }
+        }
+        break;
+
+    case Prop_Dryad_BeginTag:
+        UInt16  tagValue;
+        err = reader->PeekNextUInt16Property(Prop_Dryad_BeginTag, &tagValue);
+        if (err != DrError_OK)
+        {
+            DrLogE("Error reading Prop_Dryad_BeginTag - 0x08x", err);
+        } else {
+            switch (tagValue)
+            {
+            case DryadTag_VertexCommand:
+                if (m_nextCommandToRead >= m_nCommands)
+                {
+                    DrLogE(
+                        "Too many commands in batch. nextCommandToRead=%u, nCommands=%u",
+                        m_nextCommandToRead, m_nCommands);
+                    err = DrError_InvalidParameter;
+                }
+                else
+                {
+                    m_command[m_nextCommandToRead].Attach(new DVertexCommandBlock());
+                    err = reader->ReadAggregate(tagValue,
+                                                m_command[m_nextCommandToRead],
+                                                NULL);
+                    if (err == DrError_OK)
+                    {
+                        ++m_nextCommandToRead;
+                    }
+                }
+                break;
+
+            default:
+                DrLogW("Unexpected tag - %hu", tagValue);
+                err = reader->SkipNextPropertyOrAggregate();
+            }
+        }
+        break;
+    }
+
+    return err;
+}
+
+//
+// Get batch from response message
+//
+DrError DVertexCommandBatch::
+    ReadFromResponseMessage(DryadPnProcessPropertyResponse* response)
+{
+    DrStr64 label;
+    GetPnPropertyLabel(&label);
+    response->RetrievePropertyLabel(label);
+
+    DrMemoryBuffer* block = response->GetPropertyBlock();
+    if (block == NULL)
+    {
+        return DrError_InvalidProperty;
+    }
+
+    DrMemoryBufferReader reader(block);
+    DrError err = reader.ReadAggregate(DryadTag_VertexCommandBatch, this, NULL);
+    if (err == DrError_OK && m_nextCommandToRead != m_nCommands)
+    {
+        DrLogE("Vertex command batch promised %u commands but held %u",
+               m_nCommands, m_nextCommandToRead);
+        err = DrError_InvalidProperty;
+    }
+
+    return err;
+}
+
+void DVertexCommandBatch::GetPnPropertyLabel(DrStr* pDstString)
+{
+    pDstString->SetF("%s", s_CommandBatchPropertyLabel);
+}
@@ -205,6 +205,52 @@ void DryadAlignedReadBlock::Trim(Size_t numBytes)
 }
 
 
+//
+// Map a read-only view of a file section. offset must be a multiple of
+// the system allocation granularity; if the map fails the block is
+// left empty and IsMapped returns false, with the error available
+// from GetLastError
+//
+DryadMappedReadBlock::DryadMappedReadBlock(HANDLE mappingHandle,
+                                           UInt64 offset,
+                                           size_t size)
+{
+    m_view = ::MapViewOfFile(mappingHandle,
+                             FILE_MAP_READ,
+                             (DWORD) (offset >> 32),
+                             (DWORD) (offset & 0xffffffff),
+                             size);
+
+    if (m_view == NULL)
+    {
+        this->Init(NULL, 0);
+    }
+    else
+    {
+        this->Init((BYTE *) m_view, size);
+    }
+}
+
+DryadMappedReadBlock::~DryadMappedReadBlock()
+{
+    if (m_view != NULL)
+    {
+        BOOL bRet = ::UnmapViewOfFile(m_view);
+        LogAssert(bRet != 0);
+    }
+}
+
+bool DryadMappedReadBlock::IsMapped()
+{
+    return (m_view != NULL);
+}
+
+void* DryadMappedReadBlock::GetData()
+{
+    return m_view;
+}
+
+
 static CRITSEC s_writePoolCS;
 static size_t s_writePoolAlignment = 0;
 static size_t s_writePoolBufferSize = 0;
@@ -27,6 +27,7 @@ limitations under the License.
 
 #define DWORKQUEUE_CONTINUE   (0)
 #define DWORKQUEUE_EXIT       (1)
+#define DWORKQUEUE_STOPPING   (0x40000000)
 
 WorkRequest::~WorkRequest()
 {
@@ -62,6 +63,46 @@ WorkQueue::~WorkQueue()
     delete [] m_threadHandle;
 }
 
+//
+// Choose the work queue implementation for this process. The choice is
+// read from the environment once, when the first queue is made
+//
+WorkQueue* WorkQueue::MakeWorkQueue(DWORD numWorkerThreads,
+                                    DWORD numConcurrentThreads)
+{
+    static LONG s_useWorkStealing = -1;
+
+    if (s_useWorkStealing < 0)
+    {
+        LONG useWorkStealing = 0;
+        char envValue[32];
+        DWORD ret = ::GetEnvironmentVariableA("DRYAD_WORK_STEALING",
+                                              envValue, sizeof(envValue));
+        if (ret > 0 && ret < sizeof(envValue))
+        {
+            UInt32 value;
+            if (DrStringToUInt32(envValue, &value) == DrError_OK &&
+                value != 0)
+            {
+                useWorkStealing = 1;
+            }
+        }
+
+        ::InterlockedExchange(&s_useWorkStealing, useWorkStealing);
+        DrLogI("WorkQueue::MakeWorkQueue using %s work queues",
+               (useWorkStealing != 0) ? "work-stealing" : "shared");
+    }
+
+    if (s_useWorkStealing != 0)
+    {
+        return new WorkStealingQueue(numWorkerThreads, numConcurrentThreads);
+    }
+    else
+    {
+        return new WorkQueue(numWorkerThreads, numConcurrentThreads);
+    }
+}
+
 unsigned __stdcall WorkQueue::ThreadFunc(void* arg)
 {
     WorkQueue* self = (WorkQueue *) arg;
@@ -371,3 +412,475 @@ void WorkQueue::Clean()
     }
     LogAssert(cleanedList.IsEmpty());
 }
+
+WorkStealingQueue::WorkerList::WorkerList()
+{
+    m_parent = NULL;
+    m_index = 0;
+    m_count = 0;
+}
+
+//
+// Create a work-stealing queue with one list per worker thread
+//
+WorkStealingQueue::WorkStealingQueue(DWORD numWorkerThreads,
+                                     DWORD numConcurrentThreads) :
+    WorkQueue(numWorkerThreads, numConcurrentThreads)
+{
+    LogAssert(numWorkerThreads > 0);
+
+    m_worker = new WorkerList[m_numWorkerThreads];
+    DWORD i;
+    for (i=0; i<m_numWorkerThreads; ++i)
+    {
+        m_worker[i].m_parent = this;
+        m_worker[i].m_index = i;
+    }
+
+    m_enQueueDoneEvent = INVALID_HANDLE_VALUE;
+    m_tlsSlot = TLS_OUT_OF_INDEXES;
+
+    m_exiting = 0;
+    m_numPending = 0;
+    m_numSleeping = 0;
+    m_numPostedWakeUps = 0;
+    m_numEnQueuing = 0;
+    m_nextWorker = 0;
+}
+
+WorkStealingQueue::~WorkStealingQueue()
+{
+    LogAssert(m_enQueueDoneEvent == INVALID_HANDLE_VALUE);
+    LogAssert(m_numPending == 0);
+    delete [] m_worker;
+}
+
+void WorkStealingQueue::AddToList(WorkerList* worker, WorkRequest* request)
+{
+    AutoCriticalSection acs(&(worker->m_cs));
+
+    worker->m_list.InsertAsTail(worker->m_list.CastIn(request));
+    ::InterlockedIncrement(&(worker->m_count));
+}
+
+//
+// Owners take from the head so each list is processed in the order
+// it was filled
+//
+WorkRequest* WorkStealingQueue::TakeFromHead(WorkerList* worker)
+{
+    if (worker->m_count == 0)
+    {
+        return NULL;
+    }
+
+    AutoCriticalSection acs(&(worker->m_cs));
+
+    if (worker->m_list.IsEmpty())
+    {
+        return NULL;
+    }
+
+    ::InterlockedDecrement(&(worker->m_count));
+    return worker->m_list.CastOut(worker->m_list.RemoveHead());
+}
+
+//
+// Thieves take from the tail so they rarely touch the requests the
+// owner is about to run
+//
+WorkRequest* WorkStealingQueue::TakeFromTail(WorkerList* worker)
+{
+    if (worker->m_count == 0)
+    {
+        return NULL;
+    }
+
+    AutoCriticalSection acs(&(worker->m_cs));
+
+    if (worker->m_list.IsEmpty())
+    {
+        return NULL;
+    }
+
+    WorkRequest* request =
+        worker->m_list.CastOut(worker->m_list.GetTail());
+    worker->m_list.Remove(worker->m_list.CastIn(request));
+    ::InterlockedDecrement(&(worker->m_count));
+    return request;
+}
+
+//
+// Look on our own list first then try each other worker in turn,
+// starting with our neighbour so that thieves spread out
+//
+WorkRequest* WorkStealingQueue::FindWork(WorkerList* self)
+{
+    WorkRequest* request = TakeFromHead(self);
+
+    DWORD i;
+    for (i=1; request == NULL && i<m_numWorkerThreads; ++i)
+    {
+        WorkerList* victim = &(m_worker[(self->m_index + i) %
+                                        m_numWorkerThreads]);
+        request = TakeFromTail(victim);
+    }
+
+    if (request != NULL)
+    {
+        ::InterlockedDecrement(&m_numPending);
+    }
+
+    return request;
+}
+
+unsigned __stdcall WorkStealingQueue::ThreadFunc(void* arg)
+{
+    WorkerList* self = (WorkerList *) arg;
+    WorkStealingQueue* parent = self->m_parent;
+
+    BOOL bRetval = ::TlsSetValue(parent->m_tlsSlot, self);
+    LogAssert(bRetval != 0);
+
+    DrLogI("WorkStealingQueue::ThreadFunc starting thread %u",
+           self->m_index);
+
+    for (;;)
+    {
+        WorkRequest* request = parent->FindWork(self);
+        if (request != NULL)
+        {
+            request->Process();
+            delete request;
+            continue;
+        }
+
+        /* we increment the sleeping count before looking at the
+           pending count, and EnQueue increments the pending count
+           before looking at the sleeping count, so one side always
+           sees the other and no wake-up is lost */
+        ::InterlockedIncrement(&(parent->m_numSleeping));
+        if (parent->m_numPending > 0)
+        {
+            ::InterlockedDecrement(&(parent->m_numSleeping));
+            continue;
+        }
+
+        if (parent->m_exiting != 0)
+        {
+            ::InterlockedDecrement(&(parent->m_numSleeping));
+            break;
+        }
+
+        /* waiting on the completion port rather than a semaphore lets
+           it hold back a woken worker while m_numConcurrentThreads
+           others are running, and release one when a running worker
+           blocks inside Process */
+        DWORD numBytes;
+        ULONG_PTR completionKey;
+        LPOVERLAPPED overlapped;
+        bRetval = ::GetQueuedCompletionStatus(parent->m_completionPort,
+                                              &numBytes,
+                                              &completionKey,
+                                              &overlapped,
+                                              INFINITE);
+        if (bRetval == 0)
+        {
+            DWORD errCode = GetLastError();
+            DrLogA("WorkStealingQueue::GetQueuedCompletionStatus. error code: 0x%08x", HRESULT_FROM_WIN32(errCode));
+        }
+
+        if (numBytes == DWORKQUEUE_CONTINUE)
+        {
+            ::InterlockedDecrement(&(parent->m_numPostedWakeUps));
+        }
+
+        ::InterlockedDecrement(&(parent->m_numSleeping));
+    }
+
+    DrLogI("WorkStealingQueue::ThreadFunc exiting thread %u",
+           self->m_index);
+
+    return 0;
+}
+
+void WorkStealingQueue::Start()
+{
+    AutoCriticalSection acs(&m_baseCS);
+
+    LogAssert(m_state == WQS_Stopped);
+    LogAssert(m_completionPort == INVALID_HANDLE_VALUE);
+
+    DrLogI("WorkStealingQueue::Start entered");
+
+    m_tlsSlot = ::TlsAlloc();
+    LogAssert(m_tlsSlot != TLS_OUT_OF_INDEXES);
+
+    m_completionPort = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE,
+                                                NULL,
+                                                NULL,
+                                                m_numConcurrentThreads);
+    LogAssert(m_completionPort != NULL);
+
+    m_enQueueDoneEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    LogAssert(m_enQueueDoneEvent != NULL);
+
+    m_exiting = 0;
+    m_numPostedWakeUps = 0;
+    m_numEnQueuing = 0;
+    ::InterlockedExchange(&m_state, WQS_Running);
+
+    DWORD i;
+    for (i=0; i<m_numWorkerThreads; ++i)
+    {
+        unsigned threadAddr;
+        m_threadHandle[i] =
+            (HANDLE) ::_beginthreadex(NULL,
+                                      0,
+                                      WorkStealingQueue::ThreadFunc,
+                                      &(m_worker[i]),
+                                      0,
+                                      &threadAddr);
+        LogAssert(m_threadHandle[i] != 0);
+    }
+
+    DrLogI("WorkStealingQueue::Start created %u threads",
+           m_numWorkerThreads);
+}
+
+void WorkStealingQueue::Stop()
+{
+    DrLogI("WorkStealingQueue::Stop entered");
+
+    {
+        AutoCriticalSection acs(&m_baseCS);
+
+        LogAssert(m_state == WQS_Running);
+        ::InterlockedExchange(&m_state, WQS_Stopping);
+    }
+
+    /* turn away new requests, and wait for any EnQueue that was already
+       adding one to finish, so the workers drain it before exiting */
+    LONG numEnQueuing = ::InterlockedExchangeAdd(&m_numEnQueuing,
+                                                 DWORKQUEUE_STOPPING);
+    if (numEnQueuing > 0)
+    {
+        DWORD waitRet = ::WaitForSingleObject(m_enQueueDoneEvent, INFINITE);
+        LogAssert(waitRet == WAIT_OBJECT_0);
+    }
+
+    ::InterlockedExchange(&m_exiting, 1);
+
+    BOOL bRetval;
+    DWORD i;
+    for (i=0; i<m_numWorkerThreads; ++i)
+    {
+        bRetval = ::PostQueuedCompletionStatus(m_completionPort,
+                                               DWORKQUEUE_EXIT,
+                                               NULL,
+                                               NULL);
+        if (bRetval == 0)
+        {
+            DWORD errCode = GetLastError();
+            DrLogA("WorkStealingQueue::Stop post completion status. error code: 0x%08x", HRESULT_FROM_WIN32(errCode));
+        }
+    }
+
+    DWORD waitRet = ::WaitForMultipleObjects(m_numWorkerThreads,
+                                             m_threadHandle,
+                                             TRUE,
+                                             INFINITE);
+    LogAssert(waitRet < (WAIT_OBJECT_0 + m_numWorkerThreads));
+
+    DrLogI("WorkStealingQueue::Stop all threads have terminated");
+
+    {
+        AutoCriticalSection acs(&m_baseCS);
+
+        LogAssert(m_numPending == 0);
+        LogAssert(m_numSleeping == 0);
+
+        for (i=0; i<m_numWorkerThreads; ++i)
+        {
+            LogAssert(m_worker[i].m_list.IsEmpty());
+
+            bRetval = ::CloseHandle(m_threadHandle[i]);
+            if (bRetval == 0)
+            {
+                DWORD errCode = GetLastError();
+                DrLogA("WorkStealingQueue::Stop close thread handle. error code: 0x%08x", HRESULT_FROM_WIN32(errCode));
+            }
+            m_threadHandle[i] = INVALID_HANDLE_VALUE;
+        }
+
+        bRetval = ::CloseHandle(m_completionPort);
+        if (bRetval == 0)
+        {
+            DWORD errCode = GetLastError();
+            DrLogA("WorkStealingQueue::Stop close completion port handle. error code: 0x%08x", HRESULT_FROM_WIN32(errCode));
+        }
+        m_completionPort = INVALID_HANDLE_VALUE;
+
+        bRetval = ::CloseHandle(m_enQueueDoneEvent);
+        if (bRetval == 0)
+        {
+            DWORD errCode = GetLastError();
+            DrLogA("WorkStealingQueue::Stop close event handle. error code: 0x%08x", HRESULT_FROM_WIN32(errCode));
+        }
+        m_enQueueDoneEvent = INVALID_HANDLE_VALUE;
+
+        ::TlsFree(m_tlsSlot);
+        m_tlsSlot = TLS_OUT_OF_INDEXES;
+
+        ::InterlockedExchange(&m_state, WQS_Stopped);
+    }
+
+    DrLogI("WorkStealingQueue::Stop exiting");
+}
+
+//
+// Count an EnQueue that is adding a request, unless Stop has started.
+// A call that is turned away doesn't touch the count, so once Stop has
+// seen it fall to zero nothing else signals m_enQueueDoneEvent
+//
+bool WorkStealingQueue::BeginEnQueue()
+{
+    for (;;)
+    {
+        LONG numEnQueuing = m_numEnQueuing;
+        if ((numEnQueuing & DWORKQUEUE_STOPPING) != 0)
+        {
+            return false;
+        }
+
+        if (::InterlockedCompareExchange(&m_numEnQueuing,
+                                         numEnQueuing + 1,
+                                         numEnQueuing) == numEnQueuing)
+        {
+            return true;
+        }
+    }
+}
+
+void WorkStealingQueue::EndEnQueue()
+{
+    LONG numEnQueuing = ::InterlockedDecrement(&m_numEnQueuing);
+    if (numEnQueuing == DWORKQUEUE_STOPPING)
+    {
+        /* Stop is waiting for us */
+        BOOL bRetval = ::SetEvent(m_enQueueDoneEvent);
+        LogAssert(bRetval != 0);
+    }
+}
+
+//
+// Put a work item on the calling worker's list, or on the next list in
+// turn if the caller isn't one of our workers
+//
+bool WorkStealingQueue::EnQueue(WorkRequest* item)
+{
+    LogAssert(item != NULL);
+
+    if (!BeginEnQueue())
+    {
+        DrLogI("WorkStealingQueue::EnQueue rejecting stopping item");
+        return false;
+    }
+
+    /* Stop may have set the stopping state but not yet have turned
+       EnQueue away, in which case it waits for this request */
+    LogAssert(m_state != WQS_Stopped);
+
+    if (item->ShouldAbort())
+    {
+        EndEnQueue();
+
+        DrLogD("WorkStealingQueue::EnQueue processing aborting work item");
+
+        item->Process();
+        delete item;
+
+        return true;
+    }
+
+    WorkerList* worker = (WorkerList *) ::TlsGetValue(m_tlsSlot);
+    if (worker == NULL)
+    {
+        DWORD next = (DWORD) ::InterlockedIncrement(&m_nextWorker);
+        worker = &(m_worker[next % m_numWorkerThreads]);
+    }
+
+    AddToList(worker, item);
+    ::InterlockedIncrement(&m_numPending);
+
+    /* as in WorkQueue, no more wake-ups are queued than there are
+       workers to take them: each woken worker keeps looking until
+       every list is empty */
+    if (m_numSleeping > 0)
+    {
+        LONG numPosted = ::InterlockedIncrement(&m_numPostedWakeUps);
+        if ((DWORD) numPosted <= m_numWorkerThreads)
+        {
+            BOOL retval = ::PostQueuedCompletionStatus(m_completionPort,
+                                                       DWORKQUEUE_CONTINUE,
+                                                       NULL,
+                                                       NULL);
+            if (retval == 0)
+            {
+                DWORD errCode = GetLastError();
+                DrLogA("WorkStealingQueue::EnQueue post completion status. error code:0x%08x", HRESULT_FROM_WIN32(errCode));
+            }
+        }
+        else
+        {
+            ::InterlockedDecrement(&m_numPostedWakeUps);
+        }
+    }
+
+    EndEnQueue();
+
+    return true;
+}
+
+void WorkStealingQueue::Clean()
+{
+    WorkRequestList cleanedList;
+    DrBListEntry* listEntry;
+
+    DWORD i;
+    for (i=0; i<m_numWorkerThreads; ++i)
+    {
+        WorkerList* worker = &(m_worker[i]);
+        AutoCriticalSection acs(&(worker->m_cs));
+
+        listEntry = worker->m_list.GetHead();
+        while (listEntry != NULL)
+        {
+            WorkRequest* request = worker->m_list.CastOut(listEntry);
+            listEntry = worker->m_list.GetNext(listEntry);
+
+            if (request->ShouldAbort())
+            {
+                DrLogD("WorkStealingQueue::Clean removing work item from list");
+                cleanedList.TransitionToTail(cleanedList.CastIn(request));
+                ::InterlockedDecrement(&(worker->m_count));
+                ::InterlockedDecrement(&m_numPending);
+            }
+        }
+    }
+
+    listEntry = cleanedList.GetHead();
+    while (listEntry != NULL)
+    {
+        WorkRequest* request = cleanedList.CastOut(listEntry);
+        listEntry = cleanedList.GetNext(listEntry);
+
+        DrLogD("WorkStealingQueue::Clean processing removed work item");
+
+        request->Process();
+        cleanedList.Remove(cleanedList.CastIn(request));
+        delete request;
+    }
+    LogAssert(cleanedList.IsEmpty());
+}
+
@@ -37,7 +37,16 @@ enum TransformType {
     TT_GzipDecompression,
     TT_DeflateCompression,
     TT_DeflateDecompression,
-    TT_DeflateFastCompression
+    TT_DeflateFastCompression,
+
+    /* framed block codecs. The values match the compressionScheme
+       numbers passed to WrapperNativeInfo, so they can be handed
+       straight through. TT_FramedDecompression reads any of them */
+    TT_Lz4Compression = 7,
+    TT_Lz4HighCompression = 8,
+    TT_ZstdFastCompression = 9,
+    TT_ZstdCompression = 10,
+    TT_FramedDecompression = 11
 
 	/* Xpress removed, but left in comments as an example of 
 	 * supporting an alternate compression scheme.
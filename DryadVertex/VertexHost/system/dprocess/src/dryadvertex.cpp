@@ -58,6 +58,13 @@ static TransformType StripCompressionModeFromUri(char *uri)
         case 1:
             mode = TT_GzipFastCompression;
             break;
+        // framed block codecs, not known to DSC
+        case TT_Lz4Compression:
+        case TT_Lz4HighCompression:
+        case TT_ZstdFastCompression:
+        case TT_ZstdCompression:
+            mode = (TransformType) modeInt;
+            break;
         default:
             DrLogA("Invalid compression scheme %d specified in URI: %s", modeInt, uri);
             break;
@@ -1634,12 +1641,14 @@ DrError DryadSimpleChannelVertexBase::
     //
     // Create a work queue that has two threads per core, 
     // but only one thread per core able to run concurrently
-    // start the work queue
+    // start the work queue. DRYAD_WORK_STEALING selects the
+    // work-stealing implementation
     //
     SYSTEM_INFO systemInfo;
     GetSystemInfo(&systemInfo);
-    WorkQueue* workQueue = new WorkQueue(systemInfo.dwNumberOfProcessors*2,
-                                         systemInfo.dwNumberOfProcessors);
+    WorkQueue* workQueue =
+        WorkQueue::MakeWorkQueue(systemInfo.dwNumberOfProcessors*2,
+                                 systemInfo.dwNumberOfProcessors);
     workQueue->Start();
 
     //
@@ -24,6 +24,7 @@ limitations under the License.
 #include <dryadnativeport.h>
 #include <dryadstandaloneini.h>
 #include <httppropertyblock.h>
+#include <process.h>
 
 #include "dvertexhttppncontrol.h"
 
@@ -72,7 +73,16 @@ private:
     static NotHttpClient::NotHttpClient^ s_client;
 };
 
-class DVertexHttpSetStatus : public DryadHttpPnProcessPropertyRequest
+//
+// A property write to the process service that is told how it went
+//
+class DVertexHttpStatusRequest : public DryadHttpPnProcessPropertyRequest
+{
+public:
+    virtual void Process(DrError err) = 0;
+};
+
+class DVertexHttpSetStatus : public DVertexHttpStatusRequest
 {
 public:
     DVertexHttpSetStatus(DVertexHttpPnController* parent,
@@ -289,7 +299,7 @@ DryadPnProcessPropertyRequest*
 ref class SetStatusWrapper
 {
 public:
-    SetStatusWrapper(System::String^ a, System::String^ l, System::String^ s, array<unsigned char>^ d, bool n, DVertexHttpSetStatus* p)
+    SetStatusWrapper(System::String^ a, System::String^ l, System::String^ s, array<unsigned char>^ d, bool n, DVertexHttpStatusRequest* p)
     {
         address = a;
         label = l;
@@ -306,7 +316,7 @@ public:
     bool            notifyWaiters;
     array<unsigned char>^ payload;
 
-    DVertexHttpSetStatus* parent;
+    DVertexHttpStatusRequest* parent;
 };
 
 static void SetStatusDataCallback(System::Object^ arg)
@@ -356,6 +366,73 @@ static void SetStatusDataCallback(System::Object^ arg)
     info->parent->DecRef();
 }
 
+//
+// Copy a request into managed memory and write it on a worker thread, which
+// calls the request's Process method when the write finishes
+//
+static void StartSetStatus(const char* serverAddress, const char* propertyLabel,
+                           const char* propertyString, bool notifyWaiters,
+                           DVertexHttpStatusRequest* request)
+{
+    DrMemoryBuffer* buffer = request->GetPropertyBlock();
+
+    SetStatusWrapper^ wrapper;
+    try
+    {
+        System::String^ address = gcnew System::String(serverAddress);
+        System::String^ label = gcnew System::String(propertyLabel);
+        System::String^ status = gcnew System::String(propertyString);
+
+        Size_t payloadSize = buffer->GetAvailableSize();
+
+        LogAssert(payloadSize < System::Int32::MaxValue);
+        array<unsigned char>^ payload = gcnew array<unsigned char>((int)payloadSize);
+        Size_t bufferSize;
+        void* rawPtr = buffer->GetDataAddress(0, &bufferSize, NULL);
+        System::IntPtr bufferPtr(rawPtr);
+
+        Marshal::Copy(bufferPtr, payload, 0, (int)payloadSize);
+
+        wrapper = gcnew SetStatusWrapper(address, label, status, payload, notifyWaiters, request);
+    }
+    catch (System::Exception^ e)
+    {
+        DrString msg(e->ToString());
+        DrLogA("Failed to make wrapper: ", msg.GetChars());
+    }
+
+    Task^ t = gcnew Task(gcnew System::Action<System::Object^>(SetStatusDataCallback), wrapper);
+    t->Start();
+}
+
+//
+// Write of the process-wide status batch
+//
+class DVertexHttpSetStatusBatch : public DVertexHttpStatusRequest
+{
+public:
+    DVertexHttpSetStatusBatch(DVertexHttpPnControllerOuter* parent,
+                              DrSimpleHeapBuffer* block);
+
+    void Process(DrError err);
+
+private:
+    DVertexHttpPnControllerOuter*        m_parent;
+};
+
+DVertexHttpSetStatusBatch::
+    DVertexHttpSetStatusBatch(DVertexHttpPnControllerOuter* parent,
+                              DrSimpleHeapBuffer* block)
+{
+    m_parent = parent;
+    m_block = block;
+}
+
+void DVertexHttpSetStatusBatch::Process(DrError err)
+{
+    m_parent->StatusBatchSent(err);
+}
+
 //
 // Send updated status to vertex service
 //
@@ -448,36 +525,11 @@ void DVertexHttpPnController::SendSetStatusRequestInternal(DryadPnProcessPropert
 
     request->IncrementSendCount();
 
-    DrMemoryBuffer* buffer = request->GetPropertyBlock();
-
-    SetStatusWrapper^ wrapper;
-    try
-    {
-        System::String^ address = gcnew System::String(m_serverAddress.GetString());
-        System::String^ label = gcnew System::String(request->GetPropertyLabel());
-        System::String^ status = gcnew System::String(request->GetPropertyString());
-        bool notifyWaiters = request->GetNotifyWaiters();
-
-        Size_t payloadSize = buffer->GetAvailableSize();
-
-        LogAssert(payloadSize < System::Int32::MaxValue);
-        array<unsigned char>^ payload = gcnew array<unsigned char>((int)payloadSize);
-        Size_t bufferSize;
-        void* rawPtr = buffer->GetDataAddress(0, &bufferSize, NULL);
-        System::IntPtr bufferPtr(rawPtr);
-
-        Marshal::Copy(bufferPtr, payload, 0, (int)payloadSize);
-
-        wrapper = gcnew SetStatusWrapper(address, label, status, payload, notifyWaiters, request);
-    }
-    catch (System::Exception^ e)
-    {
-        DrString msg(e->ToString());
-        DrLogA("Failed to make wrapper: ", msg.GetChars());
-    }
-
-    Task^ t = gcnew Task(gcnew System::Action<System::Object^>(SetStatusDataCallback), wrapper);
-    t->Start();
+    StartSetStatus(m_serverAddress.GetString(),
+                   request->GetPropertyLabel(),
+                   request->GetPropertyString(),
+                   request->GetNotifyWaiters(),
+                   request);
 }
 
 //
@@ -646,12 +698,22 @@ unsigned DVertexHttpPnController::CommandLoop()
             delete data;
             delete bytes;
         }
-    } while (err == DrError_OK);
+    } while (err == DrError_OK && !HasRetired());
 
     DrLogI("Command loop exiting");
     BOOL bRet = ::SetEvent(m_commandLoopEvent);
     LogAssert(bRet != 0);
 
+    if (err == DrError_OK)
+    {
+        //
+        // The vertex is done and the process is staying up to run others,
+        // so there is nothing left for this loop to listen for
+        //
+        DrLogI("Command loop retiring");
+        return 0;
+    }
+
     if (err != DryadError_VertexReceivedTermination)
     {
         //
@@ -669,6 +731,324 @@ unsigned DVertexHttpPnController::CommandLoop()
     return 0;
 }
 
+//
+// Starts thread waiting for a batched start command from the GM
+//
+void DVertexHttpPnControllerOuter::LaunchCommandBatchLoop(bool startBatchDue)
+{
+    unsigned threadAddr;
+
+    m_startBatchDue = startBatchDue;
+
+    HANDLE threadHandle =
+        (HANDLE) ::_beginthreadex(NULL,
+                                  0,
+                                  DVertexHttpPnControllerOuter::CommandBatchLoopStatic,
+                                  this,
+                                  0,
+                                  &threadAddr);
+    LogAssert(threadHandle != 0);
+
+    BOOL bRet = ::CloseHandle(threadHandle);
+    LogAssert(bRet != 0);
+}
+
+unsigned DVertexHttpPnControllerOuter::CommandBatchLoopStatic(void* arg)
+{
+    DVertexHttpPnControllerOuter* self = (DVertexHttpPnControllerOuter *) arg;
+    return self->CommandBatchLoop();
+}
+
+//
+// Wait for the single batch of start commands the GM sends to a process
+// with several vertices, and dispatch it. Termination is left to the
+// per-vertex command loops, so this loop just stops quietly when the
+// process is going away. A reusable process keeps listening, since each
+// new vertex the GM hands it arrives as a batch. If the process service
+// can't be reached the process fails, so the GM reschedules any vertices
+// whose commands would otherwise never arrive
+//
+unsigned DVertexHttpPnControllerOuter::CommandBatchLoop()
+{
+    UInt32 retries = 0;
+    UInt64 commandVersion = 0;
+    UInt32 blockTimeout = 15 * 1000;
+    UInt32 requestTimeout = 60 * 1000;
+    bool finished = false;
+
+    DrStr64 label;
+    DVertexCommandBatch::GetPnPropertyLabel(&label);
+
+    System::String^ serverAddress = System::Environment::GetEnvironmentVariable("DRYAD_PROCESS_SERVER_URI");
+    if (serverAddress == nullptr)
+    {
+        DrLogA("Can't get environment string DRYAD_PROCESS_SERVER_URI");
+    }
+
+    System::String^ labelString = Marshal::PtrToStringAnsi((System::IntPtr)(void*)label.GetString());
+    System::String^ uriBase = serverAddress + "?timeout=" + blockTimeout + "&key=" + labelString;
+
+    do
+    {
+        System::String^ uriString = uriBase + System::String::Format("&version={0}", commandVersion);
+
+        NotHttpClient::IHttpResponse^ response = nullptr;
+        Stream^ data = nullptr;
+        MemoryStream^ bytes = nullptr;
+
+        try
+        {
+            System::Uri^ uri = gcnew System::Uri(uriString);
+            NotHttpClient::IHttpRequest^ request = HttpClientHolder::Create(uri);
+            request->Timeout = requestTimeout;
+
+            response = request->GetResponse();
+
+            System::String^ processStatus = response->Headers["X-Dryad-ProcessStatus"];
+            DrExitCode exitCode = System::UInt32::Parse(response->Headers["X-Dryad-ProcessExitCode"]);
+            UInt64 newVersion = System::UInt64::Parse(response->Headers["X-Dryad-ValueVersion"]);
+
+            data = response->GetResponseStream();
+            bytes = gcnew MemoryStream();
+            data->CopyTo(bytes);
+            array<unsigned char>^ responseData = bytes->ToArray();
+
+            retries = 0;
+
+            if (processStatus != "Running" || exitCode != DrExitCode_StillActive)
+            {
+                finished = true;
+            }
+            else if (newVersion > commandVersion)
+            {
+                DrLogI("Property %s got new version %I64u", label.GetString(), newVersion);
+
+                commandVersion = newVersion;
+
+                DrRef<DVertexCommandBatch> batch;
+                batch.Attach(new DVertexCommandBatch());
+
+                DrRef<DryadHttpPnProcessPropertyResponse> batchResponse;
+                {
+                    pin_ptr<unsigned char> nativeData = &(responseData[0]);
+                    batchResponse.Attach(new DryadHttpPnProcessPropertyResponse(responseData->Length, nativeData));
+                }
+
+                DrError err = batch->ReadFromResponseMessage(batchResponse);
+                if (err == DrError_OK)
+                {
+                    DrLogI("Got batch of %u vertex commands", batch->GetNumberOfCommands());
+                    m_startBatchDue = false;
+                    DispatchCommandBatch(batch);
+                    finished = !IsReusingProcess();
+                }
+                else
+                {
+                    DrLogW("Command batch loop got bad batch %s", DRERRORSTRING(err));
+                }
+            }
+        }
+        catch (System::Exception^ e)
+        {
+            ++retries;
+            DrString msg(e->Message);
+            DrLogE("Command batch loop http request failed try %d with exception %s", retries, msg.GetChars());
+
+            if (retries >= 4)
+            {
+                if (m_startBatchDue)
+                {
+                    //
+                    // Vertices are waiting for a start command that will
+                    // never arrive, so fail and let the GM reschedule them
+                    //
+                    DrLogE("Lost contact with the process service before the start batch arrived");
+                    DrExitProcess(DrExitCode_Fail);
+                }
+
+                //
+                // Any batch the GM writes from now on would be lost, so stop
+                // listening and offering the process for reuse. It fails once
+                // the vertices it already has are done, without killing them,
+                // and the GM reschedules whatever it sent in the meantime
+                //
+                DrLogE("Reusable process lost contact with the process service");
+                StopReusingProcess();
+                finished = true;
+            }
+            else
+            {
+                //
+                // Back off before trying again
+                //
+                UInt32 backoff = 1000 << retries;
+                DrLogI("Retrying command batch connection in %u ms", backoff);
+                ::Sleep(backoff);
+            }
+        }
+        finally
+        {
+            delete response;
+            delete data;
+            delete bytes;
+        }
+    } while (!finished);
+
+    DrLogI("Command batch loop exiting");
+
+    return 0;
+}
+
+DVertexHttpPnControllerOuter::DVertexHttpPnControllerOuter()
+{
+    m_sendingStatusBatch = false;
+    m_statusBatchQueued = false;
+    m_statusBatchNotify = false;
+    m_statusBatchRetries = 0;
+    m_startBatchDue = false;
+}
+
+//
+// Write the status batch now, or once the write in progress has finished.
+// Writes are never overlapped, so a later batch can't be overtaken by an
+// earlier one, and updates that arrive while one is in progress are
+// carried together by the next
+//
+void DVertexHttpPnControllerOuter::SendStatusBatch(bool notifyWaiters)
+{
+    {
+        AutoCriticalSection acs(&m_statusBatchCS);
+
+        m_statusBatchNotify = m_statusBatchNotify || notifyWaiters;
+
+        if (m_sendingStatusBatch)
+        {
+            m_statusBatchQueued = true;
+            return;
+        }
+
+        m_sendingStatusBatch = true;
+    }
+
+    SendStatusBatchInternal();
+}
+
+void DVertexHttpPnControllerOuter::SendStatusBatchInternal()
+{
+    bool notifyWaiters;
+    {
+        AutoCriticalSection acs(&m_statusBatchCS);
+
+        LogAssert(m_sendingStatusBatch);
+        notifyWaiters = m_statusBatchNotify;
+        m_statusBatchNotify = false;
+        m_statusBatchQueued = false;
+    }
+
+    if (m_serverAddress.GetLength() == 0)
+    {
+        System::String^ serverAddress = System::Environment::GetEnvironmentVariable("DRYAD_PROCESS_SERVER_URI");
+        if (serverAddress == nullptr)
+        {
+            DrLogA("Can't get environment string DRYAD_PROCESS_SERVER_URI");
+        }
+        m_serverAddress.Set(DrString(serverAddress).GetChars());
+    }
+
+    DrRef<DrSimpleHeapBuffer> block;
+    block.Attach(MakeStatusBatch());
+
+    DrRef<DVertexHttpSetStatusBatch> request;
+    request.Attach(new DVertexHttpSetStatusBatch(this, block));
+
+    DrStr64 label;
+    DVertexStatus::GetPnBatchPropertyLabel(&label);
+
+    DrLogI("Sending status batch notifyWaiters %s", (notifyWaiters) ? "true" : "false");
+
+    StartSetStatus(m_serverAddress.GetString(),
+                   label.GetString(),
+                   "Running",
+                   notifyWaiters,
+                   request);
+}
+
+//
+// Called when a write of the status batch has finished
+//
+void DVertexHttpPnControllerOuter::StatusBatchSent(DrError err)
+{
+    if (err == DrError_OK)
+    {
+        DrLogI("Status batch send succeeded");
+
+        m_statusBatchRetries = 0;
+
+        //
+        // This may take the process down if a vertex that failed, or the
+        // last vertex of a process that isn't being reused, has exited
+        //
+        StatusBatchDelivered();
+    }
+    else
+    {
+        ++m_statusBatchRetries;
+
+        //
+        // If there was a communication failure, retry up to 4 times, as a
+        // single vertex's status send does
+        //
+        if ((err == DrError_RemoteDisconnected ||
+             err == DrError_LocalDisconnected ||
+             err == DrError_ConnectionFailed) &&
+            m_statusBatchRetries < 4)
+        {
+            //
+            // Back off before trying again
+            //
+            UInt32 backoff = 1000 << (m_statusBatchRetries - 1);
+            DrLogW("Retrying status batch send in %u ms. error %s",
+                   backoff, DRERRORSTRING(err));
+            ::Sleep(backoff);
+
+            //
+            // The retry sends the current state, which is at least as new
+            //
+            AutoCriticalSection acs(&m_statusBatchCS);
+            m_statusBatchQueued = true;
+            m_statusBatchNotify = true;
+        }
+        else if (HasAsserted())
+        {
+            //
+            // This batch carries an assertion that already happened, so
+            // just report a warning. The next update tries again
+            //
+            DrLogW("Status batch send failed: not asserting again. done %u sends, error %s",
+                   m_statusBatchRetries, DRERRORSTRING(err));
+            m_statusBatchRetries = 0;
+        }
+        else
+        {
+            DrLogA("Status batch send failed. done %u sends, error %s",
+                   m_statusBatchRetries, DRERRORSTRING(err));
+        }
+    }
+
+    {
+        AutoCriticalSection acs(&m_statusBatchCS);
+
+        LogAssert(m_sendingStatusBatch);
+        if (!m_statusBatchQueued)
+        {
+            m_sendingStatusBatch = false;
+            return;
+        }
+    }
+
+    SendStatusBatchInternal();
+}
+
 //
 // This is just a factory method to generate controllers of the correct concrete type
 //
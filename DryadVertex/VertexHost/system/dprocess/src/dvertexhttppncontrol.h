@@ -30,9 +30,27 @@ limitations under the License.
 //
 class DVertexHttpPnControllerOuter : public DVertexPnControllerOuter
 {
+public:
+    DVertexHttpPnControllerOuter();
+
+    void SendStatusBatch(bool notifyWaiters);
+    void StatusBatchSent(DrError err);
+
 private:
     DVertexPnController* MakePnController(UInt32 vertexId,
                                           UInt32 vertexVersion);
+    void LaunchCommandBatchLoop(bool startBatchDue);
+    static unsigned CommandBatchLoopStatic(void* arg);
+    unsigned CommandBatchLoop();
+    void SendStatusBatchInternal();
+
+    CRITSEC                m_statusBatchCS;
+    bool                   m_sendingStatusBatch;
+    bool                   m_statusBatchQueued;
+    bool                   m_statusBatchNotify;
+    UInt32                 m_statusBatchRetries;
+    bool                   m_startBatchDue;
+    DrStr64                m_serverAddress;
 };
 
 class DVertexHttpPnController : public DVertexPnController
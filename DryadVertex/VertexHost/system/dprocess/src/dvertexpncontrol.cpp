@@ -26,6 +26,44 @@ limitations under the License.
 
 #pragma managed
 
+//
+// Progress updates that change the vertex status wake the GM's blocked
+// status request, at most once per push interval, instead of waiting
+// for the request to time out. Changes made in between are carried by
+// the next push. Can be overridden with DRYAD_STATUS_PUSH_INTERVAL_MS;
+// 0 turns pushing off
+//
+static const UInt32 s_defaultStatusPushIntervalMs = 1000;
+
+static DrTimeInterval GetStatusPushInterval()
+{
+    static bool s_initialized = false;
+    static DrTimeInterval s_pushInterval = DrTimeInterval_Zero;
+
+    if (!s_initialized)
+    {
+        UInt32 intervalMs = s_defaultStatusPushIntervalMs;
+
+        char envValue[32];
+        DWORD ret = ::GetEnvironmentVariableA("DRYAD_STATUS_PUSH_INTERVAL_MS",
+                                              envValue, sizeof(envValue));
+        if (ret > 0 && ret < sizeof(envValue))
+        {
+            UInt32 value;
+            if (DrStringToUInt32(envValue, &value) == DrError_OK)
+            {
+                intervalMs = value;
+            }
+        }
+
+        s_pushInterval = DrTimeInterval_Millisecond * intervalMs;
+        s_initialized = true;
+        DrLogI("Status push interval %u ms", intervalMs);
+    }
+
+    return s_pushInterval;
+}
+
 //
 // Constructor for controller associated with single vertex process
 // 
@@ -36,6 +74,10 @@ DVertexPnController::DVertexPnController(DVertexPnControllerOuter* parent,
     m_currentCommandVersion = 0;
     m_activeVertex = false;
     m_waitingForTermination = false;
+    m_statusChanged = false;
+    m_lastPushTime = DrTimeStamp_LongAgo;
+    m_statusBatchExitCode = DrExitCode_StillActive;
+    m_statusBatchExitSent = false;
 
     m_parent = parent;
     m_vertexId = vertexId;
@@ -68,6 +110,7 @@ void DVertexPnController::SendStatus(UInt32 exitOnCompletion,
                                      bool notifyWaiters)
 {
     DrRef<DryadPnProcessPropertyRequest> request;
+    bool batched = m_parent->IsBatchingStatus();
 
     //
     // Enter critical section
@@ -93,12 +136,41 @@ void DVertexPnController::SendStatus(UInt32 exitOnCompletion,
             m_waitingForTermination = true;
         }
 
-        //
-        // Notify GM that we're done
-        //
-        request.Attach(MakeSetStatusRequest(exitOnCompletion, false,
-                                            notifyWaiters));
-        m_currentStatus->StoreInRequestMessage(request);
+        if (notifyWaiters)
+        {
+            //
+            // Anything that changed so far is carried by this update
+            //
+            m_statusChanged = false;
+            m_lastPushTime = DrGetCurrentTimeStamp();
+        }
+
+        if (batched)
+        {
+            //
+            // The GM follows the whole process through the status batch,
+            // so that is the only place this update needs to go
+            //
+            StoreInStatusBatch(m_currentStatus, exitOnCompletion);
+        }
+        else
+        {
+            //
+            // Notify GM that we're done
+            //
+            request.Attach(MakeSetStatusRequest(exitOnCompletion, false,
+                                                notifyWaiters));
+            m_currentStatus->StoreInRequestMessage(request);
+        }
+    }
+
+    if (batched)
+    {
+        DrLogI( "Sending batched status update. Vertex %u.%u notifyWaiters %s",
+            m_vertexId, m_vertexVersion,
+            (notifyWaiters) ? "true" : "false");
+        m_parent->SendStatusBatch(notifyWaiters);
+        return;
     }
 
     //
@@ -111,9 +183,31 @@ void DVertexPnController::SendStatus(UInt32 exitOnCompletion,
     SendSetStatusRequest(request);
 }
 
+//
+// Serialize a status into this vertex's entry in the process status batch.
+// The caller holds m_baseCS unless it is reporting an assert failure
+//
+void DVertexPnController::StoreInStatusBatch(DVertexStatus* status,
+                                             UInt32 exitOnCompletion)
+{
+    DrRef<DrSimpleHeapBuffer> entry;
+    entry.Attach(new DrSimpleHeapBuffer());
+
+    {
+        DrMemoryBufferWriter writer(entry);
+        DrError err = status->Serialize(&writer);
+        LogAssert(err == DrError_OK);
+        err = writer.FlushMemoryWriter();
+        LogAssert(err == DrError_OK);
+    }
+
+    m_parent->UpdateStatusBatch(this, entry, exitOnCompletion);
+}
+
 void DVertexPnController::SendAssertStatus(const char* assertString)
 {
     DrRef<DryadPnProcessPropertyRequest> request;
+    bool batched = m_parent->IsBatchingStatus();
 
     if (m_baseCS.TryEnter())
     {
@@ -139,11 +233,18 @@ void DVertexPnController::SendAssertStatus(const char* assertString)
         pStatus->SetVertexErrorCode(DryadError_AssertFailure);
         pStatus->SetVertexErrorString(assertString);
 
-        request.Attach(MakeSetStatusRequest(DrExitCode_StillActive,
-                                            true, true));
-        if (request != NULL)
+        if (batched)
         {
-            m_currentStatus->StoreInRequestMessage(request);
+            StoreInStatusBatch(m_currentStatus, DrExitCode_StillActive);
+        }
+        else
+        {
+            request.Attach(MakeSetStatusRequest(DrExitCode_StillActive,
+                                                true, true));
+            if (request != NULL)
+            {
+                m_currentStatus->StoreInRequestMessage(request);
+            }
         }
     }
     else
@@ -164,15 +265,33 @@ void DVertexPnController::SendAssertStatus(const char* assertString)
 
         rawStatus->SetVertexState(DryadError_AssertFailure);
 
-        request.Attach(MakeSetStatusRequest(DrExitCode_StillActive,
-                                            true, true));
-        if (request != NULL)
+        if (batched)
+        {
+            //
+            // The batch entry has to say which vertex it is about
+            //
+            pStatus->SetVertexId(m_vertexId);
+            pStatus->SetVertexInstanceVersion(m_vertexVersion);
+            StoreInStatusBatch(rawStatus, DrExitCode_StillActive);
+        }
+        else
         {
-            rawStatus->StoreInRequestMessage(request);
+            request.Attach(MakeSetStatusRequest(DrExitCode_StillActive,
+                                                true, true));
+            if (request != NULL)
+            {
+                rawStatus->StoreInRequestMessage(request);
+            }
         }
     }
 
-    if (request != NULL)
+    if (batched)
+    {
+        DrLogI( "Sending batched notification. AssertString=%s", assertString);
+
+        m_parent->SendStatusBatch(true);
+    }
+    else if (request != NULL)
     {
         DrLogI( "Sending notification. AssertString=%s", assertString);
 
@@ -182,6 +301,16 @@ void DVertexPnController::SendAssertStatus(const char* assertString)
     }
 }
 
+bool DVertexPnController::
+    ChannelStatusChanged(DryadChannelDescription* dst,
+                         DryadChannelDescription* src)
+{
+    return (dst->GetChannelState() != src->GetChannelState() ||
+            dst->GetChannelErrorCode() != src->GetChannelErrorCode() ||
+            dst->GetChannelProcessedLength() != src->GetChannelProcessedLength() ||
+            dst->GetChannelTotalLength() != src->GetChannelTotalLength());
+}
+
 void DVertexPnController::
     AssimilateChannelStatus(DryadChannelDescription* dst,
                             DryadChannelDescription* src)
@@ -212,6 +341,11 @@ void DVertexPnController::AssimilateNewStatus(DVertexProcessStatus* status,
         LogAssert(status->GetVertexInstanceVersion() ==
                   currentPStatus->GetVertexInstanceVersion());
 
+        if (status->GetVertexErrorCode() != currentPStatus->GetVertexErrorCode())
+        {
+            m_statusChanged = true;
+        }
+
         currentPStatus->SetVertexMetaData(status->GetVertexMetaData(), false);
         currentPStatus->SetVertexErrorCode(status->GetVertexErrorCode());
         currentPStatus->SetVertexErrorString(status->GetVertexErrorString());
@@ -220,6 +354,11 @@ void DVertexPnController::AssimilateNewStatus(DVertexProcessStatus* status,
                   currentPStatus->GetInputChannelCount());
         for (i=0; i<status->GetInputChannelCount(); ++i)
         {
+            if (ChannelStatusChanged(&(currentPStatus->GetInputChannels()[i]),
+                                     &(status->GetInputChannels()[i])))
+            {
+                m_statusChanged = true;
+            }
             AssimilateChannelStatus(&(currentPStatus->GetInputChannels()[i]),
                                     &(status->GetInputChannels()[i]));
         }
@@ -228,9 +367,26 @@ void DVertexPnController::AssimilateNewStatus(DVertexProcessStatus* status,
                   currentPStatus->GetOutputChannelCount());
         for (i=0; i<status->GetOutputChannelCount(); ++i)
         {
+            if (ChannelStatusChanged(&(currentPStatus->GetOutputChannels()[i]),
+                                     &(status->GetOutputChannels()[i])))
+            {
+                m_statusChanged = true;
+            }
             AssimilateChannelStatus(&(currentPStatus->GetOutputChannels()[i]),
                                     &(status->GetOutputChannels()[i]));
         }
+
+        //
+        // Push the accumulated changes if the last push was long enough
+        // ago, otherwise leave them for a later update
+        //
+        DrTimeInterval pushInterval = GetStatusPushInterval();
+        if (sendUpdate && !notifyWaiters && m_statusChanged &&
+            pushInterval > DrTimeInterval_Zero &&
+            DrGetElapsedTime(m_lastPushTime, DrGetCurrentTimeStamp()) >= pushInterval)
+        {
+            notifyWaiters = true;
+        }
     }
 
     if (sendUpdate)
@@ -960,6 +1116,19 @@ DrError DVertexPnController::ActOnCommand(DVertexCommandBlock* commandBlock)
     return err;
 }
 
+//
+// True once the vertex has finished and reported it in a process that is
+// staying up to host more vertices, so its command loop can stop polling
+//
+bool DVertexPnController::HasRetired()
+{
+    AutoCriticalSection acs(&m_baseCS);
+
+    return (m_parent->IsReusingProcess() &&
+            m_waitingForTermination &&
+            m_activeVertex == false);
+}
+
 //
 // Starts thread for vertex command loop
 // called from DVertexPnControllerOuter.run
@@ -1011,6 +1180,10 @@ unsigned DVertexPnController::CommandLoopStatic(void* arg)
 DVertexPnControllerOuter::DVertexPnControllerOuter()
 {
     m_controllerArray = NULL;
+    m_controllerSlots = 0;
+    m_reuseProcess = false;
+    m_failOnExit = false;
+    m_batchStatus = false;
 }
 
 void DVertexPnControllerOuter::AssertCallback(void* cookie, const char* assertString)
@@ -1027,14 +1200,31 @@ void DVertexPnControllerOuter::SendAssertStatus(const char* assertString)
     if (postIncrement == 1)
     {
         /* this is the first assert we've seen, so try to do something
-           useful with it */
+           useful with it. AddController may replace the array, so take a
+           copy under the lock; the controllers themselves are never
+           freed. The lock isn't held while they send, since they may
+           take their own locks first and then this one */
+
+        UInt32 numberOfVertices;
+        DVertexPnController** controllers;
+        {
+            AutoCriticalSection acs(&m_baseCS);
+
+            numberOfVertices = m_numberOfVertices;
+            controllers = new DVertexPnController* [numberOfVertices];
+            LogAssert(controllers != NULL);
+            memcpy(controllers, m_controllerArray,
+                   numberOfVertices * sizeof(DVertexPnController*));
+        }
 
         UInt32 i;
-        for (i=0; i<m_numberOfVertices; ++i)
+        for (i=0; i<numberOfVertices; ++i)
         {
-            m_controllerArray[i]->SendAssertStatus(assertString);
+            controllers[i]->SendAssertStatus(assertString);
         }
 
+        delete [] controllers;
+
         DrLogI( "Sleeping");
 
         /* wait to give the PN a chance to receive the messages if
@@ -1049,7 +1239,262 @@ void DVertexPnControllerOuter::SendAssertStatus(const char* assertString)
 }
 
 //
-// Decrement number of active verticies and close process if done or failed
+// Hand each command in a batch from the GM to the controller of the vertex
+// it names, exactly as if that controller's own command loop had read it
+//
+void DVertexPnControllerOuter::DispatchCommandBatch(DVertexCommandBatch* batch)
+{
+    {
+        AutoCriticalSection acs(&m_baseCS);
+
+        if (m_activeVertexCount == 0)
+        {
+            //
+            // The GM only hands an idle process more vertices once it has
+            // seen every vertex the process ran before finish, so their
+            // entries no longer need to be in the status batch
+            //
+            UInt32 j;
+            for (j=0; j<m_numberOfVertices; ++j)
+            {
+                if (m_controllerArray[j]->m_statusBatchExitSent)
+                {
+                    m_controllerArray[j]->m_statusBatchEntry = NULL;
+                }
+            }
+        }
+    }
+
+    UInt32 i;
+    for (i=0; i<batch->GetNumberOfCommands(); ++i)
+    {
+        DVertexCommandBlock* command = batch->GetCommand(i);
+        UInt32 vertexId = command->GetProcessStatus()->GetVertexId();
+        UInt32 vertexVersion =
+            command->GetProcessStatus()->GetVertexInstanceVersion();
+
+        DVertexPnController* controller = NULL;
+        {
+            AutoCriticalSection acs(&m_baseCS);
+
+            UInt32 j;
+            for (j=0; j<m_numberOfVertices; ++j)
+            {
+                if (m_controllerArray[j]->m_vertexId == vertexId &&
+                    m_controllerArray[j]->m_vertexVersion == vertexVersion)
+                {
+                    controller = m_controllerArray[j];
+                    break;
+                }
+            }
+        }
+
+        if (controller == NULL)
+        {
+            if (!m_reuseProcess)
+            {
+                DrLogE("Command batch names vertex %u.%u which is not hosted here",
+                       vertexId, vertexVersion);
+                continue;
+            }
+
+            //
+            // The GM has handed this process a new vertex to run
+            //
+            DrLogI("Taking on vertex %u.%u", vertexId, vertexVersion);
+            controller = AddController(vertexId, vertexVersion);
+        }
+
+        DrLogI("Dispatching batched command for vertex %u.%u",
+               vertexId, vertexVersion);
+
+        DrError err = controller->ActOnCommand(command);
+        if (err != DrError_OK)
+        {
+            //
+            // Same treatment the vertex's own command loop gives a bad command
+            //
+            DrLogW("Command batch got bad vertex command %s for vertex %u.%u",
+                   DRERRORSTRING(err), vertexId, vertexVersion);
+            controller->Terminate(err, DrExitCode_Fail);
+        }
+    }
+}
+
+//
+// Make a controller for a vertex the GM has sent to a reused process and
+// start listening for its commands
+//
+DVertexPnController* DVertexPnControllerOuter::AddController(UInt32 vertexId,
+                                                            UInt32 vertexVersion)
+{
+    DVertexPnController* controller = MakePnController(vertexId, vertexVersion);
+    LogAssert(controller != NULL);
+
+    {
+        AutoCriticalSection acs(&m_baseCS);
+
+        if (m_numberOfVertices == m_controllerSlots)
+        {
+            DVertexPnController** newArray =
+                new DVertexPnController* [2 * m_controllerSlots];
+            LogAssert(newArray != NULL);
+            memcpy(newArray, m_controllerArray,
+                   m_numberOfVertices * sizeof(DVertexPnController*));
+            delete [] m_controllerArray;
+            m_controllerArray = newArray;
+            m_controllerSlots = 2 * m_controllerSlots;
+        }
+
+        m_controllerArray[m_numberOfVertices] = controller;
+        ++m_numberOfVertices;
+        ++m_activeVertexCount;
+    }
+
+    controller->LaunchCommandLoop();
+
+    return controller;
+}
+
+//
+// By default commands only arrive through the per-vertex command loops
+//
+void DVertexPnControllerOuter::LaunchCommandBatchLoop(bool /* startBatchDue */)
+{
+}
+
+//
+// Record the latest status of one of the vertices for the next status batch
+//
+void DVertexPnControllerOuter::UpdateStatusBatch(DVertexPnController* controller,
+                                                 DrSimpleHeapBuffer* entry,
+                                                 UInt32 exitOnCompletion)
+{
+    AutoCriticalSection acs(&m_baseCS);
+
+    controller->m_statusBatchEntry = entry;
+    if (exitOnCompletion != DrExitCode_StillActive)
+    {
+        controller->m_statusBatchExitCode = exitOnCompletion;
+    }
+}
+
+//
+// Only transports that can write the status batch ask for it
+//
+void DVertexPnControllerOuter::SendStatusBatch(bool /* notifyWaiters */)
+{
+    DrLogA("Status batch is not supported by this controller");
+}
+
+//
+// Serialize the latest status of every vertex that has reported one. Vertices
+// that have finished stay in the batch, since the GM may not yet have read
+// the version that told it so, until DispatchCommandBatch sees the GM reuse
+// the process. Any exit the batch carries is acted on once it has been
+// delivered
+//
+DrSimpleHeapBuffer* DVertexPnControllerOuter::MakeStatusBatch()
+{
+    DrSimpleHeapBuffer* block = new DrSimpleHeapBuffer();
+    LogAssert(block != NULL);
+
+    AutoCriticalSection acs(&m_baseCS);
+
+    UInt32 nEntries = 0;
+    UInt32 i;
+    for (i=0; i<m_numberOfVertices; ++i)
+    {
+        if (m_controllerArray[i]->m_statusBatchEntry != NULL)
+        {
+            ++nEntries;
+        }
+    }
+
+    {
+        DrMemoryBufferWriter writer(block);
+
+        writer.WriteUInt16Property(Prop_Dryad_BeginTag, DryadTag_VertexStatusBatch);
+        writer.WriteUInt32Property(Prop_Dryad_NumberOfVertices, nEntries);
+
+        for (i=0; i<m_numberOfVertices; ++i)
+        {
+            DVertexPnController* controller = m_controllerArray[i];
+            if (controller->m_statusBatchEntry != NULL)
+            {
+                writer.WriteBytesFromBuffer(controller->m_statusBatchEntry);
+                if (controller->m_statusBatchExitCode != DrExitCode_StillActive)
+                {
+                    controller->m_statusBatchExitSent = true;
+                }
+            }
+        }
+
+        writer.WriteUInt16Property(Prop_Dryad_EndTag, DryadTag_VertexStatusBatch);
+
+        DrError err = writer.FlushMemoryWriter();
+        LogAssert(err == DrError_OK);
+    }
+
+    return block;
+}
+
+//
+// A status batch has been written, so every vertex whose exit it carried
+// has now told the GM it is done
+//
+void DVertexPnControllerOuter::StatusBatchDelivered()
+{
+    UInt32 nExits = 0;
+    UInt32* exitCode;
+
+    {
+        AutoCriticalSection acs(&m_baseCS);
+
+        exitCode = new UInt32 [m_numberOfVertices];
+        LogAssert(exitCode != NULL);
+
+        UInt32 i;
+        for (i=0; i<m_numberOfVertices; ++i)
+        {
+            DVertexPnController* controller = m_controllerArray[i];
+            if (controller->m_statusBatchExitSent &&
+                controller->m_statusBatchExitCode != DrExitCode_StillActive)
+            {
+                exitCode[nExits] = controller->m_statusBatchExitCode;
+                ++nExits;
+
+                //
+                // Leave the entry in place but don't report the exit twice
+                //
+                controller->m_statusBatchExitCode = DrExitCode_StillActive;
+            }
+        }
+    }
+
+    UInt32 i;
+    for (i=0; i<nExits; ++i)
+    {
+        DrLogI("Exiting after status batch is set");
+        VertexExiting(exitCode[i]);
+    }
+
+    delete [] exitCode;
+}
+
+//
+// True once an assert has been reported, after which a status that can't be
+// sent mustn't assert again
+//
+bool DVertexPnControllerOuter::HasAsserted()
+{
+    return (m_assertCounter > 0);
+}
+
+//
+// Decrement number of active verticies and close process if done or failed.
+// A reusable process stays up when its vertices succeed, waiting for the GM
+// to send it more
 //
 void DVertexPnControllerOuter::VertexExiting(int exitCode)
 {
@@ -1062,13 +1507,57 @@ void DVertexPnControllerOuter::VertexExiting(int exitCode)
 
         LogAssert(m_activeVertexCount > 0);
         --m_activeVertexCount;
-        if (m_activeVertexCount == 0 || exitCode != 0)
+        if (exitCode != 0 ||
+            (m_activeVertexCount == 0 && !m_reuseProcess))
         {
+            if (exitCode == 0 && m_failOnExit)
+            {
+                exitCode = DrExitCode_Fail;
+            }
             DrExitProcess(exitCode);
         }
+
+        if (m_activeVertexCount == 0)
+        {
+            DrLogI("All vertices complete, waiting to be reused");
+        }
+    }
+}
+
+//
+// True if the process was started with --reuse
+//
+bool DVertexPnControllerOuter::IsReusingProcess()
+{
+    return m_reuseProcess;
+}
+
+//
+// Stop waiting to be reused. The process exits as soon as it has no
+// vertices left to finish, and fails so that the GM reschedules any
+// vertices it handed the process that never arrived
+//
+void DVertexPnControllerOuter::StopReusingProcess()
+{
+    AutoCriticalSection acs(&m_baseCS);
+
+    m_reuseProcess = false;
+    m_failOnExit = true;
+    if (m_activeVertexCount == 0)
+    {
+        DrLogI("No vertices running, exiting instead of waiting to be reused");
+        DrExitProcess(DrExitCode_Fail);
     }
 }
 
+//
+// True if the process was started with --statusbatch
+//
+bool DVertexPnControllerOuter::IsBatchingStatus()
+{
+    return m_batchStatus;
+}
+
 //
 // Return current exe path
 //
@@ -1091,11 +1580,39 @@ UInt32 DVertexPnControllerOuter::Run(int argc, char* argv[])
         return 1;
     }
 
+    //
+    // --reuse asks the process to wait for more vertices once its own are done.
+    // --statusbatch asks it to report all its vertices in one status property
+    //
+    UInt32 firstArg = 1;
+    for (;;)
+    {
+        if (::strcmp(argv[firstArg], "--reuse") == 0)
+        {
+            m_reuseProcess = true;
+        }
+        else if (::strcmp(argv[firstArg], "--statusbatch") == 0)
+        {
+            m_batchStatus = true;
+        }
+        else
+        {
+            break;
+        }
+
+        ++firstArg;
+        if ((UInt32) argc <= firstArg)
+        {
+            DrLogE("No vertex arguments specified to the PN controller");
+            return 1;
+        }
+    }
+
     //
     // Get path and num verticies
     //
     m_exePathName = argv[0];
-    m_numberOfVertices = atoi(argv[1]);
+    m_numberOfVertices = atoi(argv[firstArg]);
 
     //
     // Fail if number of verticies cannot be converted
@@ -1110,11 +1627,11 @@ UInt32 DVertexPnControllerOuter::Run(int argc, char* argv[])
     //
     // If number of arguments isn't 2*numVerticies + 2, then it doesn't make sense
     //
-    if ((UInt32) argc != (2 + 2*m_numberOfVertices))
+    if ((UInt32) argc != (firstArg + 1 + 2*m_numberOfVertices))
     {
         DrLogE( "%u vertices specified to the PN controller need "
                 "%u not %d arguments to describe them",
-                m_numberOfVertices, 2 + 2*m_numberOfVertices, argc);
+                m_numberOfVertices, firstArg + 1 + 2*m_numberOfVertices, argc);
         return 1;
     }
 
@@ -1124,6 +1641,7 @@ UInt32 DVertexPnControllerOuter::Run(int argc, char* argv[])
     LogAssert(m_controllerArray == NULL);
     m_controllerArray = new DVertexPnController* [m_numberOfVertices];
     LogAssert(m_controllerArray != NULL);
+    m_controllerSlots = m_numberOfVertices;
 
     //
     // Critical section to update the number of active verticies
@@ -1143,8 +1661,8 @@ UInt32 DVertexPnControllerOuter::Run(int argc, char* argv[])
         //
         // cmdline has each vertex info in for <vertexID, vertexVersion>
         //
-        UInt32 vertexId = atoi(argv[2 + i*2]);
-        UInt32 vertexVersion = atoi(argv[2 + i*2 + 1]);
+        UInt32 vertexId = atoi(argv[firstArg + 1 + i*2]);
+        UInt32 vertexVersion = atoi(argv[firstArg + 1 + i*2 + 1]);
 
         //
         // Make a new controller for each vertex
@@ -1163,6 +1681,18 @@ UInt32 DVertexPnControllerOuter::Run(int argc, char* argv[])
         m_controllerArray[i]->LaunchCommandLoop();
     }
 
+    //
+    // When several vertices share the process the GM always writes one
+    // batched command for them, empty if it starts them one at a time
+    // instead. A reused process is sent its new vertices the same way. A
+    // process with a single vertex is never sent a batch, so it doesn't
+    // listen for one
+    //
+    if (m_numberOfVertices > 1 || m_reuseProcess)
+    {
+        LaunchCommandBatchLoop(m_numberOfVertices > 1);
+    }
+
     //
     // Sleep forever - commandloop will take down process when instructed to do so
     //
@@ -46,14 +46,18 @@ public:
                              bool sendUpdate, bool notifyWaiters);
     void LaunchCommandLoop();
     void SendAssertStatus(const char* assertString);
+    bool HasRetired();
 
 protected:
     void SetChannelStatus(DryadChannelDescription* dst,
                           DryadChannelDescription* src);
+    bool ChannelStatusChanged(DryadChannelDescription* dst,
+                              DryadChannelDescription* src);
     void AssimilateChannelStatus(DryadChannelDescription* dst,
                                  DryadChannelDescription* src);
 
     void SendStatus(UInt32 exitOnCompletion, bool notifyWaiters);
+    void StoreInStatusBatch(DVertexStatus* status, UInt32 exitOnCompletion);
     void Start(DVertexCommandBlock* commandBlock);
     void ReOpenChannels(DVertexCommandBlock* reOpenCommand);
     void Terminate(DrError vertexState, UInt32 exitCode);
@@ -77,7 +81,19 @@ protected:
     bool                       m_activeVertex;
     bool                       m_waitingForTermination;
     DrRef<DVertexStatus>       m_currentStatus;
+    bool                       m_statusChanged;
+    DrTimeStamp                m_lastPushTime;
     CRITSEC                    m_baseCS;
+
+    //
+    // This vertex's entry in the process status batch, and the exit code
+    // its final entry carries. Protected by the outer's m_baseCS
+    //
+    DrRef<DrSimpleHeapBuffer>  m_statusBatchEntry;
+    UInt32                     m_statusBatchExitCode;
+    bool                       m_statusBatchExitSent;
+
+    friend class DVertexPnControllerOuter;
 };
 
 class DVertexPnControllerOuter
@@ -88,18 +104,39 @@ public:
     UInt32 Run(int argc, char* argv[]);
     void VertexExiting(int exitCode);
     const char* GetRunningExePathName();
+    bool IsReusingProcess();
+    void StopReusingProcess();
+    bool IsBatchingStatus();
+    void UpdateStatusBatch(DVertexPnController* controller,
+                           DrSimpleHeapBuffer* entry,
+                           UInt32 exitOnCompletion);
+    virtual void SendStatusBatch(bool notifyWaiters);
+
+protected:
+    void DispatchCommandBatch(DVertexCommandBatch* batch);
+    DVertexPnController* AddController(UInt32 vertexId,
+                                       UInt32 vertexVersion);
+    DrSimpleHeapBuffer* MakeStatusBatch();
+    void StatusBatchDelivered();
+    bool HasAsserted();
 
 private:
     void SendAssertStatus(const char* assertString);
     static void AssertCallback(void* cookie,
                                const char* assertString);
 
+    virtual void LaunchCommandBatchLoop(bool startBatchDue);
+
     virtual DVertexPnController* MakePnController(UInt32 vertexId,
                                                   UInt32 vertexVersion) = 0;
 
     DVertexPnController**  m_controllerArray;
+    UInt32                 m_controllerSlots;
     volatile LONG          m_assertCounter;
     UInt32                 m_numberOfVertices;
+    bool                   m_reuseProcess;
+    bool                   m_failOnExit;
+    bool                   m_batchStatus;
     UInt32                 m_activeVertexCount;
     DrStr64                m_exePathName;
     CRITSEC                m_baseCS;
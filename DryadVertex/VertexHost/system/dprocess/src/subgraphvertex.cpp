@@ -206,8 +206,9 @@ DrError DryadSubGraphVertex::VertexInfo::
     LogAssert(m_workQueue == NULL);
     if (m_canShareWorkQueue == false)
     {
-        m_workQueue = new WorkQueue(numberOfWorkQueueThreads,
-                                    concurrentWorkQueueThreads);
+        m_workQueue =
+            WorkQueue::MakeWorkQueue(numberOfWorkQueueThreads,
+                                     concurrentWorkQueueThreads);
         m_workQueue->Start();
 
         DrLogI( "Added private work queue. Vertex ID %u", m_id);
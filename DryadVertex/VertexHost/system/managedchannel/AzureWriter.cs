@@ -91,20 +91,16 @@ namespace Microsoft.Research.Dryad.Channel
             return null;
         }
 
-        public override async Task<string> WriteBuffer(byte[] managedBuffer)
+        public override async Task<string> WriteBuffer(byte[] managedBuffer, int count)
         {
-            Log.LogInformation("writing buffer " + managedBuffer.Length);
-            if (managedBuffer.LongLength > Int32.MaxValue)
-            {
-                throw new ApplicationException("Can't write a record larger than 2GB, attempting " + managedBuffer.LongLength);
-            }
+            Log.LogInformation("writing buffer " + count);
 
-            if (managedBuffer.Length > AzureConsts.MaxBlockSize4MB)
+            if (count > AzureConsts.MaxBlockSize4MB)
             {
                 exceededBlockSize = true;
             }
 
-            if (!exceededBlockSize && bytesWritten + managedBuffer.Length > AzureConsts.Size256MB)
+            if (!exceededBlockSize && bytesWritten + count > AzureConsts.Size256MB)
             {
                 Log.LogInformation("opening new stream");
                 await Close();
@@ -113,9 +109,9 @@ namespace Microsoft.Research.Dryad.Channel
             }
 
             int offset = 0;
-            while (offset < managedBuffer.Length)
+            while (offset < count)
             {
-                int toWrite = (int)Math.Min((long)AzureConsts.MaxBlockSize4MB, managedBuffer.Length - offset);
+                int toWrite = (int)Math.Min((long)AzureConsts.MaxBlockSize4MB, count - offset);
                 Log.LogInformation("writing block " + offset + " " + toWrite);
                 await writer.WriteBlockAsync(managedBuffer, offset, toWrite);
                 Log.LogInformation("wrote block " + offset + " " + toWrite);
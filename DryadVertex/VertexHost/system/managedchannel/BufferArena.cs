@@ -0,0 +1,201 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Microsoft.Research.Dryad.Channel
+{
+    /// <summary>
+    /// a process-wide pool of pinned managed arrays that back the native channel buffers
+    /// used by the managed readers and writers. Native code holds a block by its integer
+    /// handle and uses the pinned address directly, while the managed side reads from or
+    /// writes to the same array, so data is never copied across the boundary.
+    /// </summary>
+    public class BufferArena
+    {
+        private class Block
+        {
+            public byte[] data;
+            public GCHandle pin;
+            public bool lent;
+            public bool abandoned;
+        }
+
+        // idle blocks are kept pinned until this many bytes are pooled
+        private const long MaxPooledBytes = 256L * 1024 * 1024;
+
+        private static readonly BufferArena s_shared = new BufferArena();
+
+        private readonly List<Block> blocks;
+        private readonly Stack<int> freeHandles;
+        private readonly Dictionary<int, Stack<int>> idle;
+        private long pooledBytes;
+        private long lentBytes;
+        private long highWaterMark;
+
+        public BufferArena()
+        {
+            blocks = new List<Block>();
+            freeHandles = new Stack<int>();
+            idle = new Dictionary<int, Stack<int>>();
+            pooledBytes = 0;
+            lentBytes = 0;
+            highWaterMark = 0;
+        }
+
+        public static BufferArena Shared { get { return s_shared; } }
+
+        /// <summary>
+        /// the number of bytes currently lent out
+        /// </summary>
+        public long LentBytes
+        {
+            get { lock (this) { return lentBytes; } }
+        }
+
+        /// <summary>
+        /// the largest number of bytes that have been lent out at once
+        /// </summary>
+        public long HighWaterMark
+        {
+            get { lock (this) { return highWaterMark; } }
+        }
+
+        /// <summary>
+        /// lend a pinned block of exactly size bytes, reusing an idle one if there is one
+        /// </summary>
+        /// <returns>the handle of the block</returns>
+        public int Lend(int size)
+        {
+            lock (this)
+            {
+                int handle;
+                Stack<int> sameSize;
+                if (idle.TryGetValue(size, out sameSize) && sameSize.Count > 0)
+                {
+                    handle = sameSize.Pop();
+                    pooledBytes -= size;
+                }
+                else
+                {
+                    var block = new Block();
+                    block.data = new byte[size];
+                    block.pin = GCHandle.Alloc(block.data, GCHandleType.Pinned);
+
+                    if (freeHandles.Count > 0)
+                    {
+                        handle = freeHandles.Pop();
+                        blocks[handle] = block;
+                    }
+                    else
+                    {
+                        handle = blocks.Count;
+                        blocks.Add(block);
+                    }
+                }
+
+                blocks[handle].lent = true;
+                lentBytes += size;
+                if (lentBytes > highWaterMark)
+                {
+                    highWaterMark = lentBytes;
+                }
+
+                return handle;
+            }
+        }
+
+        public byte[] Data(int handle)
+        {
+            lock (this)
+            {
+                return LentBlock(handle).data;
+            }
+        }
+
+        public IntPtr Address(int handle)
+        {
+            lock (this)
+            {
+                return LentBlock(handle).pin.AddrOfPinnedObject();
+            }
+        }
+
+        /// <summary>
+        /// give a block back to the arena. It is kept pinned for reuse unless the pool
+        /// is full or the block was abandoned
+        /// </summary>
+        public void Return(int handle)
+        {
+            lock (this)
+            {
+                Block block = LentBlock(handle);
+                int size = block.data.Length;
+
+                block.lent = false;
+                lentBytes -= size;
+
+                if (!block.abandoned && pooledBytes + size <= MaxPooledBytes)
+                {
+                    Stack<int> sameSize;
+                    if (!idle.TryGetValue(size, out sameSize))
+                    {
+                        sameSize = new Stack<int>();
+                        idle.Add(size, sameSize);
+                    }
+                    sameSize.Push(handle);
+                    pooledBytes += size;
+                }
+                else
+                {
+                    block.pin.Free();
+                    blocks[handle] = null;
+                    freeHandles.Push(handle);
+                }
+            }
+        }
+
+        /// <summary>
+        /// mark a lent block so it will not be reused when it is returned. This is used
+        /// when an I/O that targets the array may still complete after the block has been
+        /// handed back, e.g. after a read timeout
+        /// </summary>
+        public void Abandon(int handle)
+        {
+            lock (this)
+            {
+                LentBlock(handle).abandoned = true;
+            }
+        }
+
+        private Block LentBlock(int handle)
+        {
+            if (handle < 0 || handle >= blocks.Count || blocks[handle] == null || !blocks[handle].lent)
+            {
+                throw new ApplicationException("Buffer arena handle " + handle + " is not lent");
+            }
+            return blocks[handle];
+        }
+    }
+}
@@ -57,9 +57,9 @@ namespace Microsoft.Research.Dryad.Channel
             return Task.FromResult<string>(null);
         }
 
-        public override async Task<string> WriteBuffer(byte[] managedBuffer)
+        public override async Task<string> WriteBuffer(byte[] managedBuffer, int count)
         {
-            await file.WriteAsync(managedBuffer, 0, managedBuffer.Length);
+            await file.WriteAsync(managedBuffer, 0, count);
             return null;
         }
 
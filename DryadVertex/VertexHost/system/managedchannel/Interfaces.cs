@@ -147,6 +147,14 @@ namespace Microsoft.Research.Dryad.Channel
         public int size;
         public IntPtr storage;
         public IntPtr handle;
+
+        /// <summary>
+        /// when storage was lent from the BufferArena, the pinned array behind it and
+        /// the arena handle of the block; otherwise null and -1, and the data at
+        /// storage must be copied
+        /// </summary>
+        public byte[] data;
+        public int arenaHandle = -1;
     }
 
     public interface IReaderClient
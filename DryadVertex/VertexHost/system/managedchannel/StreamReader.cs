@@ -208,7 +208,8 @@ namespace Microsoft.Research.Dryad.Channel
 
         private async Task DataLoop(bool errorState)
         {
-            var managedBuffer = new byte[bufferSize];
+            // only used for buffers that were not lent from the arena
+            byte[] managedBuffer = null;
             var readData = new ReadData { eof = false, nRead = 0 };
 
             while ((!readData.eof) || errorState)
@@ -243,12 +244,29 @@ namespace Microsoft.Research.Dryad.Channel
                             throw new ApplicationException("Buffer offset " + buffer.offset + " expected " + offset);
                         }
 
+                        // read straight into the pinned arena array when there is one
+                        bool inPlace = (buffer.data != null && buffer.data.Length == bufferSize);
+                        byte[] target = buffer.data;
+                        if (!inPlace)
+                        {
+                            if (managedBuffer == null)
+                            {
+                                managedBuffer = new byte[bufferSize];
+                            }
+                            target = managedBuffer;
+                        }
+
                         log.LogInformation("Waiting for buffer read");
 
                         Task<ReadData> timeout = Task.Delay(SafetyTimeout).ContinueWith((t) => new ReadData());
-                        Task<ReadData> reads = await Task.WhenAny(timeout, ReadBuffer(managedBuffer));
+                        Task<ReadData> reads = await Task.WhenAny(timeout, ReadBuffer(target));
                         if (reads == timeout)
                         {
+                            if (inPlace)
+                            {
+                                // the read may still land in the array after we discard it
+                                BufferArena.Shared.Abandon(buffer.arenaHandle);
+                            }
                             throw new ApplicationException("Excessive timeout on read operation");
                         }
                         readData = reads.Result;
@@ -256,7 +274,10 @@ namespace Microsoft.Research.Dryad.Channel
                         log.LogInformation("Got buffer read " + readData.nRead);
 
                         buffer.size = readData.nRead;
-                        Marshal.Copy(managedBuffer, 0, buffer.storage, readData.nRead);
+                        if (!inPlace)
+                        {
+                            Marshal.Copy(managedBuffer, 0, buffer.storage, readData.nRead);
+                        }
 
                         log.LogInformation("Returning to client");
 
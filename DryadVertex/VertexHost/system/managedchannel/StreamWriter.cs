@@ -146,17 +146,27 @@ namespace Microsoft.Research.Dryad.Channel
                 throw new ApplicationException("Expected offset " + offset + " got " + buffer.offset);
             }
 
-            byte[] managedBuffer = new byte[buffer.size];
-            Marshal.Copy(buffer.storage, managedBuffer, 0, buffer.size);
+            // write straight from the pinned arena array when there is one
+            byte[] managedBuffer = buffer.data;
+            if (managedBuffer == null)
+            {
+                managedBuffer = new byte[buffer.size];
+                Marshal.Copy(buffer.storage, managedBuffer, 0, buffer.size);
 
-            log.LogInformation("Copied write buffer");
+                log.LogInformation("Copied write buffer");
+            }
 
             try
             {
                 Task<string> timeout = Task.Delay(SafetyTimeout).ContinueWith((t) => "");
-                Task<string> writes = await Task.WhenAny(timeout, WriteBuffer(managedBuffer));
+                Task<string> writes = await Task.WhenAny(timeout, WriteBuffer(managedBuffer, buffer.size));
                 if (writes == timeout)
                 {
+                    if (buffer.data != null)
+                    {
+                        // the write may still be reading the array after we return it
+                        BufferArena.Shared.Abandon(buffer.arenaHandle);
+                    }
                     throw new ApplicationException("Excessive timeout on read operation");
                 }
                 error = writes.Result;
@@ -209,7 +219,10 @@ namespace Microsoft.Research.Dryad.Channel
             log.LogInformation("Finished all writes");
         }
 
-        abstract public Task<string> WriteBuffer(byte[] buffer);
+        /// <summary>
+        /// write the first count bytes of buffer to the stream
+        /// </summary>
+        abstract public Task<string> WriteBuffer(byte[] buffer, int count);
 
         abstract public Task<string> Close();
 
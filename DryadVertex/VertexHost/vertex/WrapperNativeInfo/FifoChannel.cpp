@@ -24,6 +24,8 @@ limitations under the License.
 #include <nullchanneltransform.h>
 #include <gzipdecompressionchanneltransform.h>
 #include <gzipcompressionchanneltransform.h>
+#include <FramedCompressionChannelTransform.h>
+#include <FramedDecompressionChannelTransform.h>
 
 #pragma unmanaged 
 
@@ -44,7 +46,9 @@ void FifoChannelItemWriterHandler::ProcessWriteCompleted(RChannelItemType status
 FifoChannel::FifoChannel(RChannelReader* reader, 
                          RChannelWriter *writer, 
                          DryadVertexProgram* vertex,
-                         TransformType transType)
+                         WorkQueue* workQueue,
+                         TransformType transType,
+                         int compressionLevel)
 {
     m_initialHandlerSent = false;
     m_vertex = vertex;
@@ -73,6 +77,23 @@ FifoChannel::FifoChannel(RChannelReader* reader,
         m_transform = new GzipDecompressionChannelTransform(vertex, false);
         break;
 #endif 
+#ifdef LINKWITHLZ4
+    case TT_Lz4Compression:
+    case TT_Lz4HighCompression:
+        m_transform = new FramedCompressionChannelTransform(vertex, workQueue, FCC_Lz4, compressionLevel);
+        break;
+#endif
+#ifdef LINKWITHZSTD
+    case TT_ZstdFastCompression:
+    case TT_ZstdCompression:
+        m_transform = new FramedCompressionChannelTransform(vertex, workQueue, FCC_Zstd, compressionLevel);
+        break;
+#endif
+#if defined(LINKWITHLZ4) || defined(LINKWITHZSTD)
+    case TT_FramedDecompression:
+        m_transform = new FramedDecompressionChannelTransform(vertex, workQueue);
+        break;
+#endif
     default:
         DrLogE("Invalid compressionScheme.");
         LogAssert(false);
@@ -36,7 +36,8 @@ FifoInputChannel::FifoInputChannel(UInt32 portNum,
     m_origReader = channel;
 
     MakeFifo(3, workQueue);
-    m_fifoChannel = new FifoChannel(m_origReader, m_fifoWriter->GetWriter(), vertex, tType);
+    m_fifoChannel = new FifoChannel(m_origReader, m_fifoWriter->GetWriter(), vertex, workQueue,
+        tType, 0);
     m_reader = m_fifoReader->GetReader();
 }
 
@@ -123,19 +124,35 @@ void FifoInputChannel::MakeFifo(UInt32 fifoLength, WorkQueue* workQueue)
     m_fifoWriter->GetWriter()->Start();
 }
 
-DataBlockItem*  FifoInputChannel::ReadDataBlock(byte **ppDataBlock,
-    Int32 *ppDataBlockSize,
-    Int32 *pErrorCode)
+void FifoInputChannel::EnsureStarted()
 {
     if (!m_initialHandlerSent)
     {
         m_initialHandlerSent = true;
         m_fifoChannel->Start();
     }
+}
+
+DataBlockItem*  FifoInputChannel::ReadDataBlock(byte **ppDataBlock,
+    Int32 *ppDataBlockSize,
+    Int32 *pErrorCode)
+{
+    EnsureStarted();
     return InputChannel::ReadDataBlock(ppDataBlock, ppDataBlockSize,
         pErrorCode);
 }
 
+UInt32 FifoInputChannel::ReadDataBlocks(UInt32 maxBlocks,
+    DataBlockItem **pItems,
+    byte **ppDataBlocks,
+    Int32 *pDataBlockSizes,
+    Int32 *pErrorCode)
+{
+    EnsureStarted();
+    return InputChannel::ReadDataBlocks(maxBlocks, pItems, ppDataBlocks,
+        pDataBlockSizes, pErrorCode);
+}
+
 const char* FifoInputChannel::GetURI()
 {
     return m_origReader->GetURI();
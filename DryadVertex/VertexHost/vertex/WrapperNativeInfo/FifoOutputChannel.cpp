@@ -29,14 +29,16 @@ limitations under the License.
 
 
 FifoOutputChannel::FifoOutputChannel(UInt32 portNum, DryadVertexProgram* vertex, 
-    WorkQueue *workQueue, RChannelWriter* outputChannel, TransformType tType):
+    WorkQueue *workQueue, RChannelWriter* outputChannel, TransformType tType,
+    int compressionLevel):
     OutputChannel(portNum, vertex, outputChannel) 
 {
     m_origWriter = outputChannel;
     m_fifoReader = NULL;
     m_fifoWriter = NULL;
     MakeFifo(3, workQueue);
-    m_fifoChannel = new FifoChannel(m_fifoReader->GetReader(), m_origWriter, vertex, tType);
+    m_fifoChannel = new FifoChannel(m_fifoReader->GetReader(), m_origWriter, vertex, workQueue,
+        tType, compressionLevel);
 
     m_writer = m_fifoWriter->GetWriter();    
     m_fifoChannel->Start();
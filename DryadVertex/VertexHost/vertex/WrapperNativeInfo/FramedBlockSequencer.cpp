@@ -0,0 +1,249 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include "stdafx.h"
+
+#include <FramedBlockSequencer.h>
+#include <fifochannel.h>
+#include <workqueue.h>
+
+#pragma unmanaged 
+
+/* the WorkQueue deletes its requests after running them, so each one
+   holds its own reference on the block. A request whose block has
+   already been claimed by Drain just drops that reference, and never
+   touches the sequencer, which may be gone by then */
+class FramedBlockSequencer::BlockRequest : public WorkRequest
+{
+public:
+    BlockRequest(FramedBlockSequencer* sequencer, FramedBlock* block)
+    {
+        m_sequencer = sequencer;
+        m_block = block;
+    }
+
+    void Process()
+    {
+        if (m_block->Claim())
+        {
+            m_sequencer->Execute(m_block);
+        }
+        m_block = NULL;
+    }
+
+    bool ShouldAbort()
+    {
+        return false;
+    }
+
+private:
+    FramedBlockSequencer*   m_sequencer;
+    DrRef<FramedBlock>      m_block;
+};
+
+FramedBlock::FramedBlock()
+{
+    m_claimed = 0;
+    m_queued = false;
+    m_done = false;
+    m_succeeded = false;
+}
+
+FramedBlock::~FramedBlock()
+{
+}
+
+bool FramedBlock::Claim()
+{
+    return (::InterlockedExchange(&m_claimed, 1) == 0);
+}
+
+FramedBlockSequencer::FramedBlockSequencer(WorkQueue* workQueue,
+                                           UInt32 maxBlocksInFlight)
+{
+    LogAssert(maxBlocksInFlight > 0);
+    m_workQueue = workQueue;
+    m_maxBlocksInFlight = maxBlocksInFlight;
+    m_channel = NULL;
+    m_blocksInFlight = 0;
+    m_failed = false;
+    m_drainedEvent = ::CreateEvent(NULL, TRUE, TRUE, NULL);
+    LogAssert(m_drainedEvent != NULL);
+}
+
+FramedBlockSequencer::~FramedBlockSequencer()
+{
+    LogAssert(m_blocks.IsEmpty());
+    LogAssert(m_blocksInFlight == 0);
+    BOOL bRet = ::CloseHandle(m_drainedEvent);
+    LogAssert(bRet != 0);
+}
+
+void FramedBlockSequencer::Start(FifoChannel* channel)
+{
+    m_channel = channel;
+}
+
+bool FramedBlockSequencer::Submit(FramedBlock* block)
+{
+    if (!Queue(block))
+    {
+        return false;
+    }
+
+    CatchUp();
+    return true;
+}
+
+bool FramedBlockSequencer::Queue(FramedBlock* block)
+{
+    {
+        AutoCriticalSection acs(&m_critsec);
+
+        if (m_failed)
+        {
+            block->DecRef();
+            return false;
+        }
+
+        /* the list takes over the caller's reference */
+        m_blocks.InsertAsTail(m_blocks.CastIn(block));
+        ++m_blocksInFlight;
+        BOOL bRet = ::ResetEvent(m_drainedEvent);
+        LogAssert(bRet != 0);
+
+        /* beyond the limit the block is left for CatchUp, which holds
+           up the channel writer until the queue catches up */
+        block->m_queued = (m_workQueue != NULL &&
+                           m_blocksInFlight <= m_maxBlocksInFlight);
+        if (!block->m_queued)
+        {
+            return true;
+        }
+    }
+
+    BlockRequest* request = new BlockRequest(this, block);
+    if (!m_workQueue->EnQueue(request))
+    {
+        /* the queue is shutting down */
+        delete request;
+
+        AutoCriticalSection acs(&m_critsec);
+        block->m_queued = false;
+    }
+
+    return true;
+}
+
+void FramedBlockSequencer::CatchUp()
+{
+    FramedBlock* block;
+    while ((block = ClaimUnstartedBlock(true)) != NULL)
+    {
+        Execute(block);
+    }
+}
+
+bool FramedBlockSequencer::HasFailed()
+{
+    AutoCriticalSection acs(&m_critsec);
+    return m_failed;
+}
+
+//
+// Run a claimed block, then write out every finished block at the
+// head of the list
+//
+void FramedBlockSequencer::Execute(FramedBlock* block)
+{
+    bool succeeded = block->Run();
+
+    AutoCriticalSection acs(&m_critsec);
+
+    block->m_done = true;
+    block->m_succeeded = succeeded;
+
+    while (!m_blocks.IsEmpty())
+    {
+        FramedBlock* head = m_blocks.CastOut(m_blocks.GetHead());
+        if (!head->m_done)
+        {
+            break;
+        }
+
+        m_blocks.Remove(m_blocks.CastIn(head));
+
+        if (!m_failed)
+        {
+            if (head->m_succeeded)
+            {
+                m_channel->WriteTransformedItem(head->m_output.Ptr());
+            }
+            else
+            {
+                head->ReportFailure();
+                m_failed = true;
+            }
+        }
+        head->m_output = NULL;
+        head->DecRef();
+
+        LogAssert(m_blocksInFlight > 0);
+        --m_blocksInFlight;
+    }
+
+    if (m_blocksInFlight == 0)
+    {
+        BOOL bRet = ::SetEvent(m_drainedEvent);
+        LogAssert(bRet != 0);
+    }
+}
+
+FramedBlock* FramedBlockSequencer::ClaimUnstartedBlock(bool onlyUnqueued)
+{
+    AutoCriticalSection acs(&m_critsec);
+
+    DrBListEntry* listEntry = m_blocks.GetHead();
+    while (listEntry != NULL)
+    {
+        FramedBlock* block = m_blocks.CastOut(listEntry);
+        listEntry = m_blocks.GetNext(listEntry);
+
+        if ((!onlyUnqueued || !block->m_queued) && block->Claim())
+        {
+            return block;
+        }
+    }
+
+    return NULL;
+}
+
+void FramedBlockSequencer::Drain()
+{
+    FramedBlock* block;
+    while ((block = ClaimUnstartedBlock(false)) != NULL)
+    {
+        Execute(block);
+    }
+
+    /* anything left is being run by a queue thread right now */
+    DWORD waitRet = ::WaitForSingleObject(m_drainedEvent, INFINITE);
+    LogAssert(waitRet == WAIT_OBJECT_0);
+}
@@ -0,0 +1,333 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include "stdafx.h"
+
+#include <FramedCompressionChannelTransform.h>
+#include <wrappernativeinfo.h>
+
+#pragma unmanaged 
+
+#if defined(LINKWITHLZ4) || defined(LINKWITHZSTD)
+
+static const UInt32 s_defaultBlockSize = 256 * 1024;
+static const UInt32 s_maxBlockSize = 4 * 1024 * 1024;
+
+/* one block of input waiting to be compressed. The block owns its
+   input buffer, so the transform can carry on filling the next one */
+class FramedCompressionBlock : public FramedBlock
+{
+public:
+    FramedCompressionBlock(FramedCompressionCodec codec, int level,
+                           byte* input, UInt32 inputSize)
+    {
+        m_codec = codec;
+        m_level = level;
+        m_input = input;
+        m_inputSize = inputSize;
+    }
+
+    ~FramedCompressionBlock()
+    {
+        delete [] m_input;
+    }
+
+    bool Run();
+
+    void ReportFailure()
+    {
+        /* Run() falls back to storing the block, so it can't fail */
+        LogAssert(false);
+    }
+
+private:
+    UInt32 CompressBound();
+
+    FramedCompressionCodec m_codec;
+    int m_level;
+    byte* m_input;
+    UInt32 m_inputSize;
+};
+
+UInt32 FramedCompressionBlock::CompressBound()
+{
+    switch (m_codec)
+    {
+#ifdef LINKWITHLZ4
+    case FCC_Lz4:
+        return (UInt32) LZ4_compressBound((int) m_inputSize);
+#endif
+#ifdef LINKWITHZSTD
+    case FCC_Zstd:
+        return (UInt32) ZSTD_compressBound(m_inputSize);
+#endif
+    default:
+        return m_inputSize;
+    }
+}
+
+// Run may be called on any WorkQueue thread, so it only touches the
+// block's own state
+bool FramedCompressionBlock::Run()
+{
+    LogAssert(m_inputSize > 0);
+
+    UInt32 bound = CompressBound();
+    if (bound < m_inputSize)
+    {
+        /* leave room to fall back to storing the block */
+        bound = m_inputSize;
+    }
+
+    m_output.Attach(new DataBlockItem(sizeof(FramedCompressionHeader) + bound));
+    LogAssert(m_output.Ptr() != NULL);
+    byte *dst = (byte *) m_output->GetDataAddress() + sizeof(FramedCompressionHeader);
+
+    FramedCompressionCodec codec = m_codec;
+    UInt32 compressedSize = 0;
+
+    switch (codec)
+    {
+#ifdef LINKWITHLZ4
+    case FCC_Lz4:
+        {
+            int ret;
+            if (m_level == 0)
+            {
+                ret = LZ4_compress_default((const char *) m_input, (char *) dst,
+                                           (int) m_inputSize, (int) bound);
+            }
+            else
+            {
+                ret = LZ4_compress_HC((const char *) m_input, (char *) dst,
+                                      (int) m_inputSize, (int) bound, m_level);
+            }
+            if (ret > 0)
+            {
+                compressedSize = (UInt32) ret;
+            }
+            else
+            {
+                DrLogW("LZ4 compression failed, storing block. Size %u", m_inputSize);
+            }
+        }
+        break;
+#endif
+#ifdef LINKWITHZSTD
+    case FCC_Zstd:
+        {
+            size_t ret = ZSTD_compress(dst, bound, m_input, m_inputSize,
+                                       (m_level == 0) ? ZSTD_CLEVEL_DEFAULT : m_level);
+            if (!ZSTD_isError(ret))
+            {
+                compressedSize = (UInt32) ret;
+            }
+            else
+            {
+                DrLogW("Zstd compression failed, storing block. Size %u error %s",
+                       m_inputSize, ZSTD_getErrorName(ret));
+            }
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if (compressedSize == 0 || compressedSize >= m_inputSize)
+    {
+        codec = FCC_Stored;
+        compressedSize = m_inputSize;
+        memcpy(dst, m_input, m_inputSize);
+    }
+
+    FramedCompressionHeader header;
+    header.m_magic = s_framedCompressionMagic;
+    header.m_version = s_framedCompressionVersion;
+    header.m_codec = (byte) codec;
+    header.m_flags = 0;
+    header.m_uncompressedSize = m_inputSize;
+    header.m_compressedSize = compressedSize;
+    memcpy(m_output->GetDataAddress(), &header, sizeof(header));
+
+    m_output->SetAvailableSize(sizeof(header) + compressedSize);
+
+    delete [] m_input;
+    m_input = NULL;
+
+    return true;
+}
+
+FramedCompressionChannelTransform::FramedCompressionChannelTransform(DryadVertexProgram* vertex,
+                                                                     WorkQueue* workQueue,
+                                                                     FramedCompressionCodec codec,
+                                                                     int level) :
+    m_sequencer(workQueue, s_framedCompressionMaxBlocksInFlight)
+{
+    LogAssert(sizeof(FramedCompressionHeader) == 16);
+
+    m_vertex = vertex;
+    m_codec = codec;
+    m_level = level;
+    m_blockSize = 0; /* try to infer this from the first item to process */
+    m_inputBuffer = NULL;
+    m_inputFilled = 0;
+}
+
+FramedCompressionChannelTransform::~FramedCompressionChannelTransform()
+{
+    delete [] m_inputBuffer;
+    m_inputBuffer = NULL;
+}
+
+void FramedCompressionChannelTransform::AllocateInputBuffer()
+{
+    LogAssert(m_blockSize > 0);
+    LogAssert(m_inputBuffer == NULL);
+    m_inputBuffer = new byte[m_blockSize];
+    LogAssert(m_inputBuffer != NULL);
+    m_inputFilled = 0;
+}
+
+// SubmitBlock should be called with m_critsec held. The input buffer
+// is handed to the block, so the next ProcessItem starts a new one.
+// A block the WorkQueue can't take yet is compressed by the
+// m_sequencer.CatchUp() the caller makes after releasing m_critsec
+void FramedCompressionChannelTransform::SubmitBlock()
+{
+    LogAssert(m_inputFilled > 0);
+
+    FramedCompressionBlock* block =
+        new FramedCompressionBlock(m_codec, m_level,
+                                   m_inputBuffer, m_inputFilled);
+    m_inputBuffer = NULL;
+    m_inputFilled = 0;
+
+    m_sequencer.Queue(block);
+}
+
+void FramedCompressionChannelTransform::SetOutputBufferSize(UInt32 bufferSize)
+{
+    {
+        AutoCriticalSection acs(&m_critsec);
+
+        if (m_inputFilled > 0)
+        {
+            SubmitBlock();
+        }
+
+        m_blockSize = (bufferSize > s_maxBlockSize) ? s_maxBlockSize : bufferSize;
+        delete [] m_inputBuffer;
+        m_inputBuffer = NULL;
+    }
+
+    m_sequencer.CatchUp();
+}
+
+DrError FramedCompressionChannelTransform::ProcessItem(DataBlockItem *item)
+{
+    UInt32 inputSize = (UInt32) item->GetAvailableSize();
+    if (inputSize == 0)
+    {
+        /* nothing to do here */
+        return DrError_OK;
+    }
+
+    {
+        AutoCriticalSection acs(&m_critsec);
+
+        if (m_blockSize == 0)
+        {
+            /* use the size the app wrote in as the block size, as long as
+               it is a whole number of pages */
+            UInt32 itemSize = (UInt32) item->GetAllocatedSize();
+            UInt32 inputPages = itemSize / (4 * 1024);
+            if (inputPages > 0 && inputPages * 4 * 1024 == itemSize)
+            {
+                m_blockSize = itemSize;
+            }
+            else
+            {
+                m_blockSize = s_defaultBlockSize;
+            }
+
+            if (m_blockSize > s_maxBlockSize)
+            {
+                m_blockSize = s_maxBlockSize;
+            }
+
+            DrLogI( "Starting framed compression. Codec %u level %d block size %u",
+                (UInt32) m_codec, m_level, m_blockSize);
+        }
+
+        const byte *src = (const byte *) item->GetDataAddress();
+        while (inputSize > 0)
+        {
+            if (m_inputBuffer == NULL)
+            {
+                AllocateInputBuffer();
+            }
+
+            UInt32 toCopy = m_blockSize - m_inputFilled;
+            if (toCopy > inputSize)
+            {
+                toCopy = inputSize;
+            }
+
+            memcpy(m_inputBuffer + m_inputFilled, src, toCopy);
+            m_inputFilled += toCopy;
+            src += toCopy;
+            inputSize -= toCopy;
+
+            if (m_inputFilled == m_blockSize)
+            {
+                SubmitBlock();
+            }
+        }
+    }
+
+    m_sequencer.CatchUp();
+
+    return DrError_OK;
+}
+
+DrError FramedCompressionChannelTransform::Finish(bool atEndOfStream)
+{
+    {
+        AutoCriticalSection acs(&m_critsec);
+
+        if (m_inputFilled > 0)
+        {
+            SubmitBlock();
+        }
+    }
+
+    /* every block has to be written before the termination item */
+    m_sequencer.Drain();
+
+    return DrError_OK;
+}
+
+DrError FramedCompressionChannelTransform::Start(FifoChannel *channel)
+{
+    m_sequencer.Start(channel);
+    return DrError_OK;
+}
+#endif
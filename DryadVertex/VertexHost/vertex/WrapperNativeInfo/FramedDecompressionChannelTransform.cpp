@@ -0,0 +1,385 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include "stdafx.h"
+
+#include <FramedDecompressionChannelTransform.h>
+#include <wrappernativeinfo.h>
+
+#pragma unmanaged 
+
+#if defined(LINKWITHLZ4) || defined(LINKWITHZSTD)
+
+/* one compressed block waiting to be decoded. The compressed bytes
+   either live in an input item the block holds a reference to, or in
+   a buffer the block owns when the frame was split across items */
+class FramedDecompressionBlock : public FramedBlock
+{
+public:
+    FramedDecompressionBlock(FramedDecompressionChannelTransform* parent,
+                             const FramedCompressionHeader& header,
+                             DataBlockItem* item, const byte* data,
+                             byte* ownedData)
+    {
+        m_parent = parent;
+        m_header = header;
+        m_item = item;
+        m_data = data;
+        m_ownedData = ownedData;
+    }
+
+    ~FramedDecompressionBlock()
+    {
+        delete [] m_ownedData;
+    }
+
+    bool Run();
+
+    void ReportFailure()
+    {
+        m_parent->DecompressionError("Compressed block failed to decode; corrupted input stream?");
+    }
+
+private:
+    FramedDecompressionChannelTransform* m_parent;
+    FramedCompressionHeader m_header;
+    DrRef<DataBlockItem> m_item;
+    const byte* m_data;
+    byte* m_ownedData;
+};
+
+/* stands in the sequence for a framing error found by the input
+   thread, so the termination item is written after every block that
+   came before it */
+class FramedDecompressionFailure : public FramedBlock
+{
+public:
+    FramedDecompressionFailure(FramedDecompressionChannelTransform* parent,
+                               const char* reason)
+    {
+        m_parent = parent;
+        m_reason = reason;
+    }
+
+    bool Run()
+    {
+        return false;
+    }
+
+    void ReportFailure()
+    {
+        m_parent->DecompressionError(m_reason);
+    }
+
+private:
+    FramedDecompressionChannelTransform* m_parent;
+    const char* m_reason;
+};
+
+// Run may be called on any WorkQueue thread, so it only touches the
+// block's own state
+bool FramedDecompressionBlock::Run()
+{
+    m_output.Attach(new DataBlockItem(m_header.m_uncompressedSize));
+    if (m_output.Ptr() == NULL)
+    {
+        return false;
+    }
+    byte *dst = (byte *) m_output->GetDataAddress();
+
+    bool ok = false;
+    switch (m_header.m_codec)
+    {
+    case FCC_Stored:
+        memcpy(dst, m_data, m_header.m_compressedSize);
+        ok = true;
+        break;
+#ifdef LINKWITHLZ4
+    case FCC_Lz4:
+        {
+            int ret = LZ4_decompress_safe((const char *) m_data, (char *) dst,
+                                          (int) m_header.m_compressedSize,
+                                          (int) m_header.m_uncompressedSize);
+            ok = (ret == (int) m_header.m_uncompressedSize);
+        }
+        break;
+#endif
+#ifdef LINKWITHZSTD
+    case FCC_Zstd:
+        {
+            size_t ret = ZSTD_decompress(dst, m_header.m_uncompressedSize,
+                                         m_data, m_header.m_compressedSize);
+            ok = (!ZSTD_isError(ret) && ret == m_header.m_uncompressedSize);
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+
+    /* let go of the input as soon as it has been decoded */
+    m_item = NULL;
+    m_data = NULL;
+    delete [] m_ownedData;
+    m_ownedData = NULL;
+
+    if (!ok)
+    {
+        m_output = NULL;
+        return false;
+    }
+
+    m_output->SetAvailableSize(m_header.m_uncompressedSize);
+    return true;
+}
+
+FramedDecompressionChannelTransform::FramedDecompressionChannelTransform(DryadVertexProgram* vertex,
+                                                                         WorkQueue* workQueue) :
+    m_sequencer(workQueue, s_framedCompressionMaxBlocksInFlight)
+{
+    m_vertex = vertex;
+    m_channel = NULL;
+    memset(&m_header, 0, sizeof(m_header));
+    m_headerFilled = 0;
+    m_blockBuffer = NULL;
+    m_blockFilled = 0;
+    m_failed = false;
+}
+
+FramedDecompressionChannelTransform::~FramedDecompressionChannelTransform()
+{
+    delete [] m_blockBuffer;
+    m_blockBuffer = NULL;
+    m_channel = NULL;
+}
+
+//
+// Called by the sequencer, in stream order and under its lock, so the
+// termination item follows every block written before it
+//
+void FramedDecompressionChannelTransform::DecompressionError(const char *reason)
+{
+    DrLogE( "Framed decompression failed: %s", reason);
+    m_vertex->ReportError(DryadError_ChannelRestart, reason);
+
+    RChannelItemRef termination;
+    termination.Attach(RChannelMarkerItem::Create(RChannelItem_MarshalError, false));
+    m_channel->WriteTransformedItem(termination.Ptr());
+}
+
+//
+// Report a framing error found on the input thread once the blocks
+// ahead of it have been written
+//
+DrError FramedDecompressionChannelTransform::FailStream(const char *reason)
+{
+    m_failed = true;
+
+    /* if an earlier block has already failed this is dropped, since
+       the termination item has been sent */
+    m_sequencer.Submit(new FramedDecompressionFailure(this, reason));
+    return DrError_IoReadWriteError;
+}
+
+DrError FramedDecompressionChannelTransform::ValidateHeader()
+{
+    if (m_header.m_magic != s_framedCompressionMagic ||
+        m_header.m_version != s_framedCompressionVersion)
+    {
+        return FailStream("Compression frame header corrupted; input was not written by a framed compressor?");
+    }
+
+    switch (m_header.m_codec)
+    {
+    case FCC_Stored:
+        if (m_header.m_compressedSize != m_header.m_uncompressedSize)
+        {
+            return FailStream("Stored compression frame has mismatched sizes");
+        }
+        break;
+#ifdef LINKWITHLZ4
+    case FCC_Lz4:
+        break;
+#endif
+#ifdef LINKWITHZSTD
+    case FCC_Zstd:
+        break;
+#endif
+    default:
+        return FailStream("Compression frame uses a codec that is not available in this build");
+    }
+
+    if (m_header.m_uncompressedSize == 0 ||
+        m_header.m_compressedSize == 0 ||
+        m_header.m_uncompressedSize > s_framedCompressionMaxBlockSize ||
+        m_header.m_compressedSize > s_framedCompressionMaxBlockSize)
+    {
+        return FailStream("Compression frame has an invalid block size; corrupted input stream?");
+    }
+
+    return DrError_OK;
+}
+
+//
+// Hand a complete block to the sequencer. Pass the item the block lies
+// in to decode it in place, or NULL to hand over m_blockBuffer
+//
+DrError FramedDecompressionChannelTransform::SubmitBlock(DataBlockItem* item,
+                                                         const byte* block)
+{
+    FramedDecompressionBlock* decompressionBlock;
+    if (item != NULL)
+    {
+        decompressionBlock =
+            new FramedDecompressionBlock(this, m_header, item, block, NULL);
+    }
+    else
+    {
+        decompressionBlock =
+            new FramedDecompressionBlock(this, m_header, NULL,
+                                         m_blockBuffer, m_blockBuffer);
+        m_blockBuffer = NULL;
+    }
+
+    m_headerFilled = 0;
+    m_blockFilled = 0;
+
+    if (!m_sequencer.Submit(decompressionBlock))
+    {
+        /* an earlier block failed and has already reported it */
+        return DrError_IoReadWriteError;
+    }
+
+    return DrError_OK;
+}
+
+DrError FramedDecompressionChannelTransform::ProcessItem(DataBlockItem *item)
+{
+    if (m_failed || m_sequencer.HasFailed())
+    {
+        /* the termination item has been, or is about to be, sent */
+        return DrError_IoReadWriteError;
+    }
+
+    const byte *src = (const byte *) item->GetDataAddress();
+    UInt32 available = (UInt32) item->GetAvailableSize();
+    DrError err = DrError_OK;
+
+    while (available > 0)
+    {
+        if (m_headerFilled < sizeof(m_header))
+        {
+            /* the header may be split across items */
+            UInt32 toCopy = sizeof(m_header) - m_headerFilled;
+            if (toCopy > available)
+            {
+                toCopy = available;
+            }
+            memcpy((byte *) &m_header + m_headerFilled, src, toCopy);
+            m_headerFilled += toCopy;
+            src += toCopy;
+            available -= toCopy;
+
+            if (m_headerFilled < sizeof(m_header))
+            {
+                break;
+            }
+
+            err = ValidateHeader();
+            if (err != DrError_OK)
+            {
+                return err;
+            }
+            m_blockFilled = 0;
+
+            if (available == 0)
+            {
+                break;
+            }
+        }
+
+        UInt32 needed = m_header.m_compressedSize - m_blockFilled;
+
+        if (m_blockFilled == 0 && available >= needed)
+        {
+            /* the whole block is in this item so decode it in place */
+            err = SubmitBlock(item, src);
+            if (err != DrError_OK)
+            {
+                return err;
+            }
+            src += needed;
+            available -= needed;
+            continue;
+        }
+
+        if (m_blockBuffer == NULL)
+        {
+            m_blockBuffer = new byte[m_header.m_compressedSize];
+            LogAssert(m_blockBuffer != NULL);
+        }
+
+        UInt32 toCopy = (needed > available) ? available : needed;
+        memcpy(m_blockBuffer + m_blockFilled, src, toCopy);
+        m_blockFilled += toCopy;
+        src += toCopy;
+        available -= toCopy;
+
+        if (m_blockFilled == m_header.m_compressedSize)
+        {
+            err = SubmitBlock(NULL, NULL);
+            if (err != DrError_OK)
+            {
+                return err;
+            }
+        }
+    }
+
+    return DrError_OK;
+}
+
+DrError FramedDecompressionChannelTransform::Finish(bool atEndOfStream)
+{
+    DrError err = DrError_OK;
+    if (atEndOfStream && !m_failed && m_headerFilled > 0)
+    {
+        err = FailStream("Compressed stream ended in the middle of a block");
+    }
+
+    /* every block, and any termination item, has been written when
+       this returns */
+    m_sequencer.Drain();
+
+    return err;
+}
+
+void FramedDecompressionChannelTransform::SetOutputBufferSize(UInt32 bufferSize)
+{
+    /* each output item holds exactly one decoded block, whose size
+       was chosen by the writer, so there is nothing to change */
+}
+
+DrError FramedDecompressionChannelTransform::Start(FifoChannel *channel)
+{
+    m_channel = channel;
+    m_sequencer.Start(channel);
+    return DrError_OK;
+}
+#endif
@@ -81,17 +81,89 @@ DataBlockItem* InputChannel::ReadDataBlock(byte **ppDataBlock,
                                            Int32 *pErrorCode)
 {
     RChannelItemRef nextItem;
-    DataBlockItem *itemPtr = NULL;
     bool result = m_reader->FetchNextItem(&nextItem, 
                                                         DrTimeInterval_Infinite);
     LogAssert(result);
     LogAssert(nextItem != NULL, "FetchNextItem() returned a NULL item");
-    RChannelItemType itemType = nextItem->GetType();
+
+    DataBlockItem *itemPtr = AcceptItem(nextItem.Ptr(), ppDataBlock,
+                                        ppDataBlockSize, pErrorCode);
+    if (itemPtr != NULL)
+    {
+        /* the caller owns a reference until it calls ReleaseDataBlock */
+        itemPtr->IncRef();
+    }
+    return itemPtr;
+}
+
+/* Fetch every item the reader already has queued, up to maxBlocks,
+   in a single call. Data items are handed to the caller with the
+   array's reference rather than a fresh one. A termination or error
+   item ends the batch; on an error any blocks already collected are
+   released and 0 is returned, so a return of 0 with *pErrorCode == 0
+   means the channel is at its end. */
+UInt32 InputChannel::ReadDataBlocks(UInt32 maxBlocks,
+                                    DataBlockItem **pItems,
+                                    byte **ppDataBlocks,
+                                    Int32 *pDataBlockSizes,
+                                    Int32 *pErrorCode)
+{
+    LogAssert(maxBlocks > 0);
+
+    *pErrorCode = 0;
+    if (m_atEOC)
+    {
+        return 0;
+    }
+
+    RChannelItemArrayRef itemArray;
+    bool result = m_reader->FetchNextItemArray(maxBlocks, &itemArray,
+                                               DrTimeInterval_Infinite);
+    LogAssert(result);
+    LogAssert(itemArray->GetNumberOfItems() > 0,
+              "FetchNextItemArray() returned an empty array");
+
+    RChannelItemRef* items = itemArray->GetItemArray();
+    UInt32 numberOfBlocks = 0;
+    UInt32 i;
+    for (i=0; i<itemArray->GetNumberOfItems(); ++i)
+    {
+        DataBlockItem *itemPtr = AcceptItem(items[i].Ptr(),
+                                            &ppDataBlocks[numberOfBlocks],
+                                            &pDataBlockSizes[numberOfBlocks],
+                                            pErrorCode);
+        if (itemPtr == NULL)
+        {
+            break;
+        }
+        pItems[numberOfBlocks] = (DataBlockItem*) items[i].Detach();
+        ++numberOfBlocks;
+    }
+
+    if (*pErrorCode != 0)
+    {
+        for (i=0; i<numberOfBlocks; ++i)
+        {
+            pItems[i]->DecRef();
+            pItems[i] = NULL;
+        }
+        numberOfBlocks = 0;
+    }
+
+    return numberOfBlocks;
+}
+
+DataBlockItem* InputChannel::AcceptItem(RChannelItem* item,
+                                        byte **ppDataBlock,
+                                        Int32 *ppDataBlockSize,
+                                        Int32 *pErrorCode)
+{
+    DataBlockItem *itemPtr = NULL;
+    RChannelItemType itemType = item->GetType();
 
     switch (itemType) {
     case RChannelItem_Data:
-        itemPtr = (DataBlockItem*) nextItem.Ptr();
-        itemPtr->IncRef(); 
+        itemPtr = (DataBlockItem*) item;
         *ppDataBlock = (byte *) itemPtr->GetDataAddress();
         *ppDataBlockSize = (Int32) itemPtr->GetAvailableSize();
 #ifdef VERBOSE
@@ -75,10 +75,67 @@ BOOL OutputChannel::WriteDataBlock(DataBlockItem *pItem,
     }
     
     m_bytesWritten += numBytesToWrite;
-    BOOL returnValue = true;
     RChannelItemRef marshalFailureItem;
     RChannelItemType result = m_writer->WriteItemSync(pItem, 
         false, &marshalFailureItem);
+    BOOL returnValue = CheckWriteResult(result,
+                                        marshalFailureItem.Ptr() != NULL);
+
+#ifdef VERBOSE
+    fprintf(stdout, "MEM WriteDataBlock block has addr %p.\n", pItem);
+    fflush(stdout);
+#endif    
+
+    return returnValue;
+}
+
+/* Submit a run of blocks to the writer as one item array so the
+   channel lock and the managed/native transition are paid once per
+   batch. As with WriteDataBlock the caller keeps its own reference
+   to each block; the array takes another for the duration of the
+   write. */
+BOOL OutputChannel::WriteDataBlocks(UInt32 numBlocks,
+                                    DataBlockItem **pItems,
+                                    Int32 *pNumBytesToWrite)
+{
+    if (numBlocks == 0)
+    {
+        return true;
+    }
+
+    RChannelItemArrayRef itemArray;
+    itemArray.Attach(new RChannelItemArray());
+    itemArray->SetNumberOfItems(numBlocks);
+    RChannelItemRef* items = itemArray->GetItemArray();
+
+    UInt32 i;
+    for (i=0; i<numBlocks; ++i)
+    {
+        if (pNumBytesToWrite[i] != (Int32) pItems[i]->GetAvailableSize())
+        {
+            pItems[i]->SetAvailableSize(pNumBytesToWrite[i]);
+        }
+        m_bytesWritten += pNumBytesToWrite[i];
+        items[i] = pItems[i];
+    }
+
+    RChannelItemArrayRef failureArray;
+    RChannelItemType result = m_writer->WriteItemArraySync(itemArray,
+        false, &failureArray);
+
+#ifdef VERBOSE
+    fprintf(stdout, "MEM WriteDataBlocks wrote %u blocks starting at addr %p.\n",
+            numBlocks, pItems[0]);
+    fflush(stdout);
+#endif    
+
+    return CheckWriteResult(result, failureArray != NULL);
+}
+
+BOOL OutputChannel::CheckWriteResult(RChannelItemType result,
+                                     bool marshalFailed)
+{
+    BOOL returnValue = true;
     switch (result) {
     case RChannelItem_Data:
         // successful write
@@ -116,7 +173,7 @@ BOOL OutputChannel::WriteDataBlock(DataBlockItem *pItem,
     }        
 
     // and make sure there was not a marshalling error
-    if (marshalFailureItem.Ptr() != NULL) 
+    if (marshalFailed) 
     {
         DrLogE("Received MarshalError Item from channel.");
         if (m_vertex != NULL) {
@@ -125,11 +182,6 @@ BOOL OutputChannel::WriteDataBlock(DataBlockItem *pItem,
         returnValue = false;
     }
 
-#ifdef VERBOSE
-    fprintf(stdout, "MEM WriteDataBlock block has addr %p.\n", pItem);
-    fflush(stdout);
-#endif    
-
     return returnValue;
 }
 
@@ -27,6 +27,41 @@ limitations under the License.
 
 #pragma unmanaged 
 
+/* levels used by the fast and high-compression framed schemes when
+   the caller doesn't put one in the second byte of compressionScheme */
+static const int s_lz4HighCompressionLevel = 9;
+static const int s_zstdFastCompressionLevel = 1;
+
+/* a framed scheme whose codec wasn't compiled into this build falls
+   back to gzip rather than reaching the assert in FifoChannel. Both
+   ends of a channel run the same build, so the reader makes the same
+   choice as the writer */
+static Int32 FallBackFromMissingCodec(Int32 compressionScheme)
+{
+    bool missing = false;
+#ifndef LINKWITHLZ4
+    if (compressionScheme == 7 || compressionScheme == 8)
+    {
+        missing = true;
+    }
+#endif
+#ifndef LINKWITHZSTD
+    if (compressionScheme == 9 || compressionScheme == 10)
+    {
+        missing = true;
+    }
+#endif
+
+    if (missing)
+    {
+        DrLogW("Compression scheme %d is not built into this vertex host, using gzip",
+               compressionScheme);
+        return 1;
+    }
+
+    return compressionScheme;
+}
+
 WrapperNativeInfoBase::~WrapperNativeInfoBase()
 {
 }
@@ -246,13 +281,50 @@ BOOL WrapperNativeInfo::WriteDataBlock(UInt32 portNum,
     return retVal;
 }
 
+UInt32 WrapperNativeInfo::ReadDataBlocks(UInt32 portNum,
+                                         UInt32 maxBlocks,
+                                         DataBlockItem **pItems,
+                                         byte **ppDataBlocks,
+                                         Int32 *pDataBlockSizes,
+                                         Int32 *pErrorCode)
+{
+    LogAssert(portNum < m_numberOfInputChannels);
+
+    DrLogD("ReadDataBlocks() entering: portNum = %d, maxBlocks = %u", portNum, maxBlocks);
+
+    UInt32 numBlocks = m_inputChannels[portNum]->ReadDataBlocks(maxBlocks, pItems, ppDataBlocks, pDataBlockSizes, pErrorCode);
+
+    DrLogD("ReadDataBlocks() returning: portNum = %d, numBlocks = %u, errorCode = %d", portNum, numBlocks, *pErrorCode);
+
+    return numBlocks;
+}
+
+BOOL WrapperNativeInfo::WriteDataBlocks(UInt32 portNum,
+                                        UInt32 numBlocks,
+                                        DataBlockItem **pItems,
+                                        Int32 *pNumBytesToWrite)
+{
+    DrLogD("WriteDataBlocks() entering: portNum = %d, numBlocks = %u", portNum, numBlocks);
+
+    LogAssert(portNum < m_numberOfOutputChannels);
+
+    BOOL retVal = m_outputChannels[portNum]->WriteDataBlocks(numBlocks, pItems, pNumBytesToWrite);
+
+    DrLogD("WriteDataBlocks() returning: portNum = %d, success = %d ", portNum, retVal);
+
+    return retVal;
+}
+
 
 void WrapperNativeInfo::EnableFifoInputChannel(Int32 compressionScheme, 
     UInt32 channel)
 {
     DrLogI( "Enabling fifo for input channel. Channel %u scheme %d", channel, compressionScheme);
     LogAssert(channel < m_numberOfInputChannels);
-    LogAssert((compressionScheme >= 0) && ( compressionScheme <= 6));
+    /* the level in the second byte only matters when compressing */
+    compressionScheme &= 0xff;
+    LogAssert((compressionScheme >= 0) && ( compressionScheme <= 10));
+    compressionScheme = FallBackFromMissingCodec(compressionScheme);
     TransformType tType = TT_NullTransform;
     if (compressionScheme == 1)
     {
@@ -270,6 +342,11 @@ void WrapperNativeInfo::EnableFifoInputChannel(Int32 compressionScheme,
     {
         tType = TT_DeflateDecompression;
     }
+    else if (compressionScheme >= 7 && compressionScheme <= 10)
+    {
+        /* the codec is read from each frame header */
+        tType = TT_FramedDecompression;
+    }
 
     /* Xpress removed, but left in comments as an example of 
      * supporting an alternate compression scheme.
@@ -294,7 +371,14 @@ void WrapperNativeInfo::EnableFifoOutputChannel(Int32 compressionScheme,
 {
     DrLogI( "Enabling fifo for output channel. Channel %u scheme %d", channel, compressionScheme);
     LogAssert(channel < m_numberOfOutputChannels);
-    LogAssert((compressionScheme >= 0) && ( compressionScheme <= 6));
+    int compressionLevel = (compressionScheme >> 8) & 0xff;
+    compressionScheme &= 0xff;
+    LogAssert((compressionScheme >= 0) && ( compressionScheme <= 10));
+    if (FallBackFromMissingCodec(compressionScheme) != compressionScheme)
+    {
+        compressionScheme = 1;
+        compressionLevel = 0;
+    }
     TransformType tType = TT_NullTransform;
     if (compressionScheme == 1) 
     {
@@ -312,6 +396,30 @@ void WrapperNativeInfo::EnableFifoOutputChannel(Int32 compressionScheme,
     {
         tType = TT_DeflateFastCompression;
     }
+    else if (compressionScheme == 7)
+    {
+        tType = TT_Lz4Compression;
+    }
+    else if (compressionScheme == 8)
+    {
+        tType = TT_Lz4HighCompression;
+        if (compressionLevel == 0)
+        {
+            compressionLevel = s_lz4HighCompressionLevel;
+        }
+    }
+    else if (compressionScheme == 9)
+    {
+        tType = TT_ZstdFastCompression;
+        if (compressionLevel == 0)
+        {
+            compressionLevel = s_zstdFastCompressionLevel;
+        }
+    }
+    else if (compressionScheme == 10)
+    {
+        tType = TT_ZstdCompression;
+    }
 
     /* Xpress removed, but left in comments as an example of 
      * supporting an alternate compression scheme.
@@ -327,6 +435,7 @@ void WrapperNativeInfo::EnableFifoOutputChannel(Int32 compressionScheme,
 
     OutputChannel *origChannel = m_outputChannels[channel];
     m_outputChannels[channel] = new FifoOutputChannel(channel, 
-        m_vertex, m_workQueue, origChannel->GetWriter(), tType);
+        m_vertex, m_workQueue, origChannel->GetWriter(), tType,
+        compressionLevel);
     delete origChannel;
 } 
@@ -103,6 +103,33 @@ BOOL WriteDataBlock(WrapperNativeInfoBase *info,
     return info->WriteDataBlock(portNum, pItem, numBytesToWrite);
 }
 
+UInt32 ReadDataBlocks(WrapperNativeInfoBase *info,
+                      UInt32 portNum,
+                      UInt32 maxBlocks,
+                      DataBlockItem **pItems,
+                      byte **ppDataBlocks,
+                      Int32 *pDataBlockSizes,
+                      Int32 *pErrorCode)
+{
+    return info->ReadDataBlocks(portNum, maxBlocks, pItems, ppDataBlocks,
+                                pDataBlockSizes, pErrorCode);
+}
+
+BOOL WriteDataBlocks(WrapperNativeInfoBase *info,
+                     UInt32 portNum,
+                     UInt32 numBlocks,
+                     DataBlockItem **pItems,
+                     Int32 *pNumBytesToWrite)
+{
+#ifdef VERBOSE
+    fprintf(stdout, "Writing %u blocks to channel %u.\n", 
+            numBlocks, portNum);
+    fflush(stdout);
+#endif
+
+    return info->WriteDataBlocks(portNum, numBlocks, pItems, pNumBytesToWrite);
+}
+
 void Flush(WrapperNativeInfoBase *info, UInt32 portNum)
 {
   // NYI
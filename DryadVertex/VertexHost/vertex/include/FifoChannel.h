@@ -44,7 +44,9 @@ public:
     FifoChannel(RChannelReader* reader, 
                 RChannelWriter *writer, 
                 DryadVertexProgram* vertex,
-                TransformType transType);
+                WorkQueue* workQueue,
+                TransformType transType,
+                int compressionLevel);
     virtual ~FifoChannel();
     virtual void ProcessItem(RChannelItem* deliveredItem);
     virtual void ProcessWriteCompleted(RChannelItemType status,
@@ -33,11 +33,17 @@ public:
     virtual DataBlockItem* ReadDataBlock(byte **ppDataBlock,
         Int32 *ppDataBlockSize,
         Int32 *pErrorCode);
+    virtual UInt32 ReadDataBlocks(UInt32 maxBlocks,
+        DataBlockItem **pItems,
+        byte **ppDataBlocks,
+        Int32 *pDataBlockSizes,
+        Int32 *pErrorCode);
     bool GetTotalLength(UInt64 *length);
     bool GetExpectedLength(UInt64 *length);    
     const char* GetURI();
 private:
     void MakeFifo(UInt32 fifoLength, WorkQueue* workQueue);
+    void EnsureStarted();
 
     bool m_initialHandlerSent;
     FifoChannel *m_fifoChannel;
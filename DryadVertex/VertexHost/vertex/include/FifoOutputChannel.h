@@ -27,7 +27,7 @@ class FifoOutputChannel: public OutputChannel
 public:
     FifoOutputChannel(UInt32 portNum, DryadVertexProgram* vertex, 
         WorkQueue *workQueue, RChannelWriter* outputChannel, 
-        TransformType tType);
+        TransformType tType, int compressionLevel);
     void Stop();
     
     void SetInitialSizeHint(UInt64 hint);
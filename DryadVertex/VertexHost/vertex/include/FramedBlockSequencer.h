@@ -0,0 +1,108 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+#include <dryadvertex.h>
+#include <DataBlockItem.h>
+#include <dryadlisthelper.h>
+
+class FifoChannel;
+
+/* One independently transformed block of a framed channel. Run()
+   fills in the output item; it may be called on any thread. A block
+   is run exactly once, by whichever thread claims it first. */
+class FramedBlock : public DrRefCounter
+{
+public:
+    FramedBlock();
+    virtual ~FramedBlock();
+
+    virtual bool Run() = 0;
+    /* called, in stream order, instead of writing the output when
+       Run() returned false */
+    virtual void ReportFailure() = 0;
+
+    bool Claim();
+
+protected:
+    DrRef<DataBlockItem>   m_output;
+
+private:
+    LONG volatile          m_claimed;
+    bool                   m_queued;
+    bool                   m_done;
+    bool                   m_succeeded;
+    DrBListEntry           m_listPtr;
+    friend class DryadBList<FramedBlock>;
+    friend class FramedBlockSequencer;
+};
+
+/* Runs FramedBlocks on the vertex WorkQueue and writes their outputs
+   to the channel in the order they were submitted. At most
+   maxBlocksInFlight are outstanding; beyond that Submit runs the
+   block on the calling thread, which holds up the channel reader
+   until the queue catches up. */
+class FramedBlockSequencer
+{
+public:
+    FramedBlockSequencer(WorkQueue* workQueue, UInt32 maxBlocksInFlight);
+    ~FramedBlockSequencer();
+
+    void Start(FifoChannel* channel);
+
+    /* returns false if an earlier block has failed, in which case the
+       block is discarded */
+    bool Submit(FramedBlock* block);
+
+    /* the two halves of Submit. Queue fixes the block's place in the
+       stream but never runs it on the calling thread, so it can be
+       called with the caller's own lock held; CatchUp then runs any
+       blocks that couldn't be handed to the WorkQueue and should be
+       called once that lock has been released */
+    bool Queue(FramedBlock* block);
+    void CatchUp();
+
+    /* true once a block has failed and reported it; may be called on
+       any thread */
+    bool HasFailed();
+
+    /* runs any blocks that haven't been picked up by the queue yet
+       and waits for the rest, so every output has been written when
+       it returns. Never waits on queued work, so it is safe to call
+       from a WorkQueue thread */
+    void Drain();
+
+private:
+    typedef DryadBList<FramedBlock> FramedBlockList;
+
+    class BlockRequest;
+
+    void Execute(FramedBlock* block);
+    FramedBlock* ClaimUnstartedBlock(bool onlyUnqueued);
+
+    WorkQueue*         m_workQueue;
+    UInt32             m_maxBlocksInFlight;
+    FifoChannel*       m_channel;
+    FramedBlockList    m_blocks;
+    UInt32             m_blocksInFlight;
+    bool               m_failed;
+    HANDLE             m_drainedEvent;
+    CRITSEC            m_critsec;
+};
@@ -0,0 +1,92 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+#include <dryadvertex.h>
+#include <channeltransform.h>
+#include <fifochannel.h>
+#include <FramedBlockSequencer.h>
+
+/* Every block written by a FramedCompressionChannelTransform starts
+   with this header, so the reader can tell which codec produced it
+   without being told. All fields are little-endian. */
+struct FramedCompressionHeader
+{
+    UInt32 m_magic;
+    byte   m_version;
+    byte   m_codec;
+    UInt16 m_flags;
+    UInt32 m_uncompressedSize;
+    UInt32 m_compressedSize;
+};
+
+static const UInt32 s_framedCompressionMagic = 0x46595244; /* "DRYF" */
+static const byte s_framedCompressionVersion = 1;
+static const UInt32 s_framedCompressionMaxBlockSize = 64 * 1024 * 1024;
+
+/* the most blocks of one channel compressed or decompressed at once */
+static const UInt32 s_framedCompressionMaxBlocksInFlight = 8;
+
+enum FramedCompressionCodec {
+    FCC_Stored = 0,
+    FCC_Lz4 = 1,
+    FCC_Zstd = 2
+};
+
+#if defined(LINKWITHLZ4) || defined(LINKWITHZSTD)
+#ifdef LINKWITHLZ4
+#include "lz4.h"
+#include "lz4hc.h"
+#endif
+#ifdef LINKWITHZSTD
+#include "zstd.h"
+#endif
+
+/* Compresses the channel in independent blocks, each preceded by a
+   FramedCompressionHeader. Blocks are compressed concurrently on the
+   vertex WorkQueue and written in order. A level of 0 uses the codec's
+   default; for LZ4 any other level selects the high-compression
+   encoder. A block that doesn't shrink is stored uncompressed. */
+class FramedCompressionChannelTransform : public ChannelTransform
+{
+public: 
+    FramedCompressionChannelTransform(DryadVertexProgram* vertex,
+                                      WorkQueue* workQueue,
+                                      FramedCompressionCodec codec,
+                                      int level);
+    virtual ~FramedCompressionChannelTransform();
+    virtual DrError Start(FifoChannel *channel);
+    virtual void SetOutputBufferSize(UInt32 bufferSize);
+    virtual DrError ProcessItem(DataBlockItem *item);
+    virtual DrError Finish(bool atEndOfStream);
+
+ private:
+    void AllocateInputBuffer();
+    void SubmitBlock();
+
+    FramedCompressionCodec m_codec;
+    int m_level;
+    UInt32 m_blockSize;
+    byte *m_inputBuffer;
+    UInt32 m_inputFilled;
+    FramedBlockSequencer m_sequencer;
+    CRITSEC m_critsec;
+};
+#endif
@@ -0,0 +1,62 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+#include <dryadvertex.h>
+#include <channeltransform.h>
+#include <fifochannel.h>
+#include <FramedCompressionChannelTransform.h>
+
+#if defined(LINKWITHLZ4) || defined(LINKWITHZSTD)
+
+/* Undoes a FramedCompressionChannelTransform. The codec is read from
+   each block's header, so one instance handles LZ4, Zstandard and
+   stored blocks in any mix. Headers and blocks may be split across
+   input items. Blocks are decoded concurrently on the vertex WorkQueue
+   and written in order. */
+class FramedDecompressionChannelTransform : public ChannelTransform
+{
+public: 
+    FramedDecompressionChannelTransform(DryadVertexProgram * vertex,
+                                        WorkQueue* workQueue);
+    virtual ~FramedDecompressionChannelTransform();
+    virtual DrError Start(FifoChannel *channel);
+    virtual void SetOutputBufferSize(UInt32 bufferSize);
+    virtual DrError ProcessItem(DataBlockItem *item);
+    virtual DrError Finish(bool atEndOfStream);
+
+    void DecompressionError(const char *reason);
+
+ private:
+    DrError ValidateHeader();
+    DrError SubmitBlock(DataBlockItem* item, const byte* block);
+    DrError FailStream(const char *reason);
+
+    FifoChannel *m_channel;
+    FramedCompressionHeader m_header;
+    UInt32 m_headerFilled;
+    byte *m_blockBuffer;
+    UInt32 m_blockFilled;
+    /* only touched on the thread calling ProcessItem and Finish; a
+       block that fails to decode is recorded by m_sequencer instead */
+    bool m_failed;
+    FramedBlockSequencer m_sequencer;
+};
+#endif
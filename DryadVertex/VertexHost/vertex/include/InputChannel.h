@@ -36,6 +36,11 @@ public:
     virtual DataBlockItem* ReadDataBlock(byte **ppDataBlock,
                                          Int32 *ppDataBlockSize,
                                          Int32 *pErrorCode);
+    virtual UInt32 ReadDataBlocks(UInt32 maxBlocks,
+                                  DataBlockItem **pItems,
+                                  byte **ppDataBlocks,
+                                  Int32 *pDataBlockSizes,
+                                  Int32 *pErrorCode);
     virtual bool AtEndOfChannel();
     Int64 GetBytesRead();
     RChannelReader* GetReader();
@@ -44,6 +49,11 @@ public:
     virtual const char* GetURI();
 
 protected:
+    DataBlockItem* AcceptItem(RChannelItem* item,
+                              byte **ppDataBlock,
+                              Int32 *ppDataBlockSize,
+                              Int32 *pErrorCode);
+
     RChannelReader* m_reader;
     DryadVertexProgram* m_vertex;
     Int64 m_bytesRead;
@@ -35,6 +35,9 @@ public:
 
     BOOL WriteDataBlock(DataBlockItem *pItem,
                         Int32 numBytesToWrite);
+    BOOL WriteDataBlocks(UInt32 numBlocks,
+                         DataBlockItem **pItems,
+                         Int32 *pNumBytesToWrite);
     void ProcessWriteCompleted(RChannelItemType status,
                                RChannelItem* marshalFailureItem);
     Int64 GetBytesWritten();
@@ -43,6 +46,8 @@ public:
     virtual const char* GetURI();
 
 protected:
+    BOOL CheckWriteResult(RChannelItemType result, bool marshalFailed);
+
     RChannelWriter* m_writer;
     DryadVertexProgram* m_vertex;
     Int64 m_bytesWritten;
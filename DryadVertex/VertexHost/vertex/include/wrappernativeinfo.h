@@ -44,6 +44,16 @@ public:
     virtual BOOL WriteDataBlock(UInt32 portNum, 
                                 DataBlockItem *pData,
                                 Int32 numBytesToWrite) = 0;
+    virtual UInt32 ReadDataBlocks(UInt32 portNum,
+                                  UInt32 maxBlocks,
+                                  DataBlockItem **pItems,
+                                  byte **ppDataBlocks,
+                                  Int32 *pDataBlockSizes,
+                                  Int32 *pErrorCode) = 0;
+    virtual BOOL WriteDataBlocks(UInt32 portNum,
+                                 UInt32 numBlocks,
+                                 DataBlockItem **pItems,
+                                 Int32 *pNumBytesToWrite) = 0;
     virtual Int64 GetTotalLength(UInt32 portNum) = 0;
     virtual Int64 GetExpectedLength(UInt32 portNum) = 0;    
     virtual Int64 GetVertexId() = 0;
@@ -82,6 +92,16 @@ public:
     BOOL WriteDataBlock(UInt32 portNum, 
                         DataBlockItem *pData,
                         Int32 numBytesToWrite);
+    UInt32 ReadDataBlocks(UInt32 portNum,
+                          UInt32 maxBlocks,
+                          DataBlockItem **pItems,
+                          byte **ppDataBlocks,
+                          Int32 *pDataBlockSizes,
+                          Int32 *pErrorCode);
+    BOOL WriteDataBlocks(UInt32 portNum,
+                         UInt32 numBlocks,
+                         DataBlockItem **pItems,
+                         Int32 *pNumBytesToWrite);
     Int64 GetTotalLength(UInt32 portNum);
     Int64 GetExpectedLength(UInt32 portNum);
     Int64 GetVertexId();
@@ -119,6 +139,13 @@ extern "C" {
     // The values are:
     // 0 - No transform, just passthrough
     // 1 - gzip compression or decompression
+    // 7 - LZ4 framed compression
+    // 8 - LZ4 high-compression framed compression
+    // 9 - Zstandard framed compression, fast level
+    // 10 - Zstandard framed compression, default level
+    // For 7-10 the second byte, if non-zero, overrides the codec
+    // level. Readers decode any of 7-10 from the frame headers.
+    // A host built without the LZ4 or Zstandard codec uses gzip instead.
     void EnableFifoInputChannel(WrapperNativeInfoBase *info, 
         Int32 compresionScheme, UInt32 channel); 
     void EnableFifoOutputChannel(WrapperNativeInfoBase *info, 
@@ -138,6 +165,28 @@ extern "C" {
                         DataBlockItem *pItem,
                         Int32 numBytesToWrite); 
 
+    // Batched forms of ReadDataBlock and WriteDataBlock. ReadDataBlocks
+    // fills in up to maxBlocks entries of the three arrays with blocks
+    // that are already available and returns how many it filled; it
+    // blocks only when none are. A return of 0 with *pErrorCode == 0
+    // means the channel has reached its end. Each returned block must
+    // be released individually. WriteDataBlocks writes numBlocks blocks
+    // in order as a single channel write; the same read-only rule as
+    // WriteDataBlock applies to every block in the batch.
+    UInt32 ReadDataBlocks(WrapperNativeInfoBase *info,
+                          UInt32 portNum,
+                          UInt32 maxBlocks,
+                          DataBlockItem **pItems,
+                          byte **ppDataBlocks,
+                          Int32 *pDataBlockSizes,
+                          Int32 *pErrorCode);
+
+    BOOL WriteDataBlocks(WrapperNativeInfoBase *info,
+                         UInt32 portNum,
+                         UInt32 numBlocks,
+                         DataBlockItem **pItems,
+                         Int32 *pNumBytesToWrite);
+
     DataBlockItem* AllocateDataBlock(WrapperNativeInfoBase *info, 
                                      Int32 dataBlockSize,
                                      byte **pDataBlock); 
@@ -209,6 +209,19 @@ void SetLoggingLevel()
     }
 }
 
+//
+// if $DRYAD_TRACE_FILE is defined, record binary trace events for the channel hot paths there
+//
+void EnableTracing()
+{
+    WCHAR traceFileName[MAX_PATH];
+    HRESULT hr = DrGetEnvironmentVariable(L"DRYAD_TRACE_FILE", traceFileName);
+    if(hr == DrError_OK)
+    {
+        DrTrace::Initialize(traceFileName);
+    }
+}
+
 //
 // if $HPCQUERY_DEBUGVERTEXHOST is defined, break into the debugger
 //
@@ -271,6 +284,7 @@ public:
             // Enable logging based on environment variable
             //
             SetLoggingLevel();
+            EnableTracing();
 
             DrInitErrorTable();
             DrInitExitCodeTable();
@@ -353,6 +367,8 @@ public:
                 DrLogE("Couldn't uninitialise cluster");
             }
 
+            DrTrace::Shutdown();
+
             return exitCode;
         }
         catch (System::Exception^ e)
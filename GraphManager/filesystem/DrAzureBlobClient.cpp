@@ -82,6 +82,12 @@ DrString DrAzureInputStream::GetURIForRead(int partitionIndex, DrResourcePtr run
     }
 }
 
+UINT64 DrAzureInputStream::GetVersionStamp(int /* unused partitionIndex */)
+{
+    /* parts don't carry an ETag or last-modified time */
+    return 0;
+}
+
 
 DrAzureOutputStream::DrAzureOutputStream()
 {
@@ -32,6 +32,7 @@ public:
     virtual int GetNumberOfParts() DROVERRIDE;
     virtual DrAffinityRef GetAffinity(int partitionIndex) DROVERRIDE;
     virtual DrString GetURIForRead(int partitionIndex, DrResourcePtr runningResource) DROVERRIDE;
+    virtual UINT64 GetVersionStamp(int partitionIndex) DROVERRIDE;
 
 private:
     AzureCollectionPartition^    m_partition;
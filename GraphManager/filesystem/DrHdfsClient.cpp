@@ -414,6 +414,12 @@ DrString DrHdfsInputStream::GetURIForRead(int partitionIndex,
         return uri;
 }
 
+UINT64 DrHdfsInputStream::GetVersionStamp(int /* unused partitionIndex */)
+{
+    /* the bridge doesn't expose modification times */
+    return 0;
+}
+
 
 DrHdfsOutputStream::DrHdfsOutputStream()
 {
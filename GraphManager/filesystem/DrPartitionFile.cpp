@@ -407,6 +407,32 @@ DrString DrPartitionInputStream::GetURIForRead(int partitionIndex, DrResourcePtr
     return uri;
 }
 
+UINT64 DrPartitionInputStream::GetVersionStamp(int partitionIndex)
+{
+    /* the last write time of the first replica, read through the same URI
+       a vertex on that computer would use */
+    DrResourceListRef location = m_affinity[partitionIndex]->GetLocalityArray();
+    DrResourcePtr replica = (location->Size() > 0) ? location[0] : DrNull;
+
+    try
+    {
+        Uri^ uri = DrNew Uri(GetURIForRead(partitionIndex, replica).GetString());
+        System::IO::FileInfo^ info = DrNew System::IO::FileInfo(uri->LocalPath);
+        if (info->Exists == false)
+        {
+            return 0;
+        }
+        return (UINT64) info->LastWriteTimeUtc.ToFileTimeUtc();
+    }
+    catch (System::Exception^ e)
+    {
+        DrString reason(e->Message);
+        DrLogI("Can't get version of partition %d of %s: %s",
+               partitionIndex, m_streamName.GetChars(), reason.GetChars());
+        return 0;
+    }
+}
+
 HRESULT DrPartitionOutputStream::Open(DrNativeString streamName, DrNativeString pathBase)
 {
     return OpenInternal(DrString(streamName), DrString(pathBase));
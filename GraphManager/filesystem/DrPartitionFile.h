@@ -30,6 +30,7 @@ public:
     virtual int GetNumberOfParts() DROVERRIDE;
     virtual DrAffinityRef GetAffinity(int partitionIndex) DROVERRIDE;
     virtual DrString GetURIForRead(int partitionIndex, DrResourcePtr runningResource) DROVERRIDE;
+    virtual UINT64 GetVersionStamp(int partitionIndex) DROVERRIDE;
 
     typedef DrStringStringDictionary Override;
     DRREF(Override);
@@ -105,4 +105,6 @@ const UINT16 DrTag_VertexArray = 10010;
 const UINT16 DrTag_VertexInfo = 10011;
 const UINT16 DrTag_EdgeArray = 10012;
 const UINT16 DrTag_EdgeInfo = 10013;
-const UINT16 DrTag_GraphDescription = 10014;
\ No newline at end of file
+const UINT16 DrTag_GraphDescription = 10014;
+const UINT16 DrTag_VertexCommandBatch = 10028;
+const UINT16 DrTag_VertexStatusBatch = 10029;
\ No newline at end of file
@@ -27,6 +27,7 @@ public:
     virtual int GetNumberOfParts() DRABSTRACT;
     virtual DrAffinityRef GetAffinity(int partitionIndex) DRABSTRACT;
     virtual DrString GetURIForRead(int partitionIndex, DrResourcePtr runningResource) DRABSTRACT;
+    virtual UINT64 GetVersionStamp(int partitionIndex) DRABSTRACT;
 };
 DRREF(DrInputStream);
 
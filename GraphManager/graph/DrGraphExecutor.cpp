@@ -35,9 +35,26 @@ DrGraphPtr DrGraphExecutor::Initialize(DrGraphParametersPtr parameters)
     DrMessagePumpRef pump = DrNew DrMessagePump(8, 4);
     pump->Start();
 
+    return InitializeWithCluster(parameters, pump, DrCluster::Create());
+}
+
+DrGraphPtr DrGraphExecutor::InitializeSimulated(DrGraphParametersPtr parameters,
+                                                DrSimulationParametersPtr simulation,
+                                                DrSimulationStatisticsPtr statistics)
+{
+    DrMessagePumpRef pump = DrNew DrMessagePump(8, 4);
+    pump->Start();
+
+    DrSimulatedClusterRef simulator = DrNew DrSimulatedCluster(simulation, statistics, pump);
+
+    return InitializeWithCluster(parameters, pump, DrCluster::Create(simulator));
+}
+
+DrGraphPtr DrGraphExecutor::InitializeWithCluster(DrGraphParametersPtr parameters, DrMessagePumpPtr pump,
+                                                  DrClusterPtr cluster)
+{
     DrUniverseRef universe = DrNew DrUniverse();
 
-    DrClusterRef cluster = DrCluster::Create();
     if (SUCCEEDED( cluster->Initialize(universe, pump, parameters->m_propertyUpdateInterval) ))
     {
         m_graph = DrNew DrGraph(cluster, parameters);
@@ -27,6 +27,11 @@ public:
     ~DrGraphExecutor();
 
     DrGraphPtr Initialize(DrGraphParametersPtr parameters);
+    /* runs the graph against an in-process simulated cluster instead of the
+       real one, filling in statistics as it goes */
+    DrGraphPtr InitializeSimulated(DrGraphParametersPtr parameters,
+                                   DrSimulationParametersPtr simulation,
+                                   DrSimulationStatisticsPtr statistics);
 
     void Run();
     DrErrorPtr Join();
@@ -34,6 +39,9 @@ public:
     virtual void ReceiveMessage(DrErrorRef exitStatus);
 
 private:
+    DrGraphPtr InitializeWithCluster(DrGraphParametersPtr parameters, DrMessagePumpPtr pump,
+                                     DrClusterPtr cluster);
+
     DrGraphRef  m_graph;
     HANDLE      m_event;
     DrErrorRef  m_exitStatus;
@@ -24,4 +24,5 @@ limitations under the License.
 
 #include <DrFileSystem.h>
 #include <DrDefaultParameters.h>
+#include <DrSimulatedCluster.h>
 #include <DrGraphExecutor.h>
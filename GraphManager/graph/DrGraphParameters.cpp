@@ -57,6 +57,10 @@ DrGraphParametersRef DrDefaultParameters::Make(DrNativeString exeName, DrNativeS
         p->m_defaultOutlierThreshold = 10 * DrTimeInterval_Minute;
         /* Wait until this fraction of vertices have completed before computing outlier time estimate */
         p->m_nonParametricThresholdFraction = 0.50;
+        /* Duplicate early any vertex projected from its read progress to take twice the stage median,
+           using at most a tenth of the cluster for such duplicates at once */
+        p->m_progressOutlierFactor = 2.0;
+        p->m_speculativeDuplicateFraction = 0.10;
     }
     else
     {
@@ -64,10 +68,24 @@ DrGraphParametersRef DrDefaultParameters::Make(DrNativeString exeName, DrNativeS
         // and require all vertices complete before calculating non-parametric threshold
         p->m_defaultOutlierThreshold = DrTimeInterval_Infinite;
         p->m_nonParametricThresholdFraction = 1.0;
+        p->m_progressOutlierFactor = 0.0;
+        p->m_speculativeDuplicateFraction = 0.0;
     }
 
     p->m_minOutlierThreshold = 10 * DrTimeInterval_Second;
 
+    /* finished vertex hosts are not kept for the next cohort unless the
+       job asks for it, since an idle host holds its computer's resources */
+    p->m_maxIdleVertexHostsPerComputer = 0;
+    p->m_vertexHostIdleTimeOut = DrTimeInterval_Minute;
+
+    p->m_gangPlacementTimeOut = DrTimeInterval_Minute * 2;
+
+    p->m_aggregateVertexOverhead = DrTimeInterval_Second * 5;
+    p->m_aggregateCrossPodBytesPerSecond = 50 * 1024 * 1024;
+
+    p->m_broadcastFanOut = 0;
+
     p->m_defaultProcessTemplate = MakeProcessTemplate(exeName, jobClass);
     p->m_defaultVertexTemplate = MakeVertexTemplate();
 
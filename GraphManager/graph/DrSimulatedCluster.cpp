@@ -0,0 +1,1096 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+#include <DrGraphHeaders.h>
+
+using namespace System::Collections::Generic;
+
+DrSimulationParameters::DrSimulationParameters()
+{
+    m_numberOfComputers = 100;
+    m_computersPerRack = 20;
+    m_processStartLatency = DrTimeInterval_Millisecond * 500;
+    m_vertexRunTime = DrTimeInterval_Second;
+    m_vertexRunTimeJitter = 0.5;
+    m_vertexFailureRate = 0.0;
+    m_bytesPerOutputChannel = 64 * 1024 * 1024;
+    m_randomSeed = 0;
+    m_sampleInterval = DrTimeInterval_Millisecond * 100;
+}
+
+
+DrSimulationStatistics::DrSimulationStatistics()
+{
+    m_startLatency = gcnew List<DrTimeInterval>();
+    m_scheduleLatency = gcnew List<DrTimeInterval>();
+
+    m_numberOfQueueSamples = 0;
+    m_totalQueueDepth = 0;
+    m_maxQueueDepth = 0;
+    m_maxDelayedMessages = 0;
+
+    m_processesScheduled = 0;
+    m_processesExited = 0;
+    m_verticesStarted = 0;
+    m_verticesCompleted = 0;
+    m_verticesFailed = 0;
+
+    m_startTime = DrDateTime_LongAgo;
+    m_stopTime = DrDateTime_LongAgo;
+    m_startProcessorTime = DrTimeInterval_Zero;
+    m_stopProcessorTime = DrTimeInterval_Zero;
+}
+
+static DrTimeInterval GetProcessorTimeNow()
+{
+    return System::Diagnostics::Process::GetCurrentProcess()->TotalProcessorTime.Ticks;
+}
+
+void DrSimulationStatistics::StartClock()
+{
+    DrAutoCriticalSection acs(this);
+
+    m_startTime = DrSimulatedCluster::GetCurrentTimeStamp();
+    m_startProcessorTime = GetProcessorTimeNow();
+}
+
+void DrSimulationStatistics::StopClock()
+{
+    DrAutoCriticalSection acs(this);
+
+    m_stopTime = DrSimulatedCluster::GetCurrentTimeStamp();
+    m_stopProcessorTime = GetProcessorTimeNow();
+}
+
+void DrSimulationStatistics::RecordProcessScheduled()
+{
+    DrAutoCriticalSection acs(this);
+
+    ++m_processesScheduled;
+}
+
+void DrSimulationStatistics::RecordProcessExited()
+{
+    DrAutoCriticalSection acs(this);
+
+    ++m_processesExited;
+}
+
+void DrSimulationStatistics::RecordVertexStarted(DrTimeInterval sinceProcessStarted,
+                                                 DrTimeInterval sinceProcessScheduled)
+{
+    DrAutoCriticalSection acs(this);
+
+    ++m_verticesStarted;
+    m_startLatency->Add(sinceProcessStarted);
+    m_scheduleLatency->Add(sinceProcessScheduled);
+}
+
+void DrSimulationStatistics::RecordVertexFinished(bool succeeded)
+{
+    DrAutoCriticalSection acs(this);
+
+    if (succeeded)
+    {
+        ++m_verticesCompleted;
+    }
+    else
+    {
+        ++m_verticesFailed;
+    }
+}
+
+void DrSimulationStatistics::RecordQueueDepth(int readyMessages, int delayedMessages)
+{
+    DrAutoCriticalSection acs(this);
+
+    ++m_numberOfQueueSamples;
+    m_totalQueueDepth += readyMessages;
+    if (readyMessages > m_maxQueueDepth)
+    {
+        m_maxQueueDepth = readyMessages;
+    }
+    if (delayedMessages > m_maxDelayedMessages)
+    {
+        m_maxDelayedMessages = delayedMessages;
+    }
+}
+
+DrTimeInterval DrSimulationStatistics::GetPercentile(List<DrTimeInterval>^ samples, double percentile)
+{
+    if (samples->Count == 0)
+    {
+        return DrTimeInterval_Zero;
+    }
+
+    List<DrTimeInterval>^ sorted = gcnew List<DrTimeInterval>(samples);
+    sorted->Sort();
+
+    int index = (int) System::Math::Ceiling(percentile / 100.0 * (double) sorted->Count) - 1;
+    if (index < 0)
+    {
+        index = 0;
+    }
+    if (index >= sorted->Count)
+    {
+        index = sorted->Count - 1;
+    }
+
+    return sorted[index];
+}
+
+DrTimeInterval DrSimulationStatistics::GetStartLatency(double percentile)
+{
+    DrAutoCriticalSection acs(this);
+
+    return GetPercentile(m_startLatency, percentile);
+}
+
+DrTimeInterval DrSimulationStatistics::GetScheduleLatency(double percentile)
+{
+    DrAutoCriticalSection acs(this);
+
+    return GetPercentile(m_scheduleLatency, percentile);
+}
+
+int DrSimulationStatistics::GetMaxQueueDepth()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_maxQueueDepth;
+}
+
+double DrSimulationStatistics::GetMeanQueueDepth()
+{
+    DrAutoCriticalSection acs(this);
+
+    if (m_numberOfQueueSamples == 0)
+    {
+        return 0.0;
+    }
+
+    return (double) m_totalQueueDepth / (double) m_numberOfQueueSamples;
+}
+
+int DrSimulationStatistics::GetMaxDelayedMessages()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_maxDelayedMessages;
+}
+
+int DrSimulationStatistics::GetNumberOfProcessesScheduled()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_processesScheduled;
+}
+
+int DrSimulationStatistics::GetNumberOfVerticesStarted()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_verticesStarted;
+}
+
+int DrSimulationStatistics::GetNumberOfVerticesCompleted()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_verticesCompleted;
+}
+
+int DrSimulationStatistics::GetNumberOfVerticesFailed()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_verticesFailed;
+}
+
+DrTimeInterval DrSimulationStatistics::GetElapsedTime()
+{
+    DrAutoCriticalSection acs(this);
+
+    return (DrTimeInterval) (m_stopTime - m_startTime);
+}
+
+DrTimeInterval DrSimulationStatistics::GetProcessorTime()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_stopProcessorTime - m_startProcessorTime;
+}
+
+double DrSimulationStatistics::GetVertexTransitionsPerSecond()
+{
+    DrAutoCriticalSection acs(this);
+
+    DrTimeInterval elapsed = (DrTimeInterval) (m_stopTime - m_startTime);
+    if (elapsed <= 0)
+    {
+        return 0.0;
+    }
+
+    /* each execution goes through starting, running and a terminal state */
+    double transitions = (double) (m_verticesStarted + m_verticesCompleted + m_verticesFailed);
+    return transitions * (double) DrTimeInterval_Second / (double) elapsed;
+}
+
+DrTimeInterval DrSimulationStatistics::GetProcessorTimePerVertex()
+{
+    DrAutoCriticalSection acs(this);
+
+    if (m_verticesStarted == 0)
+    {
+        return DrTimeInterval_Zero;
+    }
+
+    return (m_stopProcessorTime - m_startProcessorTime) / m_verticesStarted;
+}
+
+
+DrSimulatedComputer::DrSimulatedComputer(System::String^ name, System::String^ rackName)
+{
+    m_name = name;
+    m_rackName = rackName;
+}
+
+System::String^ DrSimulatedComputer::Name::get()
+{
+    return m_name;
+}
+
+System::String^ DrSimulatedComputer::ProcessServer::get()
+{
+    return "http://" + m_name + "/";
+}
+
+System::String^ DrSimulatedComputer::FileServer::get()
+{
+    return "http://" + m_name + "/";
+}
+
+System::String^ DrSimulatedComputer::Directory::get()
+{
+    return "simulated";
+}
+
+System::String^ DrSimulatedComputer::Host::get()
+{
+    return m_name;
+}
+
+System::String^ DrSimulatedComputer::RackName::get()
+{
+    return m_rackName;
+}
+
+
+DrSimulatedVertex::DrSimulatedVertex(DrSimulatedProcessPtr process, DrVertexProcessStatusPtr status)
+{
+    m_process = process;
+    m_status = status;
+    m_finished = false;
+}
+
+void DrSimulatedVertex::Start(DrTimeInterval runTime)
+{
+    m_timer = gcnew System::Threading::Timer(gcnew System::Threading::TimerCallback(this, &DrSimulatedVertex::OnTimer),
+                                             DrNull, System::Threading::Timeout::Infinite,
+                                             System::Threading::Timeout::Infinite);
+    m_timer->Change((INT64) (runTime / DrTimeInterval_Millisecond),
+                    (INT64) System::Threading::Timeout::Infinite);
+}
+
+void DrSimulatedVertex::Stop()
+{
+    System::Threading::Timer^ timer = m_timer;
+    if (timer != DrNull)
+    {
+        delete timer;
+    }
+}
+
+void DrSimulatedVertex::OnTimer(System::Object^ /* unused state */)
+{
+    m_process->FinishVertex(this);
+}
+
+DrVertexProcessStatusPtr DrSimulatedVertex::GetStatus()
+{
+    return m_status;
+}
+
+bool DrSimulatedVertex::IsFinished()
+{
+    return m_finished;
+}
+
+void DrSimulatedVertex::SetFinished()
+{
+    m_finished = true;
+}
+
+
+DrSimulatedWaiter::DrSimulatedWaiter(IProcessKeyStatus^ status, DrDateTime deadline)
+{
+    m_status = status;
+    m_deadline = deadline;
+    m_version = 0;
+}
+
+
+DrSimulatedKey::DrSimulatedKey()
+{
+    m_version = 0;
+    m_waiter = gcnew List<DrSimulatedWaiterRef>();
+}
+
+
+DrSimulatedProcess::DrSimulatedProcess(DrSimulatedClusterPtr cluster, IProcessWatcher^ watcher,
+                                       System::String^ commandLineArguments)
+{
+    m_cluster = cluster;
+    m_watcher = watcher;
+    m_id = System::Guid::NewGuid().ToString();
+
+    m_state = DSPS_Initializing;
+    m_exitCode = STILL_ACTIVE;
+    m_finishedVertices = 0;
+    m_nextVersion = 0;
+    m_scheduledTime = DrDateTime_LongAgo;
+    m_startedTime = DrDateTime_LongAgo;
+
+    m_key = gcnew Dictionary<System::String^, DrSimulatedKeyRef>();
+    m_vertex = gcnew Dictionary<System::String^, DrSimulatedVertexRef>();
+    m_batchedStatus = gcnew Dictionary<System::String^, DrVertexStatusRef>();
+
+    /* cohort processes are launched with "--startfrompn [--statusbatch] [--reuse] <n> <id> <version> ..."
+       and a vertex host exits once all n of its vertices have finished, unless
+       --reuse asked it to wait for more. --statusbatch asks it to report its
+       vertices in one status property */
+    m_expectedVertices = 1;
+    m_reuse = false;
+    m_statusBatch = false;
+    array<System::String^>^ args = commandLineArguments->Split(' ');
+    for (int i=0; i+1<args->Length; ++i)
+    {
+        if (args[i] == "--startfrompn")
+        {
+            int j = i+1;
+            for (; j+1 < args->Length; ++j)
+            {
+                if (args[j] == "--reuse")
+                {
+                    m_reuse = true;
+                }
+                else if (args[j] == "--statusbatch")
+                {
+                    m_statusBatch = true;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            int n;
+            if (System::Int32::TryParse(args[j], n) && n > 0)
+            {
+                m_expectedVertices = n;
+            }
+        }
+    }
+}
+
+System::String^ DrSimulatedProcess::Id::get()
+{
+    return m_id;
+}
+
+System::String^ DrSimulatedProcess::Directory::get()
+{
+    return "simulated/" + m_id;
+}
+
+void DrSimulatedProcess::Schedule(DrSimulatedComputerPtr computer)
+{
+    {
+        DrAutoCriticalSection acs(this);
+
+        DrAssert(m_state == DSPS_Initializing);
+        m_state = DSPS_Scheduling;
+        m_computer = computer;
+        m_scheduledTime = DrSimulatedCluster::GetCurrentTimeStamp();
+    }
+
+    /* the watcher callbacks are delivered from the timer thread, as the real
+       cluster delivers them from its own threads, so the caller has a chance
+       to register for state changes before they arrive */
+    m_timer = gcnew System::Threading::Timer(gcnew System::Threading::TimerCallback(this, &DrSimulatedProcess::OnTimer),
+                                             DrNull, System::Threading::Timeout::Infinite,
+                                             System::Threading::Timeout::Infinite);
+    m_timer->Change(0, System::Threading::Timeout::Infinite);
+}
+
+void DrSimulatedProcess::OnTimer(System::Object^ /* unused state */)
+{
+    DrSimulatedProcessState state;
+    DrTimeInterval startLatency = m_cluster->GetParameters()->m_processStartLatency;
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        state = m_state;
+        if (state == DSPS_Scheduling)
+        {
+            m_state = DSPS_Starting;
+        }
+        else if (state == DSPS_Starting)
+        {
+            m_state = DSPS_Running;
+            m_startedTime = DrSimulatedCluster::GetCurrentTimeStamp();
+        }
+    }
+
+    INT64 timestamp = (INT64) DrSimulatedCluster::GetCurrentTimeStamp();
+
+    switch (state)
+    {
+    case DSPS_Scheduling:
+        m_watcher->OnQueued();
+        m_watcher->OnMatched(m_computer, timestamp);
+        m_timer->Change((INT64) (startLatency / DrTimeInterval_Millisecond),
+                        (INT64) System::Threading::Timeout::Infinite);
+        break;
+
+    case DSPS_Starting:
+        m_watcher->OnCreated(timestamp);
+        m_watcher->OnStarted(timestamp);
+        break;
+
+    default:
+        /* the process was canceled while the timer was pending */
+        break;
+    }
+}
+
+void DrSimulatedProcess::Cancel()
+{
+    bool started;
+    {
+        DrAutoCriticalSection acs(this);
+
+        started = (m_state == DSPS_Running);
+    }
+
+    if (started)
+    {
+        Exit(ProcessExitState::ProcessExited, 1, "Process killed");
+    }
+    else
+    {
+        Exit(ProcessExitState::ScheduleCanceled, 1, "Process canceled before it started");
+    }
+}
+
+void DrSimulatedProcess::Shutdown()
+{
+    List<DrSimulatedVertexRef>^ vertices;
+    {
+        DrAutoCriticalSection acs(this);
+
+        vertices = gcnew List<DrSimulatedVertexRef>(m_vertex->Values);
+    }
+
+    if (m_timer != DrNull)
+    {
+        delete m_timer;
+    }
+    for (int i=0; i<vertices->Count; ++i)
+    {
+        vertices[i]->Stop();
+    }
+}
+
+System::String^ DrSimulatedProcess::GetKey(DrVertexProcessStatusPtr status)
+{
+    return DrVertexStatus::GetPropertyLabel(status->GetVertexId(),
+                                            status->GetVertexInstanceVersion()).GetString();
+}
+
+DrVertexStatusRef DrSimulatedProcess::MakeStatus(DrVertexProcessStatusPtr status, HRESULT vertexState)
+{
+    DrVertexStatusRef vertexStatus = DrNew DrVertexStatus();
+    vertexStatus->SetVertexState(vertexState);
+    vertexStatus->SetProcessStatus(status);
+    return vertexStatus;
+}
+
+DrSimulatedProcess::WaiterList^ DrSimulatedProcess::TakeWaiters(DrSimulatedKeyPtr key)
+{
+    WaiterList^ waiters = key->m_waiter;
+    key->m_waiter = gcnew WaiterList();
+
+    for (int i=0; i<waiters->Count; ++i)
+    {
+        waiters[i]->m_version = key->m_version;
+        waiters[i]->m_value = key->m_value;
+    }
+
+    return waiters;
+}
+
+DrSimulatedProcess::WaiterList^ DrSimulatedProcess::StoreValue(System::String^ keyName, array<unsigned char>^ value)
+{
+    DrSimulatedKeyRef key;
+    if (m_key->TryGetValue(keyName, key) == false)
+    {
+        key = DrNew DrSimulatedKey();
+        m_key->Add(keyName, key);
+    }
+
+    ++m_nextVersion;
+    key->m_version = m_nextVersion;
+    key->m_value = value;
+
+    return TakeWaiters(key);
+}
+
+/* the caller must hold the process lock. Like a real vertex host, the status
+   goes either into the vertex's own property or into the process' batch */
+DrSimulatedProcess::WaiterList^ DrSimulatedProcess::StoreStatus(DrVertexProcessStatusPtr status, HRESULT vertexState)
+{
+    DrVertexStatusRef vertexStatus = MakeStatus(status, vertexState);
+    DrPropertyWriterRef writer = DrNew DrPropertyWriter();
+
+    if (m_statusBatch == false)
+    {
+        vertexStatus->Serialize(writer);
+        return StoreValue(GetKey(status), writer->GetBuffer()->GetArray());
+    }
+
+    m_batchedStatus[GetKey(status)] = vertexStatus;
+
+    DrVertexStatusBatchRef batch = DrNew DrVertexStatusBatch();
+    for each (DrVertexStatusRef s in m_batchedStatus->Values)
+    {
+        batch->Add(s);
+    }
+    batch->Serialize(writer);
+
+    return StoreValue(DrVertexStatusBatch::GetPropertyLabel().GetString(), writer->GetBuffer()->GetArray());
+}
+
+void DrSimulatedProcess::CompleteWaiters(WaiterList^ waiters, int exitCode)
+{
+    for (int i=0; i<waiters->Count; ++i)
+    {
+        waiters[i]->m_status->OnCompleted(waiters[i]->m_version, waiters[i]->m_value, exitCode, DrNull);
+    }
+}
+
+void DrSimulatedProcess::GetStatus(IProcessKeyStatus^ status)
+{
+    DrSimulatedWaiterRef waiter = DrNew DrSimulatedWaiter(status, DrDateTime_Never);
+    int exitCode;
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        DrSimulatedKeyRef key;
+        if (m_key->TryGetValue(status->GetKey(), key) == false)
+        {
+            key = DrNew DrSimulatedKey();
+            m_key->Add(status->GetKey(), key);
+        }
+
+        if (m_state != DSPS_Exited && key->m_version <= status->GetVersion())
+        {
+            /* nothing new to report: block until the key is written or the
+               request times out */
+            waiter->m_deadline = DrSimulatedCluster::GetCurrentTimeStamp() +
+                (DrDateTime) status->GetTimeout() * DrTimeInterval_Millisecond;
+            key->m_waiter->Add(waiter);
+            return;
+        }
+
+        waiter->m_version = key->m_version;
+        waiter->m_value = key->m_value;
+        exitCode = (m_state == DSPS_Exited) ? m_exitCode : STILL_ACTIVE;
+    }
+
+    status->OnCompleted(waiter->m_version, waiter->m_value, exitCode, DrNull);
+}
+
+void DrSimulatedProcess::ExpireWaiters(DrDateTime now)
+{
+    WaiterList^ expired = gcnew WaiterList();
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        if (m_state == DSPS_Exited)
+        {
+            return;
+        }
+
+        for each (DrSimulatedKeyRef key in m_key->Values)
+        {
+            for (int i=key->m_waiter->Count-1; i>=0; --i)
+            {
+                DrSimulatedWaiterRef waiter = key->m_waiter[i];
+                if (waiter->m_deadline <= now)
+                {
+                    waiter->m_version = key->m_version;
+                    waiter->m_value = key->m_value;
+                    expired->Add(waiter);
+                    key->m_waiter->RemoveAt(i);
+                }
+            }
+        }
+    }
+
+    CompleteWaiters(expired, STILL_ACTIVE);
+}
+
+void DrSimulatedProcess::SetCommand(IProcessCommand^ command)
+{
+    DrByteArrayRef block = DrNew DrByteArray();
+    block->SetArray(command->GetPayload());
+    DrPropertyReaderRef reader = DrNew DrPropertyReader(block);
+
+    UINT16 tagValue;
+    HRESULT err = reader->PeekNextAggregateTag(&tagValue);
+    if (err == S_OK)
+    {
+        if (tagValue == DrTag_VertexCommandBatch)
+        {
+            DrVertexCommandBatchRef batch = DrNew DrVertexCommandBatch();
+            err = reader->ReadAggregate(tagValue, batch);
+            if (err == S_OK)
+            {
+                for (int i=0; i<batch->GetNumberOfCommands(); ++i)
+                {
+                    ActOnCommand(batch->GetCommand(i));
+                }
+            }
+        }
+        else
+        {
+            DrVertexCommandBlockRef cmd = DrNew DrVertexCommandBlock();
+            err = reader->ReadAggregate(DrTag_VertexCommand, cmd);
+            if (err == S_OK)
+            {
+                ActOnCommand(cmd);
+            }
+        }
+    }
+
+    if (err == S_OK)
+    {
+        command->OnCompleted(DrNull);
+    }
+    else
+    {
+        DrString key(command->GetKey());
+        DrString reason;
+        reason.SetF("Simulated process couldn't parse command %s: %s", key.GetChars(), DRERRORSTRING(err));
+        DrLogW("%s", reason.GetChars());
+        command->OnCompleted(reason.GetString());
+    }
+}
+
+void DrSimulatedProcess::ActOnCommand(DrVertexCommandBlockPtr command)
+{
+    switch (command->GetVertexCommand())
+    {
+    case DrVC_Start:
+        StartVertex(command->GetProcessStatus());
+        break;
+
+    case DrVC_Terminate:
+        TerminateVertex(command->GetProcessStatus());
+        break;
+
+    default:
+        /* channels are never reopened since no data moves */
+        break;
+    }
+}
+
+void DrSimulatedProcess::StartVertex(DrVertexProcessStatusPtr status)
+{
+    System::String^ keyName = GetKey(status);
+    DrSimulatedVertexRef vertex = DrNew DrSimulatedVertex(this, status);
+
+    DrDateTime now = DrSimulatedCluster::GetCurrentTimeStamp();
+    DrTimeInterval sinceStarted;
+    DrTimeInterval sinceScheduled;
+    WaiterList^ waiters;
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        if (m_state != DSPS_Running || m_vertex->ContainsKey(keyName))
+        {
+            DrString key(keyName);
+            DrLogW("Simulated process ignoring start command for %s in state %d",
+                   key.GetChars(), (int) m_state);
+            return;
+        }
+
+        m_vertex->Add(keyName, vertex);
+        waiters = StoreStatus(status, DrError_VertexRunning);
+
+        sinceStarted = (DrTimeInterval) (now - m_startedTime);
+        sinceScheduled = (DrTimeInterval) (now - m_scheduledTime);
+    }
+
+    m_cluster->GetStatistics()->RecordVertexStarted(sinceStarted, sinceScheduled);
+
+    CompleteWaiters(waiters, STILL_ACTIVE);
+
+    vertex->Start(m_cluster->DrawVertexRunTime());
+}
+
+void DrSimulatedProcess::FinishVertex(DrSimulatedVertexPtr vertex)
+{
+    DrVertexProcessStatusPtr status = vertex->GetStatus();
+    bool failed = m_cluster->DrawVertexFailure();
+
+    UINT64 bytes = m_cluster->GetParameters()->m_bytesPerOutputChannel;
+    DrOutputChannelArrayRef outputs = status->GetOutputChannels();
+    for (int i=0; i<outputs->Allocated(); ++i)
+    {
+        outputs[i]->SetChannelTotalLength(bytes);
+        outputs[i]->SetChannelProcessedLength(bytes);
+    }
+
+    HRESULT vertexState = DrError_VertexCompleted;
+    if (failed)
+    {
+        vertexState = DrError_VertexError;
+        status->SetVertexErrorCode(E_FAIL);
+        status->SetVertexErrorString(DrString("Simulated vertex failure"));
+    }
+
+    WaiterList^ waiters;
+    bool allFinished;
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        if (vertex->IsFinished() || m_state != DSPS_Running)
+        {
+            return;
+        }
+
+        /* the status is written under the same lock that counts the vertex
+           as finished, so the process can't be seen to exit before it */
+        vertex->SetFinished();
+        waiters = StoreStatus(status, vertexState);
+
+        ++m_finishedVertices;
+        allFinished = (m_finishedVertices >= m_expectedVertices);
+    }
+
+    m_cluster->GetStatistics()->RecordVertexFinished(!failed);
+
+    CompleteWaiters(waiters, STILL_ACTIVE);
+
+    /* a reusable host only exits if one of its vertices fails */
+    if (m_reuse ? failed : allFinished)
+    {
+        Exit(ProcessExitState::ProcessExited, 0, "");
+    }
+}
+
+void DrSimulatedProcess::TerminateVertex(DrVertexProcessStatusPtr status)
+{
+    System::String^ keyName = GetKey(status);
+    DrSimulatedVertexRef vertex;
+    bool allFinished;
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        if (m_vertex->TryGetValue(keyName, vertex) == false || vertex->IsFinished())
+        {
+            return;
+        }
+
+        /* the graph has already given up on the vertex, so there is no need
+           to write a final status for it */
+        vertex->SetFinished();
+
+        ++m_finishedVertices;
+        allFinished = (m_finishedVertices >= m_expectedVertices);
+    }
+
+    vertex->Stop();
+
+    if (allFinished || m_reuse)
+    {
+        Exit(ProcessExitState::ProcessExited, 0, "");
+    }
+}
+
+void DrSimulatedProcess::Exit(ProcessExitState exitState, int exitCode, System::String^ reason)
+{
+    WaiterList^ waiters = gcnew WaiterList();
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        if (m_state == DSPS_Exited)
+        {
+            return;
+        }
+
+        m_state = DSPS_Exited;
+        m_exitCode = exitCode;
+
+        for each (DrSimulatedKeyRef key in m_key->Values)
+        {
+            waiters->AddRange(TakeWaiters(key));
+        }
+    }
+
+    Shutdown();
+
+    m_cluster->RemoveProcess(this);
+
+    m_watcher->OnExited(exitState, (INT64) DrSimulatedCluster::GetCurrentTimeStamp(), exitCode, reason);
+
+    CompleteWaiters(waiters, exitCode);
+}
+
+
+DrSimulatedCluster::DrSimulatedCluster(DrSimulationParametersPtr parameters,
+                                       DrSimulationStatisticsPtr statistics,
+                                       DrMessagePumpPtr pump)
+{
+    m_parameters = parameters;
+    m_statistics = statistics;
+    m_messagePump = pump;
+    m_random = gcnew System::Random(parameters->m_randomSeed);
+
+    m_computers = gcnew List<IComputer^>();
+    m_computerByHost = gcnew Dictionary<System::String^, DrSimulatedComputerRef>();
+    m_process = gcnew List<DrSimulatedProcessRef>();
+
+    int perRack = (parameters->m_computersPerRack > 0) ? parameters->m_computersPerRack : 1;
+    for (int i=0; i<parameters->m_numberOfComputers; ++i)
+    {
+        System::String^ rack = System::String::Format("simrack{0}", i / perRack);
+        System::String^ name = System::String::Format("simnode{0}", i);
+        DrSimulatedComputerRef computer = DrNew DrSimulatedComputer(name, rack);
+
+        m_computers->Add(computer);
+        m_computerByHost->Add(name, computer);
+    }
+}
+
+DrDateTime DrSimulatedCluster::GetCurrentTimeStamp()
+{
+    /* same units and epoch as the message pump's timestamps */
+    return (DrDateTime) System::DateTime::UtcNow.ToFileTimeUtc();
+}
+
+DrSimulationParametersPtr DrSimulatedCluster::GetParameters()
+{
+    return m_parameters;
+}
+
+DrSimulationStatisticsPtr DrSimulatedCluster::GetStatistics()
+{
+    return m_statistics;
+}
+
+DrTimeInterval DrSimulatedCluster::DrawVertexRunTime()
+{
+    DrAutoCriticalSection acs(this);
+
+    double spread = m_parameters->m_vertexRunTimeJitter * (2.0 * m_random->NextDouble() - 1.0);
+    DrTimeInterval runTime = (DrTimeInterval) ((double) m_parameters->m_vertexRunTime * (1.0 + spread));
+    return (runTime > 0) ? runTime : DrTimeInterval_Zero;
+}
+
+bool DrSimulatedCluster::DrawVertexFailure()
+{
+    DrAutoCriticalSection acs(this);
+
+    return (m_random->NextDouble() < m_parameters->m_vertexFailureRate);
+}
+
+bool DrSimulatedCluster::Start()
+{
+    DrLogI("Starting simulated cluster with %d computers", m_computers->Count);
+
+    m_statistics->StartClock();
+
+    INT64 interval = (INT64) (m_parameters->m_sampleInterval / DrTimeInterval_Millisecond);
+    m_timer = gcnew System::Threading::Timer(gcnew System::Threading::TimerCallback(this, &DrSimulatedCluster::OnTimer),
+                                             DrNull, interval, interval);
+
+    return true;
+}
+
+void DrSimulatedCluster::Stop()
+{
+    if (m_timer != DrNull)
+    {
+        delete m_timer;
+        m_timer = DrNull;
+    }
+
+    m_statistics->StopClock();
+
+    List<DrSimulatedProcessRef>^ processes;
+    {
+        DrAutoCriticalSection acs(this);
+
+        processes = gcnew List<DrSimulatedProcessRef>(m_process);
+        m_process->Clear();
+    }
+
+    for (int i=0; i<processes->Count; ++i)
+    {
+        processes[i]->Shutdown();
+    }
+}
+
+void DrSimulatedCluster::OnTimer(System::Object^ /* unused state */)
+{
+    m_statistics->RecordQueueDepth(m_messagePump->GetQueueDepth(),
+                                   m_messagePump->GetNumberOfDelayedMessages());
+
+    List<DrSimulatedProcessRef>^ processes;
+    {
+        DrAutoCriticalSection acs(this);
+
+        processes = gcnew List<DrSimulatedProcessRef>(m_process);
+    }
+
+    DrDateTime now = GetCurrentTimeStamp();
+    for (int i=0; i<processes->Count; ++i)
+    {
+        processes[i]->ExpireWaiters(now);
+    }
+}
+
+List<IComputer^>^ DrSimulatedCluster::GetComputers()
+{
+    return m_computers;
+}
+
+System::String^ DrSimulatedCluster::GetLocalFilePath(IComputer^ computer, System::String^ directory,
+                                                     System::String^ fileName, int /* unused compressionMode */)
+{
+    return "file:///" + computer->Name + "/" + directory + "/" + fileName;
+}
+
+System::String^ DrSimulatedCluster::GetRemoteFilePath(IComputer^ computer, System::String^ directory,
+                                                      System::String^ fileName, int /* unused compressionMode */)
+{
+    return computer->FileServer + directory + "/" + fileName;
+}
+
+IProcess^ DrSimulatedCluster::NewProcess(IProcessWatcher^ watcher, System::String^ /* unused commandLine */,
+                                         System::String^ commandLineArguments)
+{
+    return DrNew DrSimulatedProcess(this, watcher, commandLineArguments);
+}
+
+DrSimulatedComputerPtr DrSimulatedCluster::PickComputer(List<Affinity^>^ affinities)
+{
+    /* honor the heaviest affinity that names a computer, and otherwise place
+       the process anywhere; there is no contention for computers, so this
+       measures the graph manager rather than a scheduling policy */
+    DrSimulatedComputerRef best;
+    UINT64 bestWeight = 0;
+
+    for (int i=0; i<affinities->Count; ++i)
+    {
+        Affinity^ a = affinities[i];
+        for (int j=0; j<a->affinities->Count; ++j)
+        {
+            AffinityResource^ r = a->affinities[j];
+            DrSimulatedComputerRef computer;
+            if (r->level == AffinityResourceLevel::Host &&
+                m_computerByHost->TryGetValue(r->locality, computer) &&
+                (best == DrNull || a->weight > bestWeight))
+            {
+                best = computer;
+                bestWeight = a->weight;
+            }
+        }
+    }
+
+    if (best == DrNull)
+    {
+        DrAutoCriticalSection acs(this);
+
+        best = safe_cast<DrSimulatedComputerRef>(m_computers[m_random->Next(m_computers->Count)]);
+    }
+
+    return best;
+}
+
+void DrSimulatedCluster::ScheduleProcess(IProcess^ process, List<Affinity^>^ affinities)
+{
+    DrSimulatedProcessRef p = safe_cast<DrSimulatedProcessRef>(process);
+
+    {
+        DrAutoCriticalSection acs(this);
+
+        m_process->Add(p);
+    }
+
+    m_statistics->RecordProcessScheduled();
+
+    p->Schedule(PickComputer(affinities));
+}
+
+void DrSimulatedCluster::CancelProcess(IProcess^ process)
+{
+    safe_cast<DrSimulatedProcessRef>(process)->Cancel();
+}
+
+void DrSimulatedCluster::RemoveProcess(DrSimulatedProcessPtr process)
+{
+    {
+        DrAutoCriticalSection acs(this);
+
+        m_process->Remove(process);
+    }
+
+    m_statistics->RecordProcessExited();
+}
+
+void DrSimulatedCluster::GetProcessStatus(IProcess^ process, IProcessKeyStatus^ status)
+{
+    safe_cast<DrSimulatedProcessRef>(process)->GetStatus(status);
+}
+
+void DrSimulatedCluster::SetProcessCommand(IProcess^ process, IProcessCommand^ command)
+{
+    safe_cast<DrSimulatedProcessRef>(process)->SetCommand(command);
+}
@@ -0,0 +1,305 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+#pragma once
+
+/* An in-process stand-in for the cluster that lets the graph manager be driven
+   at full speed without any vertex hosts. It implements the same ICluster
+   interface as the HTTP cluster, so DrClusterInternal, the process and vertex
+   records, the cohorts and the stage managers all run unmodified: processes
+   come up after a configurable start latency, start commands are decoded and
+   answered with the status properties a real vertex host would write, and
+   vertices "run" for a configurable time before reporting completion or
+   failure. It exists for benchmarking the scheduler, not for running jobs */
+
+using namespace Microsoft::Research::Dryad::ClusterInterface;
+
+DRBASECLASS(DrSimulationParameters)
+{
+public:
+    DrSimulationParameters();
+
+    int               m_numberOfComputers;
+    int               m_computersPerRack;
+    /* time from a process being scheduled to it being reported started */
+    DrTimeInterval    m_processStartLatency;
+    /* time from a vertex start command arriving to the vertex completing,
+       spread uniformly by +/- m_vertexRunTimeJitter of itself */
+    DrTimeInterval    m_vertexRunTime;
+    double            m_vertexRunTimeJitter;
+    /* fraction of vertex executions that report an error instead of completing */
+    double            m_vertexFailureRate;
+    UINT64            m_bytesPerOutputChannel;
+    int               m_randomSeed;
+    /* how often the message pump queue depth is sampled and how often blocked
+       property requests are checked for timeouts */
+    DrTimeInterval    m_sampleInterval;
+};
+DRREF(DrSimulationParameters);
+
+DRCLASS(DrSimulationStatistics) : public DrCritSec
+{
+public:
+    DrSimulationStatistics();
+
+    void StartClock();
+    void StopClock();
+
+    void RecordProcessScheduled();
+    void RecordProcessExited();
+    void RecordVertexStarted(DrTimeInterval sinceProcessStarted, DrTimeInterval sinceProcessScheduled);
+    void RecordVertexFinished(bool succeeded);
+    void RecordQueueDepth(int readyMessages, int delayedMessages);
+
+    /* percentile is in [0,100]. The start latency runs from the simulated
+       process reporting that it has started to the vertex start command
+       arriving, so it is pure graph manager overhead; the schedule latency
+       runs from ScheduleProcess to the same point and includes the simulated
+       process start latency */
+    DrTimeInterval GetStartLatency(double percentile);
+    DrTimeInterval GetScheduleLatency(double percentile);
+
+    int GetMaxQueueDepth();
+    double GetMeanQueueDepth();
+    int GetMaxDelayedMessages();
+
+    int GetNumberOfProcessesScheduled();
+    int GetNumberOfVerticesStarted();
+    int GetNumberOfVerticesCompleted();
+    int GetNumberOfVerticesFailed();
+
+    DrTimeInterval GetElapsedTime();
+    DrTimeInterval GetProcessorTime();
+    double GetVertexTransitionsPerSecond();
+    DrTimeInterval GetProcessorTimePerVertex();
+
+private:
+    static DrTimeInterval GetPercentile(System::Collections::Generic::List<DrTimeInterval>^ samples,
+                                        double percentile);
+
+    System::Collections::Generic::List<DrTimeInterval>^   m_startLatency;
+    System::Collections::Generic::List<DrTimeInterval>^   m_scheduleLatency;
+
+    int               m_numberOfQueueSamples;
+    INT64             m_totalQueueDepth;
+    int               m_maxQueueDepth;
+    int               m_maxDelayedMessages;
+
+    int               m_processesScheduled;
+    int               m_processesExited;
+    int               m_verticesStarted;
+    int               m_verticesCompleted;
+    int               m_verticesFailed;
+
+    DrDateTime        m_startTime;
+    DrDateTime        m_stopTime;
+    DrTimeInterval    m_startProcessorTime;
+    DrTimeInterval    m_stopProcessorTime;
+};
+DRREF(DrSimulationStatistics);
+
+DRDECLARECLASS(DrSimulatedCluster);
+DRREF(DrSimulatedCluster);
+
+DRBASECLASS(DrSimulatedComputer), public IComputer
+{
+public:
+    DrSimulatedComputer(System::String^ name, System::String^ rackName);
+
+    virtual property System::String^ Name { System::String^ get(); }
+    virtual property System::String^ ProcessServer { System::String^ get(); }
+    virtual property System::String^ FileServer { System::String^ get(); }
+    virtual property System::String^ Directory { System::String^ get(); }
+    virtual property System::String^ Host { System::String^ get(); }
+    virtual property System::String^ RackName { System::String^ get(); }
+
+private:
+    System::String^   m_name;
+    System::String^   m_rackName;
+};
+DRREF(DrSimulatedComputer);
+
+DRDECLARECLASS(DrSimulatedProcess);
+DRREF(DrSimulatedProcess);
+
+/* a vertex that has been started in a simulated process and is waiting for
+   its run time to elapse */
+DRBASECLASS(DrSimulatedVertex)
+{
+public:
+    DrSimulatedVertex(DrSimulatedProcessPtr process, DrVertexProcessStatusPtr status);
+
+    void Start(DrTimeInterval runTime);
+    void Stop();
+
+    DrVertexProcessStatusPtr GetStatus();
+    bool IsFinished();
+    void SetFinished();
+
+private:
+    void OnTimer(System::Object^ state);
+
+    DrSimulatedProcessRef             m_process;
+    DrVertexProcessStatusRef          m_status;
+    System::Threading::Timer^         m_timer;
+    bool                              m_finished;
+};
+DRREF(DrSimulatedVertex);
+
+/* a blocked property request: it completes when the key is next written, when
+   the process exits, or at its deadline. The value to return is copied in
+   under the process lock so the reply can be sent after it is released */
+DRBASECLASS(DrSimulatedWaiter)
+{
+public:
+    DrSimulatedWaiter(IProcessKeyStatus^ status, DrDateTime deadline);
+
+    IProcessKeyStatus^                m_status;
+    DrDateTime                        m_deadline;
+    UINT64                            m_version;
+    array<unsigned char>^             m_value;
+};
+DRREF(DrSimulatedWaiter);
+
+DRBASECLASS(DrSimulatedKey)
+{
+public:
+    DrSimulatedKey();
+
+    UINT64                            m_version;
+    array<unsigned char>^             m_value;
+    System::Collections::Generic::List<DrSimulatedWaiterRef>^  m_waiter;
+};
+DRREF(DrSimulatedKey);
+
+DRENUM(DrSimulatedProcessState)
+{
+    DSPS_Initializing,
+    DSPS_Scheduling,
+    DSPS_Starting,
+    DSPS_Running,
+    DSPS_Exited
+};
+
+DRCLASS(DrSimulatedProcess) : public DrCritSec, public IProcess
+{
+public:
+    DrSimulatedProcess(DrSimulatedClusterPtr cluster, IProcessWatcher^ watcher,
+                       System::String^ commandLineArguments);
+
+    virtual property System::String^ Id { System::String^ get(); }
+    virtual property System::String^ Directory { System::String^ get(); }
+
+    void Schedule(DrSimulatedComputerPtr computer);
+    void Cancel();
+    void Shutdown();
+
+    void GetStatus(IProcessKeyStatus^ status);
+    void SetCommand(IProcessCommand^ command);
+    void ExpireWaiters(DrDateTime now);
+
+    void FinishVertex(DrSimulatedVertexPtr vertex);
+
+private:
+    typedef System::Collections::Generic::List<DrSimulatedWaiterRef> WaiterList;
+
+    void OnTimer(System::Object^ state);
+    void ActOnCommand(DrVertexCommandBlockPtr command);
+    void StartVertex(DrVertexProcessStatusPtr status);
+    void TerminateVertex(DrVertexProcessStatusPtr status);
+    void Exit(ProcessExitState exitState, int exitCode, System::String^ reason);
+
+    /* the caller must hold the process lock; the returned waiters must be
+       completed after it is released */
+    WaiterList^ StoreValue(System::String^ key, array<unsigned char>^ value);
+    WaiterList^ StoreStatus(DrVertexProcessStatusPtr status, HRESULT vertexState);
+    WaiterList^ TakeWaiters(DrSimulatedKeyPtr key);
+    static void CompleteWaiters(WaiterList^ waiters, int exitCode);
+
+    static DrVertexStatusRef MakeStatus(DrVertexProcessStatusPtr status, HRESULT vertexState);
+    static System::String^ GetKey(DrVertexProcessStatusPtr status);
+
+    DrSimulatedClusterRef             m_cluster;
+    IProcessWatcher^                  m_watcher;
+    System::String^                   m_id;
+    System::Threading::Timer^         m_timer;
+    DrSimulatedComputerRef            m_computer;
+
+    DrSimulatedProcessState           m_state;
+    int                               m_exitCode;
+    int                               m_expectedVertices;
+    int                               m_finishedVertices;
+    bool                              m_reuse;
+    bool                              m_statusBatch;
+    UINT64                            m_nextVersion;
+    DrDateTime                        m_scheduledTime;
+    DrDateTime                        m_startedTime;
+
+    System::Collections::Generic::Dictionary<System::String^, DrSimulatedKeyRef>^        m_key;
+    System::Collections::Generic::Dictionary<System::String^, DrSimulatedVertexRef>^     m_vertex;
+    System::Collections::Generic::Dictionary<System::String^, DrVertexStatusRef>^        m_batchedStatus;
+};
+
+DRCLASS(DrSimulatedCluster) : public DrCritSec, public ICluster
+{
+public:
+    DrSimulatedCluster(DrSimulationParametersPtr parameters,
+                       DrSimulationStatisticsPtr statistics,
+                       DrMessagePumpPtr pump);
+
+    virtual bool Start();
+    virtual void Stop();
+    virtual System::Collections::Generic::List<IComputer^>^ GetComputers();
+    virtual System::String^ GetLocalFilePath(IComputer^ computer, System::String^ directory,
+                                             System::String^ fileName, int compressionMode);
+    virtual System::String^ GetRemoteFilePath(IComputer^ computer, System::String^ directory,
+                                              System::String^ fileName, int compressionMode);
+    virtual IProcess^ NewProcess(IProcessWatcher^ watcher, System::String^ commandLine,
+                                 System::String^ commandLineArguments);
+    virtual void ScheduleProcess(IProcess^ process, System::Collections::Generic::List<Affinity^>^ affinities);
+    virtual void CancelProcess(IProcess^ process);
+    virtual void GetProcessStatus(IProcess^ process, IProcessKeyStatus^ status);
+    virtual void SetProcessCommand(IProcess^ process, IProcessCommand^ command);
+
+    DrSimulationParametersPtr GetParameters();
+    DrSimulationStatisticsPtr GetStatistics();
+
+    /* these draw from the cluster's seeded generator so a run is repeatable
+       up to thread interleaving */
+    DrTimeInterval DrawVertexRunTime();
+    bool DrawVertexFailure();
+
+    void RemoveProcess(DrSimulatedProcessPtr process);
+
+    static DrDateTime GetCurrentTimeStamp();
+
+private:
+    DrSimulatedComputerPtr PickComputer(System::Collections::Generic::List<Affinity^>^ affinities);
+    void OnTimer(System::Object^ state);
+
+    DrSimulationParametersRef         m_parameters;
+    DrSimulationStatisticsRef         m_statistics;
+    DrMessagePumpRef                  m_messagePump;
+    System::Random^                   m_random;
+    System::Threading::Timer^         m_timer;
+
+    System::Collections::Generic::List<IComputer^>^                                 m_computers;
+    System::Collections::Generic::Dictionary<System::String^, DrSimulatedComputerRef>^   m_computerByHost;
+    System::Collections::Generic::List<DrSimulatedProcessRef>^                      m_process;
+};
@@ -427,6 +427,11 @@ DrClusterRef DrCluster::Create()
     return DrNew DrClusterInternal();
 }
 
+DrClusterRef DrCluster::Create(ICluster^ cluster)
+{
+    return DrNew DrClusterInternal(cluster);
+}
+
 
 DrClusterInternal::DrClusterInternal()
 {
@@ -436,6 +441,14 @@ DrClusterInternal::DrClusterInternal()
     m_random = DrNew System::Random();
 }
 
+DrClusterInternal::DrClusterInternal(ICluster^ cluster)
+{
+    m_cluster = cluster;
+    m_critSec = DrNew DrCritSec();
+    m_outstandingPropertyRequests = 0;
+    m_random = DrNew System::Random();
+}
+
 DrClusterInternal::~DrClusterInternal()
 {
     Shutdown();
@@ -476,7 +489,10 @@ HRESULT DrClusterInternal::Initialize(DrUniversePtr universe, DrMessagePumpPtr p
 
     DrLogI("Initializing Scheduler");
 
-    m_cluster = gcnew HttpCluster(this);
+    if (m_cluster == DrNull)
+    {
+        m_cluster = gcnew HttpCluster(this);
+    }
 
     if (m_cluster->Start())
     {
@@ -32,6 +32,9 @@ DRCLASS(DrCluster abstract) : public DrCritSec
 public:
     /* this returns an object of the concrete type */
     static DrClusterRef Create();
+    /* this returns an object of the concrete type driving the supplied cluster
+       implementation instead of the default HTTP one, e.g. a simulator */
+    static DrClusterRef Create(Microsoft::Research::Dryad::ClusterInterface::ICluster^ cluster);
 
     virtual ~DrCluster();
 
@@ -152,6 +152,7 @@ DRCLASS(DrClusterInternal) : public DrCluster, public ILogger
 {
 public:
     DrClusterInternal();
+    DrClusterInternal(ICluster^ cluster);
     ~DrClusterInternal();
 
     virtual HRESULT Initialize(DrUniversePtr universe, DrMessagePumpPtr pump, DrTimeInterval propertyUpdateInterval) DROVERRIDE;
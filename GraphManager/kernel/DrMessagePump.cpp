@@ -23,24 +23,278 @@ limitations under the License.
 #define DRMESSAGEPUMP_CONTINUE   (0)
 #define DRMESSAGEPUMP_EXIT       (1)
 
+/* each worker has several shards so that unrelated locks which happen to
+   hash together rarely hold each other up */
+static const int s_shardsPerWorker = 16;
+/* a worker hands a shard back to the completion port after this many
+   deliveries, so a busy lock can't starve the rest */
+static const int s_maxMessagesPerWakeUp = 64;
+/* resolution of delayed messages */
+static const DrTimeInterval s_timerTickInterval = DrTimeInterval_Millisecond * 100;
+
+static const int s_wheelBitsPerLevel = 6;
+static const int s_wheelSlotsPerLevel = 1 << s_wheelBitsPerLevel;
+static const int s_wheelLevels = 4;
+
 DrMessageBase::~DrMessageBase()
 {
 }
 
-DRCLASS(DrMessageDummy) : public DrMessageBase
+
+DrMessageShard::DrMessageShard(int index)
+{
+    m_index = index;
+    m_scheduled = false;
+    m_accepting = false;
+    m_length = 0;
+}
+
+int DrMessageShard::GetIndex()
+{
+    return m_index;
+}
+
+int DrMessageShard::GetLength()
+{
+    return m_length;
+}
+
+void DrMessageShard::AddToTail(DrMessageBasePtr message)
+{
+    DrAssert(message->m_nextMessage == DrNull);
+
+    if (m_tail == DrNull)
+    {
+        DrAssert(m_head == DrNull);
+        m_head = message;
+    }
+    else
+    {
+        m_tail->m_nextMessage = message;
+    }
+    m_tail = message;
+
+    ++m_length;
+}
+
+DrMessageBaseRef DrMessageShard::RemoveFromHead()
 {
-public:
-    virtual void Deliver() DROVERRIDE
+    DrMessageBaseRef message = m_head;
+
+    if (message != DrNull)
     {
-        DrLogA("Dummy message asked to deliver");
+        DrAssert(m_length > 0);
+        --m_length;
+
+        m_head = message->m_nextMessage;
+        if (m_head == DrNull)
+        {
+            m_tail = DrNull;
+        }
+        message->m_nextMessage = DrNull;
     }
 
-    virtual DrCritSecPtr GetBaseLock() DROVERRIDE
+    return message;
+}
+
+bool DrMessageShard::Empty()
+{
+    if (m_head == DrNull)
     {
-        DrLogA("Dummy message lock requested");
-        return DrNull;
+        DrAssert(m_tail == DrNull);
+        DrAssert(m_length == 0);
+        return true;
     }
-};
+    else
+    {
+        DrAssert(m_length > 0);
+        return false;
+    }
+}
+
+void DrMessageShard::Clear()
+{
+    while (RemoveFromHead() != DrNull)
+    {
+    }
+}
+
+
+DrMessageTimerWheel::DrMessageTimerWheel(DrDateTime startTime, DrTimeInterval tickInterval)
+{
+    DrAssert(tickInterval > 0);
+
+    m_startTime = startTime;
+    m_tickInterval = tickInterval;
+    m_currentTick = 0;
+    m_numberOfMessages = 0;
+    m_slotHead = DrNew SlotArray(s_wheelLevels * s_wheelSlotsPerLevel);
+    m_slotTail = DrNew SlotArray(s_wheelLevels * s_wheelSlotsPerLevel);
+}
+
+int DrMessageTimerWheel::GetNumberOfMessages()
+{
+    return m_numberOfMessages;
+}
+
+UINT64 DrMessageTimerWheel::TickOf(DrDateTime time)
+{
+    if (time <= m_startTime)
+    {
+        return 0;
+    }
+
+    /* round up so nothing is delivered before it is due */
+    UINT64 tickInterval = (UINT64) m_tickInterval;
+    return (time - m_startTime + tickInterval - 1) / tickInterval;
+}
+
+void DrMessageTimerWheel::AddToSlot(int slot, DrMessageBasePtr message)
+{
+    DrAssert(message->m_nextMessage == DrNull);
+
+    if (m_slotTail[slot] == DrNull)
+    {
+        m_slotHead[slot] = message;
+    }
+    else
+    {
+        m_slotTail[slot]->m_nextMessage = message;
+    }
+    m_slotTail[slot] = message;
+}
+
+DrMessageBaseRef DrMessageTimerWheel::TakeSlot(int slot)
+{
+    DrMessageBaseRef list = m_slotHead[slot];
+    m_slotHead[slot] = DrNull;
+    m_slotTail[slot] = DrNull;
+    return list;
+}
+
+void DrMessageTimerWheel::Place(DrMessageBasePtr message, UINT64 dueTick)
+{
+    DrAssert(dueTick > m_currentTick);
+
+    UINT64 delta = dueTick - m_currentTick;
+    UINT64 horizon = (UINT64) 1 << (s_wheelBitsPerLevel * s_wheelLevels);
+    if (delta >= horizon)
+    {
+        /* further out than the wheel reaches: park it in the furthest slot.
+           It is placed again from its real due time when that slot cascades */
+        dueTick = m_currentTick + horizon - 1;
+        delta = horizon - 1;
+    }
+
+    int level = 0;
+    while (delta >= ((UINT64) 1 << (s_wheelBitsPerLevel * (level+1))))
+    {
+        ++level;
+    }
+    DrAssert(level < s_wheelLevels);
+
+    int slot = (int) ((dueTick >> (s_wheelBitsPerLevel * level)) & (s_wheelSlotsPerLevel - 1));
+    AddToSlot(level * s_wheelSlotsPerLevel + slot, message);
+}
+
+void DrMessageTimerWheel::Expire(DrMessageBasePtr message)
+{
+    DrAssert(m_numberOfMessages > 0);
+    --m_numberOfMessages;
+
+    if (m_expiredTail == DrNull)
+    {
+        m_expiredHead = message;
+    }
+    else
+    {
+        m_expiredTail->m_nextMessage = message;
+    }
+    m_expiredTail = message;
+}
+
+void DrMessageTimerWheel::Cascade(DrMessageBasePtr message)
+{
+    UINT64 dueTick = TickOf(message->m_dueTime);
+    if (dueTick <= m_currentTick)
+    {
+        Expire(message);
+    }
+    else
+    {
+        Place(message, dueTick);
+    }
+}
+
+bool DrMessageTimerWheel::Insert(DrMessageBasePtr message)
+{
+    UINT64 dueTick = TickOf(message->m_dueTime);
+    if (dueTick <= m_currentTick)
+    {
+        return false;
+    }
+
+    Place(message, dueTick);
+    ++m_numberOfMessages;
+
+    return true;
+}
+
+DrMessageBaseRef DrMessageTimerWheel::Advance(DrDateTime currentTime)
+{
+    UINT64 targetTick = 0;
+    if (currentTime > m_startTime)
+    {
+        targetTick = (currentTime - m_startTime) / (UINT64) m_tickInterval;
+    }
+
+    if (m_numberOfMessages == 0 && targetTick > m_currentTick)
+    {
+        /* nothing to cascade or expire on the way */
+        m_currentTick = targetTick;
+    }
+
+    while (m_currentTick < targetTick)
+    {
+        ++m_currentTick;
+
+        /* each level whose slot boundary we just crossed is spread over the
+           levels below it, highest first so that lower levels see everything
+           that belongs to them before they are themselves cascaded */
+        int level;
+        for (level = s_wheelLevels-1; level > 0; --level)
+        {
+            UINT64 levelMask = ((UINT64) 1 << (s_wheelBitsPerLevel * level)) - 1;
+            if ((m_currentTick & levelMask) == 0)
+            {
+                int slot = (int) ((m_currentTick >> (s_wheelBitsPerLevel * level)) &
+                                  (s_wheelSlotsPerLevel - 1));
+                DrMessageBaseRef message = TakeSlot(level * s_wheelSlotsPerLevel + slot);
+                while (message != DrNull)
+                {
+                    DrMessageBaseRef next = message->m_nextMessage;
+                    message->m_nextMessage = DrNull;
+                    Cascade(message);
+                    message = next;
+                }
+            }
+        }
+
+        DrMessageBaseRef message = TakeSlot((int) (m_currentTick & (s_wheelSlotsPerLevel - 1)));
+        while (message != DrNull)
+        {
+            DrMessageBaseRef next = message->m_nextMessage;
+            message->m_nextMessage = DrNull;
+            Expire(message);
+            message = next;
+        }
+    }
+
+    DrMessageBaseRef expired = m_expiredHead;
+    m_expiredHead = DrNull;
+    m_expiredTail = DrNull;
+    return expired;
+}
 
 
 DrMessagePump::DrMessagePump(int numWorkerThreads,
@@ -60,23 +314,20 @@ DrMessagePump::DrMessagePump(int numWorkerThreads,
     }
 #endif
 
-    m_currentListener = DrNew CSArray(m_numWorkerThreads);
-
-    m_numQueuedWakeUps = 0;
-    m_listDummy = DrNew DrMessageDummy();
-    m_listDummy->m_nextMessage = m_listDummy;
-    m_listDummy->m_prevMessage = m_listDummy;
-    m_listLength = 0;
+    m_numShards = m_numWorkerThreads * s_shardsPerWorker;
+    m_shard = DrNew ShardArray(m_numShards);
+    int s;
+    for (s=0; s<m_numShards; ++s)
+    {
+        m_shard[s] = DrNew DrMessageShard(s);
+    }
 
-    m_pendingMessages = DrNew MessageQueue();
+    m_pendingMessages = DrNew DrMessageTimerWheel(GetCurrentTimeStamp(), s_timerTickInterval);
 }
 
 DrMessagePump::~DrMessagePump()
 {
     DrAssert(m_completionPort == INVALID_HANDLE_VALUE);
-    /* free the circular references */
-    m_listDummy->m_nextMessage = DrNull;
-    m_listDummy->m_prevMessage = DrNull;
 }
 
 static DrDateTime GetSystemTimeStamp()
@@ -94,46 +345,70 @@ DrDateTime DrMessagePump::GetCurrentTimeStamp()
     return GetSystemTimeStamp();
 }
 
-void DrMessagePump::AddToListTail(DrMessageBasePtr message)
+DrMessageShardPtr DrMessagePump::GetShard(DrMessageBasePtr message)
 {
-    DrAssert(message->m_nextMessage == DrNull);
-    DrAssert(message->m_prevMessage == DrNull);
+    DrCritSecPtr lock = message->GetBaseLock();
 
-    message->m_nextMessage = m_listDummy;
-    message->m_prevMessage = m_listDummy->m_prevMessage;
-    message->m_prevMessage->m_nextMessage = message;
-    message->m_nextMessage->m_prevMessage = message;
+#ifdef _MANAGED
+    UINT32 hash = (UINT32) System::Runtime::CompilerServices::RuntimeHelpers::GetHashCode(lock);
+#else
+    /* locks are heap objects, so the low bits of the address carry nothing */
+    UINT64 address = (UINT64) (UINT_PTR) lock;
+    UINT32 hash = (UINT32) ((address >> 4) ^ (address >> 20));
+#endif
 
-    ++m_listLength;
+    return m_shard[(int) (hash % (UINT32) m_numShards)];
 }
 
-void DrMessagePump::RemoveFromList(DrMessageBasePtr message)
+/* called with the shard's lock held */
+void DrMessagePump::PostWakeUp(DrMessageShardPtr shard)
 {
-    DrAssert(message != m_listDummy);
-    DrAssert(m_listLength > 0);
-
-    --m_listLength;
-
-    message->m_nextMessage->m_prevMessage = message->m_prevMessage;
-    message->m_prevMessage->m_nextMessage = message->m_nextMessage;
-
-    message->m_nextMessage = DrNull;
-    message->m_prevMessage = DrNull;
+    BOOL retval = ::PostQueuedCompletionStatus(m_completionPort,
+                                               DRMESSAGEPUMP_CONTINUE,
+                                               (ULONG_PTR) shard->GetIndex(),
+                                               NULL);
+    if (retval == 0)
+    {
+        DWORD errCode = GetLastError();
+        DrLogA("post completion status", "error code: %d", errCode);
+    }
 }
 
-bool DrMessagePump::ListEmpty()
+void DrMessagePump::DrainShard(DrMessageShardPtr shard)
 {
-    if (m_listDummy->m_nextMessage == m_listDummy)
+    int delivered;
+    for (delivered=0; delivered<s_maxMessagesPerWakeUp; ++delivered)
     {
-        DrAssert(m_listDummy->m_prevMessage == m_listDummy);
-        DrAssert(m_listLength == 0);
-        return true;
+        DrMessageBaseRef message;
+
+        {
+            DrAutoCriticalSection acs(shard);
+
+            message = shard->RemoveFromHead();
+            if (message == DrNull)
+            {
+                shard->m_scheduled = false;
+                return;
+            }
+        }
+
+        /* this acquires the lock and sends the message */
+        message->Deliver();
     }
-    else
+
     {
-        DrAssert(m_listDummy->m_prevMessage != m_listDummy);
-        DrAssert(m_listLength > 0);
-        return false;
+        DrAutoCriticalSection acs(shard);
+
+        if (shard->Empty())
+        {
+            shard->m_scheduled = false;
+        }
+        else
+        {
+            /* go to the back of the completion port queue, still scheduled,
+               so other shards get a turn */
+            PostWakeUp(shard);
+        }
     }
 }
 
@@ -145,27 +420,32 @@ void DrMessagePump::TimerThread()
 
     do
     {
-        Sleep(1000);
+        Sleep((DWORD) (s_timerTickInterval / DrTimeInterval_Millisecond));
+
+        DrMessageBaseRef expired;
 
         {
             DrAutoCriticalSection acs(this);
 
-            DrDateTime currentTime = GetCurrentTimeStamp();
-
             if (m_state == MPS_Running)
             {
-                MessageQueue::Iter iter = m_pendingMessages->Begin();
-                while (iter != m_pendingMessages->End() && iter->first <= currentTime)
-                {
-                    EnQueueInternal(iter->second);
-                    iter = m_pendingMessages->Erase(iter);
-                }
+                expired = m_pendingMessages->Advance(GetCurrentTimeStamp());
             }
             else
             {
                 finished = true;
             }
         }
+
+        /* hand the due messages to their shards outside the pump lock */
+        while (expired != DrNull)
+        {
+            DrMessageBaseRef message = expired;
+            expired = message->m_nextMessage;
+            message->m_nextMessage = DrNull;
+
+            EnQueueInternal(message);
+        }
     } while (!finished);
 
     DrLogI("exiting timer thread");
@@ -191,137 +471,25 @@ void DrMessagePump::ThreadMain(int threadId)
                                                   &overlapped,
                                                   INFINITE);
 
-        bool mustDecrementCount = false;
-        if (retval != 0)
+        if (retval == 0)
         {
-            DrAssert(overlapped == NULL);
+            DWORD errCode = GetLastError();
+            DrLogA("error code", "%d", errCode);
+        }
 
-            /* This is a queue wakeup event */
-            mustDecrementCount = true;
-            finished = (numBytes == DRMESSAGEPUMP_EXIT);
+        DrAssert(overlapped == NULL);
 
-            if (finished)
-            {
-                DrLogI("received shutdown event");
-            }
-            else
-            {
-                //DrLogI("Received queued wakeup");
-            }
+        if (numBytes == DRMESSAGEPUMP_EXIT)
+        {
+            DrLogI("received shutdown event");
+            finished = true;
         }
         else
         {
-            DWORD errCode = GetLastError();
-            DrLogA("error code", "%d", errCode);
+            /* This is a wakeup for a shard with messages queued */
+            DrAssert(completionKey < (ULONG_PTR) m_numShards);
+            DrainShard(m_shard[(int) completionKey]);
         }
-
-        bool foundMessage = false;
-        do
-        {
-            DrMessageBaseRef message = DrNull;
-
-            {
-                DrAutoCriticalSection acs(this);
-
-                message = m_listDummy->m_nextMessage;
-
-                if (finished)
-                {
-                    /* Received a shutdown message - verify that the message queue is now empty */
-                    DrAssert(message == m_listDummy);
-                }
-
-                foundMessage = false;
-                while (!foundMessage && message != m_listDummy)
-                {
-                    int i;
-                    /* Check whether another thread is holding the same 
-                    lock that this message wants to acquire. If so, skip
-                    this message so we don't block waiting to acquire
-                    the lock. */
-                    for (i=0; i<m_numWorkerThreads; ++i)
-                    {
-                        if (m_currentListener[i] == message->GetBaseLock())
-                        {
-                            message = message->m_nextMessage;
-                            break;
-                        }
-                    }
-
-                    if (i == m_numWorkerThreads)
-                    {
-                        /* Found a message - no other thread is holding the lock */
-                        foundMessage = true;
-                        RemoveFromList(message);
-                        m_currentListener[threadId] = message->GetBaseLock();
-                    }
-                }
-
-                if (!foundMessage && mustDecrementCount)
-                {
-                    mustDecrementCount = false;
-                    DrAssert(m_numQueuedWakeUps > 0);
-                    --m_numQueuedWakeUps;
-                }
-            }
-
-            if (foundMessage)
-            {
-                /* this acquires the lock and sends the message */
-                message->Deliver();
-
-                {
-                    DrAutoCriticalSection acs(this);
-
-                    if (m_state == MPS_Stopping)
-                    {
-                        /* If the message pump is stopping - verify that there
-                        are no more messages left on the queue */
-                        DrAssert(m_listLength == 0);
-                    }
-
-                    m_currentListener[threadId] = DrNull;
-
-                    /* If we didn't receive a shutdown message, check whether
-                    there are any more messages in the queue, and
-                    wake up any free threads to help process them */
-                    if (!finished)
-                    {
-                        int numberOfSpareMessages = m_listLength;
-                        int numberOfFreeThreads = 0;
-                        int i;
-                        for (i=0; i<m_numWorkerThreads && numberOfSpareMessages > 0; ++i)
-                        {
-                            if (m_currentListener[i] == DrNull)
-                            {
-                                ++numberOfFreeThreads;
-                                --numberOfSpareMessages;
-                            }
-                        }
-
-                        /* we are free by construction: if anyone else is, wake them up */
-                        for (i=m_numQueuedWakeUps; i<numberOfFreeThreads; ++i)
-                        {
-                            ++m_numQueuedWakeUps;
-                            BOOL retval = ::PostQueuedCompletionStatus(m_completionPort,
-                                DRMESSAGEPUMP_CONTINUE,
-                                NULL,
-                                NULL);
-                            if (retval == 0)
-                            {
-                                DWORD errCode = GetLastError();
-                                DrLogA("post completion status", "error code: %d", errCode);
-                            }
-                        }
-                    }
-                }
-            }
-
-            if (!foundMessage && !finished)
-            {
-                //DrLogI("Sleeping");
-            }
-        } while (foundMessage);
     } while (!finished);
 
     DrLogI("exiting thread %d", threadId);
@@ -458,6 +626,28 @@ HANDLE DrMessagePump::GetCompletionPort()
     return m_completionPort;
 }
 
+int DrMessagePump::GetQueueDepth()
+{
+    int depth = 0;
+
+    int i;
+    for (i=0; i<m_numShards; ++i)
+    {
+        DrMessageShardPtr shard = m_shard[i];
+        DrAutoCriticalSection acs(shard);
+        depth += shard->GetLength();
+    }
+
+    return depth;
+}
+
+int DrMessagePump::GetNumberOfDelayedMessages()
+{
+    DrAutoCriticalSection acs(this);
+
+    return m_pendingMessages->GetNumberOfMessages();
+}
+
 void DrMessagePump::Start()
 {
     {
@@ -476,11 +666,19 @@ void DrMessagePump::Start()
 
         DrLogI("created completion port");
 
+        int s;
+        for (s=0; s<m_numShards; ++s)
+        {
+            DrMessageShardPtr shard = m_shard[s];
+            DrAutoCriticalSection sacs(shard);
+            shard->m_accepting = true;
+        }
+
         StartThreads();
 
         m_state = MPS_Running;
 
-        DrLogI("created threads");
+        DrLogI("created threads with %d message shards", m_numShards);
     }
 }
 
@@ -494,13 +692,16 @@ void DrMessagePump::Stop()
         DrAssert(m_state == MPS_Running);
 
         m_state = MPS_Stopping;
+    }
 
-        while (ListEmpty() == false)
-        {
-            RemoveFromList(m_listDummy->m_nextMessage);
-        }
-
-        m_numQueuedWakeUps += m_numWorkerThreads;
+    /* stop taking messages and throw away any that haven't been delivered */
+    int s;
+    for (s=0; s<m_numShards; ++s)
+    {
+        DrMessageShardPtr shard = m_shard[s];
+        DrAutoCriticalSection acs(shard);
+        shard->m_accepting = false;
+        shard->Clear();
     }
 
     int i;
@@ -527,8 +728,6 @@ void DrMessagePump::Stop()
     {
         DrAutoCriticalSection acs(this);
 
-        DrAssert(m_numQueuedWakeUps == 0);
-
         BOOL bRetval = ::CloseHandle(m_completionPort);
         if (bRetval == 0)
         {
@@ -537,9 +736,16 @@ void DrMessagePump::Stop()
                    "error code: %d", errCode);
         }
 
-        DrAssert(ListEmpty());
+        /* any wakeups still queued went away with the completion port */
+        for (s=0; s<m_numShards; ++s)
+        {
+            DrMessageShardPtr shard = m_shard[s];
+            DrAutoCriticalSection sacs(shard);
+            DrAssert(shard->Empty());
+            shard->m_scheduled = false;
+        }
 
-        m_pendingMessages = DrNew MessageQueue();
+        m_pendingMessages = DrNew DrMessageTimerWheel(GetCurrentTimeStamp(), s_timerTickInterval);
 
         m_completionPort = INVALID_HANDLE_VALUE;
         m_state = MPS_Stopped;
@@ -548,41 +754,35 @@ void DrMessagePump::Stop()
     DrLogI("exiting");
 }
 
-void DrMessagePump::EnQueueInternal(DrMessageBasePtr message)
+bool DrMessagePump::EnQueueInternal(DrMessageBasePtr message)
 {
-    AddToListTail(message);
+    DrMessageShardPtr shard = GetShard(message);
 
-    if (m_numQueuedWakeUps < m_numWorkerThreads)
+    DrAutoCriticalSection acs(shard);
+
+    if (shard->m_accepting == false)
     {
-        ++m_numQueuedWakeUps;
-        BOOL retval = ::PostQueuedCompletionStatus(m_completionPort,
-                                                   DRMESSAGEPUMP_CONTINUE,
-                                                   NULL,
-                                                   NULL);
-        if (retval == 0)
-        {
-            DWORD errCode = GetLastError();
-            DrLogA("post completion status", "error code: %d", errCode);
-        }
+        return false;
+    }
+
+    shard->AddToTail(message);
+
+    if (shard->m_scheduled == false)
+    {
+        /* nobody is draining this shard, so wake a worker up to do it */
+        shard->m_scheduled = true;
+        PostWakeUp(shard);
     }
+
+    return true;
 }
 
 bool DrMessagePump::EnQueue(DrMessageBasePtr message)
 {
+    if (EnQueueInternal(message) == false)
     {
-        DrAutoCriticalSection acs(this);
-
-        if (m_state == MPS_Stopping)
-        {
-            DrLogI("rejecting stopping item");
-            return false;
-        }
-        else
-        {
-            DrAssert(m_state == MPS_Running);
-        }
-
-        EnQueueInternal(message);
+        DrLogI("rejecting stopping item");
+        return false;
     }
 
     return true;
@@ -607,8 +807,13 @@ bool DrMessagePump::EnQueueDelayed(DrTimeInterval delay, DrMessageBasePtr messag
             DrAssert(m_state == MPS_Running);
         }
 
-        m_pendingMessages->Insert(currentTime + delay, message);
+        message->m_dueTime = currentTime + delay;
+        if (m_pendingMessages->Insert(message))
+        {
+            return true;
+        }
     }
 
-    return true;
+    /* the wheel has already passed the due time, so it goes out now */
+    return EnQueue(message);
 }
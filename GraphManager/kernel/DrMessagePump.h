@@ -32,8 +32,11 @@ public:
     virtual void Deliver() = 0;
     virtual DrCritSecPtr GetBaseLock() = 0;
 
+    /* link used by the pump's shard queues and by the timer wheel; a message
+       is on at most one of them at a time */
     DrMessageBaseRef    m_nextMessage;
-    DrMessageBaseRef    m_prevMessage;
+    /* when a delayed message is due to be delivered */
+    DrDateTime          m_dueTime;
 };
 
 template <class Notification> DRINTERFACE(DrListener)
@@ -110,9 +113,79 @@ DRENUM(MessagePumpState)
     MPS_Stopping
 };
 
-/* stop spurious compiler warning by exercising template machinery */
-template ref class DrMultiMap<DrDateTime, DrMessageBaseRef>;
+/* a FIFO of messages that all hash to the same shard. Messages for a given
+   base lock always land in the same shard, and at most one worker drains a
+   shard at a time, so messages to a lock are delivered in the order they were
+   queued without any worker ever blocking on a lock another worker holds */
+DRCLASS(DrMessageShard) : public DrCritSec
+{
+public:
+    DrMessageShard(int index);
+
+    int GetIndex();
+    int GetLength();
+
+    void AddToTail(DrMessageBasePtr message);
+    DrMessageBaseRef RemoveFromHead();
+    bool Empty();
+    void Clear();
+
+    /* true while a wakeup for this shard is queued or a worker is draining it */
+    bool               m_scheduled;
+    /* false once the pump has started stopping */
+    bool               m_accepting;
+
+private:
+    int                m_index;
+    DrMessageBaseRef   m_head;
+    DrMessageBaseRef   m_tail;
+    int                m_length;
+};
+DRREF(DrMessageShard);
+
+/* hierarchical timing wheel holding delayed messages. Each level has a fixed
+   number of slots, and a slot at level l spans (slots per level)^l ticks;
+   messages cascade down a level as their slot comes round, so inserting and
+   expiring are constant time however many timers are outstanding */
+DRCLASS(DrMessageTimerWheel)
+{
+public:
+    DrMessageTimerWheel(DrDateTime startTime, DrTimeInterval tickInterval);
+
+    /* returns false, and does not keep the message, if it is already due */
+    bool Insert(DrMessageBasePtr message);
+
+    /* moves the wheel up to currentTime and returns the messages that have
+       become due, chained through m_nextMessage */
+    DrMessageBaseRef Advance(DrDateTime currentTime);
+
+    int GetNumberOfMessages();
 
+private:
+    typedef DrArray<DrMessageBaseRef> SlotArray;
+    DRAREF(SlotArray,DrMessageBaseRef);
+
+    UINT64 TickOf(DrDateTime time);
+    void AddToSlot(int slot, DrMessageBasePtr message);
+    DrMessageBaseRef TakeSlot(int slot);
+    void Place(DrMessageBasePtr message, UINT64 dueTick);
+    void Cascade(DrMessageBasePtr message);
+    void Expire(DrMessageBasePtr message);
+
+    DrDateTime         m_startTime;
+    DrTimeInterval     m_tickInterval;
+    UINT64             m_currentTick;
+    int                m_numberOfMessages;
+    SlotArrayRef       m_slotHead;
+    SlotArrayRef       m_slotTail;
+    /* messages that expire during one Advance, in the order they expired */
+    DrMessageBaseRef   m_expiredHead;
+    DrMessageBaseRef   m_expiredTail;
+};
+DRREF(DrMessageTimerWheel);
+
+/* the pump lock only guards the state and the timer wheel: immediate messages
+   go straight to their shard under that shard's lock */
 DRCLASS(DrMessagePump) : public DrCritSec
 {
  public:
@@ -130,11 +203,15 @@ DRCLASS(DrMessagePump) : public DrCritSec
 
     HANDLE GetCompletionPort();
 
+    /* snapshots for monitoring: the messages waiting in the shards to be
+       delivered, summed one shard lock at a time, and the delayed messages
+       still in the timer wheel */
+    int GetQueueDepth();
+    int GetNumberOfDelayedMessages();
+
 private:
-    typedef DrArray<DrCritSecRef> CSArray;
-    DRAREF(CSArray,DrCritSecRef);
-    typedef DrMultiMap<DrDateTime, DrMessageBaseRef> MessageQueue;
-    DRREF(MessageQueue);
+    typedef DrArray<DrMessageShardRef> ShardArray;
+    DRAREF(ShardArray,DrMessageShardRef);
 
 #ifdef _MANAGED
     
@@ -144,8 +221,6 @@ private:
     void ThreadFunc(Object^ parameter);
 
 #else
-    /* stop spurious compiler warning by exercising template machinery */
-    template class DrMultiMap<DrDateTime, DrMessageBaseRef>;
     typedef DrArray<HANDLE> ThreadArray;
     DRAREF(ThreadArray,HANDLE);
     static unsigned __stdcall TimerFunc(void* parameter);
@@ -153,9 +228,9 @@ private:
 
 #endif
 
-    void AddToListTail(DrMessageBasePtr message);
-    void RemoveFromList(DrMessageBasePtr message);
-    bool ListEmpty();
+    DrMessageShardPtr GetShard(DrMessageBasePtr message);
+    void PostWakeUp(DrMessageShardPtr shard);
+    void DrainShard(DrMessageShardPtr shard);
 
     void StartThreads();
     void WaitForThreads();
@@ -163,11 +238,11 @@ private:
     void TimerThread();
     void ThreadMain(int threadId);
 
-    void EnQueueInternal(DrMessageBasePtr message);
+    bool EnQueueInternal(DrMessageBasePtr message);
 
-    DrMessageBaseRef  m_listDummy; /* list of messages */
-    int               m_listLength;
-    MessageQueueRef   m_pendingMessages; /* list of delayed messages */
+    ShardArrayRef           m_shard;
+    int                     m_numShards;
+    DrMessageTimerWheelRef  m_pendingMessages; /* delayed messages */
 
     MessagePumpState  m_state;
 
@@ -175,8 +250,6 @@ private:
     int               m_numConcurrentThreads;
     HANDLE            m_completionPort;
     ThreadArrayRef    m_threadHandle;
-    CSArrayRef        m_currentListener;
-    int               m_numQueuedWakeUps;
 };
 DRREF(DrMessagePump);
 
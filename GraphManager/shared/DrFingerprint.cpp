@@ -0,0 +1,92 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include "DrShared.h"
+
+/* basic_types.h, which DrFPrint.h includes, defines the same limits as
+   DrTypes.h */
+#pragma warning( push )
+#pragma warning( disable: 4005 )
+#include "DrFPrint.h"
+#pragma warning( pop )
+
+/* the polynomial the channel code uses for its data fingerprints */
+static const UINT64 s_polynomial = 0x911498ae0e66bad6;
+
+static Dryad_dupelim_fprint_data_t volatile s_fprintData = NULL;
+
+void* DrFingerprint::GetFPrintData()
+{
+    if (s_fprintData == NULL)
+    {
+        Dryad_dupelim_fprint_data_t data = Dryad_dupelim_fprint_new(s_polynomial, 0);
+        if (InterlockedCompareExchangePointer((PVOID volatile *) &s_fprintData, data, NULL) != NULL)
+        {
+            /* another thread got there first */
+            Dryad_dupelim_fprint_close(data);
+        }
+    }
+
+    return s_fprintData;
+}
+
+DrFingerprint::DrFingerprint()
+{
+    m_value = Empty();
+}
+
+UINT64 DrFingerprint::Empty()
+{
+    return Dryad_dupelim_fprint_empty((Dryad_dupelim_fprint_data_tc) GetFPrintData());
+}
+
+void DrFingerprint::ExtendBytes(const void* data, size_t length)
+{
+    DrAssert(length <= MAX_UINT32);
+    m_value = Dryad_dupelim_fprint_extend((Dryad_dupelim_fprint_data_tc) GetFPrintData(), m_value,
+                                          (const unsigned char *) data, (unsigned) length);
+}
+void DrFingerprint::ExtendString(DrString s)
+{
+    /* include the length so that adjacent strings can't run into each other */
+    int length = s.GetCharsLength();
+    ExtendUInt64((UINT64) length);
+    if (length > 0)
+    {
+        ExtendBytes(s.GetChars(), (size_t) length);
+    }
+}
+
+void DrFingerprint::ExtendUInt64(UINT64 value)
+{
+    /* little-endian, as the vertex code sees a UINT64 in memory */
+    unsigned char b[8];
+    int i;
+    for (i=0; i<8; ++i)
+    {
+        b[i] = (unsigned char) (value >> (8*i));
+    }
+    ExtendBytes(b, sizeof(b));
+}
+
+UINT64 DrFingerprint::GetValue()
+{
+    return m_value;
+}
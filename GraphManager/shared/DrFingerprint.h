@@ -0,0 +1,47 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+
+/* A 64-bit Rabin fingerprint that can be extended a piece at a time. It is
+   a thin wrapper around the vertex host's DrFPrint code, which is compiled
+   into the graph manager too, using the polynomial the channel code uses
+   for its data fingerprints */
+DRBASECLASS(DrFingerprint)
+{
+public:
+    /* the fingerprint of the empty string */
+    DrFingerprint();
+
+    void ExtendBytes(const void* data, size_t length);
+    void ExtendString(DrString s);
+    void ExtendUInt64(UINT64 value);
+
+    UINT64 GetValue();
+
+    /* the value of an empty fingerprint, which callers can use as "none" */
+    static UINT64 Empty();
+
+private:
+    static void* GetFPrintData();
+
+    UINT64 m_value;
+};
+DRREF(DrFingerprint);
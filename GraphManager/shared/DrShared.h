@@ -53,4 +53,5 @@ limitations under the License.
 
 #include "DrError.h"
 
-#include "DrStringUtil.h"
\ No newline at end of file
+#include "DrStringUtil.h"
+#include "DrFingerprint.h"
\ No newline at end of file
@@ -138,6 +138,11 @@ void DrConnectionManager::DefaultDealWithUpstreamRemoval(DrVertexPtr upstreamVer
 }
 
 
+DrVertexProgress::DrVertexProgress()
+{
+    m_projectedRunningTime = DrTimeInterval_Infinite;
+}
+
 bool RTIter::operator==(RTIterR other)
 {
     return
@@ -251,6 +256,7 @@ DrManagerBase::DrManagerBase(DrGraphPtr graph, DrNativeString stageName) : DrSta
     m_holder = DrNew HolderList();
     m_runningMap = DrNew RunningMap();
     m_runningTimeMap = DrNew RunningTimeMap();
+    m_speculatedVertices = DrNew DrActiveVertexSet();
 
     m_stageName = stageName;
     m_stageStatistics->SetName(m_stageName);
@@ -286,6 +292,7 @@ void DrManagerBase::Discard()
     m_downStreamStages = DrNull;
     m_runningMap = DrNull;
     m_runningTimeMap = DrNull;
+    m_speculatedVertices = DrNull;
 }
 
 DrGraphPtr DrManagerBase::GetGraph()
@@ -556,6 +563,12 @@ void DrManagerBase::UnRegisterVertex(DrVertexPtr vertex)
     bool removed = m_vertices->Remove(vertex);
     DrAssert(removed);
 
+    DrActiveVertexPtr activeVertex = dynamic_cast<DrActiveVertexPtr>(vertex);
+    if (activeVertex != DrNull)
+    {
+        ReleaseSpeculativeDuplicate(activeVertex);
+    }
+
     m_stageStatistics->DecrementSampleSize();
 
     /* tell the downstream stage managers that something is being removed */
@@ -633,6 +646,7 @@ void DrManagerBase::AddToRunningMap(DrActiveVertexPtr vertex, int version, DrDat
     RTIter rt;
     rt.m_version = version;
     rt.m_iter = i;
+    rt.m_progress = DrNew DrVertexProgress();
     list->Add(rt);
 }
 
@@ -661,10 +675,130 @@ void DrManagerBase::RemoveFromRunningMap(DrActiveVertexPtr vertex, int version)
     }
 }
 
+void DrManagerBase::ReleaseSpeculativeDuplicate(DrActiveVertexPtr vertex)
+{
+    if (m_speculatedVertices->Remove(vertex))
+    {
+        m_graph->ReleaseSpeculativeDuplicate();
+    }
+}
+
+void DrManagerBase::CheckForProgressOutliers()
+{
+    DrGraphParametersPtr params = m_graph->GetParameters();
+
+    if (params->m_progressOutlierFactor <= 0.0 || m_runningTimeMap->GetSize() == 0)
+    {
+        return;
+    }
+
+    /* gather the projections of all running versions that have
+       reported some progress, and find out which vertex each belongs
+       to */
+    int numberOfRunning = m_runningTimeMap->GetSize();
+    DrUINT64ArrayRef projection = DrNew DrUINT64Array(numberOfRunning);
+    DrActiveVertexListRef candidateVertex = DrNew DrActiveVertexList();
+    DrIntArrayListRef candidateVersion = DrNew DrIntArrayList();
+    DrUINT64ArrayRef candidateRunningTime = DrNew DrUINT64Array(numberOfRunning);
+    int numberOfProjections = 0;
+
+    RunningMap::DrEnumerator e = m_runningMap->GetDrEnumerator();
+    while (e.MoveNext())
+    {
+        RTIterListRef list = e.GetValue();
+        int i;
+        for (i=0; i<list->Size(); ++i)
+        {
+            DrTimeInterval projected = list[i].m_progress->m_projectedRunningTime;
+            if (projected == DrTimeInterval_Infinite)
+            {
+                continue;
+            }
+
+            projection[numberOfProjections] = (UINT64) projected;
+            ++numberOfProjections;
+
+            /* a vertex with more than one version running is already
+               being duplicated */
+            if (list->Size() == 1)
+            {
+                candidateRunningTime[candidateVertex->Size()] = list[i].m_iter->first;
+                candidateVertex->Add(list[i].m_iter->second.m_vertex);
+                candidateVersion->Add(list[i].m_version);
+            }
+        }
+    }
+
+    DrTimeInterval median;
+    DrTimeInterval threshold = m_stageStatistics->GetProgressOutlierThreshold(params, projection,
+                                                                               numberOfProjections, median);
+    if (threshold == DrTimeInterval_Infinite)
+    {
+        return;
+    }
+
+    DrDateTime now = m_graph->GetCluster()->GetCurrentTimeStamp();
+
+    int i;
+    for (i=0; i<candidateVertex->Size(); ++i)
+    {
+        DrActiveVertexPtr v = candidateVertex[i];
+        int version = candidateVersion[i];
+
+        RTIterListRef list;
+        if (m_runningMap->TryGetValue(v, list) == false ||
+            list->Size() != 1 || list[0].m_version != version)
+        {
+            continue;
+        }
+
+        DrTimeInterval elapsed = (DrTimeInterval) (now - candidateRunningTime[i]);
+        DrTimeInterval projected = list[0].m_progress->m_projectedRunningTime;
+
+        /* only duplicate if the version is an outlier, has been
+           running for long enough to be sure, and a fresh copy taking
+           the median time could be expected to finish first */
+        if (projected <= threshold ||
+            elapsed < params->m_minOutlierThreshold ||
+            projected - elapsed <= median)
+        {
+            continue;
+        }
+
+        /* a vertex that has already been duplicated holds its share
+           of the budget until it completes, even if only one version
+           is left running, so don't duplicate it again */
+        if (m_speculatedVertices->Contains(v))
+        {
+            continue;
+        }
+
+        if (m_graph->AcquireSpeculativeDuplicate() == false)
+        {
+            return;
+        }
+
+        DrLogI("Duplicating progress outlier Stage %s vertex %d.%d (%s) running for %lf projected %lf "
+               "threshold %lf median %lf",
+               GetStageName().GetChars(), v->GetId(), version, v->GetName().GetChars(),
+               (double) elapsed / (double) DrTimeInterval_Second,
+               (double) projected / (double) DrTimeInterval_Second,
+               (double) threshold / (double) DrTimeInterval_Second,
+               (double) median / (double) DrTimeInterval_Second);
+
+        m_speculatedVertices->Add(v);
+        v->RequestDuplicate(version+1);
+
+        RemoveFromRunningMap(v, version);
+    }
+}
+
 void DrManagerBase::CheckForDuplicates()
 {
     CheckForDuplicatesDerived();
 
+    CheckForProgressOutliers();
+
     DrTimeInterval threshold = m_stageStatistics->GetOutlierThreshold(m_graph->GetParameters());
 
     if (threshold == DrTimeInterval_Infinite || m_runningTimeMap->GetSize() == 0)
@@ -736,10 +870,67 @@ void DrManagerBase::NotifyVertexRunningDerived(DrActiveVertexPtr /* unused verte
 {
 }
 
-void DrManagerBase::NotifyVertexStatus(DrActiveVertexPtr /* unused vertex */,
-                                       HRESULT /* unused completionStatus */,
-                                       DrVertexProcessStatusPtr /* unused status */)
+void DrManagerBase::NotifyVertexStatus(DrActiveVertexPtr vertex,
+                                       HRESULT completionStatus,
+                                       DrVertexProcessStatusPtr status)
 {
+    if (completionStatus != DrError_VertexRunning)
+    {
+        return;
+    }
+
+    RTIterListRef list;
+    if (m_runningMap->TryGetValue(vertex, list) == false)
+    {
+        return;
+    }
+
+    int version = status->GetVertexInstanceVersion();
+    int i;
+    for (i=0; i<list->Size(); ++i)
+    {
+        if (list[i].m_version == version)
+        {
+            break;
+        }
+    }
+    if (i == list->Size())
+    {
+        return;
+    }
+
+    /* the fraction of the vertex's input consumed so far, counting
+       only channels whose total length is known */
+    UINT64 totalLength = 0;
+    UINT64 processedLength = 0;
+    DrInputChannelArrayRef inputs = status->GetInputChannels();
+    int j;
+    for (j=0; j<inputs->Allocated(); ++j)
+    {
+        DrChannelDescriptionPtr c = inputs[j];
+        UINT64 channelLength = c->GetChannelTotalLength();
+        if (channelLength > 0)
+        {
+            UINT64 channelProcessed = c->GetChannelProcessedLength();
+            totalLength += channelLength;
+            processedLength += (channelProcessed < channelLength) ? channelProcessed : channelLength;
+        }
+    }
+
+    if (totalLength == 0 || processedLength == 0)
+    {
+        return;
+    }
+
+    DrDateTime now = m_graph->GetCluster()->GetCurrentTimeStamp();
+    DrDateTime runningTime = list[i].m_iter->first;
+    if (now <= runningTime)
+    {
+        return;
+    }
+
+    double fraction = (double) processedLength / (double) totalLength;
+    list[i].m_progress->m_projectedRunningTime = (DrTimeInterval) ((double) (now - runningTime) / fraction);
 }
 
 void DrManagerBase::NotifyVertexCompleted(DrActiveVertexPtr vertex, int executionVersion,
@@ -753,10 +944,12 @@ void DrManagerBase::NotifyVertexCompleted(DrActiveVertexPtr vertex, int executio
     }
 
     RemoveFromRunningMap(vertex, executionVersion);
+    ReleaseSpeculativeDuplicate(vertex);
 
     /* machine is DrNull if this is a dummy vertex continuing after
-       failure */
-    if (machine != DrNull)
+       failure, and the vertex never ran if its outputs came from the
+       stage output cache; neither says how long the stage's vertices take */
+    if (machine != DrNull && statistics->m_runningTime != DrDateTime_Never)
     {
         m_stageStatistics->AddMeasurement(m_graph->GetParameters(), machine, statistics);
     }
@@ -826,6 +1019,11 @@ void DrManagerBase::NotifyVertexFailedDerived(DrActiveVertexPtr /* unused vertex
 {
 }
 
+void DrManagerBase::NotifyVertexHostClaim(bool reused, DrTimeInterval startupTimeSaved)
+{
+    m_stageStatistics->AddVertexHostClaim(reused, startupTimeSaved);
+}
+
 /* this is a virtual method and the default does nothing */
 void DrManagerBase::NotifyLastVertexCompletedDerived()
 {
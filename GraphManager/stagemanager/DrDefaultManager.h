@@ -81,6 +81,19 @@ typedef DrMultiMap<DrDateTime, VertexAndVersion> RunningTimeMap;
 DRREF(RunningTimeMap);
 
 
+DRBASECLASS(DrVertexProgress)
+{
+public:
+    DrVertexProgress();
+
+    /* the running time this version is projected to need, based on
+       the fraction of its input that it had read at its last status
+       update, or DrTimeInterval_Infinite if it hasn't reported any
+       progress yet */
+    DrTimeInterval        m_projectedRunningTime;
+};
+DRREF(DrVertexProgress);
+
 DRDECLAREVALUECLASS(RTIter);
 DRRREF(RTIter);
 DRVALUECLASS(RTIter)
@@ -90,6 +103,7 @@ DRVALUECLASS(RTIter)
 
         int                   m_version;
         RunningTimeMap::Iter  m_iter;
+        DrVertexProgressRef   m_progress;
 };
 DRMAKEARRAYLIST(RTIter);
 typedef DrDictionary<DrVertexRef, RTIterListRef> RunningMap;
@@ -244,7 +258,10 @@ public:
        GetVertexMetaData()) and information about all of its input and
        output channels.
 
-       The default implementation does nothing.
+       The base implementation uses the input channel progress to
+       project the vertex's running time, which CheckForDuplicates
+       uses to duplicate outliers before the stage has gathered enough
+       completed measurements to estimate an outlier threshold.
     */
     virtual void NotifyVertexStatus(DrActiveVertexPtr vertex,
                                     HRESULT completionStatus,
@@ -274,6 +291,8 @@ public:
     virtual void CheckForDuplicates() DROVERRIDE DRSEALED;
     virtual void CheckForDuplicatesDerived();
 
+    virtual void NotifyVertexHostClaim(bool reused, DrTimeInterval startupTimeSaved) DROVERRIDE DRSEALED;
+
     virtual void NotifyLastVertexCompletedDerived();
     virtual void NotifyUpstreamVertexCompletedDerived(DrActiveVertexPtr upstreamVertex,
                                                       int upstreamVertexOutputPort,
@@ -352,6 +371,8 @@ private:
 
     void AddToRunningMap(DrActiveVertexPtr vertex, int version, DrDateTime runningTime);
     void RemoveFromRunningMap(DrActiveVertexPtr vertex, int version);
+    void CheckForProgressOutliers();
+    void ReleaseSpeculativeDuplicate(DrActiveVertexPtr vertex);
     HolderPtr AddDynamicConnectionManagerInternal(DrManagerBasePtr upstreamStage,
                                                   DrConnectionManagerPtr connector);
 
@@ -371,5 +392,10 @@ private:
     DrStageSetRef                m_downStreamStages;
     RunningMapRef                m_runningMap;
     RunningTimeMapRef            m_runningTimeMap;
+
+    /* vertices for which a progress-based duplicate has been
+       requested and which are holding a unit of the graph's
+       speculative duplicate budget until they complete */
+    DrActiveVertexSetRef         m_speculatedVertices;
 };
 DRREF(DrManagerBase);
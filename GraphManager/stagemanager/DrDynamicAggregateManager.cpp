@@ -498,8 +498,12 @@ void DrDamPartiallyGroupedLayer::
 //
 // When nothing left, it destorys a group and returns DrNull, otherwise it
 // returns a pointer to a group with unprocessed input vertices.
+//
+// The minimum amount of data that justifies a group comes from the
+// parent's planner, so it depends on the grouping level.
 
 DrDamVertexGroupPtr DrDamPartiallyGroupedLayer::SendMinimum(DrDamVertexGroupPtr group,
+                                                            DrDamGroupingLevel level,
                                                             int minVertices, int maxVertices)
 {
     // If source group is DrNull, return it as is -- nothing to do
@@ -511,12 +515,13 @@ DrDamVertexGroupPtr DrDamPartiallyGroupedLayer::SendMinimum(DrDamVertexGroupPtr
     int vertexIdx = 0;
     DrDamVertexGroupRef tmp_group = DrNull;
     DrDamCompletedVertexListRef vertex_array = group->GetGroupArray();
+    UINT64 minData = GetParent()->GetPlannedMinDataPerGroup(level);
 
     // Move input vertices from group to tmp_group while it have at least
     // minimum number of vertices OR data size of a vertex is not less than
     // required minimum amount (minimum threshold).
     while (group->GetGroupSize() >= minVertices ||
-           group->GetCombinedOutputSize() >= GetParent()->GetMinDataPerGroup())
+           group->GetCombinedOutputSize() >= minData)
     {
         // Allocate temporary group if not done before
         if (tmp_group == DrNull)
@@ -928,7 +933,7 @@ void DrDamPartiallyGroupedLayer::GatherRemainingMachineGroups()
     {
         if (mm.GetValue() != DrNull)
         {
-            SendMinimum(mm.GetValue(), GetParent()->GetMinPerMachine(), GetParent()->GetMaxPerMachine());
+            SendMinimum(mm.GetValue(), DDGL_Machine, GetParent()->GetMinPerMachine(), GetParent()->GetMaxPerMachine());
         }
     }
 
@@ -953,7 +958,7 @@ void DrDamPartiallyGroupedLayer::GatherRemainingPodGroups()
     GroupMap::DrEnumerator p = m_podGroup->GetDrEnumerator();
     while (p.MoveNext())
     {
-        SendMinimum(p.GetValue(), GetParent()->GetMinPerPod(), GetParent()->GetMaxPerPod());
+        SendMinimum(p.GetValue(), DDGL_Pod, GetParent()->GetMinPerPod(), GetParent()->GetMaxPerPod());
     }
 
     p = m_podGroup->GetDrEnumerator();
@@ -969,7 +974,7 @@ void DrDamPartiallyGroupedLayer::GatherRemainingOverallGroups()
 {
     if (m_overallGroup != DrNull)
     {
-        SendMinimum(m_overallGroup, GetParent()->GetMinOverall(), GetParent()->GetMaxOverall());
+        SendMinimum(m_overallGroup, DDGL_Overall, GetParent()->GetMinOverall(), GetParent()->GetMaxOverall());
         ReturnUnGrouped(m_overallGroup, DDGL_Overall);
         m_overallGroup = DrNull;
     }
@@ -1015,6 +1020,89 @@ void DrDamPartiallyGroupedLayer::MakeInternalGroup(DrDamVertexGroupPtr group,
     vertex->KickStateMachine();
 }
 
+DrDamAggregationPlanner::DrDamAggregationPlanner()
+{
+    SetCostSettings(DrTimeInterval_Second * s_vertexOverheadSeconds,
+                    s_crossPodBytesPerSecond);
+    m_totalInputSize = 0;
+    m_totalOutputSize = 0;
+    m_numberOfMeasurements = 0;
+    m_wasWorthAggregating = true;
+}
+
+void DrDamAggregationPlanner::SetCostSettings(DrTimeInterval vertexOverhead,
+                                              UINT64 crossPodBytesPerSecond)
+{
+    DrAssert(vertexOverhead >= 0);
+    DrAssert(crossPodBytesPerSecond > 0);
+
+    m_vertexOverhead = vertexOverhead;
+    m_crossPodBytesPerSecond = crossPodBytesPerSecond;
+}
+
+void DrDamAggregationPlanner::AddMeasurement(int aggregationLevel,
+                                             UINT64 inputSize, UINT64 outputSize)
+{
+    if (inputSize == 0)
+    {
+        /* an internal vertex that read nothing tells us nothing about
+           the combiner */
+        return;
+    }
+
+    m_totalInputSize += inputSize;
+    m_totalOutputSize += outputSize;
+    ++m_numberOfMeasurements;
+
+    if (!HasEstimate())
+    {
+        return;
+    }
+
+    bool worthAggregating = IsWorthAggregating();
+    if (m_numberOfMeasurements == s_minMeasurements ||
+        worthAggregating != m_wasWorthAggregating)
+    {
+        DrLogI("Aggregation plan after level %d vertex: reduction ratio %.3lf over %d internal vertices, "
+               "break-even group size %I64u bytes, %s",
+               aggregationLevel, GetReductionRatio(), m_numberOfMeasurements,
+               GetBreakEvenDataSize(),
+               (worthAggregating) ? "adding levels as needed" : "not adding further levels");
+    }
+    m_wasWorthAggregating = worthAggregating;
+}
+
+bool DrDamAggregationPlanner::HasEstimate()
+{
+    return (m_numberOfMeasurements >= s_minMeasurements);
+}
+
+double DrDamAggregationPlanner::GetReductionRatio()
+{
+    DrAssert(m_totalInputSize > 0);
+    return (double) m_totalOutputSize / (double) m_totalInputSize;
+}
+
+bool DrDamAggregationPlanner::IsWorthAggregating()
+{
+    return (GetReductionRatio() * 100.0 < (double) s_barelyReducingPercent);
+}
+
+UINT64 DrDamAggregationPlanner::GetBreakEvenDataSize()
+{
+    if (!IsWorthAggregating())
+    {
+        return MAX_UINT64;
+    }
+
+    double overheadSeconds = (double) m_vertexOverhead / (double) DrTimeInterval_Second;
+    double breakEven = overheadSeconds * (double) m_crossPodBytesPerSecond /
+        (1.0 - GetReductionRatio());
+
+    return (UINT64) breakEven;
+}
+
+
 DrDynamicAggregateManager::DrDynamicAggregateManager() : DrConnectionManager(true)
 {
     InitializeEmpty();
@@ -1049,6 +1137,7 @@ void DrDynamicAggregateManager::InitializeEmpty()
     SetGroupingSettings(s_minGroupSize, s_maxGroupSize);
     SetDataGroupingSettings(s_minDataSize, s_maxDataSize,
                             s_maxDataSizeToConsider);
+    m_planner = DrNew DrDamAggregationPlanner();
 
     m_splitAfterGrouping = false;
     m_numberOfSplitCreated = 0;
@@ -1064,6 +1153,7 @@ void DrDynamicAggregateManager::CopySettings(DrDynamicAggregateManagerPtr src,
                                            int nameIndex)
 {
     m_maxAggregationLevel = src->m_maxAggregationLevel;
+    m_plannedMaxAggregationLevel = src->m_maxAggregationLevel;
     m_minPerMachine = src->m_minPerMachine;
     m_maxPerMachine = src->m_maxPerMachine;
     m_minPerPod = src->m_minPerPod;
@@ -1073,6 +1163,9 @@ void DrDynamicAggregateManager::CopySettings(DrDynamicAggregateManagerPtr src,
     m_minDataPerGroup = src->m_minDataPerGroup;
     m_maxDataPerGroup = src->m_maxDataPerGroup;
     m_maxDataToConsiderGrouping = src->m_maxDataToConsiderGrouping;
+    /* share the planner so measurements from every destination's
+       tree inform the others */
+    m_planner = src->m_planner;
 
     if (src->m_internalVertex == DrNull)
     {
@@ -1161,6 +1254,7 @@ void DrDynamicAggregateManager::SetInternalVertex(DrVertexPtr internalVertex)
 void DrDynamicAggregateManager::SetMaxAggregationLevel(int maxAggregation)
 {
     m_maxAggregationLevel = maxAggregation;
+    m_plannedMaxAggregationLevel = maxAggregation;
 }
 
 int DrDynamicAggregateManager::GetMaxAggregationLevel()
@@ -1270,6 +1364,58 @@ UINT64 DrDynamicAggregateManager::GetMaxDataToConsiderGrouping()
     return m_maxDataToConsiderGrouping;
 }
 
+void DrDynamicAggregateManager::SetCostSettings(DrTimeInterval vertexOverhead,
+                                                UINT64 crossPodBytesPerSecond)
+{
+    m_planner->SetCostSettings(vertexOverhead, crossPodBytesPerSecond);
+}
+
+UINT64 DrDynamicAggregateManager::GetPlannedMinDataPerGroup(DrDamGroupingLevel level)
+{
+    /* an overall group reads its inputs across pods anyway, so it
+       saves no cross-pod traffic and only the configured fan-in
+       limits apply */
+    if (level == DDGL_Overall || !m_planner->HasEstimate())
+    {
+        return m_minDataPerGroup;
+    }
+
+    UINT64 breakEven = m_planner->GetBreakEvenDataSize();
+    if (breakEven > m_maxDataPerGroup)
+    {
+        /* no group we are allowed to build is large enough to pay for
+           itself on data alone, so only full groups get sent */
+        return m_maxDataPerGroup;
+    }
+
+    return breakEven;
+}
+
+/* the deepest level at which groups are still formed. Once the planner
+   decides the combiner doesn't reduce enough to pay for more levels
+   this stops growing, but it never drops below the number of layers
+   that exist already: groups pending in the top layer may still be
+   sent, and they have to be allowed one level further up */
+int DrDynamicAggregateManager::PlanMaxAggregationLevel()
+{
+    if (m_internalVertex == DrNull)
+    {
+        return 0;
+    }
+
+    if (!m_planner->HasEstimate() || m_planner->IsWorthAggregating())
+    {
+        m_plannedMaxAggregationLevel = m_maxAggregationLevel;
+    }
+    else if (m_grouping->Size() < m_plannedMaxAggregationLevel)
+    {
+        DrLogI("Limiting aggregation tree depth to %d levels", m_grouping->Size());
+        m_plannedMaxAggregationLevel = m_grouping->Size();
+    }
+
+    return m_plannedMaxAggregationLevel;
+}
+
 void DrDynamicAggregateManager::SetSplitAfterGrouping(bool splitAfterGrouping)
 {
     m_splitAfterGrouping = splitAfterGrouping;
@@ -1297,11 +1443,7 @@ DrVertexRef DrDynamicAggregateManager::AddSplitVertex()
 void DrDynamicAggregateManager::AcceptCompletedGroup(DrDamVertexGroupPtr group,
                                                      int aggregationLevel)
 {
-    int maxAggregationLevel = m_maxAggregationLevel;
-    if (m_internalVertex == DrNull)
-    {
-        maxAggregationLevel = 0;
-    }
+    int maxAggregationLevel = PlanMaxAggregationLevel();
 
     if (aggregationLevel == maxAggregationLevel)
     {
@@ -1415,11 +1557,7 @@ void DrDynamicAggregateManager::AddCompletedVertex(DrDamCompletedVertexPtr verte
 
     DrDamPartiallyGroupedLayerPtr layer = m_grouping[aggLevel];
 
-    int maxAggregationLevel = m_maxAggregationLevel;
-    if (m_internalVertex == DrNull)
-    {
-        maxAggregationLevel = 0;
-    }
+    int maxAggregationLevel = PlanMaxAggregationLevel();
 
     /* if a vertex output is greater than m_maxDataToConsiderGrouping don't
        bother to try to group it. The greedy algorithm we are using is
@@ -1480,6 +1618,15 @@ void DrDynamicAggregateManager::
     m_createdMap->TryGetValue(vertex, aggLevel);
 
     UINT64 outputSize = statistics->m_outputData[outputPort]->m_dataWritten;
+
+    if (aggLevel > 0 && statistics->m_totalInputData != DrNull)
+    {
+        /* one of our internal vertices: its output relative to the
+           groups it read is the reduction ratio the planner uses */
+        m_planner->AddMeasurement(aggLevel, statistics->m_totalInputData->m_dataRead,
+                                  outputSize);
+    }
+
     AddCompletedVertex(DrNew DrDamCompletedVertex(vertex, machine, outputSize, outputPort),
                        aggLevel);
 }
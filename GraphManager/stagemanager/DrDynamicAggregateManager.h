@@ -146,7 +146,8 @@ private:
 
 
     void ConsiderSending(DrDamVertexGroupPtr group, int maxVertices, UINT64 additionalSize);
-    DrDamVertexGroupPtr SendMinimum(DrDamVertexGroupPtr group, int minVertices, int maxVertices);
+    DrDamVertexGroupPtr SendMinimum(DrDamVertexGroupPtr group, DrDamGroupingLevel level,
+                                    int minVertices, int maxVertices);
     void ReturnUnGrouped(DrDamVertexGroupPtr group, DrDamGroupingLevel level);
     static int MachineGroupCmp(MachineGroupR left, MachineGroupR right);
     bool MoveOneVertex(MachineGroupR grpStruct);
@@ -165,6 +166,52 @@ private:
 DRREF(DrDamPartiallyGroupedLayer);
 
 
+/* the planner chooses grouping parameters from the reduction ratio
+   measured on completed internal aggregation vertices. An internal
+   vertex costs a fixed scheduling and startup overhead, and pays for
+   itself through the cross-pod transfer time of the bytes it removes,
+   so a machine or pod group is worth aggregating once its combined
+   output exceeds
+
+       vertexOverhead * crossPodBandwidth / (1 - reductionRatio)
+
+   A combiner that barely reduces its input never pays for itself and
+   no further aggregation levels are worth adding. One planner is
+   shared by all the per-destination managers made from the same base
+   manager, so that they pool their measurements */
+DRBASECLASS(DrDamAggregationPlanner)
+{
+public:
+    DrDamAggregationPlanner();
+
+    static const int    s_minMeasurements = 4;
+    static const int    s_barelyReducingPercent = 90;
+    static const int    s_vertexOverheadSeconds = 5;
+    static const UINT64 s_crossPodBytesPerSecond = 50*1024*1024;
+
+    void SetCostSettings(DrTimeInterval vertexOverhead,
+                         UINT64 crossPodBytesPerSecond);
+
+    void AddMeasurement(int aggregationLevel, UINT64 inputSize, UINT64 outputSize);
+
+    /* false until s_minMeasurements internal vertices have completed */
+    bool HasEstimate();
+    double GetReductionRatio();
+    bool IsWorthAggregating();
+    /* the combined size at which a group pays for its internal
+       vertex, or MAX_UINT64 if no group ever does */
+    UINT64 GetBreakEvenDataSize();
+
+private:
+    DrTimeInterval  m_vertexOverhead;
+    UINT64          m_crossPodBytesPerSecond;
+    UINT64          m_totalInputSize;
+    UINT64          m_totalOutputSize;
+    int             m_numberOfMeasurements;
+    bool            m_wasWorthAggregating;
+};
+DRREF(DrDamAggregationPlanner);
+
 DRCLASS(DrDynamicAggregateManager) : public DrConnectionManager
 {
 public:
@@ -210,6 +257,13 @@ public:
     UINT64 GetMaxDataPerGroup();
     UINT64 GetMaxDataToConsiderGrouping();
 
+    /* the cost settings used by the planner to pick the minimum data
+       per machine or pod group and the depth of the aggregation tree
+       once the reduction ratio of the internal vertices is known */
+    void SetCostSettings(DrTimeInterval vertexOverhead,
+                         UINT64 crossPodBytesPerSecond);
+    UINT64 GetPlannedMinDataPerGroup(DrDamGroupingLevel level);
+
     void SetSplitAfterGrouping(bool splitAfterGrouping);
     bool GetSplitAfterGrouping();
 
@@ -242,9 +296,11 @@ public:
     void ReturnUnGrouped(DrDamCompletedVertexPtr vertex, int aggLevel);
     void AddCompletedVertex(DrDamCompletedVertexPtr vertex, int aggLevel);
     void RegisterCreatedVertex(DrVertexPtr vertex, int aggLevel);
+    int PlanMaxAggregationLevel();
     void CleanUp();
 
     int                             m_maxAggregationLevel;
+    int                             m_plannedMaxAggregationLevel;
     int                             m_minPerMachine;
     int                             m_maxPerMachine;
     int                             m_minPerPod;
@@ -254,6 +310,7 @@ public:
     UINT64                          m_minDataPerGroup;
     UINT64                          m_maxDataPerGroup;
     UINT64                          m_maxDataToConsiderGrouping;
+    DrDamAggregationPlannerRef      m_planner;
     DrVertexRef                     m_internalVertex;
     DrVertexRef                     m_dstVertex;
     bool                            m_splitAfterGrouping;
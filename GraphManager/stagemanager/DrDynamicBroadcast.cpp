@@ -22,11 +22,52 @@ limitations under the License.
 
 #include <math.h>
 
+DrBroadcastPodMachines::DrBroadcastPodMachines()
+{
+    m_machine = DrNew DrResourceList();
+    m_next = 0;
+}
+
+void DrBroadcastPodMachines::Add(DrResourcePtr machine)
+{
+    m_machine->Add(machine);
+}
+
+DrResourcePtr DrBroadcastPodMachines::Next(DrResourcePtr avoid)
+{
+    int tried;
+    for (tried=0; tried<m_machine->Size(); ++tried)
+    {
+        DrResourcePtr machine = m_machine[m_next];
+        m_next = (m_next + 1) % m_machine->Size();
+        if (machine != avoid)
+        {
+            return machine;
+        }
+    }
+
+    return DrNull;
+}
+
+
 DrDynamicBroadcastManager::DrDynamicBroadcastManager(DrActiveVertexPtr copyVertex)
     : DrConnectionManager(false)
 {
     m_copyVertex = copyVertex;
     m_teeNumber = 0;
+    m_nextMachine = 0;
+    m_fanOut = 0;
+}
+
+void DrDynamicBroadcastManager::SetFanOut(int fanOut)
+{
+    DrAssert(fanOut == 0 || fanOut > 1);
+    m_fanOut = fanOut;
+}
+
+int DrDynamicBroadcastManager::GetFanOut()
+{
+    return m_fanOut;
 }
 
 void DrDynamicBroadcastManager::RegisterVertex(DrVertexPtr vertex, bool splitting)
@@ -46,6 +87,7 @@ void DrDynamicBroadcastManager::MaybeMakeRoundRobinPodMachines()
     if (m_roundRobinMachines == DrNull)
     {
         m_roundRobinMachines = DrNew DrResourceList();
+        m_podMachines = DrNew PodMap();
 
         /* we have to look down a long chain to find who's in the cluster, but it's there somewhere... */
         DrUniversePtr universe = m_copyVertex->GetStageManager()->GetGraph()->GetCluster()->GetUniverse();
@@ -60,6 +102,15 @@ void DrDynamicBroadcastManager::MaybeMakeRoundRobinPodMachines()
             for (i=0; i<pods->Size(); ++i)
             {
                 podIndex->Add(0);
+
+                DrBroadcastPodMachinesRef podMachines = DrNew DrBroadcastPodMachines();
+                DrResourceListRef podChildren = pods[i]->GetChildren();
+                int j;
+                for (j=0; j<podChildren->Size(); ++j)
+                {
+                    podMachines->Add(podChildren[j]);
+                }
+                m_podMachines->Add(pods[i], podMachines);
             }
 
             int podsToFinish = pods->Size();
@@ -115,55 +166,130 @@ void DrDynamicBroadcastManager::NotifyUpstreamVertexCompleted(DrActiveVertexPtr
 
     UINT64 dataWritten = statistics->m_outputData[0]->m_dataWritten;
 
-    ExpandTee(sourceTee, dataWritten, machine);
-}
-
-void DrDynamicBroadcastManager::ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataWritten, DrResourcePtr machine)
-{
-    // how many nodes to expand this stage to
     int destinations = sourceTee->GetOutputs()->GetNumberOfEdges();
     if (destinations < s_minConsumers)
     {
         return;
     }
 
-    int copies = (int)(sqrt((double)destinations)); 
-    
     // find the pods lazily
     MaybeMakeRoundRobinPodMachines();
 
-    int machines = m_roundRobinMachines->Size();
-    DrAssert(machines > 0);
-
     // If there is only one machine don't ExpandTee
-    if (machines == 1)
+    if (m_roundRobinMachines->Size() == 1)
     {
         return;
     }
 
-    if (copies > machines)
+    int fanOut = ChooseFanOut(dataWritten);
+
+    DrLogI("Inserting dynamic broadcast tree source: %d consumers: %d fan-out: %d data: %I64u",
+           sourceTee->GetId(), destinations, fanOut, dataWritten);
+
+    /* build the whole tree before starting any of it, so nothing is
+       kicked while its outputs are still being rewired */
+    DrVertexListRef newVertices = DrNew DrVertexList();
+    ExpandTee(sourceTee, dataWritten, machine, fanOut, 1, newVertices);
+
+    /* kick all the copy vertices to start them going */
+    int kick;
+    for (kick=0; kick<newVertices->Size(); ++kick)
+    {
+        newVertices[kick]->InitializeForGraphExecution();
+        newVertices[kick]->KickStateMachine();
+    }
+}
+
+int DrDynamicBroadcastManager::ChooseFanOut(UINT64 dataWritten)
+{
+    if (m_fanOut > 0)
+    {
+        return m_fanOut;
+    }
+
+    /* a tree with fan-out f has log_f(n) levels, and each level costs a copy vertex start-up plus
+       the time for one machine to send out f copies of the data. Pick the f that minimizes
+       (overhead + f * transfer) / ln(f): small broadcasts get a flat tree and large ones a deep,
+       narrow one */
+    double transfer = (double) dataWritten / (double) s_copyBytesPerSecond;
+
+    int bestFanOut = 2;
+    double bestCost = 0.0;
+    int fanOut;
+    for (fanOut=2; fanOut<=s_maxFanOut; ++fanOut)
     {
-        copies = machines;
+        double cost = ((double) s_copyOverheadSeconds + (double) fanOut * transfer) / log((double) fanOut);
+        if (fanOut == 2 || cost < bestCost)
+        {
+            bestFanOut = fanOut;
+            bestCost = cost;
+        }
     }
 
-    int currentMachine;
-    for (currentMachine=0; currentMachine<machines; ++currentMachine)
+    return bestFanOut;
+}
+
+DrResourcePtr DrDynamicBroadcastManager::PickMachine(DrResourcePtr parentMachine, bool samePod)
+{
+    if (samePod)
     {
-        if (m_roundRobinMachines[currentMachine] == machine)
+        DrBroadcastPodMachinesRef podMachines;
+        if (parentMachine->GetParent() != DrNull &&
+            m_podMachines->TryGetValue(parentMachine->GetParent(), podMachines))
         {
-            /* this is the machine the upstream vertex just ran on */
-            break;
+            DrResourcePtr machine = podMachines->Next(parentMachine);
+            if (machine != DrNull)
+            {
+                return machine;
+            }
         }
+
+        /* the pod has no other machine, so go outside it */
+    }
+
+    /* consecutive entries in the round-robin list are in different pods */
+    int machines = m_roundRobinMachines->Size();
+    DrResourcePtr machine = m_roundRobinMachines[m_nextMachine];
+    m_nextMachine = (m_nextMachine + 1) % machines;
+    if (machine == parentMachine)
+    {
+        machine = m_roundRobinMachines[m_nextMachine];
+        m_nextMachine = (m_nextMachine + 1) % machines;
+    }
+
+    return machine;
+}
+
+/* split the outputs of sourceTee, whose data is on machine, across fanOut new tees and recurse
+   into each of them. breadth is the number of tees at sourceTee's level of the tree */
+void DrDynamicBroadcastManager::ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataWritten, DrResourcePtr machine,
+                                          int fanOut, int breadth, DrVertexListPtr newVertices)
+{
+    int destinations = sourceTee->GetOutputs()->GetNumberOfEdges();
+    if (destinations <= fanOut)
+    {
+        return;
+    }
+
+    /* use no more copies than it takes for each subtree to reach its share of the destinations
+       in the levels below, so the tree is as shallow as the fan-out allows */
+    int subtreeCapacity = 1;
+    while (subtreeCapacity * fanOut < destinations)
+    {
+        subtreeCapacity *= fanOut;
     }
-    DrAssert(currentMachine < machines);
+    int copies = (destinations + subtreeCapacity - 1) / subtreeCapacity;
+    DrAssert(copies > 1 && copies <= fanOut);
 
-    DrLogI("Inserting dynamic broadcast tree source: %d size: %d\n", sourceTee->GetId(), copies);
+    /* spread copies across pods until the level reaches every pod, then keep each subtree
+       inside its parent's pod so the data crosses into a pod only once */
+    bool samePod = (breadth >= m_podMachines->GetSize());
 
     int edgesPerNode = destinations / copies;
     int nodesWithExtraDestination = destinations % copies;
 
-    DrTeeVertexRef newTee;
-    DrVertexListRef newVertices = DrNew DrVertexList();
+    DrVertexListRef subtreeTee = DrNew DrVertexList();
+    DrResourceListRef subtreeMachine = DrNew DrResourceList();
 
     int currentDestination = 0;
     int copy;
@@ -184,7 +310,7 @@ void DrDynamicBroadcastManager::ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataW
         {
             /* the first 'copy' is just another tee without a copier, since the data is already on this machine */
             downstream = tee;
-            newTee = tee;
+            subtreeMachine->Add(machine);
         }
         else
         {
@@ -198,15 +324,18 @@ void DrDynamicBroadcastManager::ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataW
             newVertex->GetOutputs()->SetNumberOfEdges(1);
 
             /* make it prefer the new machine more than the one where the data lives */
-            newVertex->GetAffinity()->AddLocality(m_roundRobinMachines[currentMachine]);
+            DrResourcePtr copyMachine = PickMachine(machine, samePod);
+            newVertex->GetAffinity()->AddLocality(copyMachine);
             newVertex->GetAffinity()->SetWeight(10 * dataWritten);
 
             newVertex->ConnectOutput(0, tee, 0, DCT_File);
 
             downstream = newVertex;
+            subtreeMachine->Add(copyMachine);
         }
 
         newVertices->Add(downstream);
+        subtreeTee->Add(tee);
 
         int i;
         for (i=0; i<edges; ++i, ++currentDestination)
@@ -228,15 +357,12 @@ void DrDynamicBroadcastManager::ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataW
 
     sourceTee->GetOutputs()->Compact(DrNull);
 
-    /* kick all the copy vertices to start them going */
-    int kick;
-    for (kick=0; kick<newVertices->Size(); ++kick)
+    /* now recurse down into every new tee. Since there are a logarithmic number of levels,
+       I'm not worried about exhausting the stack unless somebody builds a *really* big cluster */
+    for (copy=0; copy<copies; ++copy)
     {
-        newVertices[kick]->InitializeForGraphExecution();
-        newVertices[kick]->KickStateMachine();
+        DrTeeVertexPtr tee = dynamic_cast<DrTeeVertexPtr>((DrVertexPtr) subtreeTee[copy]);
+        ExpandTee(tee, dataWritten, subtreeMachine[copy], fanOut, breadth * copies,
+                  newVertices);
     }
-
-    /* now recurse down with the new tee we just created. Since there are a logarithmic number of levels,
-       I'm not worried about exhausting the stack unless somebody builds a *really* big cluster */
-    ExpandTee(newTee, dataWritten, machine);
 }
@@ -20,6 +20,25 @@ limitations under the License.
 
 #pragma once
 
+/* the machines of one pod, handed out in turn to copy vertices that stay
+   inside the pod */
+DRBASECLASS(DrBroadcastPodMachines)
+{
+public:
+    DrBroadcastPodMachines();
+
+    void Add(DrResourcePtr machine);
+
+    /* the next machine in the pod other than avoid, or DrNull if there
+       isn't one */
+    DrResourcePtr Next(DrResourcePtr avoid);
+
+private:
+    DrResourceListRef  m_machine;
+    int                m_next;
+};
+DRREF(DrBroadcastPodMachines);
+
 DRCLASS(DrDynamicBroadcastManager) : public DrConnectionManager
 {
     /*
@@ -33,16 +52,26 @@ DRCLASS(DrDynamicBroadcastManager) : public DrConnectionManager
 
       (S >= T)^k >=^k (C^n)
 
-      it builds something like:
+      it builds a tree in which every tee feeds at most f outputs:
 
-      (S >= T >= (copy >= T)^(sqrt(n)))^k >=^k (C ^ n)
+      (S >= T >= (copy >= T >= (copy >= T ...)^f)^f)^k >=^k (C ^ n)
 
-      Where the operator >=^k is >= applied k times.
+      so there are about log_f(n) levels of copies. The first output
+      of each tee is another tee without a copier, since its data is
+      already on that machine. Copies are spread across pods until
+      every pod has one, and below that they stay in their parent's
+      pod. The fan-out f is fixed by SetFanOut, or chosen from the
+      data size when the source completes.
     */
 
 public:
     DrDynamicBroadcastManager(DrActiveVertexPtr copyVertex);
 
+    /* the maximum number of outputs of each tee in the tree. Zero
+       (the default) sizes it from the amount of data broadcast */
+    void SetFanOut(int fanOut);
+    int GetFanOut();
+
     virtual void NotifyUpstreamVertexCompleted(DrActiveVertexPtr vertex, int outputPort,
                                                int executionVersion,
                                                DrResourcePtr machine,
@@ -50,13 +79,25 @@ public:
     virtual void RegisterVertex(DrVertexPtr vertex, bool splitting) DROVERRIDE;
 
 private:
+    typedef DrDictionary<DrResourceRef, DrBroadcastPodMachinesRef> PodMap;
+    DRREF(PodMap);
+
     void MaybeMakeRoundRobinPodMachines();
-    void ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataWritten, DrResourcePtr machine);
+    int ChooseFanOut(UINT64 dataWritten);
+    DrResourcePtr PickMachine(DrResourcePtr parentMachine, bool samePod);
+    void ExpandTee(DrTeeVertexPtr sourceTee, UINT64 dataWritten, DrResourcePtr machine,
+                   int fanOut, int breadth, DrVertexListPtr newVertices);
 
     DrTeeVertexRef                    m_baseTee;
     DrActiveVertexRef                 m_copyVertex;     // inserted as a layer
     DrResourceListRef                 m_roundRobinMachines; // machines ordered to repeat pods as rarely as possible
+    PodMapRef                         m_podMachines;    // the machines of each pod
+    int                               m_nextMachine;    // next entry of m_roundRobinMachines to place a copy on
     int                               m_teeNumber;       // used to renumber the copies
+    int                               m_fanOut;          // zero to size from the data
     static const int                  s_minConsumers = 5; // do not create broadcast copies if there are fewer than this many consumers
+    static const int                  s_maxFanOut = 64;
+    static const int                  s_copyOverheadSeconds = 5;   // start-up cost of one copy vertex
+    static const UINT64               s_copyBytesPerSecond = 50*1024*1024; // rate one machine sends a copy at
 };
 DRREF(DrDynamicBroadcastManager);
\ No newline at end of file
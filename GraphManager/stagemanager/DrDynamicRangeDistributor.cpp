@@ -20,6 +20,56 @@ limitations under the License.
 
 #include <DrStageHeaders.h>
 
+DrDynamicRangeBucketMonitor::DrDynamicRangeBucketMonitor(DrStageStatisticsPtr statistics,
+                                                         int numberOfBuckets,
+                                                         UINT64 estimatedBucketSize)
+    : DrConnectionManager(false)
+{
+    m_statistics = statistics;
+    m_estimatedBucketSize = estimatedBucketSize;
+
+    m_bucketSize = DrNew DrUINT64Array(numberOfBuckets);
+    int i;
+    for (i=0; i<numberOfBuckets; ++i)
+    {
+        m_bucketSize[i] = 0;
+    }
+
+    m_countedDistributor = DrNew DrActiveVertexSet();
+}
+
+void DrDynamicRangeBucketMonitor::NotifyUpstreamVertexCompleted(DrActiveVertexPtr vertex,
+                                                                int outputPort,
+                                                                int /* unused executionVersion */,
+                                                                DrResourcePtr /* unused machine */,
+                                                                DrVertexExecutionStatisticsPtr statistics)
+{
+    if (outputPort == 0)
+    {
+        if (m_countedDistributor->Contains(vertex))
+        {
+            m_countingDistributor = DrNull;
+        }
+        else
+        {
+            m_countedDistributor->Add(vertex);
+            m_countingDistributor = vertex;
+        }
+    }
+
+    if (vertex != m_countingDistributor || outputPort >= m_bucketSize->Allocated())
+    {
+        return;
+    }
+
+    m_bucketSize[outputPort] += statistics->m_outputData[outputPort]->m_dataWritten;
+}
+
+void DrDynamicRangeBucketMonitor::NotifyUpstreamLastVertexCompleted(DrManagerBasePtr /* unused upstreamStage */)
+{
+    m_statistics->SetRangeBucketSizes(m_bucketSize, m_estimatedBucketSize);
+}
+
 DrDynamicRangeDistributionManager::DrDynamicRangeDistributionManager(DrStageManagerPtr dataConsumer,
                                                                      double samplingRate)
     : DrConnectionManager(false)
@@ -68,6 +118,8 @@ void DrDynamicRangeDistributionManager::NotifyUpstreamLastVertexCompleted(DrMana
 
     DrLogI("Resizing stage for dynamic range distribution, new size: %d\n", copies);
 
+    DrVertexRef distributorVertex;
+
     if (copies > 1)
     {
         DrVertexListRef consumers = m_dataConsumer->GetVertexVector();
@@ -118,6 +170,24 @@ void DrDynamicRangeDistributionManager::NotifyUpstreamLastVertexCompleted(DrMana
         DrAssert(dataConsumerVertex->GetOutputs()->GetNumberOfEdges() == 0);
 
         dataConsumerVertex->RemoveFromGraphExecution();
+
+        if (distributors->Size() > 0)
+        {
+            distributorVertex = distributors[0];
+        }
+    }
+
+    if (distributorVertex != DrNull)
+    {
+        /* watch the distributors' output so the resulting bucket sizes
+           get recorded in the consumer stage's statistics. The
+           estimate is what an even split of the sampled data would
+           give each bucket. */
+        UINT64 estimatedBucketSize = (UINT64) ((double) m_combinedOutputSize / m_samplingRate) / copies;
+        DrManagerBasePtr consumer = dynamic_cast<DrManagerBasePtr>(m_dataConsumer);
+        DrDynamicRangeBucketMonitorRef monitor =
+            DrNew DrDynamicRangeBucketMonitor(consumer->GetStageStatistics(), copies, estimatedBucketSize);
+        m_dataConsumer->AddDynamicConnectionManagerAtRuntime(distributorVertex->GetStageManager(), monitor);
     }
 
     DrString arg;
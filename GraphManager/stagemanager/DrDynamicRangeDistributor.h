@@ -20,6 +20,38 @@ limitations under the License.
 
 #pragma once
 
+/* this is attached by DrDynamicRangeDistributionManager to the
+   consumer stage M once it has been expanded, watching the
+   distributor stage D. It adds up the data each distributor writes to
+   each output port, i.e. to each range bucket, and reports the bucket
+   sizes when the last distributor completes so skew in the chosen
+   boundaries shows up in the job log. */
+DRCLASS(DrDynamicRangeBucketMonitor) : public DrConnectionManager
+{
+public:
+    DrDynamicRangeBucketMonitor(DrStageStatisticsPtr statistics, int numberOfBuckets,
+                                UINT64 estimatedBucketSize);
+
+    virtual void NotifyUpstreamVertexCompleted(DrActiveVertexPtr vertex, int outputPort,
+                                               int executionVersion,
+                                               DrResourcePtr machine,
+                                               DrVertexExecutionStatisticsPtr statistics) DROVERRIDE;
+    virtual void NotifyUpstreamLastVertexCompleted(DrManagerBasePtr upstreamStage) DROVERRIDE;
+
+private:
+    DrStageStatisticsRef              m_statistics;
+    UINT64                            m_estimatedBucketSize;
+    DrUINT64ArrayRef                  m_bucketSize;
+
+    /* a distributor's outputs are all reported one after another when
+       it completes; only the first completion of each distributor is
+       counted, so duplicates and re-executions don't inflate the
+       sizes */
+    DrActiveVertexSetRef              m_countedDistributor;
+    DrActiveVertexRef                 m_countingDistributor;
+};
+DRREF(DrDynamicRangeBucketMonitor);
+
 DRCLASS(DrDynamicRangeDistributionManager) : public DrConnectionManager
 {
     /*
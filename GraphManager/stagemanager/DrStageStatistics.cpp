@@ -26,6 +26,8 @@ static const double s_outlierThresholdInSigmas = 3.0;
 static const int s_numberOfTrials = 10;
 static const double s_conditionThreshold = 10000.0;
 
+static const int s_minimumProgressSamples = 4;
+
 static const int s_firstEstimationPercentage = 50;
 static const int s_reEstimationPercentage = 5;
 
@@ -52,6 +54,23 @@ DrStageStatistics::DrStageStatistics()
     m_relativeStdDev = 1.0;
     m_numberOfOutliers = 0;
 
+    m_numberOfTempReaders = 0;
+    m_numberOfMachineLocal = 0;
+    m_numberOfPodLocal = 0;
+    m_tempDataRead = 0;
+    m_tempDataReadCrossMachine = 0;
+    m_tempDataReadCrossPod = 0;
+
+    m_vertexHostHits = 0;
+    m_vertexHostMisses = 0;
+    m_vertexHostStartupSaved = 0;
+
+    m_estimatedRangeBucketSize = 0;
+    m_rangeBucketTotal = 0;
+    m_largestRangeBucket = 0;
+    m_largestRangeBucketIndex = 0;
+    m_emptyRangeBuckets = 0;
+
     m_gotEstimate = false;
     m_nonParametricOutlierEstimate = DrTimeInterval_Infinite;
     m_reportedFinalStatistics = false;
@@ -156,6 +175,8 @@ void DrStageStatistics::AddMeasurement(DrGraphParametersPtr params, DrResourcePt
 
     m_measurement->Add(m);
 
+    AddLocalityMeasurement(statistics);
+
     int nextReEstimation = (m_sampleSize * m_nextReEstimationPercentage) / 100;
     if (nextReEstimation < 2)
     {
@@ -181,6 +202,14 @@ void DrStageStatistics::AddMeasurement(DrGraphParametersPtr params, DrResourcePt
                (double) tiStdDev / (double) DrTimeInterval_Second,
                m_relativeStdDev, m_numberOfOutliers);
 
+        if (m_numberOfTempReaders > 0)
+        {
+            DrLogI("Stage locality Stage=%s machine-local=%lf pod-local=%lf of %d executions reading temp data",
+                   m_name.GetChars(),
+                   GetLocalityHitRate(DRL_Computer), GetLocalityHitRate(DRL_Rack),
+                   m_numberOfTempReaders);
+        }
+
         ComputeNextEstimationThreshold();
     }
     else
@@ -189,6 +218,156 @@ void DrStageStatistics::AddMeasurement(DrGraphParametersPtr params, DrResourcePt
     }
 }
 
+void DrStageStatistics::AddLocalityMeasurement(DrVertexExecutionStatisticsPtr statistics)
+{
+    DrInputChannelExecutionStatisticsPtr input = statistics->m_totalInputData;
+
+    m_tempDataRead += input->m_tempDataRead;
+    m_tempDataReadCrossMachine += input->m_tempDataReadCrossMachine;
+    m_tempDataReadCrossPod += input->m_tempDataReadCrossPod;
+
+    if (input->m_tempDataRead + input->m_tempDataReadCrossMachine + input->m_tempDataReadCrossPod == 0)
+    {
+        /* this execution read only stable storage inputs, so its
+           placement says nothing about the scheduler */
+        return;
+    }
+
+    ++m_numberOfTempReaders;
+    if (input->m_tempDataReadCrossPod == 0)
+    {
+        ++m_numberOfPodLocal;
+        if (input->m_tempDataReadCrossMachine == 0)
+        {
+            ++m_numberOfMachineLocal;
+        }
+    }
+}
+
+double DrStageStatistics::GetLocalityHitRate(DrResourceLevel level)
+{
+    if (m_numberOfTempReaders == 0)
+    {
+        return -1.0;
+    }
+
+    int hits;
+    if (level == DRL_Core || level == DRL_Socket || level == DRL_Computer)
+    {
+        hits = m_numberOfMachineLocal;
+    }
+    else if (level == DRL_Rack)
+    {
+        hits = m_numberOfPodLocal;
+    }
+    else
+    {
+        hits = m_numberOfTempReaders;
+    }
+
+    return (double) hits / (double) m_numberOfTempReaders;
+}
+
+void DrStageStatistics::ReportLocality(FILE* f)
+{
+    if (m_numberOfTempReaders == 0)
+    {
+        return;
+    }
+
+    fprintf(f, "Locality for stage %s: %d executions read temp data\n"
+            "machine-local=%lf pod-local=%lf\n"
+            "temp bytes local=%I64u cross-machine=%I64u cross-pod=%I64u\n\n",
+            m_name.GetChars(), m_numberOfTempReaders,
+            GetLocalityHitRate(DRL_Computer), GetLocalityHitRate(DRL_Rack),
+            m_tempDataRead, m_tempDataReadCrossMachine, m_tempDataReadCrossPod);
+}
+
+void DrStageStatistics::AddVertexHostClaim(bool reused, DrTimeInterval startupTimeSaved)
+{
+    if (reused)
+    {
+        ++m_vertexHostHits;
+        m_vertexHostStartupSaved += startupTimeSaved;
+    }
+    else
+    {
+        ++m_vertexHostMisses;
+    }
+
+    DrLogI("Stage vertex host reuse Stage=%s hits=%d misses=%d startup saved=%lf",
+           m_name.GetChars(), m_vertexHostHits, m_vertexHostMisses,
+           (double) m_vertexHostStartupSaved / (double) DrTimeInterval_Second);
+}
+
+void DrStageStatistics::ReportVertexHostReuse(FILE* f)
+{
+    if (m_vertexHostHits + m_vertexHostMisses == 0)
+    {
+        return;
+    }
+
+    fprintf(f, "Vertex host reuse for stage %s: %d reused hosts, %d new hosts\n"
+            "hit rate=%lf startup saved=%lf\n\n",
+            m_name.GetChars(), m_vertexHostHits, m_vertexHostMisses,
+            (double) m_vertexHostHits / (double) (m_vertexHostHits + m_vertexHostMisses),
+            (double) m_vertexHostStartupSaved / (double) DrTimeInterval_Second);
+}
+
+void DrStageStatistics::SetRangeBucketSizes(DrUINT64ArrayPtr bucketSize, UINT64 estimatedBucketSize)
+{
+    m_rangeBucketSize = bucketSize;
+    m_estimatedRangeBucketSize = estimatedBucketSize;
+    m_rangeBucketTotal = 0;
+    m_largestRangeBucket = 0;
+    m_largestRangeBucketIndex = 0;
+    m_emptyRangeBuckets = 0;
+
+    int numberOfBuckets = m_rangeBucketSize->Allocated();
+    int i;
+    for (i=0; i<numberOfBuckets; ++i)
+    {
+        DrLogI("Range bucket size Stage %s bucket %d of %d: %I64u bytes (estimated %I64u)",
+               m_name.GetChars(), i, numberOfBuckets, m_rangeBucketSize[i], m_estimatedRangeBucketSize);
+
+        m_rangeBucketTotal += m_rangeBucketSize[i];
+        if (m_rangeBucketSize[i] > m_largestRangeBucket)
+        {
+            m_largestRangeBucket = m_rangeBucketSize[i];
+            m_largestRangeBucketIndex = i;
+        }
+        if (m_rangeBucketSize[i] == 0)
+        {
+            ++m_emptyRangeBuckets;
+        }
+    }
+
+    UINT64 mean = (numberOfBuckets > 0) ? (m_rangeBucketTotal / numberOfBuckets) : 0;
+
+    DrLogI("Range distribution Stage %s: %d buckets total %I64u bytes mean %I64u largest %I64u (bucket %d) "
+           "largest/mean %lf empty %d",
+           m_name.GetChars(), numberOfBuckets, m_rangeBucketTotal, mean,
+           m_largestRangeBucket, m_largestRangeBucketIndex,
+           (mean > 0) ? ((double) m_largestRangeBucket / (double) mean) : 0.0, m_emptyRangeBuckets);
+}
+
+void DrStageStatistics::ReportRangeBuckets(FILE* f)
+{
+    if (m_rangeBucketSize == DrNull || m_rangeBucketSize->Allocated() == 0)
+    {
+        return;
+    }
+
+    int numberOfBuckets = m_rangeBucketSize->Allocated();
+    UINT64 mean = m_rangeBucketTotal / numberOfBuckets;
+
+    fprintf(f, "Range buckets for stage %s: %d buckets total %I64u bytes\n"
+            "mean=%I64u estimated=%I64u largest=%I64u (bucket %d) largest/mean=%lf empty=%d\n\n",
+            m_name.GetChars(), numberOfBuckets, m_rangeBucketTotal,
+            mean, m_estimatedRangeBucketSize, m_largestRangeBucket, m_largestRangeBucketIndex,
+            (mean > 0) ? ((double) m_largestRangeBucket / (double) mean) : 0.0, m_emptyRangeBuckets);
+}
+
 DRCLASS(DrSignedDeviationComparer) : public DrComparer<DrStageStatistics::MeasurementRef>
 {
 public:
@@ -248,6 +427,51 @@ void DrStageStatistics::SortElapsed()
     m_measurement->Sort(comparer);
 }
 
+DrTimeInterval DrStageStatistics::GetProgressOutlierThreshold(DrGraphParametersPtr params,
+                                                              DrUINT64ArrayPtr projectedRunningTime,
+                                                              int numberOfProjections,
+                                                              DrTimeInterval& pMedian /* OUT */)
+{
+    pMedian = DrTimeInterval_Infinite;
+
+    if (params->m_progressOutlierFactor <= 0.0 ||
+        m_measurement->Size() + numberOfProjections < s_minimumProgressSamples)
+    {
+        return DrTimeInterval_Infinite;
+    }
+
+    /* make a scratch list so the order of m_measurement, which the
+       model estimation depends on, isn't disturbed */
+    MeasurementListRef sample = DrNew MeasurementList();
+
+    int i;
+    for (i=0; i<m_measurement->Size(); ++i)
+    {
+        sample->Add(m_measurement[i]);
+    }
+    for (i=0; i<numberOfProjections; ++i)
+    {
+        MeasurementRef m = DrNew Measurement();
+        m->m_elapsed = (double) projectedRunningTime[i];
+        m->m_dataSize = 0.0;
+        m->m_deviation = 0.0;
+        sample->Add(m);
+    }
+
+    DrElapsedComparerRef comparer = DrNew DrElapsedComparer();
+    sample->Sort(comparer);
+
+    pMedian = (DrTimeInterval) sample[sample->Size() / 2]->m_elapsed;
+
+    DrTimeInterval threshold = (DrTimeInterval) (params->m_progressOutlierFactor * (double) pMedian);
+    if (threshold < params->m_minOutlierThreshold)
+    {
+        threshold = params->m_minOutlierThreshold;
+    }
+
+    return threshold;
+}
+
 void DrStageStatistics::ComputeDeviations(double startup, double dataMultiplier, double stdDeviation)
 {
     double outlierThreshold = stdDeviation * s_outlierThresholdInSigmas;
@@ -602,6 +826,9 @@ void DrStageStatistics::ReportFinalStatistics(FILE* f)
     {
         fprintf(f, "Final statistics for stage %s unavailable: %s collected\n\n", m_name.GetChars(),
                 (m_measurement->Size() == 0) ? "no measurements" : "only 1 measurement");
+        ReportLocality(f);
+        ReportVertexHostReuse(f);
+        ReportRangeBuckets(f);
         return;
     }
 
@@ -621,6 +848,10 @@ void DrStageStatistics::ReportFinalStatistics(FILE* f)
             (double) tiMultiplier / (double) DrTimeInterval_Second,
             (double) tiStdDev / (double) DrTimeInterval_Second,
             m_relativeStdDev, m_numberOfOutliers);
+
+    ReportLocality(f);
+    ReportVertexHostReuse(f);
+    ReportRangeBuckets(f);
 }
 
 void DrStageStatistics::DumpRawStatisticsData(FILE* f)
@@ -649,4 +880,16 @@ void DrStageStatistics::DumpRawStatisticsData(FILE* f)
                 (UINT64) m_measurement[i]->m_elapsed);
     }
     fprintf(f, "\n\n");
+
+    if (m_rangeBucketSize != DrNull)
+    {
+        fprintf(f, "Raw range bucket sizes for stage %s: %d buckets\n",
+                m_name.GetChars(), m_rangeBucketSize->Allocated());
+
+        for (i=0; i<m_rangeBucketSize->Allocated(); ++i)
+        {
+            fprintf(f, "%s%I64u", (i == 0) ? "" : ",", m_rangeBucketSize[i]);
+        }
+        fprintf(f, "\n\n");
+    }
 }
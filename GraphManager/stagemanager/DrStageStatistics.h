@@ -53,6 +53,41 @@ public:
        passed in to read thresholds out of. */
     DrTimeInterval GetOutlierThreshold(DrGraphParametersPtr params);
 
+    /* this returns a threshold on the projected running time of a
+       vertex that is still running, above which it should be
+       considered an outlier. The stage median running time is taken
+       over completed measurements together with the
+       numberOfProjections running-time projections passed in, which
+       the caller has extrapolated from the read progress of its
+       running vertices, so an estimate is available long before the
+       non-parametric threshold. The median is returned in
+       pMedian. The threshold is DrTimeInterval_Infinite if
+       progress-based duplication is disabled or there are too few
+       samples. */
+    DrTimeInterval GetProgressOutlierThreshold(DrGraphParametersPtr params,
+                                               DrUINT64ArrayPtr projectedRunningTime,
+                                               int numberOfProjections,
+                                               DrTimeInterval& pMedian /* OUT */);
+
+    /* this returns the fraction of executions, among those that read
+       any intermediate data, that were placed at least as close to
+       all of that data as level: DRL_Computer counts executions that
+       read all their intermediate data from the machine they ran on,
+       DRL_Rack also counts those that only read within their own
+       pod. It returns -1.0 if no such execution has been measured
+       yet. */
+    double GetLocalityHitRate(DrResourceLevel level);
+
+    /* record one request by a vertex in this stage for an idle vertex
+       host from the pool: reused says whether it got one, and
+       startupTimeSaved is the pool's estimate of what that saved */
+    void AddVertexHostClaim(bool reused, DrTimeInterval startupTimeSaved);
+
+    /* record the number of bytes a dynamic range distribution sent to
+       each of this stage's vertices, and the size an even split of
+       the sampled data predicted for each */
+    void SetRangeBucketSizes(DrUINT64ArrayPtr bucketSize, UINT64 estimatedBucketSize);
+
     void ReportFinalStatistics(FILE* f);
     void DumpRawStatisticsData(FILE* f);
 
@@ -86,6 +121,10 @@ private:
     void RandomlySample(int robustEstimatePrefix);
     void ComputeRelativeStandardDeviation();
     void ReEstimate(DrGraphParametersPtr params);
+    void AddLocalityMeasurement(DrVertexExecutionStatisticsPtr statistics);
+    void ReportLocality(FILE* f);
+    void ReportVertexHostReuse(FILE* f);
+    void ReportRangeBuckets(FILE* f);
 
     /* a string to print out to identify these statistics */
     DrString             m_name;
@@ -146,6 +185,37 @@ private:
        the model prediction */
     int                  m_numberOfOutliers;
 
+    /* these record how well the scheduler managed to place executions
+       near their intermediate inputs. m_numberOfTempReaders is the
+       number of measured executions that read any intermediate data;
+       of those, m_numberOfMachineLocal read it all from their own
+       machine and m_numberOfPodLocal read none of it from another
+       pod. The byte counts are summed over all measured executions in
+       the same categories as DrInputChannelExecutionStatistics. */
+    int                  m_numberOfTempReaders;
+    int                  m_numberOfMachineLocal;
+    int                  m_numberOfPodLocal;
+    UINT64               m_tempDataRead;
+    UINT64               m_tempDataReadCrossMachine;
+    UINT64               m_tempDataReadCrossPod;
+
+    /* these record how often vertices in this stage were started on a
+       reused idle vertex host rather than a new process, and the
+       estimated startup time the reused hosts saved */
+    int                  m_vertexHostHits;
+    int                  m_vertexHostMisses;
+    DrTimeInterval       m_vertexHostStartupSaved;
+
+    /* the bytes each vertex of a range-partitioned stage received, or
+       DrNull if the stage was not range partitioned, and the even
+       split the sample predicted. The rest are derived from them. */
+    DrUINT64ArrayRef     m_rangeBucketSize;
+    UINT64               m_estimatedRangeBucketSize;
+    UINT64               m_rangeBucketTotal;
+    UINT64               m_largestRangeBucket;
+    int                  m_largestRangeBucketIndex;
+    int                  m_emptyRangeBuckets;
+
     /* this class may be attached to more than one stage manager, and
        each one will tell it to report but we only want to do it
        once. These flags record whether we've dumped yet. */
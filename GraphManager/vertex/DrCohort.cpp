@@ -30,6 +30,12 @@ DrCohortProcess::DrCohortProcess(DrGraphPtr graph, DrCohortPtr parent, int versi
     m_version = version;
     m_numberOfVerticesLeftToComplete = numberOfVertices;
     m_timeout = timeout;
+    m_sentStartBatch = false;
+    m_reusedHost = false;
+    m_allVerticesSucceeded = true;
+    m_statusWaiter = DrNew DrVertexStatusWaiterList();
+    m_statusRequestOutstanding = false;
+    m_statusBatchVersion = 0;
 }
 
 void DrCohortProcess::DiscardParent()
@@ -47,6 +53,203 @@ DrLockBox<DrProcess> DrCohortProcess::GetProcess()
     return m_process;
 }
 
+void DrCohortProcess::OpenStartBatch()
+{
+    /* the vertex host only listens for one batch per process, since a later
+       write to the same property would hide an earlier one that it had not
+       yet fetched */
+    DrAssert(m_sentStartBatch == false);
+    DrAssert(m_startBatch == DrNull);
+    m_startBatch = DrNew DrVertexCommandBatch();
+}
+
+bool DrCohortProcess::AddToStartBatch(DrVertexCommandBlockPtr command)
+{
+    if (m_startBatch == DrNull)
+    {
+        if (m_reusedHost == false)
+        {
+            return false;
+        }
+
+        /* a reused host only learns about new vertices through the batch
+           property, so a vertex that becomes ready after the host was
+           adopted still has to be sent that way */
+        m_startBatch = DrNew DrVertexCommandBatch();
+        m_startBatch->Add(command);
+        SendStartBatch();
+        return true;
+    }
+
+    m_startBatch->Add(command);
+    return true;
+}
+
+void DrCohortProcess::SendStartBatch()
+{
+    DrAssert(m_startBatch != DrNull);
+    DrVertexCommandBatchRef batch = m_startBatch;
+    m_startBatch = DrNull;
+    m_sentStartBatch = true;
+
+    /* a host with several vertices waits for the batch property until it
+       arrives, so it is always written to one, even if it is empty because
+       every vertex is going to be started on its own later */
+    bool hostListensForBatch = (m_reusedHost || m_parent->GetMembers()->Size() > 1);
+
+    if (batch->GetNumberOfCommands() == 0 && hostListensForBatch == false)
+    {
+        return;
+    }
+
+    DrString label;
+    DrString description;
+    DrPropertyWriterRef writer = DrNew DrPropertyWriter();
+
+    if (hostListensForBatch == false)
+    {
+        /* a host with a single vertex only listens on that vertex's own
+           property, so send it the way a vertex that starts on its own would */
+        DrAssert(batch->GetNumberOfCommands() == 1);
+        DrVertexCommandBlockPtr command = batch->GetCommand(0);
+        int id = command->GetProcessStatus()->GetVertexId();
+        int version = command->GetProcessStatus()->GetVertexInstanceVersion();
+
+        label = DrVertexCommandBlock::GetPropertyLabel(id, version);
+        description.SetF("Start command for vertex %d.%d", id, version);
+        command->Serialize(writer);
+    }
+    else
+    {
+        label = DrVertexCommandBatch::GetPropertyLabel();
+        description.SetF("Start command batch for %d vertices of cohort %s v.%d",
+                         batch->GetNumberOfCommands(),
+                         m_parent->GetDescription().GetChars(), m_version);
+        batch->Serialize(writer);
+    }
+
+    DrByteArrayRef block = writer->GetBuffer();
+
+    DrLogI("Cohort %s v.%d sending %d start commands in one property write",
+           m_parent->GetDescription().GetChars(), m_version, batch->GetNumberOfCommands());
+
+    DrAssert(m_process.IsEmpty() == false);
+    {
+        DrLockBoxKey<DrProcess> process(m_process);
+        process->SendCommand(label, description, block);
+    }
+}
+
+bool DrCohortProcess::RequestVertexStatus(int vertexId, int vertexVersion, UINT64 lastSeenVersion,
+                                          DrPropertyListenerPtr listener)
+{
+    if (m_process.IsEmpty())
+    {
+        return false;
+    }
+
+    DrVertexStatusWaiter waiter;
+    waiter.m_vertexId = vertexId;
+    waiter.m_vertexVersion = vertexVersion;
+    waiter.m_lastSeenVersion = lastSeenVersion;
+    waiter.m_listener = listener;
+
+    if (m_statusBatch != DrNull && m_statusBatchVersion > lastSeenVersion)
+    {
+        /* the batch we already have may be news to this vertex, for example
+           if it has only just started listening */
+        DrVertexStatusPtr status = m_statusBatch->FindStatus(vertexId, vertexVersion);
+        if (status != DrNull)
+        {
+            DrPropertyStatusRef batchStatus = DrNew DrPropertyStatus(DPBS_Running, STILL_ACTIVE, DrNull);
+            batchStatus->m_process = m_process;
+            DeliverVertexStatus(waiter, batchStatus, status);
+            return true;
+        }
+    }
+
+    m_statusWaiter->Add(waiter);
+
+    if (m_statusRequestOutstanding == false)
+    {
+        m_statusRequestOutstanding = true;
+
+        DrLockBoxKey<DrProcess> process(m_process);
+        process->RequestProperty(m_statusBatchVersion, DrVertexStatusBatch::GetPropertyLabel(), this);
+    }
+
+    return true;
+}
+
+void DrCohortProcess::DeliverVertexStatus(DrVertexStatusWaiter waiter, DrPropertyStatusPtr batchStatus,
+                                          DrVertexStatusPtr status)
+{
+    /* give the vertex a property that looks just like the one it would have
+       read itself, carrying the batch version so its ordering checks still
+       work */
+    DrPropertyStatusRef vertexStatus = DrNew DrPropertyStatus(batchStatus->m_processState,
+                                                              batchStatus->m_exitCode,
+                                                              batchStatus->m_status);
+    vertexStatus->m_process = batchStatus->m_process;
+    vertexStatus->m_statusVersion = m_statusBatchVersion;
+
+    if (status != DrNull)
+    {
+        DrPropertyWriterRef writer = DrNew DrPropertyWriter();
+        status->Serialize(writer);
+        vertexStatus->m_statusBlock = writer->GetBuffer();
+    }
+
+    DrPropertyMessageRef message = DrNew DrPropertyMessage(waiter.m_listener, vertexStatus);
+    m_messagePump->EnQueue(message);
+}
+
+void DrCohortProcess::ReceiveMessage(DrPropertyStatusRef message)
+{
+    m_statusRequestOutstanding = false;
+
+    if (message->m_statusBlock != DrNull && message->m_statusVersion >= m_statusBatchVersion)
+    {
+        DrVertexStatusBatchRef batch = DrNew DrVertexStatusBatch();
+        DrPropertyReaderRef parser = DrNew DrPropertyReader(message->m_statusBlock);
+        HRESULT err = parser->ReadAggregate(DrTag_VertexStatusBatch, batch);
+        if (SUCCEEDED(err))
+        {
+            m_statusBatch = batch;
+        }
+        else
+        {
+            DrLogW("Cohort process v.%d got unparseable status batch version %I64u error %s: ignoring",
+                   m_version, message->m_statusVersion, DRERRORSTRING(err));
+        }
+
+        /* move on even if the batch didn't parse so we don't keep fetching it */
+        m_statusBatchVersion = message->m_statusVersion;
+    }
+
+    /* everyone waiting hears about this reply, just as they would have heard
+       about their own property: a vertex the process hasn't reported yet gets
+       an empty status, and once the process has exited every vertex gets the
+       process' final state */
+    DrVertexStatusWaiterListRef waiters = m_statusWaiter;
+    m_statusWaiter = DrNew DrVertexStatusWaiterList();
+
+    int i;
+    for (i=0; i<waiters->Size(); ++i)
+    {
+        DrVertexStatusPtr status = DrNull;
+        if (m_statusBatch != DrNull)
+        {
+            status = m_statusBatch->FindStatus(waiters[i].m_vertexId, waiters[i].m_vertexVersion);
+        }
+
+        DeliverVertexStatus(waiters[i], message, status);
+    }
+
+    DrLogI("Cohort process v.%d delivered status batch version %I64u to %d vertices",
+           m_version, m_statusBatchVersion, waiters->Size());
+}
+
 void DrCohortProcess::ReceiveMessage(DrProcessInfoRef message)
 {
     if (m_receivedProcess == false)
@@ -185,6 +388,14 @@ void DrCohortProcess::ReceiveMessage(DrProcessInfoRef message)
         DrLogI("Cohort %s v.%d starting process",
                m_parent->GetDescription().GetChars(), m_version);
 
+        if (m_reusedHost == false && message->m_jmProcessScheduledTime != DrDateTime_Never)
+        {
+            DrGraphPtr graph = m_parent->GetGraph();
+            DrTimeInterval startupTime =
+                graph->GetCluster()->GetCurrentTimeStamp() - message->m_jmProcessScheduledTime;
+            graph->GetVertexHostPool()->NotifyColdStart(startupTime);
+        }
+
         m_parent->NotifyProcessHasStarted(m_version);
     }
 }
@@ -194,12 +405,83 @@ bool DrCohortProcess::ProcessHasStarted()
     return (m_processHandle != DrNull);
 }
 
-void DrCohortProcess::NotifyVertexCompletion()
+DrResourcePtr DrCohortProcess::GetAssignedNode()
+{
+    DrAssert(m_processHandle != DrNull);
+    return m_processHandle->GetAssignedNode();
+}
+
+void DrCohortProcess::StartPlacementTimer(DrTimeInterval timeOut)
+{
+    if (timeOut == DrTimeInterval_Infinite)
+    {
+        return;
+    }
+
+    DrCohortPlacementMessageRef message = DrNew DrCohortPlacementMessage(this, 0);
+    m_messagePump->EnQueueDelayed(timeOut, message);
+}
+
+void DrCohortProcess::ReceiveMessage(DrCohortPlacementCheck /* unused message */)
+{
+    if (m_parent == DrNull || m_processHandle != DrNull)
+    {
+        /* the version has gone away or the process started in time */
+        return;
+    }
+
+    DrLogW("Cohort %s v.%d was not placed with the rest of its gang in time",
+           m_parent->GetDescription().GetChars(), m_version);
+
+    m_parent->GetGang()->ReactToPlacementTimeOut(m_version);
+}
+
+void DrCohortProcess::AdoptIdleHost(DrLockBox<DrProcess> idleHost)
+{
+    m_reusedHost = true;
+    /* if we are cancelled before the messages below arrive, this is what
+       makes sure the host gets terminated rather than forgotten */
+    m_process = idleHost;
+
+    /* deliver the same pair of messages a newly scheduled process would
+       produce: first the process itself, then its running state. They are
+       queued before we start listening to the process so anything it
+       reports later arrives after them */
+    DrProcessInfoRef startNotification = DrNew DrProcessInfo();
+    startNotification->m_state = DrNew DrProcessStateRecord();
+    startNotification->m_state->m_state = DPS_NotStarted;
+    startNotification->m_jmProcessScheduledTime = DrDateTime_Never;
+
+    DrProcessInfoRef runningNotification = DrNew DrProcessInfo();
+    runningNotification->m_jmProcessScheduledTime = DrDateTime_Never;
+
+    {
+        DrLockBoxKey<DrProcess> process(idleHost);
+
+        startNotification->m_process = idleHost;
+        runningNotification->m_process = idleHost;
+        runningNotification->m_state = process->GetInfo()->m_state->Clone();
+
+        DrProcessMessageRef startMessage = DrNew DrProcessMessage(this, startNotification);
+        m_messagePump->EnQueue(startMessage);
+        DrProcessMessageRef runningMessage = DrNew DrProcessMessage(this, runningNotification);
+        m_messagePump->EnQueue(runningMessage);
+
+        process->AddListener(this);
+    }
+}
+
+void DrCohortProcess::NotifyVertexCompletion(bool succeeded)
 {
     DrLogI("Enter with m_numberOfVerticesLeftToComplete %d", m_numberOfVerticesLeftToComplete);
     DrAssert(m_numberOfVerticesLeftToComplete > 0);
     --m_numberOfVerticesLeftToComplete;
 
+    if (succeeded == false)
+    {
+        m_allVerticesSucceeded = false;
+    }
+
     if (m_numberOfVerticesLeftToComplete > 0)
     {
         DrLogI("Still have %d vertices to complete", m_numberOfVerticesLeftToComplete);
@@ -207,11 +489,19 @@ void DrCohortProcess::NotifyVertexCompletion()
     }
 
     bool scheduleTermination = false;
+    bool offerForReuse = false;
     if (m_process.IsEmpty() == false)
     {
         DrLockBoxKey<DrProcess> process(m_process);
 
-        if (process->GetInfo()->m_state->m_state <= DPS_Running)
+        if (process->GetInfo()->m_state->m_state == DPS_Running &&
+            m_processHandle != DrNull && m_allVerticesSucceeded &&
+            m_parent->GetGraph()->GetVertexHostPool()->IsEnabled())
+        {
+            /* the host is waiting for more work rather than exiting */
+            offerForReuse = true;
+        }
+        else if (process->GetInfo()->m_state->m_state <= DPS_Running)
         {
             /* the process hasn't exited yet even though all the vertices are done. It will
                probably exit soon of its own accord, but in case it doesn't we'll schedule
@@ -228,6 +518,19 @@ void DrCohortProcess::NotifyVertexCompletion()
         }
     }
 
+    if (offerForReuse)
+    {
+        DrVertexHostPoolPtr pool = m_parent->GetGraph()->GetVertexHostPool();
+        if (pool->Park(m_process, m_parent->GetProcessTemplate(), m_processHandle->GetAssignedNode()) == false)
+        {
+            /* the host is sitting idle waiting to be reused and won't exit of
+               its own accord, so there is no point giving it time to */
+            DrLockBoxKey<DrProcess> process(m_process);
+            DrLogI("Idle vertex host %s not kept, terminating", process->GetName().GetChars());
+            process->Terminate();
+        }
+    }
+
     if (scheduleTermination)
     {
         /* The listener for the state message (DrProcess::ReceiveMessage(DrProcessState message))
@@ -458,7 +761,7 @@ void DrCohort::PrepareDescription()
     }
 }
 
-void DrCohort::StartProcess(DrGraphPtr graph, int version)
+void DrCohort::StartProcess(DrGraphPtr graph, int version, DrCohortPlacement placement)
 {
     int i;
     for (i=0; i<m_versionList->Size(); ++i)
@@ -466,33 +769,137 @@ void DrCohort::StartProcess(DrGraphPtr graph, int version)
         DrAssert(m_versionList[i].m_version != version);
     }
 
-    DrString processName;
-    processName.SetF("%s v.%d", m_description.GetChars(), version);
-
-    DrString commandLine;
-    commandLine.SetF("--noredirect --startfrompn %d", m_list->Size());
-
-    for (i=0; i<m_list->Size(); ++i)
-    {
-        commandLine = commandLine.AppendF(" %d %d", m_list[i]->GetId(), version);
-    }
-
     DrCohortProcessRef process =
         DrNew DrCohortProcess(graph, this, version, m_list->Size(),
                               m_processTemplate->GetTimeOutBetweenProcessEndAndVertexNotification());
 
+    DrAffinityListRef affinity = DrNew DrAffinityList();
+    if (placement == DCP_GangAnchor)
+    {
+        /* the rest of the gang will follow us onto whatever computer we get, so
+           ask for the place that suits the whole gang */
+        DrCohortListRef gangCohort = m_gang->GetCohorts();
+        int c;
+        for (c=0; c<gangCohort->Size(); ++c)
+        {
+            DrActiveVertexListRef members = gangCohort[c]->GetMembers();
+            for (i=0; i<members->Size(); ++i)
+            {
+                members[i]->AddCurrentAffinitiesToList(version, affinity);
+            }
+        }
+    }
+    else
+    {
+        for (i=0; i<m_list->Size(); ++i)
+        {
+            m_list[i]->AddCurrentAffinitiesToList(version, affinity);
+        }
+    }
+
     VersionProcess vp;
     vp.m_version = version;
     vp.m_process = process;
+    if (placement == DCP_ColocateWithAnchor)
+    {
+        /* the member affinities have to be collected now, while the members
+           still hold this version as pending */
+        vp.m_deferredAffinity = affinity;
+    }
     m_versionList->Add(vp);
 
-    DrAffinityListRef affinity = DrNew DrAffinityList();
-    for (i=0; i<m_list->Size(); ++i)
+	graph->IncrementInFlightProcesses();
+
+    if (placement == DCP_ColocateWithAnchor)
     {
-        m_list[i]->AddCurrentAffinitiesToList(version, affinity);
+        DrLogI("Cohort %s v.%d waiting for its gang's anchor process to be placed",
+               m_description.GetChars(), version);
+        return;
     }
 
-	graph->IncrementInFlightProcesses();
+    if (placement == DCP_Independent && m_list->Size() == 1)
+    {
+        /* a reused host gets exactly one start batch per adoption, which is
+           only guaranteed for a cohort of one vertex; gangs are placed
+           together so they always start fresh */
+        DrLockBox<DrProcess> idleHost =
+            graph->GetVertexHostPool()->Claim(m_processTemplate, affinity,
+                                              m_list[0]->GetStageManager());
+        if (idleHost.IsEmpty() == false)
+        {
+            DrLogI("Cohort %s v.%d reusing an idle vertex host",
+                   m_description.GetChars(), version);
+            process->AdoptIdleHost(idleHost);
+            return;
+        }
+    }
+
+    ScheduleProcess(graph, process, version, affinity);
+}
+
+void DrCohort::StartColocatedProcess(int version, DrResourcePtr computer)
+{
+    int i;
+    for (i=0; i<m_versionList->Size(); ++i)
+    {
+        if (m_versionList[i].m_version == version)
+        {
+            break;
+        }
+    }
+
+    if (i == m_versionList->Size() || m_versionList[i].m_deferredAffinity == DrNull)
+    {
+        /* the version was cancelled while the anchor was starting */
+        DrLogI("Cohort %s v.%d no longer waiting for placement", m_description.GetChars(), version);
+        return;
+    }
+
+    VersionProcess vp = m_versionList[i];
+    DrAffinityListRef affinity = vp.m_deferredAffinity;
+    vp.m_deferredAffinity = DrNull;
+    m_versionList[i] = vp;
+
+    DrAffinityRef colocation = DrNew DrAffinity();
+    colocation->SetHardConstraint(true);
+    colocation->AddLocality(computer);
+    affinity->Add(colocation);
+
+    DrLogI("Cohort %s v.%d following its gang onto computer %s",
+           m_description.GetChars(), version, computer->GetName().GetChars());
+
+    /* the computer may never have room for us while the anchor is holding
+       part of it, so don't wait for ever */
+    vp.m_process->StartPlacementTimer(GetGraph()->GetParameters()->m_gangPlacementTimeOut);
+
+    ScheduleProcess(GetGraph(), vp.m_process, version, affinity);
+}
+
+void DrCohort::ScheduleProcess(DrGraphPtr graph, DrCohortProcessPtr process, int version,
+                               DrAffinityListPtr affinity)
+{
+    DrString processName;
+    processName.SetF("%s v.%d", m_description.GetChars(), version);
+
+    /* the host reports all of its vertices in one status batch, which
+       DrCohortProcess follows on their behalf */
+    DrString commandLine;
+    if (graph->GetVertexHostPool()->IsEnabled())
+    {
+        /* the host waits for more vertices when its own are done, in case
+           the pool wants to keep it */
+        commandLine.SetF("--noredirect --startfrompn --statusbatch --reuse %d", m_list->Size());
+    }
+    else
+    {
+        commandLine.SetF("--noredirect --startfrompn --statusbatch %d", m_list->Size());
+    }
+
+    int i;
+    for (i=0; i<m_list->Size(); ++i)
+    {
+        commandLine = commandLine.AppendF(" %d %d", m_list[i]->GetId(), version);
+    }
 
     /* hand off the computation to merge the affinities (which can be slow) and the actual call to
        start the process onto the work queue */
@@ -515,12 +922,22 @@ void DrCohort::NotifyProcessHasStarted(int version)
         }
     }
     DrAssert(i < m_versionList->Size());
-    DrLockBox<DrProcess> process = m_versionList[i].m_process->GetProcess();
+    DrCohortProcessPtr cohortProcess = m_versionList[i].m_process;
+    DrLockBox<DrProcess> process = cohortProcess->GetProcess();
+
+    /* every member whose inputs are already available starts now: gather
+       their start commands so the process gets them in one property write
+       rather than one round trip per vertex */
+    cohortProcess->OpenStartBatch();
 
     for (i=0; i<m_list->Size(); ++i)
     {
         m_list[i]->ReactToStartedProcess(version, process);
     }
+
+    cohortProcess->SendStartBatch();
+
+    m_gang->NotifyCohortProcessStarted(this, version, cohortProcess->GetAssignedNode());
 }
 
 void DrCohort::NotifyProcessComplete(int version)
@@ -627,6 +1044,8 @@ DrGang::DrGang(DrCohortPtr initialCohort, DrStartCliquePtr initialStartClique)
 	m_completedVersion = 0;
 
     m_nextVersion = 1;
+    m_unreadyVertexCount = 0;
+    m_firstFileVersion = 0;
 }
 
 void DrGang::Discard()
@@ -715,6 +1134,13 @@ void DrGang::AssimilateOther(DrGangPtr other)
         c->SetGang(this);
         m_clique->Add(c);
     }
+
+    m_unreadyVertexCount += other->m_unreadyVertexCount;
+}
+
+bool DrGang::HasInstantiatedVersion()
+{
+    return (m_nextVersion > 1);
 }
 
 void DrGang::StartVersion(DrGraphPtr graph, int version)
@@ -737,13 +1163,90 @@ void DrGang::StartVersion(DrGraphPtr graph, int version)
 
 	m_runningVersion->Add(rv);
 
-    /* if we had a gang-scheduling interface to Cluster we would be calling it here */
+    /* if we had a gang-scheduling interface to Cluster we would be calling it here. Instead,
+       when there is more than one cohort the first one is placed for the whole gang and the
+       rest are scheduled onto its computer once it starts */
     for (i=0; i<m_cohort->Size(); ++i)
     {
-        m_cohort[i]->StartProcess(graph, version);
+        DrCohortPlacement placement = DCP_Independent;
+        if (m_cohort->Size() > 1 && PipesUseFiles(version) == false)
+        {
+            placement = (i == 0) ? DCP_GangAnchor : DCP_ColocateWithAnchor;
+        }
+        m_cohort[i]->StartProcess(graph, version, placement);
     }
 }
 
+void DrGang::StartCachedVersion(int version)
+{
+    DrAssert(version < m_nextVersion);
+
+	DrAssert(version == m_pendingVersion);
+	m_pendingVersion = 0;
+
+    DrAssert(m_cohort->Size() == 1 && m_cohort[0]->GetMembers()->Size() == 1);
+
+    /* the version counts as running until its vertex has been told about
+       the hit, just as if a process had been started for it */
+	DrRunningGang rv;
+	rv.m_version = version;
+	rv.m_verticesLeftToComplete = 1;
+
+	m_runningVersion->Add(rv);
+}
+
+void DrGang::NotifyCohortProcessStarted(DrCohortPtr cohort, int version, DrResourcePtr computer)
+{
+    if (m_cohort->Size() == 1 || m_cohort[0] != cohort)
+    {
+        return;
+    }
+
+    int i;
+    for (i=1; i<m_cohort->Size(); ++i)
+    {
+        m_cohort[i]->StartColocatedProcess(version, computer);
+    }
+}
+
+void DrGang::ReactToPlacementTimeOut(int version)
+{
+    int i;
+    for (i=0; i<m_runningVersion->Size(); ++i)
+    {
+        if (m_runningVersion[i].m_version == version)
+        {
+            break;
+        }
+    }
+
+    if (i == m_runningVersion->Size())
+    {
+        /* the version was cancelled while the timer was in the queue */
+        return;
+    }
+
+    if (m_firstFileVersion == 0)
+    {
+        /* versions that are already running keep their shared-memory pipes. A pending
+           version hasn't been placed yet, so it can switch too */
+        m_firstFileVersion = (m_pendingVersion > 0) ? m_pendingVersion : m_nextVersion;
+        DrLogW("Gang can't be placed on one computer: sending pipes through files from version %d",
+               m_firstFileVersion);
+    }
+
+    DrString reason;
+    reason.SetF("Gang version %d could not be placed on one computer in time", version);
+    DrErrorRef error = DrNew DrError(DrError_HardConstraintCannotBeMet, "DrGang", reason);
+
+    CancelVersion(version, error);
+}
+
+bool DrGang::PipesUseFiles(int version)
+{
+    return (m_firstFileVersion > 0 && version >= m_firstFileVersion);
+}
+
 void DrGang::CancelAllVersions(DrErrorPtr error)
 {
     DrLogI("Canceling all versions for gang");
@@ -20,7 +20,44 @@ limitations under the License.
 
 #pragma once
 
-DRCLASS(DrCohortProcess) : public DrSharedCritSec, public DrProcessListener
+/* how a cohort's process is placed when its gang starts a version. A gang
+   with more than one cohort is held together by pipe edges, which stream
+   through shared memory, so every process in the gang has to run on the
+   same computer: the anchor is placed using the affinities of the whole
+   gang and the others follow it once it has started. A gang that couldn't
+   be placed together in time sends its pipes through files and places
+   every cohort independently */
+enum DrCohortPlacement
+{
+    DCP_Independent,
+    DCP_GangAnchor,
+    DCP_ColocateWithAnchor
+};
+
+/* Gang placement timer message, sent to a cohort process that is
+   following its gang's anchor. The payload is unused */
+typedef int DrCohortPlacementCheck;
+
+typedef DrListener<DrCohortPlacementCheck> DrCohortPlacementListener;
+DRIREF(DrCohortPlacementListener);
+
+typedef DrMessage<DrCohortPlacementCheck> DrCohortPlacementMessage;
+DRREF(DrCohortPlacementMessage);
+
+/* a vertex record waiting to hear about a newer status than the one it has */
+DRVALUECLASS(DrVertexStatusWaiter)
+{
+public:
+    int                         m_vertexId;
+    int                         m_vertexVersion;
+    UINT64                      m_lastSeenVersion;
+    DrPropertyListenerIRef      m_listener;
+};
+typedef DrArrayList<DrVertexStatusWaiter> DrVertexStatusWaiterList;
+DRAREF(DrVertexStatusWaiterList,DrVertexStatusWaiter);
+
+DRCLASS(DrCohortProcess) : public DrSharedCritSec, public DrProcessListener, public DrPropertyListener,
+                            public DrCohortPlacementListener
 {
 public:
     DrCohortProcess(DrGraphPtr graph, DrCohortPtr cohort,
@@ -33,13 +70,49 @@ public:
 
     DrLockBox<DrProcess> GetProcess();
     bool ProcessHasStarted();
-
-    void NotifyVertexCompletion();
+    DrResourcePtr GetAssignedNode();
+
+    /* if the process still hasn't started after timeOut, the gang is told
+       it couldn't be placed together */
+    void StartPlacementTimer(DrTimeInterval timeOut);
+
+    /* succeeded is false if the vertex failed or was cancelled; a process
+       is only offered for reuse if every one of its vertices succeeded */
+    void NotifyVertexCompletion(bool succeeded);
+
+    /* use an idle vertex host from the pool instead of scheduling a new
+       process. The cohort hears that it is running as if it had just
+       started */
+    void AdoptIdleHost(DrLockBox<DrProcess> idleHost);
+
+    /* while a start batch is open, vertices starting in this process add
+       their start commands to it instead of sending them one at a time;
+       SendStartBatch closes the batch and sends whatever was collected */
+    void OpenStartBatch();
+    bool AddToStartBatch(DrVertexCommandBlockPtr command);
+    void SendStartBatch();
+
+    /* the process writes the status of all its vertices as one batch
+       property, and the cohort keeps a single request outstanding for it
+       on behalf of every vertex that is waiting for news. Returns false if
+       the process has gone away, in which case the vertex should ask for
+       its own status property */
+    bool RequestVertexStatus(int vertexId, int vertexVersion, UINT64 lastSeenVersion,
+                             DrPropertyListenerPtr listener);
 
     /* DrProcessListener implementation */
     virtual void ReceiveMessage(DrProcessInfoRef message);
 
+    /* DrPropertyListener implementation, used for the status batch */
+    virtual void ReceiveMessage(DrPropertyStatusRef message);
+
+    /* DrCohortPlacementListener implementation */
+    virtual void ReceiveMessage(DrCohortPlacementCheck message);
+
 private:
+    void DeliverVertexStatus(DrVertexStatusWaiter waiter, DrPropertyStatusPtr batchStatus,
+                             DrVertexStatusPtr status);
+
     bool                     m_receivedProcess;
     DrMessagePumpRef         m_messagePump;
     DrCohortRef              m_parent;
@@ -48,6 +121,14 @@ private:
     int                      m_numberOfVerticesLeftToComplete;
     DrProcessHandleRef       m_processHandle;
     DrTimeInterval           m_timeout;
+    DrVertexCommandBatchRef  m_startBatch;
+    bool                     m_sentStartBatch;
+    bool                     m_reusedHost;
+    bool                     m_allVerticesSucceeded;
+    DrVertexStatusWaiterListRef  m_statusWaiter;
+    bool                     m_statusRequestOutstanding;
+    UINT64                   m_statusBatchVersion;
+    DrVertexStatusBatchRef   m_statusBatch;
 };
 DRREF(DrCohortProcess);
 
@@ -57,6 +138,9 @@ DRVALUECLASS(VersionProcess)
 public:
     int                         m_version;
     DrCohortProcessRef          m_process;
+    /* non-null while the process is waiting for the gang's anchor to be
+       placed before it is scheduled */
+    DrAffinityListRef           m_deferredAffinity;
 };
 typedef DrArrayList<VersionProcess> VPList;
 DRAREF(VPList,VersionProcess);
@@ -79,7 +163,8 @@ public:
 
     DrCohortProcessPtr GetProcessForVersion(int version);
     DrCohortProcessPtr EnsureProcess(DrGraphPtr graph, int version);
-    void StartProcess(DrGraphPtr graph, int version);
+    void StartProcess(DrGraphPtr graph, int version, DrCohortPlacement placement);
+    void StartColocatedProcess(int version, DrResourcePtr computer);
     void NotifyProcessHasStarted(int version);
     void CancelVertices(int version, DrErrorPtr originalReason);
     void NotifyProcessComplete(int version);
@@ -91,6 +176,8 @@ public:
 private:
     void AssimilateOther(DrCohortPtr other);
     void PrepareDescription();
+    void ScheduleProcess(DrGraphPtr graph, DrCohortProcessPtr process, int version,
+                         DrAffinityListPtr affinity);
 
     DrProcessTemplateRef     m_processTemplate;
     DrActiveVertexListRef    m_list;
@@ -124,7 +211,19 @@ public:
     void DecrementUnreadyVertices();
     bool VerticesAreReady();
 
+    bool HasInstantiatedVersion();
     void StartVersion(DrGraphPtr graph, int version);
+    /* a version of a single-vertex gang whose outputs were found in the
+       stage output cache runs without a process */
+    void StartCachedVersion(int version);
+    void NotifyCohortProcessStarted(DrCohortPtr cohort, int version, DrResourcePtr computer);
+    /* a cohort of the running version wasn't placed with the rest of the
+       gang in time */
+    void ReactToPlacementTimeOut(int version);
+    /* true if the version's pipe edges are written to files, and their
+       readers wait for the writers to complete, because an earlier version
+       couldn't be placed on one computer */
+    bool PipesUseFiles(int version);
     void CancelVersion(int version, DrErrorPtr error);
 	void CancelAllVersions(DrErrorPtr error);
 	void EnsurePendingVersion(int duplicateVersion);
@@ -167,4 +266,7 @@ private:
 	/* This is the version number that will be handed out to the next pending version. */
     int                    m_nextVersion;
     int                    m_unreadyVertexCount;
+
+	/* If non-zero, this and every later version sends its pipe edges through files. */
+    int                    m_firstFileVersion;
 };
@@ -23,6 +23,29 @@ limitations under the License.
 DrGraphParameters::DrGraphParameters()
 {
     m_reporters = DrNew DrIReporterRefList();
+
+    m_progressOutlierFactor = 0.0;
+    m_speculativeDuplicateFraction = 0.0;
+
+    m_maxIdleVertexHostsPerComputer = 0;
+    m_vertexHostIdleTimeOut = DrTimeInterval_Zero;
+
+    m_gangPlacementTimeOut = DrTimeInterval_Infinite;
+
+    m_aggregateVertexOverhead = DrTimeInterval_Zero;
+    m_aggregateCrossPodBytesPerSecond = 0;
+
+    m_broadcastFanOut = 0;
+
+    m_outputCacheMaxBytes = 0;
+    m_outputCacheScope = 0;
+}
+
+void DrGraphParameters::SetOutputCache(DrNativeString directory, UINT64 maxBytes, UINT64 scope)
+{
+    m_outputCacheDirectory = DrString(directory);
+    m_outputCacheMaxBytes = maxBytes;
+    m_outputCacheScope = scope;
 }
 
 DrFailureInfo::DrFailureInfo()
@@ -41,9 +64,13 @@ DrGraph::DrGraph(DrClusterPtr cluster, DrGraphParametersPtr parameters)
     m_partitionGeneratorList = DrNew DrPartitionGeneratorList();
 
     m_state = DGS_NotStarted;
+    m_speculativeDuplicateCount = 0;
     m_activeVertexCount = 0;
     m_activeVertexCompleteCount = 0;
 
+    m_vertexHostPool = DrNew DrVertexHostPool(this);
+    m_outputCache = DrNew DrOutputCache(this);
+
     DrActiveVertexOutputGenerator::s_intermediateCompressionMode = parameters->m_intermediateCompressionMode;
 }
 
@@ -61,6 +88,12 @@ void DrGraph::Discard()
     m_stageList = DrNull;
 
     m_partitionGeneratorList = DrNull;
+
+    m_vertexHostPool->Discard();
+    m_vertexHostPool = DrNull;
+
+    m_outputCache->Discard();
+    m_outputCache = DrNull;
 }
 
 void DrGraph::AddStage(DrStageManagerPtr stage)
@@ -283,6 +316,10 @@ void DrGraph::ReceiveMessage(DrExitStatus /* unused exitStatus */)
     {
         m_state = DGS_Stopping;
 
+        /* idle hosts aren't in flight, so nothing else would stop them */
+        m_vertexHostPool->Shutdown();
+        m_outputCache->Shutdown();
+
 		if (m_inFlightProcessCount == 0)
 		{
             DrLogI("No processes in flight, finalizing graph");
@@ -389,6 +426,16 @@ DrGraphParametersPtr DrGraph::GetParameters()
     return m_parameters;
 }
 
+DrVertexHostPoolPtr DrGraph::GetVertexHostPool()
+{
+    return m_vertexHostPool;
+}
+
+DrOutputCachePtr DrGraph::GetOutputCache()
+{
+    return m_outputCache;
+}
+
 int DrGraph::ReportFailure(DrActiveVertexPtr vertex, int version,
                            DrVertexProcessStatusPtr status, DrErrorPtr error)
 {
@@ -455,6 +502,43 @@ int DrGraph::ReportFailure(DrActiveVertexPtr vertex, int version,
     return -1;
 }
 
+bool DrGraph::AcquireSpeculativeDuplicate()
+{
+    int budget = 0;
+    if (m_parameters->m_progressOutlierFactor > 0.0)
+    {
+        DrUniversePtr universe = m_cluster->GetUniverse();
+        int numberOfComputers;
+        {
+            DrAutoCriticalSection acs(universe->GetResourceLock());
+
+            numberOfComputers = universe->GetResources(DRL_Computer)->Size();
+        }
+
+        budget = (int) (m_parameters->m_speculativeDuplicateFraction * (double) numberOfComputers);
+        if (budget < 1)
+        {
+            budget = 1;
+        }
+    }
+
+    if (m_speculativeDuplicateCount >= budget)
+    {
+        DrLogI("Speculative duplicate budget exhausted: %d outstanding of %d",
+               m_speculativeDuplicateCount, budget);
+        return false;
+    }
+
+    ++m_speculativeDuplicateCount;
+    return true;
+}
+
+void DrGraph::ReleaseSpeculativeDuplicate()
+{
+    DrAssert(m_speculativeDuplicateCount > 0);
+    --m_speculativeDuplicateCount;
+}
+
 void DrGraph::ReportStorageFailure(DrStorageVertexPtr vertex, DrErrorPtr originalError)
 {
     DrFailureInfoRef info;
@@ -37,6 +37,8 @@ DRBASECLASS(DrGraphParameters)
 public:
     DrGraphParameters();
 
+    void SetOutputCache(DrNativeString directory, UINT64 maxBytes, UINT64 scope);
+
     DrTimeInterval                m_processAbortTimeOut;
     DrTimeInterval                m_propertyUpdateInterval;
     int                           m_maxActiveFailureCount;
@@ -46,6 +48,54 @@ public:
     DrTimeInterval                m_minOutlierThreshold;
     double                        m_nonParametricThresholdFraction;
 
+    /* a running vertex whose running time, projected from the
+       fraction of its input it has read so far, is more than
+       m_progressOutlierFactor times the stage median is duplicated
+       without waiting for the stage to complete enough vertices to
+       estimate the non-parametric threshold. 0 disables this. */
+    double                        m_progressOutlierFactor;
+    /* at most this fraction of the cluster's computers can be used by
+       progress-based duplicates at any one time, with a minimum of
+       one if m_progressOutlierFactor is non-zero */
+    double                        m_speculativeDuplicateFraction;
+
+    /* a vertex host whose vertices all completed successfully is kept
+       running for up to m_vertexHostIdleTimeOut so a later cohort with
+       the same process template can reuse it, keeping at most this many
+       idle hosts on each computer. 0 disables reuse. */
+    int                           m_maxIdleVertexHostsPerComputer;
+    DrTimeInterval                m_vertexHostIdleTimeOut;
+
+    /* a gang whose cohorts are joined by pipe edges is placed on one
+       computer. If the rest of the gang hasn't started there within this
+       long of the first process, the version is cancelled and the gang's
+       later versions send their pipe edges through files instead.
+       DrTimeInterval_Infinite waits for ever. */
+    DrTimeInterval                m_gangPlacementTimeOut;
+
+    /* the costs dynamic aggregation trees are planned with once the
+       reduction ratio of their internal vertices is known: the fixed
+       overhead of scheduling one more vertex, and the rate at which
+       data can be read across pods */
+    DrTimeInterval                m_aggregateVertexOverhead;
+    UINT64                        m_aggregateCrossPodBytesPerSecond;
+
+    /* the maximum number of outputs of each tee in a dynamic broadcast
+       tree. 0 sizes it from the amount of data broadcast. */
+    int                           m_broadcastFanOut;
+
+    /* completed executions are kept in this directory, up to
+       m_outputCacheMaxBytes, and reused in place of later executions of a
+       vertex with the same program, arguments and inputs. An empty
+       directory disables the cache. m_outputCacheScope is a hash of the
+       job's code and plan that goes into every fingerprint, since the
+       vertex arguments alone don't identify the code a vertex runs; 0
+       means there is no such hash and entries are only reused within
+       this job. */
+    DrString                      m_outputCacheDirectory;
+    UINT64                        m_outputCacheMaxBytes;
+    UINT64                        m_outputCacheScope;
+
     int                           m_intermediateCompressionMode;
 
     DrProcessTemplateRef          m_defaultProcessTemplate;
@@ -80,6 +130,8 @@ public:
 
     DrClusterPtr GetCluster();
     DrGraphParametersPtr GetParameters();
+    DrVertexHostPoolPtr GetVertexHostPool();
+    DrOutputCachePtr GetOutputCache();
 
     void AddStage(DrStageManagerPtr stage);
     DrStageListPtr GetStages();
@@ -107,6 +159,14 @@ public:
 	void DecrementInFlightProcesses();
 
     int ReportFailure(DrActiveVertexPtr vertex, int version, DrVertexProcessStatusPtr status, DrErrorPtr error);
+
+    /* stage managers call this before requesting a progress-based
+       duplicate. It returns false if the job-wide budget of
+       outstanding duplicates is used up, otherwise it reserves one
+       which must later be given back with
+       ReleaseSpeculativeDuplicate */
+    bool AcquireSpeculativeDuplicate();
+    void ReleaseSpeculativeDuplicate();
     void ReportStorageFailure(DrStorageVertexPtr vertex, DrErrorPtr error);
 
 private:
@@ -124,5 +184,8 @@ private:
     int                           m_activeVertexCount;
     int                           m_activeVertexCompleteCount;
 	int                           m_inFlightProcessCount;
+    int                           m_speculativeDuplicateCount;
+    DrVertexHostPoolRef           m_vertexHostPool;
+    DrOutputCacheRef              m_outputCache;
 };
 DRREF(DrGraph);
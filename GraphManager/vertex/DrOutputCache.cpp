@@ -0,0 +1,671 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include <DrVertexHeaders.h>
+
+using namespace System::IO;
+
+DrOutputCacheWriter::DrOutputCacheWriter(DrOutputCachePtr cache, UINT64 fingerprint,
+                                         DrString computerName,
+                                         DrStringArrayPtr sourceUri, DrStringArrayPtr query)
+{
+    m_cache = cache;
+    m_fingerprint = fingerprint;
+    m_computerName = computerName;
+    m_sourceUri = sourceUri;
+    m_query = query;
+}
+
+void DrOutputCacheWriter::Run()
+{
+    m_cache->WriteEntry(m_fingerprint, m_computerName, m_sourceUri, m_query);
+}
+
+
+static DrString MakeDataURI(System::String^ dataPath, System::String^ query)
+{
+    System::UriBuilder^ builder = DrNew System::UriBuilder("file:///");
+    builder->Path = dataPath;
+    if (query->Length > 0)
+    {
+        builder->Query = query;
+    }
+    return DrString(builder->Uri->AbsoluteUri);
+}
+
+static void DeleteEntryFiles(DirectoryInfo^ directory, System::String^ entryName)
+{
+    /* the index goes first so a lookup never finds an entry with missing data */
+    File::Delete(Path::Combine(directory->FullName, entryName + ".idx"));
+
+    array<FileInfo^>^ data = directory->GetFiles(entryName + "_*");
+    int i;
+    for (i=0; i<data->Length; ++i)
+    {
+        data[i]->Delete();
+    }
+}
+
+DrOutputCache::DrOutputCache(DrGraphPtr graph)
+    : DrSharedCritSec(graph)
+{
+    m_messagePump = graph->GetCluster()->GetMessagePump();
+    m_universe = graph->GetCluster()->GetUniverse();
+    m_directory = graph->GetParameters()->m_outputCacheDirectory;
+    m_maxBytes = graph->GetParameters()->m_outputCacheMaxBytes;
+    m_scope = graph->GetParameters()->m_outputCacheScope;
+    m_shutdown = false;
+
+    m_storeLock = DrNew DrCritSec();
+    m_index = DrNew DrOutputCacheIndex();
+    m_indexBytes = 0;
+
+    m_hits = 0;
+    m_misses = 0;
+    m_bytesServed = 0;
+    m_stored = 0;
+    m_bytesStored = 0;
+    m_evicted = 0;
+
+    if (IsEnabled())
+    {
+        try
+        {
+            Directory::CreateDirectory(m_directory.GetString());
+            DrLogI("Stage output cache in %s holding up to %I64u bytes",
+                   m_directory.GetChars(), m_maxBytes);
+
+            if (m_scope == 0)
+            {
+                /* nothing identifies the code this job runs, so make its
+                   entries unreachable from any other job */
+                array<unsigned char>^ guid = System::Guid::NewGuid().ToByteArray();
+                m_scope = System::BitConverter::ToUInt64(guid, 0) ^ System::BitConverter::ToUInt64(guid, 8);
+                DrLogW("Stage output cache entries will only be reused within this job");
+            }
+
+            LoadIndex();
+        }
+        catch (System::Exception^ e)
+        {
+            DrString reason(e->Message);
+            DrLogW("Disabling stage output cache: can't create %s: %s",
+                   m_directory.GetChars(), reason.GetChars());
+            m_directory = DrString();
+        }
+    }
+}
+
+void DrOutputCache::Discard()
+{
+    m_universe = DrNull;
+}
+
+bool DrOutputCache::IsEnabled()
+{
+    return (m_directory.GetCharsLength() > 0 && m_maxBytes > 0 && m_shutdown == false);
+}
+
+UINT64 DrOutputCache::GetScope()
+{
+    return m_scope;
+}
+
+DrString DrOutputCache::GetEntryName(UINT64 fingerprint)
+{
+    DrString name;
+    name.SetF("%016I64x", fingerprint);
+    return name;
+}
+
+void DrOutputCache::LoadIndex()
+{
+    DirectoryInfo^ directory = DrNew DirectoryInfo(m_directory.GetString());
+    array<FileInfo^>^ index = directory->GetFiles("*.idx");
+
+    int i;
+    for (i=0; i<index->Length; ++i)
+    {
+        System::String^ name = Path::GetFileNameWithoutExtension(index[i]->Name);
+        UINT64 fingerprint;
+        if (System::UInt64::TryParse(name, System::Globalization::NumberStyles::HexNumber,
+                                     nullptr, fingerprint) == false)
+        {
+            continue;
+        }
+
+        DrString entryName(name);
+        DrOutputCacheEntryRef entry = ReadEntry(index[i]->FullName, entryName);
+        if (entry == DrNull)
+        {
+            /* the index is renamed into place after the data, and deleted
+               before it, so a damaged entry will never become usable */
+            try
+            {
+                DeleteEntryFiles(directory, name);
+            }
+            catch (System::Exception^)
+            {
+            }
+            continue;
+        }
+
+        m_index->Add(fingerprint, entry);
+        m_indexBytes += entry->m_totalBytes;
+    }
+
+    DrLogI("Stage output cache holds %d entries with %I64u bytes",
+           m_index->GetSize(), m_indexBytes);
+}
+
+DrOutputCacheEntryRef DrOutputCache::ReadEntry(System::String^ indexPath, DrString entryName)
+{
+    try
+    {
+        /* the index holds the name of the computer that wrote the entry, the
+           number of outputs, then a line for each output with its length and
+           the query part of the URI it was written with, which carries the
+           compression mode */
+        array<System::String^>^ line = File::ReadAllLines(indexPath);
+        if (line->Length < 2)
+        {
+            DrLogW("Stage output cache entry %s has a truncated index", entryName.GetChars());
+            return DrNull;
+        }
+
+        int numberOfOutputs = System::Int32::Parse(line[1]);
+        if (numberOfOutputs < 0 || line->Length != numberOfOutputs + 2)
+        {
+            DrLogW("Stage output cache entry %s has a damaged index", entryName.GetChars());
+            return DrNull;
+        }
+
+        DrOutputCacheEntryRef entry = DrNew DrOutputCacheEntry();
+        entry->m_computerName = DrString(line[0]);
+        entry->m_uri = DrNew DrStringArray(numberOfOutputs);
+        entry->m_length = DrNew DrUINT64Array(numberOfOutputs);
+        entry->m_totalBytes = 0;
+        entry->m_lastUsed = File::GetLastAccessTimeUtc(indexPath);
+        entry->m_lastUsedChanged = false;
+
+        int i;
+        for (i=0; i<numberOfOutputs; ++i)
+        {
+            array<System::String^>^ field = line[i+2]->Split(L'\t');
+            UINT64 expected = System::UInt64::Parse(field[0]);
+
+            DrString dataName;
+            dataName.SetF("%s_%d", entryName.GetChars(), i);
+            FileInfo^ data = DrNew FileInfo(Path::Combine(m_directory.GetString(), dataName.GetString()));
+            if (data->Exists == false || (UINT64) data->Length != expected)
+            {
+                DrLogW("Stage output cache entry %s output %d is missing or damaged",
+                       entryName.GetChars(), i);
+                return DrNull;
+            }
+
+            entry->m_uri[i] = MakeDataURI(data->FullName, (field->Length > 1) ? field[1] : "");
+            entry->m_length[i] = expected;
+            entry->m_totalBytes += expected;
+        }
+
+        return entry;
+    }
+    catch (System::Exception^ e)
+    {
+        DrString reason(e->Message);
+        DrLogW("Can't read stage output cache entry %s: %s", entryName.GetChars(), reason.GetChars());
+        return DrNull;
+    }
+}
+
+DrCachedOutputGeneratorRef DrOutputCache::Lookup(UINT64 fingerprint, int vertexId, int version,
+                                                 int numberOfOutputs)
+{
+    if (IsEnabled() == false)
+    {
+        return DrNull;
+    }
+
+    DrCachedOutputGeneratorRef hit;
+    UINT64 bytes = 0;
+    {
+        DrAutoCriticalSection acs(m_storeLock);
+
+        DrOutputCacheEntryRef entry;
+        if (m_index->TryGetValue(fingerprint, entry))
+        {
+            hit = MakeHitUnderLock(fingerprint, entry, vertexId, version, numberOfOutputs);
+            if (hit != DrNull)
+            {
+                bytes = entry->m_totalBytes;
+            }
+        }
+    }
+
+    if (hit == DrNull)
+    {
+        ++m_misses;
+        DrLogI("Stage output cache miss for vertex %d.%d fingerprint %s",
+               vertexId, version, GetEntryName(fingerprint).GetChars());
+        return DrNull;
+    }
+
+    ++m_hits;
+    m_bytesServed += bytes;
+    DrLogI("Stage output cache hit for vertex %d.%d fingerprint %s: %I64u bytes, %d hits %d misses",
+           vertexId, version, GetEntryName(fingerprint).GetChars(), bytes, m_hits, m_misses);
+
+    return hit;
+}
+
+DrCachedOutputGeneratorRef DrOutputCache::MakeHitUnderLock(UINT64 fingerprint, DrOutputCacheEntryPtr entry,
+                                                           int vertexId, int version,
+                                                           int numberOfOutputs)
+{
+    DrString entryName = GetEntryName(fingerprint);
+
+    if (entry->m_uri->Allocated() != numberOfOutputs)
+    {
+        DrLogW("Stage output cache entry %s doesn't match vertex %d with %d outputs",
+               entryName.GetChars(), vertexId, numberOfOutputs);
+        return DrNull;
+    }
+
+    /* another job sharing the directory may have evicted the entry since it
+       was indexed. Its index file is deleted before its data, so that is the
+       one thing worth checking; a reader that finds the data damaged anyway
+       invalidates the entry */
+    try
+    {
+        System::String^ indexPath = Path::Combine(m_directory.GetString(), entryName.GetString() + ".idx");
+        if (File::Exists(indexPath) == false)
+        {
+            DrLogI("Stage output cache entry %s has been deleted", entryName.GetChars());
+            RemoveFromIndexUnderLock(fingerprint);
+            return DrNull;
+        }
+    }
+    catch (System::Exception^ e)
+    {
+        DrString reason(e->Message);
+        DrLogW("Can't read stage output cache entry %s: %s", entryName.GetChars(), reason.GetChars());
+        return DrNull;
+    }
+
+    /* the computer only tells the stage statistics where the data came
+       from, so if it has left the cluster any computer will do */
+    DrResourcePtr computer;
+    {
+        DrAutoCriticalSection acs(m_universe->GetResourceLock());
+        computer = m_universe->LookUpResourceInternal(entry->m_computerName);
+        if (computer == DrNull)
+        {
+            DrResourceListRef computers = m_universe->GetResources(DRL_Computer);
+            if (computers->Size() == 0)
+            {
+                return DrNull;
+            }
+            computer = computers[0];
+        }
+    }
+
+    /* eviction orders entries by this; it is written back to the index file
+       on a pool thread the next time an entry is stored */
+    entry->m_lastUsed = System::DateTime::UtcNow;
+    entry->m_lastUsedChanged = true;
+
+    return DrNew DrCachedOutputGenerator(vertexId, version, fingerprint, computer,
+                                         entry->m_uri, entry->m_length);
+}
+
+void DrOutputCache::RemoveFromIndexUnderLock(UINT64 fingerprint)
+{
+    DrOutputCacheEntryRef entry;
+    if (m_index->TryGetValue(fingerprint, entry))
+    {
+        m_index->Remove(fingerprint);
+        m_indexBytes -= entry->m_totalBytes;
+    }
+}
+
+void DrOutputCache::DeliverHit(DrActiveVertexPtr vertex, DrCachedOutputGeneratorPtr generator)
+{
+    DrOutputCacheHitRef hit = DrNew DrOutputCacheHit();
+    hit->m_vertex = vertex;
+    hit->m_generator = generator;
+
+    DrOutputCacheHitMessageRef message = DrNew DrOutputCacheHitMessage(this, hit);
+    m_messagePump->EnQueue(message);
+}
+
+void DrOutputCache::ReceiveMessage(DrOutputCacheHitRef hit)
+{
+    hit->m_vertex->ReactToCachedVersion(hit->m_generator);
+}
+
+void DrOutputCache::Store(DrActiveVertexOutputGeneratorPtr generator, int numberOfOutputs)
+{
+    if (IsEnabled() == false || generator->GetFingerprint() == 0)
+    {
+        return;
+    }
+
+    if (dynamic_cast<DrCachedOutputGeneratorPtr>(generator) != DrNull)
+    {
+        /* these outputs are already in the cache */
+        return;
+    }
+
+    DrResourcePtr computer = generator->GetResource();
+    if (computer == DrNull)
+    {
+        return;
+    }
+
+    /* the copy runs on the graph manager's computer, so ask for the URI a
+       vertex on some other computer would read the outputs with, which goes
+       through the writer's file server. Only when the writer is the only
+       computer in the cluster is its local path the one to use */
+    DrResourcePtr reader = computer;
+    {
+        DrAutoCriticalSection acs(m_universe->GetResourceLock());
+        DrResourceListRef computers = m_universe->GetResources(DRL_Computer);
+        int i;
+        for (i=0; i<computers->Size(); ++i)
+        {
+            if (computers[i]->GetLocality() != computer->GetLocality())
+            {
+                reader = computers[i];
+                break;
+            }
+        }
+    }
+
+    DrStringArrayRef sourceUri = DrNew DrStringArray(numberOfOutputs);
+    DrStringArrayRef query = DrNew DrStringArray(numberOfOutputs);
+
+    int i;
+    for (i=0; i<numberOfOutputs; ++i)
+    {
+        DrString uri = generator->GetURIForRead(i, DCT_File, reader);
+        System::Uri^ parsed = DrNew System::Uri(uri.GetString());
+        if (parsed->IsFile == false &&
+            parsed->Scheme != System::Uri::UriSchemeHttp && parsed->Scheme != System::Uri::UriSchemeHttps)
+        {
+            DrLogI("Not caching outputs for fingerprint %s: can't copy from %s",
+                   GetEntryName(generator->GetFingerprint()).GetChars(), uri.GetChars());
+            return;
+        }
+
+        sourceUri[i] = uri;
+        query[i] = DrString(parsed->Query->TrimStart(L'?'));
+    }
+
+    DrOutputCacheWriterRef writer =
+        DrNew DrOutputCacheWriter(this, generator->GetFingerprint(), computer->GetName(),
+                                  sourceUri, query);
+    System::Threading::Tasks::Task::Factory->StartNew(
+        DrNew System::Action(writer, &DrOutputCacheWriter::Run));
+}
+
+void DrOutputCache::WriteEntry(UINT64 fingerprint, DrString computerName,
+                               DrStringArrayPtr sourceUri, DrStringArrayPtr query)
+{
+    DrString entryName = GetEntryName(fingerprint);
+    System::String^ indexPath = Path::Combine(m_directory.GetString(), entryName.GetString() + ".idx");
+
+    if (File::Exists(indexPath))
+    {
+        /* a duplicate execution got here first */
+        return;
+    }
+
+    DrStringArrayRef source = sourceUri;
+    DrStringArrayRef queryString = query;
+    int numberOfOutputs = source->Allocated();
+
+    array<System::String^>^ line = DrNew array<System::String^>(numberOfOutputs + 2);
+    line[0] = computerName.GetString();
+    line[1] = numberOfOutputs.ToString();
+
+    array<System::String^>^ dataPath = DrNew array<System::String^>(numberOfOutputs);
+    DrUINT64ArrayRef dataLength = DrNew DrUINT64Array(numberOfOutputs);
+    UINT64 entryBytes = 0;
+
+    /* copy under temporary names, outside the lock, so lookups carry on
+       while the data moves and never see half an entry */
+    int i;
+    try
+    {
+        for (i=0; i<numberOfOutputs; ++i)
+        {
+            DrString dataName;
+            dataName.SetF("%s_%d", entryName.GetChars(), i);
+            dataPath[i] = Path::Combine(m_directory.GetString(), dataName.GetString());
+
+            System::Uri^ from = DrNew System::Uri(source[i].GetString());
+            if (from->IsFile)
+            {
+                File::Copy(from->LocalPath, dataPath[i] + ".tmp", true);
+            }
+            else
+            {
+                System::Net::WebClient^ client = DrNew System::Net::WebClient();
+                try
+                {
+                    client->DownloadFile(from, dataPath[i] + ".tmp");
+                }
+                finally
+                {
+                    delete client;
+                }
+            }
+
+            UINT64 length = (UINT64) (DrNew FileInfo(dataPath[i] + ".tmp"))->Length;
+            dataLength[i] = length;
+            entryBytes += length;
+            line[i+2] = System::String::Format("{0}\t{1}", length, queryString[i].GetString());
+        }
+    }
+    catch (System::Exception^ e)
+    {
+        DrString reason(e->Message);
+        DrLogW("Not caching outputs for fingerprint %s: %s", entryName.GetChars(), reason.GetChars());
+
+        DrAutoCriticalSection acs(m_storeLock);
+        try
+        {
+            DeleteEntryFiles(DrNew DirectoryInfo(m_directory.GetString()), entryName.GetString());
+        }
+        catch (System::Exception^)
+        {
+        }
+        return;
+    }
+
+    DrAutoCriticalSection acs(m_storeLock);
+
+    try
+    {
+        if (File::Exists(indexPath))
+        {
+            /* a duplicate finished copying while we were */
+            DeleteEntryFiles(DrNew DirectoryInfo(m_directory.GetString()), entryName.GetString());
+            return;
+        }
+
+        for (i=0; i<numberOfOutputs; ++i)
+        {
+            if (File::Exists(dataPath[i]))
+            {
+                File::Delete(dataPath[i]);
+            }
+            File::Move(dataPath[i] + ".tmp", dataPath[i]);
+        }
+
+        /* the index is written last and renamed into place, which is what
+           makes the entry visible */
+        File::WriteAllLines(indexPath + ".tmp", line);
+        File::Move(indexPath + ".tmp", indexPath);
+    }
+    catch (System::Exception^ e)
+    {
+        DrString reason(e->Message);
+        DrLogW("Failed to store stage output cache entry %s: %s", entryName.GetChars(), reason.GetChars());
+        return;
+    }
+
+    DrOutputCacheEntryRef entry = DrNew DrOutputCacheEntry();
+    entry->m_computerName = computerName;
+    entry->m_uri = DrNew DrStringArray(numberOfOutputs);
+    entry->m_length = dataLength;
+    entry->m_totalBytes = entryBytes;
+    entry->m_lastUsed = System::DateTime::UtcNow;
+    entry->m_lastUsedChanged = false;
+    for (i=0; i<numberOfOutputs; ++i)
+    {
+        entry->m_uri[i] = MakeDataURI(dataPath[i], queryString[i].GetString());
+    }
+
+    RemoveFromIndexUnderLock(fingerprint);
+    m_index->Add(fingerprint, entry);
+    m_indexBytes += entryBytes;
+
+    ++m_stored;
+    m_bytesStored += entryBytes;
+    DrLogI("Stored stage output cache entry %s: %d outputs %I64u bytes",
+           entryName.GetChars(), numberOfOutputs, entryBytes);
+
+    SaveLastUsedUnderLock();
+    EvictUnderLock();
+}
+
+void DrOutputCache::SaveLastUsedUnderLock()
+{
+    /* so that other jobs sharing the directory, and later ones, evict the
+       entries this job used last */
+    DrOutputCacheIndex::DrEnumerator e = m_index->GetDrEnumerator();
+    while (e.MoveNext())
+    {
+        DrOutputCacheEntryPtr entry = e.GetValue();
+        if (entry->m_lastUsedChanged)
+        {
+            entry->m_lastUsedChanged = false;
+
+            DrString entryName = GetEntryName(e.GetKey());
+            try
+            {
+                File::SetLastAccessTimeUtc(Path::Combine(m_directory.GetString(), entryName.GetString() + ".idx"),
+                                           entry->m_lastUsed);
+            }
+            catch (System::Exception^)
+            {
+                /* the entry has been deleted by another job, which a lookup
+                   will notice */
+            }
+        }
+    }
+}
+
+void DrOutputCache::EvictUnderLock()
+{
+    if (m_indexBytes <= m_maxBytes)
+    {
+        return;
+    }
+
+    /* least recently used first */
+    int numberOfEntries = m_index->GetSize();
+    array<UINT64>^ fingerprint = DrNew array<UINT64>(numberOfEntries);
+    array<System::DateTime>^ lastUsed = DrNew array<System::DateTime>(numberOfEntries);
+
+    int i = 0;
+    DrOutputCacheIndex::DrEnumerator entries = m_index->GetDrEnumerator();
+    while (entries.MoveNext())
+    {
+        fingerprint[i] = entries.GetKey();
+        lastUsed[i] = entries.GetValue()->m_lastUsed;
+        ++i;
+    }
+    System::Array::Sort(lastUsed, fingerprint);
+
+    DirectoryInfo^ directory = DrNew DirectoryInfo(m_directory.GetString());
+    for (i=0; i<numberOfEntries && m_indexBytes > m_maxBytes; ++i)
+    {
+        DrString entryName = GetEntryName(fingerprint[i]);
+        try
+        {
+            DeleteEntryFiles(directory, entryName.GetString());
+        }
+        catch (System::Exception^ e)
+        {
+            DrString reason(e->Message);
+            DrLogW("Failed to evict stage output cache entry %s: %s", entryName.GetChars(), reason.GetChars());
+            continue;
+        }
+
+        DrOutputCacheEntryRef entry;
+        m_index->TryGetValue(fingerprint[i], entry);
+        RemoveFromIndexUnderLock(fingerprint[i]);
+        ++m_evicted;
+
+        DrLogI("Evicted stage output cache entry %s: %I64u bytes, %I64u bytes remain",
+               entryName.GetChars(), entry->m_totalBytes, m_indexBytes);
+    }
+}
+
+void DrOutputCache::Invalidate(UINT64 fingerprint)
+{
+    if (m_directory.GetCharsLength() == 0)
+    {
+        return;
+    }
+
+    DrString entryName = GetEntryName(fingerprint);
+    DrLogW("Invalidating stage output cache entry %s after a read failure", entryName.GetChars());
+
+    DrAutoCriticalSection acs(m_storeLock);
+    RemoveFromIndexUnderLock(fingerprint);
+    try
+    {
+        DeleteEntryFiles(DrNew DirectoryInfo(m_directory.GetString()), entryName.GetString());
+    }
+    catch (System::Exception^ e)
+    {
+        DrString reason(e->Message);
+        DrLogW("Failed to delete stage output cache entry %s: %s", entryName.GetChars(), reason.GetChars());
+    }
+}
+
+void DrOutputCache::Shutdown()
+{
+    if (m_directory.GetCharsLength() == 0)
+    {
+        return;
+    }
+
+    m_shutdown = true;
+
+    DrAutoCriticalSection acs(m_storeLock);
+    SaveLastUsedUnderLock();
+    DrLogI("Stage output cache: %d hits serving %I64u bytes, %d misses, %d entries stored holding %I64u bytes, %d evicted",
+           m_hits, m_bytesServed, m_misses, m_stored, m_bytesStored, m_evicted);
+}
@@ -0,0 +1,152 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+
+DRDECLARECLASS(DrOutputCache);
+DRREF(DrOutputCache);
+
+/* a hit is delivered to its vertex through the message queue, because the
+   lookup happens while a version is being started, which may be partway
+   through the completion of an upstream vertex */
+DRBASECLASS(DrOutputCacheHit)
+{
+public:
+    DrActiveVertexRef           m_vertex;
+    DrCachedOutputGeneratorRef  m_generator;
+};
+DRREF(DrOutputCacheHit);
+
+typedef DrListener<DrOutputCacheHitRef> DrOutputCacheHitListener;
+DRIREF(DrOutputCacheHitListener);
+
+typedef DrMessage<DrOutputCacheHitRef> DrOutputCacheHitMessage;
+DRREF(DrOutputCacheHitMessage);
+
+/* copies one completed execution's outputs into the cache on a pool
+   thread, so the graph manager isn't held up while the data moves */
+DRBASECLASS(DrOutputCacheWriter)
+{
+public:
+    DrOutputCacheWriter(DrOutputCachePtr cache, UINT64 fingerprint, DrString computerName,
+                        DrStringArrayPtr sourceUri, DrStringArrayPtr query);
+
+    void Run();
+
+private:
+    DrOutputCacheRef   m_cache;
+    UINT64             m_fingerprint;
+    DrString           m_computerName;
+    DrStringArrayRef   m_sourceUri;
+    DrStringArrayRef   m_query;
+};
+DRREF(DrOutputCacheWriter);
+
+/* what the cache knows about one stored entry. The index of entries is
+   read from the directory when the cache is created and kept up to date as
+   entries are written and evicted, so a lookup on the graph manager's
+   thread only has to check that the entry is still on disk */
+DRBASECLASS(DrOutputCacheEntry)
+{
+public:
+    DrString            m_computerName;
+    DrStringArrayRef    m_uri;
+    DrUINT64ArrayRef    m_length;
+    UINT64              m_totalBytes;
+    System::DateTime    m_lastUsed;
+    bool                m_lastUsedChanged;
+};
+DRREF(DrOutputCacheEntry);
+
+typedef DrDictionary<UINT64,DrOutputCacheEntryRef> DrOutputCacheIndex;
+DRREF(DrOutputCacheIndex);
+
+/* Completed executions are stored in a local directory keyed by a
+   fingerprint of the vertex program, its arguments and the identity of its
+   inputs (see DrActiveVertex::ComputeFingerprint). When a later version of
+   a vertex with the same fingerprint is ready to start, in this job or a
+   later one running the same code, the stored outputs are handed downstream instead of
+   scheduling a process. Each entry is an index file naming its outputs'
+   lengths plus one data file per output; the least recently used entries
+   are deleted once the entries this job knows about hold more than the
+   configured size. The directory has to be readable by vertex hosts at the
+   same path, e.g. on a local cluster or a share. */
+DRCLASS(DrOutputCache) : public DrSharedCritSec, public DrOutputCacheHitListener
+{
+public:
+    DrOutputCache(DrGraphPtr graph);
+    void Discard();
+
+    bool IsEnabled();
+
+    /* extended into every fingerprint so entries are only shared between
+       jobs running the same code */
+    UINT64 GetScope();
+
+    /* returns DrNull if there's no usable entry for the fingerprint */
+    DrCachedOutputGeneratorRef Lookup(UINT64 fingerprint, int vertexId, int version,
+                                      int numberOfOutputs);
+    void DeliverHit(DrActiveVertexPtr vertex, DrCachedOutputGeneratorPtr generator);
+
+    /* starts copying the outputs of a completed execution into the cache */
+    void Store(DrActiveVertexOutputGeneratorPtr generator, int numberOfOutputs);
+
+    /* deletes an entry that a reader couldn't use */
+    void Invalidate(UINT64 fingerprint);
+
+    void Shutdown();
+
+    /* called on a pool thread by DrOutputCacheWriter */
+    void WriteEntry(UINT64 fingerprint, DrString computerName,
+                    DrStringArrayPtr sourceUri, DrStringArrayPtr query);
+
+    /* DrOutputCacheHitListener implementation */
+    virtual void ReceiveMessage(DrOutputCacheHitRef hit);
+
+private:
+    DrString GetEntryName(UINT64 fingerprint);
+    void LoadIndex();
+    DrOutputCacheEntryRef ReadEntry(System::String^ indexPath, DrString entryName);
+    DrCachedOutputGeneratorRef MakeHitUnderLock(UINT64 fingerprint, DrOutputCacheEntryPtr entry,
+                                                int vertexId, int version, int numberOfOutputs);
+    void RemoveFromIndexUnderLock(UINT64 fingerprint);
+    void SaveLastUsedUnderLock();
+    void EvictUnderLock();
+
+    DrMessagePumpRef   m_messagePump;
+    DrUniverseRef      m_universe;
+    DrString           m_directory;
+    UINT64             m_maxBytes;
+    UINT64             m_scope;
+    bool               m_shutdown;
+
+    /* serializes the index and the entry files between lookups on the
+       graph manager's thread and writers on pool threads */
+    DrCritSecRef       m_storeLock;
+    DrOutputCacheIndexRef  m_index;
+    UINT64             m_indexBytes;
+
+    int                m_hits;
+    int                m_misses;
+    UINT64             m_bytesServed;
+    int                m_stored;
+    UINT64             m_bytesStored;
+    int                m_evicted;
+};
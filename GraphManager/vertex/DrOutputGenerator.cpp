@@ -140,6 +140,17 @@ DrEdge DrEdgeHolder::GetEdge(int edgeIndex)
 }
 
 
+DrActiveVertexOutputGenerator::DrActiveVertexOutputGenerator()
+{
+    m_fingerprint = 0;
+    m_pipesUseFiles = false;
+}
+
+void DrActiveVertexOutputGenerator::SetPipesUseFiles(bool pipesUseFiles)
+{
+    m_pipesUseFiles = pipesUseFiles;
+}
+
 void DrActiveVertexOutputGenerator::StoreOutputLengths(DrVertexProcessStatusPtr status, DrTimeInterval runningTime)
 {
     DrOutputChannelArrayRef outputs = status->GetOutputChannels();
@@ -160,6 +171,16 @@ DrTimeInterval DrActiveVertexOutputGenerator::GetRunningTime()
     return m_runningTime;
 }
 
+void DrActiveVertexOutputGenerator::SetFingerprint(UINT64 fingerprint)
+{
+    m_fingerprint = fingerprint;
+}
+
+UINT64 DrActiveVertexOutputGenerator::GetFingerprint()
+{
+    return m_fingerprint;
+}
+
 #ifndef _MANAGED
 int DrActiveVertexOutputGenerator::s_intermediateCompressionMode = 0;
 #endif
@@ -229,8 +250,14 @@ DrString DrActiveVertexOutputGenerator::GetURIForWrite(DrEdgeHolderPtr outputEdg
         break;
 
     case DCT_Pipe:
-        /* TODO implement pipes */
-        DrLogA("Pipes not implemented");
+        if (m_pipesUseFiles)
+        {
+            uri = GetURIForWrite(outputEdges, output, DCT_File, metaData);
+        }
+        else
+        {
+            uri = GetPipeURI(output);
+        }
         break;
 
     case DCT_Fifo:
@@ -245,6 +272,17 @@ DrString DrActiveVertexOutputGenerator::GetURIForWrite(DrEdgeHolderPtr outputEdg
     return uri;
 }
 
+/* the gang puts both ends of a pipe on the same computer, so the data streams
+   through a shared-memory ring. The writer's working directory is unique to
+   its process, which keeps the ring names of different jobs and versions
+   apart */
+DrString DrActiveVertexOutputGenerator::GetPipeURI(int output)
+{
+    DrString uri;
+    uri.SetF("shm://%s/%d_%d_%d", m_directory.GetChars(), m_vertexId, output, m_version);
+    return uri;
+}
+
 DrString DrActiveVertexOutputGenerator::GetURIForRead(int output, DrConnectorType type,
                                                       DrResourcePtr runningResource)
 {
@@ -272,8 +310,23 @@ DrString DrActiveVertexOutputGenerator::GetURIForRead(int output, DrConnectorTyp
         break;
 
     case DCT_Pipe:
-        /* TODO implement pipes */
-        DrLogA("Pipes not implemented");
+        if (m_pipesUseFiles)
+        {
+            uri = GetURIForRead(output, DCT_File, runningResource);
+        }
+        else if (runningResource != m_assignedNode)
+        {
+            /* the shared-memory ring can't be reached from here. Hand out the file
+               the writer would have used so the read fails and the gang runs again,
+               rather than taking down the job */
+            DrLogW("Pipe from vertex %d.%d output %d is being read on a different computer",
+                   m_vertexId, m_version, output);
+            uri = GetURIForRead(output, DCT_File, runningResource);
+        }
+        else
+        {
+            uri = GetPipeURI(output);
+        }
         break;
 
     case DCT_Fifo:
@@ -294,6 +347,51 @@ DrResourcePtr DrActiveVertexOutputGenerator::GetResource()
 }
 
 
+DrCachedOutputGenerator::DrCachedOutputGenerator(int vertexId, int version, UINT64 fingerprint,
+                                                 DrResourcePtr computer,
+                                                 DrStringArrayPtr uri, DrUINT64ArrayPtr length)
+{
+    SetProcess(DrNull, vertexId, version);
+    SetFingerprint(fingerprint);
+
+    m_computer = computer;
+    m_uri = uri;
+    m_length = length;
+}
+
+int DrCachedOutputGenerator::GetNumberOfOutputs()
+{
+    return m_uri->Allocated();
+}
+
+UINT64 DrCachedOutputGenerator::GetOutputLength(int output)
+{
+    return m_length[output];
+}
+
+DrResourcePtr DrCachedOutputGenerator::GetResource()
+{
+    /* the computer that originally wrote the outputs, so the stage
+       statistics have somewhere to put them */
+    return m_computer;
+}
+
+DrAffinityRef DrCachedOutputGenerator::GetOutputAffinity(int output)
+{
+    /* the cached copy isn't on any particular computer in the cluster */
+    DrAffinityRef a = DrNew DrAffinity();
+    a->SetWeight(m_length[output]);
+    return a;
+}
+
+DrString DrCachedOutputGenerator::GetURIForRead(int output, DrConnectorType type,
+                                                DrResourcePtr /* unused runningResource */)
+{
+    DrAssert(type == DCT_File);
+    return m_uri[output];
+}
+
+
 DrStorageVertexOutputGenerator::DrStorageVertexOutputGenerator(int partitionIndex,
                                                                DrIInputPartitionReaderPtr reader)
 {
@@ -316,6 +414,11 @@ int DrStorageVertexOutputGenerator::GetPartitionIndex()
     return m_partitionIndex;
 }
 
+UINT64 DrStorageVertexOutputGenerator::GetVersionStamp()
+{
+    return m_reader->GetVersionStamp(m_partitionIndex);
+}
+
 DrAffinityRef DrStorageVertexOutputGenerator::GetOutputAffinity(int /* unused output */)
 {
     return m_reader->GetAffinity(m_partitionIndex);
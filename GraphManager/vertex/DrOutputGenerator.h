@@ -88,6 +88,8 @@ DRAREF(DrGeneratorArray,DrVertexOutputGeneratorRef);
 DRCLASS(DrActiveVertexOutputGenerator) : public DrVertexOutputGenerator
 {
 public:
+    DrActiveVertexOutputGenerator();
+
     void StoreOutputLengths(DrVertexProcessStatusPtr status, DrTimeInterval runningTime);
     void SetProcess(DrProcessHandlePtr process, int vertexId, int version);
 
@@ -101,9 +103,20 @@ public:
 
     DrTimeInterval GetRunningTime();
 
+    /* identifies the computation and inputs that produced the outputs, or 0 if
+       the execution can't be found in the stage output cache */
+    void SetFingerprint(UINT64 fingerprint);
+    UINT64 GetFingerprint();
+
+    /* set when the gang couldn't be placed on one computer, so pipe
+       edges are written to and read from files instead */
+    void SetPipesUseFiles(bool pipesUseFiles);
+
     static int s_intermediateCompressionMode;
 
 private:
+    DrString GetPipeURI(int output);
+
     int                   m_vertexId;
     int                   m_version;
     DrUINT64ArrayRef      m_lengthArray;
@@ -111,14 +124,41 @@ private:
     DrString              m_directory;
     DrResourcePtr         m_assignedNode;
     int                   m_compression;
+    UINT64                m_fingerprint;
+    bool                  m_pipesUseFiles;
 };
 DRREF(DrActiveVertexOutputGenerator);
 
+/* stands in for an execution whose outputs were found in the stage output
+   cache, so downstream vertices read the cached copies instead */
+DRCLASS(DrCachedOutputGenerator) : public DrActiveVertexOutputGenerator
+{
+public:
+    DrCachedOutputGenerator(int vertexId, int version, UINT64 fingerprint,
+                            DrResourcePtr computer, DrStringArrayPtr uri, DrUINT64ArrayPtr length);
+
+    int GetNumberOfOutputs();
+    UINT64 GetOutputLength(int output);
+
+    virtual DrResourcePtr GetResource() DROVERRIDE;
+    virtual DrAffinityRef GetOutputAffinity(int output) DROVERRIDE;
+    virtual DrString GetURIForRead(int output, DrConnectorType type, DrResourcePtr runningResource) DROVERRIDE;
+
+private:
+    DrResourceRef         m_computer;
+    DrStringArrayRef      m_uri;
+    DrUINT64ArrayRef      m_length;
+};
+DRREF(DrCachedOutputGenerator);
+
 DRINTERFACE(DrIInputPartitionReader)
 {
 public:
     virtual DrAffinityRef GetAffinity(int partitionIndex) DRABSTRACT;
     virtual DrString GetURIForRead(int partitionIndex, DrResourcePtr runningResource) DRABSTRACT;
+    /* something that changes whenever the partition's content does, e.g. its
+       last write time, or 0 if the store can't tell */
+    virtual UINT64 GetVersionStamp(int partitionIndex) DRABSTRACT;
 };
 DRIREF(DrIInputPartitionReader);
 
@@ -133,6 +173,7 @@ public:
     virtual DrString GetURIForRead(int output, DrConnectorType type, DrResourcePtr runningResource) DROVERRIDE;
 
     int GetPartitionIndex();
+    UINT64 GetVersionStamp();
 
 private:
     int                          m_partitionIndex;
@@ -155,6 +155,12 @@ public:
 
     virtual void CheckForDuplicates() = 0;
 
+    /* NotifyVertexHostClaim is called each time a single-vertex cohort
+       from this stage asks the vertex host pool for an idle host. If
+       reused is true it was given one, and startupTimeSaved is the
+       pool's estimate of the time the reuse saved. */
+    virtual void NotifyVertexHostClaim(bool reused, DrTimeInterval startupTimeSaved) = 0;
+
     virtual void NotifyInputReady(DrStorageVertexPtr vertex, DrAffinityPtr affinity) = 0;
 
     virtual void SetStillAddingVertices(bool stillAddingVertices) = 0;
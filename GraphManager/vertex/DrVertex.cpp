@@ -210,6 +210,7 @@ DrActiveVertex::DrActiveVertex(DrStageManagerPtr stage, DrProcessTemplatePtr pro
     m_registeredWithGraph = false;
 
     m_runningVertex = DrNew DrVertexRecordList();
+    m_cachedVersion = DrNew DrCompletedVertexList();
     m_spareCompletedRecord = DrNew DrCompletedVertexList();
 }
 
@@ -238,6 +239,7 @@ void DrActiveVertex::DiscardDerived()
         }
     }
     m_runningVertex = DrNull;
+    m_cachedVersion = DrNull;
 
     m_completedRecord = DrNull;
 
@@ -481,6 +483,42 @@ void DrActiveVertex::InitializeForGraphExecution()
         {
             m_cohort->GetGang()->IncrementUnreadyVertices();
         }
+
+        /* the two ends of a pipe have to start together. Whichever end is
+           initialized second joins the other's start clique */
+        JoinPipeNeighbours(m_inputEdges);
+        JoinPipeNeighbours(m_outputEdges);
+    }
+}
+
+void DrActiveVertex::JoinPipeNeighbours(DrEdgeHolderPtr edges)
+{
+    int i;
+    for (i=0; i<edges->GetNumberOfEdges(); ++i)
+    {
+        DrEdge e = edges->GetEdge(i);
+        if (e.m_type != DCT_Pipe || e.m_remoteVertex == DrNull)
+        {
+            continue;
+        }
+
+        /* a pipe only ever connects two active vertices */
+        DrActiveVertexPtr remote = (DrActiveVertexPtr) e.m_remoteVertex;
+        DrStartCliqueRef remoteClique = remote->GetStartClique();
+        if (remoteClique == DrNull)
+        {
+            /* not initialized yet: it will join us when it is */
+            continue;
+        }
+
+        if (m_startClique->GetGang()->HasInstantiatedVersion() ||
+            remoteClique->GetGang()->HasInstantiatedVersion())
+        {
+            DrLogA("Vertex %d(%s) can't join pipe neighbour %d(%s) after either has started a version",
+                   m_id, m_name.GetChars(), remote->GetId(), remote->GetName().GetChars());
+        }
+
+        DrStartClique::Merge(m_startClique, remoteClique);
     }
 }
 
@@ -607,6 +645,12 @@ void DrActiveVertex::StartProcess(int version)
 {
     DrAssert(m_stage->VertexIsReady(this));
 
+    UINT64 fingerprint = ComputeFingerprint(m_pendingVersion);
+    if (fingerprint != 0 && StartCachedVersion(version, fingerprint))
+    {
+        return;
+    }
+
     /* this will start the process if we are the first vertex in the cohort to want to start */
     DrCohortProcessRef cohortProcess = m_cohort->EnsureProcess(m_stage->GetGraph(), version);
 
@@ -616,12 +660,166 @@ void DrActiveVertex::StartProcess(int version)
 
     DrVertexRecordRef execution = DrNew DrVertexRecord(m_stage->GetGraph()->GetCluster(), this,
                                                        cohortProcess, generator, m_vertexTemplate);
+    execution->SetFingerprint(fingerprint);
 
     m_runningVertex->Add(execution);
 }
 
+UINT64 DrActiveVertex::ComputeFingerprint(DrVertexVersionGeneratorPtr inputs)
+{
+    if (m_stage->GetGraph()->GetOutputCache()->IsEnabled() == false)
+    {
+        return 0;
+    }
+
+    /* a hit completes the vertex without a process, which the gang only
+       allows for a vertex that runs on its own, and outputs to storage have
+       to be written by the vertex itself */
+    if (m_cohort->GetMembers()->Size() != 1 || m_cohort->GetGang()->GetCohorts()->Size() != 1)
+    {
+        return 0;
+    }
+
+    int i;
+    for (i=0; i<m_outputEdges->GetNumberOfEdges(); ++i)
+    {
+        if (m_outputEdges->GetEdge(i).m_type != DCT_File)
+        {
+            return 0;
+        }
+    }
+
+    DrFingerprintRef fingerprint = DrNew DrFingerprint();
+
+    /* the arguments name the vertex code but not its content, e.g. every
+       DryadLINQ query runs a method of the same generated DLL, so the
+       cache's scope stands in for the code and plan of the job */
+    fingerprint->ExtendUInt64(m_stage->GetGraph()->GetOutputCache()->GetScope());
+
+    /* the program and its arguments, but not the vertex id or version,
+       which differ between jobs and executions of the same computation */
+    fingerprint->ExtendString(m_processTemplate->GetCommandLineBase());
+    fingerprint->ExtendUInt64((UINT64) m_argument->Size());
+    for (i=0; i<m_argument->Size(); ++i)
+    {
+        fingerprint->ExtendString(m_argument[i]);
+    }
+
+    fingerprint->ExtendUInt64((UINT64) m_outputEdges->GetNumberOfEdges());
+    fingerprint->ExtendUInt64((UINT64) m_inputEdges->GetNumberOfEdges());
+    for (i=0; i<m_inputEdges->GetNumberOfEdges(); ++i)
+    {
+        DrEdge e = m_inputEdges->GetEdge(i);
+        if (e.m_type != DCT_File ||
+            AddInputToFingerprint(fingerprint, inputs->GetGenerator(i), e.m_remotePort) == false)
+        {
+            return 0;
+        }
+    }
+
+    return fingerprint->GetValue();
+}
+
+bool DrActiveVertex::AddInputToFingerprint(DrFingerprintPtr fingerprint,
+                                           DrVertexOutputGeneratorPtr generator, int port)
+{
+    /* a tee passes on the only output of the vertex behind it */
+    DrTeeVertexOutputGeneratorPtr tee = dynamic_cast<DrTeeVertexOutputGeneratorPtr>(generator);
+    while (tee != DrNull)
+    {
+        generator = tee->GetWrappedGenerator();
+        port = 0;
+        tee = dynamic_cast<DrTeeVertexOutputGeneratorPtr>(generator);
+    }
+
+    DrActiveVertexOutputGeneratorPtr active = dynamic_cast<DrActiveVertexOutputGeneratorPtr>(generator);
+    if (active != DrNull)
+    {
+        /* an upstream execution only has a fingerprint if everything it
+           read does, so chaining through it covers the whole computation */
+        if (active->GetFingerprint() == 0)
+        {
+            return false;
+        }
+        fingerprint->ExtendUInt64(active->GetFingerprint());
+        fingerprint->ExtendUInt64((UINT64) port);
+        return true;
+    }
+
+    DrStorageVertexOutputGeneratorPtr storage = dynamic_cast<DrStorageVertexOutputGeneratorPtr>(generator);
+    if (storage != DrNull)
+    {
+        /* name the partition by the URI of its first replica, so which
+           replica a reader would pick doesn't change the value */
+        DrAffinityRef affinity = storage->GetOutputAffinity(port);
+        DrResourceListRef location = affinity->GetLocalityArray();
+        DrResourcePtr replica = DrNull;
+        if (location->Size() > 0)
+        {
+            replica = location[0];
+        }
+
+        /* the name and size don't change when a file is rewritten in place,
+           so an input whose store can't say which version it holds isn't
+           cached at all */
+        UINT64 versionStamp = storage->GetVersionStamp();
+        if (versionStamp == 0)
+        {
+            return false;
+        }
+
+        fingerprint->ExtendString(storage->GetURIForRead(port, DCT_File, replica));
+        fingerprint->ExtendUInt64(affinity->GetWeight());
+        fingerprint->ExtendUInt64(versionStamp);
+        return true;
+    }
+
+    return false;
+}
+
+bool DrActiveVertex::StartCachedVersion(int version, UINT64 fingerprint)
+{
+    DrAssert(m_pendingVersion != DrNull && m_pendingVersion->GetVersion() == version);
+
+    DrCachedOutputGeneratorRef hit =
+        m_stage->GetGraph()->GetOutputCache()->Lookup(fingerprint, m_id, version,
+                                                      m_outputEdges->GetNumberOfEdges());
+    if (hit == DrNull)
+    {
+        return false;
+    }
+
+    m_cohort->GetGang()->StartCachedVersion(version);
+
+    m_pendingVersion = DrNull;
+    m_cachedVersion->Add(hit);
+
+    m_stage->GetGraph()->GetOutputCache()->DeliverHit(this, hit);
+
+    return true;
+}
+
+DrCachedOutputGeneratorPtr DrActiveVertex::GetCachedVersion(int version)
+{
+    int i;
+    for (i=0; i<m_cachedVersion->Size(); ++i)
+    {
+        if (m_cachedVersion[i]->GetVersion() == version)
+        {
+            return dynamic_cast<DrCachedOutputGeneratorPtr>((DrActiveVertexOutputGeneratorPtr) m_cachedVersion[i]);
+        }
+    }
+    return DrNull;
+}
+
 void DrActiveVertex::CheckForProcessAlreadyStarted(int version)
 {
+   if (GetCachedVersion(version) != DrNull)
+   {
+       /* the outputs came from the stage output cache so there is no process */
+       return;
+   }
+
    DrCohortProcessRef cohortProcess = m_cohort->GetProcessForVersion(version);
    DrAssert(cohortProcess != DrNull);
 
@@ -678,6 +876,13 @@ void DrActiveVertex::ReactToUpStreamRunningProcess(int inputPort, DrConnectorTyp
         break;
 
     case DCT_Pipe:
+        if (m_cohort->GetGang()->PipesUseFiles(generator->GetVersion()))
+        {
+            /* the pipe is going through a file, so we wait for the writer to complete */
+            return;
+        }
+        break;
+
     case DCT_Fifo:
         break;
     }
@@ -758,7 +963,45 @@ void DrActiveVertex::ReactToCompletedVertex(DrVertexRecordPtr record, DrVertexEx
     DrLogI("Reacting to completed vertex %d.%d", this->m_id, record->GetVersion());
 	DrActiveVertexOutputGeneratorRef newCompletedRecord = record->GetGenerator();
 	DrAssert(newCompletedRecord != DrNull);
-    
+
+    CompleteVersion(newCompletedRecord, record, stats);
+}
+
+void DrActiveVertex::ReactToCachedVersion(DrCachedOutputGeneratorPtr generator)
+{
+    if (m_cachedVersion == DrNull || m_cachedVersion->Remove(generator) == false)
+    {
+        /* the version was cancelled while the hit was in the queue */
+        DrLogI("Dropping stage output cache hit for cancelled vertex %d.%d", m_id, generator->GetVersion());
+        return;
+    }
+
+    DrLogI("Completing vertex %d.%d from the stage output cache", m_id, generator->GetVersion());
+
+    /* the vertex never ran, which the running time of Never tells the stage */
+    DrVertexExecutionStatisticsRef stats = DrNew DrVertexExecutionStatistics();
+    stats->m_creationTime = m_stage->GetGraph()->GetCluster()->GetCurrentTimeStamp();
+    stats->m_completionTime = stats->m_creationTime;
+    stats->m_exitCode = 0;
+    stats->m_exitStatus = DrError_VertexCompleted;
+
+    stats->SetNumberOfChannels(m_inputEdges->GetNumberOfEdges(), generator->GetNumberOfOutputs());
+    stats->m_totalOutputData = DrNew DrOutputChannelExecutionStatistics();
+    int i;
+    for (i=0; i<generator->GetNumberOfOutputs(); ++i)
+    {
+        stats->m_outputData[i]->m_dataWritten = generator->GetOutputLength(i);
+        stats->m_totalOutputData->m_dataWritten += generator->GetOutputLength(i);
+    }
+
+    CompleteVersion(generator, DrNull, stats);
+}
+
+void DrActiveVertex::CompleteVersion(DrActiveVertexOutputGeneratorPtr newCompletedRecord,
+                                     DrVertexRecordPtr record, DrVertexExecutionStatisticsPtr stats)
+{
+    int version = newCompletedRecord->GetVersion();
+
 	bool becomingComplete = false;
     if (m_completedRecord == DrNull)
     {
@@ -771,6 +1014,13 @@ void DrActiveVertex::ReactToCompletedVertex(DrVertexRecordPtr record, DrVertexEx
         DrLogI("Adding spare completed record");
 		m_spareCompletedRecord->Add(newCompletedRecord);
 	}
+
+    if (record != DrNull)
+    {
+        /* this has to happen before the graph can be rewritten below and
+           change the output edges */
+        m_stage->GetGraph()->GetOutputCache()->Store(newCompletedRecord, m_outputEdges->GetNumberOfEdges());
+    }
     
     //
     // go down output edges and let the start clique notify external
@@ -788,8 +1038,8 @@ void DrActiveVertex::ReactToCompletedVertex(DrVertexRecordPtr record, DrVertexEx
 	// during this call the graph may be rewritten!!! The set of output edges may be different,
 	// in particular
 	//
-    DrLogI("Notifying stage of vertex %d.%d completion", this->m_id, record->GetVersion());
-    m_stage->NotifyVertexCompleted(this, record->GetVersion(), newCompletedRecord->GetResource(), stats);
+    DrLogI("Notifying stage of vertex %d.%d completion", this->m_id, version);
+    m_stage->NotifyVertexCompleted(this, version, newCompletedRecord->GetResource(), stats);
     ++m_numberOfReportedCompletions;
 
     DrString message;
@@ -809,11 +1059,14 @@ void DrActiveVertex::ReactToCompletedVertex(DrVertexRecordPtr record, DrVertexEx
         e.m_remoteVertex->ReactToUpStreamCompletedVertex(e.m_remotePort, e.m_type, newCompletedRecord, stats);
     }
 
-    m_runningVertex->Remove(record);
+    if (record != DrNull)
+    {
+        m_runningVertex->Remove(record);
+    }
 
     if (becomingComplete)
     {
-        DrLogI("Notifying graph of vertex %d.%d completion", this->m_id, record->GetVersion());
+        DrLogI("Notifying graph of vertex %d.%d completion", this->m_id, version);
         m_stage->GetGraph()->NotifyActiveVertexComplete();
     }
 
@@ -858,12 +1111,24 @@ void DrActiveVertex::NotifyUpStreamCompletedVertex(int inputPort, DrConnectorTyp
 }
 
 void DrActiveVertex::ReactToUpStreamCompletedVertex(int inputPort, DrConnectorType type,
-                                                    DrVertexOutputGeneratorPtr /* unused generator */,
+                                                    DrVertexOutputGeneratorPtr generator,
                                                     DrVertexExecutionStatisticsPtr /* unused stats */)
 {
     DrEdge e = m_inputEdges->GetEdge(inputPort);
     DrAssert(e.m_type == type);
 
+    if (type == DCT_Pipe && m_cohort->GetGang()->PipesUseFiles(generator->GetVersion()))
+    {
+        /* the writer in our own gang version has finished its file, which is the
+           active input our running version was waiting for */
+        DrVertexRecordPtr record = GetRunningVersion(generator->GetVersion());
+        if (record != DrNull)
+        {
+            record->SetActiveInput(inputPort, generator);
+        }
+        return;
+    }
+
     if (type != DCT_File)
     {
         /* we don't care when these complete */
@@ -900,7 +1165,7 @@ bool DrActiveVertex::HasRunningVersion(int version)
 		}
 	}
 
-	return false;
+	return (GetCachedVersion(version) != DrNull);
 }
 
 bool DrActiveVertex::HasCompletedVersion(int version)
@@ -947,13 +1212,23 @@ void DrActiveVertex::CancelVersion(int version, DrErrorPtr error, DrCohortProces
                 DrLogI("However the process did already start, so we have to tell it we're never going to run");
                 DrVertexRecord::SendTerminateCommand(m_id, version, cohortProcess->GetProcess());
             }
-            cohortProcess->NotifyVertexCompletion();
+            cohortProcess->NotifyVertexCompletion(false);
         }
         m_pendingVersion = DrNull;
 
         return;
     }
 
+    DrCachedOutputGeneratorPtr cached = GetCachedVersion(version);
+    if (cached != DrNull)
+    {
+        /* the hit is still in the queue: it will be dropped when it arrives */
+        DrLogI("Version %d was being served from the stage output cache", version);
+        m_cachedVersion->Remove(cached);
+
+        return;
+    }
+
 	int i;
     for (i=0; i<m_runningVertex->Size(); ++i)
     {
@@ -1048,6 +1323,13 @@ void DrActiveVertex::ReactToFailedVertex(DrVertexOutputGeneratorPtr failedGenera
 
 	DrLogI("Vertex %d.%d", m_id, version);
 
+    DrCachedOutputGeneratorPtr cached = dynamic_cast<DrCachedOutputGeneratorPtr>(failedGenerator);
+    if (cached != DrNull && originalReason != DrNull && originalReason->m_code == DrError_BadOutputReported)
+    {
+        /* a reader couldn't use the cached copy, so don't serve it again */
+        m_stage->GetGraph()->GetOutputCache()->Invalidate(cached->GetFingerprint());
+    }
+
     m_stage->NotifyVertexFailed(this, version, failedGenerator->GetResource(), stats);
 
     bool foundVersion = false;
@@ -208,6 +208,7 @@ public:
     void ReactToRunningVertexUpdate(DrVertexRecordPtr record,
                                     HRESULT exitStatus, DrVertexProcessStatusPtr status);
     void ReactToCompletedVertex(DrVertexRecordPtr record, DrVertexExecutionStatisticsPtr stats);
+    void ReactToCachedVersion(DrCachedOutputGeneratorPtr generator);
     void CancelVersion(int version, DrErrorPtr error, DrCohortProcessPtr cohortProcess);
 
     int GetNumberOfReportedCompletions();
@@ -222,6 +223,17 @@ public:
 
 private:
     DrVertexRecordPtr GetRunningVersion(int version);
+    void JoinPipeNeighbours(DrEdgeHolderPtr edges);
+
+    /* returns 0 if executions of the vertex can't be served from the stage
+       output cache */
+    UINT64 ComputeFingerprint(DrVertexVersionGeneratorPtr inputs);
+    static bool AddInputToFingerprint(DrFingerprintPtr fingerprint,
+                                      DrVertexOutputGeneratorPtr generator, int port);
+    bool StartCachedVersion(int version, UINT64 fingerprint);
+    DrCachedOutputGeneratorPtr GetCachedVersion(int version);
+    void CompleteVersion(DrActiveVertexOutputGeneratorPtr newCompletedRecord,
+                         DrVertexRecordPtr record, DrVertexExecutionStatisticsPtr stats);
 
     DrCohortRef                       m_cohort;
     DrStartCliqueRef                  m_startClique;
@@ -240,6 +252,9 @@ private:
 
     DrVertexVersionGeneratorRef       m_pendingVersion;
     DrVertexRecordListRef             m_runningVertex;
+    /* versions found in the stage output cache whose hit hasn't been
+       delivered yet */
+    DrCompletedVertexListRef          m_cachedVersion;
     DrActiveVertexOutputGeneratorRef  m_completedRecord;
 	DrCompletedVertexListRef          m_spareCompletedRecord;
 };
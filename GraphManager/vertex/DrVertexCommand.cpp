@@ -22,6 +22,8 @@ limitations under the License.
 
 static const char* s_StatusPropertyLabel = "DVertexStatus";
 static const char* s_CommandPropertyLabel = "DVertexCommand";
+static const char* s_CommandBatchPropertyLabel = "DVertexCommandBatch";
+static const char* s_StatusBatchPropertyLabel = "DVertexStatusBatch";
 
 DrChannelDescription::DrChannelDescription(bool isInputChannel)
 {
@@ -961,3 +963,216 @@ DrString DrVertexCommandBlock::GetPropertyLabel(int vertexId, int vertexVersion)
     s.SetF("%s-%d.%d", s_CommandPropertyLabel, vertexId, vertexVersion);
     return s;
 }
+
+
+DrVertexCommandBatch::DrVertexCommandBatch()
+{
+    m_command = DrNew DrVertexCommandBlockList();
+}
+
+void DrVertexCommandBatch::Add(DrVertexCommandBlockPtr command)
+{
+    m_command->Add(command);
+}
+
+int DrVertexCommandBatch::GetNumberOfCommands()
+{
+    return m_command->Size();
+}
+
+DrVertexCommandBlockPtr DrVertexCommandBatch::GetCommand(int index)
+{
+    return m_command[index];
+}
+
+void DrVertexCommandBatch::Serialize(DrPropertyWriterPtr writer)
+{
+    int i;
+
+    writer->WriteProperty(DrProp_BeginTag, DrTag_VertexCommandBatch);
+
+    writer->WriteProperty(DrProp_NumberOfVertices, (UINT32) m_command->Size());
+    for (i=0; i<m_command->Size(); ++i)
+    {
+        m_command[i]->Serialize(writer);
+    }
+
+    writer->WriteProperty(DrProp_EndTag, DrTag_VertexCommandBatch);
+}
+
+HRESULT DrVertexCommandBatch::ParseProperty(DrPropertyReaderPtr reader, UINT16 enumID,
+                                            UINT32 /* unused dataLen */)
+{
+    HRESULT err;
+
+    switch (enumID)
+    {
+    default:
+        DrLogW("Unknown property in vertex command batch enumID %u", (UINT32) enumID);
+        err = reader->SkipNextPropertyOrAggregate();
+        break;
+
+    case DrProp_NumberOfVertices:
+        /* the list grows as the commands are read, so the count is only a
+           consistency check */
+        UINT32 nCommands;
+        err = reader->ReadNextProperty(enumID, nCommands);
+        if (err == S_OK && nCommands >= 0x80000000)
+        {
+            DrLogW("Too large command count %u", nCommands);
+            err = HRESULT_FROM_WIN32(ERROR_INVALID_PARAMETER);
+        }
+        break;
+
+    case DrProp_BeginTag:
+        UINT16 tagValue;
+        err = reader->PeekNextAggregateTag(&tagValue);
+        if (err != S_OK)
+        {
+            DrLogW("Error reading DrProp_BeginTag %d", err);
+        }
+        else
+        {
+            switch (tagValue)
+            {
+            case DrTag_VertexCommand:
+                {
+                    DrVertexCommandBlockRef command = DrNew DrVertexCommandBlock();
+                    err = reader->ReadAggregate(tagValue, command);
+                    if (err == S_OK)
+                    {
+                        m_command->Add(command);
+                    }
+                }
+                break;
+
+            default:
+                DrLogW("Unexpected tag %d", tagValue);
+                err = reader->SkipNextPropertyOrAggregate();
+            }
+        }
+        break;
+    }
+
+    return err;
+}
+
+DrString DrVertexCommandBatch::GetPropertyLabel()
+{
+    DrString s;
+    s.SetF("%s", s_CommandBatchPropertyLabel);
+    return s;
+}
+
+
+DrVertexStatusBatch::DrVertexStatusBatch()
+{
+    m_status = DrNew DrVertexStatusList();
+}
+
+void DrVertexStatusBatch::Add(DrVertexStatusPtr status)
+{
+    m_status->Add(status);
+}
+
+int DrVertexStatusBatch::GetNumberOfStatuses()
+{
+    return m_status->Size();
+}
+
+DrVertexStatusPtr DrVertexStatusBatch::GetStatus(int index)
+{
+    return m_status[index];
+}
+
+DrVertexStatusPtr DrVertexStatusBatch::FindStatus(int vertexId, int vertexVersion)
+{
+    int i;
+    for (i=0; i<m_status->Size(); ++i)
+    {
+        DrVertexProcessStatusPtr ps = m_status[i]->GetProcessStatus();
+        if (ps->GetVertexId() == vertexId && ps->GetVertexInstanceVersion() == vertexVersion)
+        {
+            return m_status[i];
+        }
+    }
+
+    return DrNull;
+}
+
+void DrVertexStatusBatch::Serialize(DrPropertyWriterPtr writer)
+{
+    int i;
+
+    writer->WriteProperty(DrProp_BeginTag, DrTag_VertexStatusBatch);
+
+    writer->WriteProperty(DrProp_NumberOfVertices, (UINT32) m_status->Size());
+    for (i=0; i<m_status->Size(); ++i)
+    {
+        m_status[i]->Serialize(writer);
+    }
+
+    writer->WriteProperty(DrProp_EndTag, DrTag_VertexStatusBatch);
+}
+
+HRESULT DrVertexStatusBatch::ParseProperty(DrPropertyReaderPtr reader, UINT16 enumID,
+                                           UINT32 /* unused dataLen */)
+{
+    HRESULT err;
+
+    switch (enumID)
+    {
+    default:
+        DrLogW("Unknown property in vertex status batch enumID %u", (UINT32) enumID);
+        err = reader->SkipNextPropertyOrAggregate();
+        break;
+
+    case DrProp_NumberOfVertices:
+        UINT32 nStatuses;
+        err = reader->ReadNextProperty(enumID, nStatuses);
+        if (err == S_OK && nStatuses >= 0x80000000)
+        {
+            DrLogW("Too large status count %u", nStatuses);
+            err = HRESULT_FROM_WIN32(ERROR_INVALID_PARAMETER);
+        }
+        break;
+
+    case DrProp_BeginTag:
+        UINT16 tagValue;
+        err = reader->PeekNextAggregateTag(&tagValue);
+        if (err != S_OK)
+        {
+            DrLogW("Error reading DrProp_BeginTag %d", err);
+        }
+        else
+        {
+            switch (tagValue)
+            {
+            case DrTag_VertexStatus:
+                {
+                    DrVertexStatusRef status = DrNew DrVertexStatus();
+                    err = reader->ReadAggregate(tagValue, status);
+                    if (err == S_OK)
+                    {
+                        m_status->Add(status);
+                    }
+                }
+                break;
+
+            default:
+                DrLogW("Unexpected tag %d", tagValue);
+                err = reader->SkipNextPropertyOrAggregate();
+            }
+        }
+        break;
+    }
+
+    return err;
+}
+
+DrString DrVertexStatusBatch::GetPropertyLabel()
+{
+    DrString s;
+    s.SetF("%s", s_StatusBatchPropertyLabel);
+    return s;
+}
@@ -210,4 +210,56 @@ private:
 
     int                               m_nextArgumentToRead;
 };
-DRREF(DrVertexCommandBlock);
\ No newline at end of file
+DRREF(DrVertexCommandBlock);
+
+typedef DrArrayList<DrVertexCommandBlockRef> DrVertexCommandBlockList;
+DRAREF(DrVertexCommandBlockList,DrVertexCommandBlockRef);
+
+/* a batch of command blocks destined for different vertices in the same
+   process, sent as a single process property so that a cohort whose
+   vertices are all ready when its process starts needs only one round
+   trip to launch them */
+DRBASECLASS(DrVertexCommandBatch), public DrPropertyParser
+{
+public:
+    DrVertexCommandBatch();
+
+    void Add(DrVertexCommandBlockPtr command);
+    int GetNumberOfCommands();
+    DrVertexCommandBlockPtr GetCommand(int index);
+
+    void Serialize(DrPropertyWriterPtr writer);
+    virtual HRESULT ParseProperty(DrPropertyReaderPtr reader, UINT16 enumID, UINT32 dataLen);
+
+    static DrString GetPropertyLabel();
+
+private:
+    DrVertexCommandBlockListRef       m_command;
+};
+DRREF(DrVertexCommandBatch);
+
+typedef DrArrayList<DrVertexStatusRef> DrVertexStatusList;
+DRAREF(DrVertexStatusList,DrVertexStatusRef);
+
+/* the latest status of every vertex a process hosts, written by the process
+   as a single property so that the graph manager can follow all of them
+   with one outstanding request instead of one per vertex */
+DRBASECLASS(DrVertexStatusBatch), public DrPropertyParser
+{
+public:
+    DrVertexStatusBatch();
+
+    void Add(DrVertexStatusPtr status);
+    int GetNumberOfStatuses();
+    DrVertexStatusPtr GetStatus(int index);
+    DrVertexStatusPtr FindStatus(int vertexId, int vertexVersion);
+
+    void Serialize(DrPropertyWriterPtr writer);
+    virtual HRESULT ParseProperty(DrPropertyReaderPtr reader, UINT16 enumID, UINT32 dataLen);
+
+    static DrString GetPropertyLabel();
+
+private:
+    DrVertexStatusListRef             m_status;
+};
+DRREF(DrVertexStatusBatch);
\ No newline at end of file
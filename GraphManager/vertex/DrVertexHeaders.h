@@ -29,6 +29,8 @@ limitations under the License.
 #include <DrVertex.h>
 #include <DrClique.h>
 #include <DrCohort.h>
+#include <DrVertexHostPool.h>
+#include <DrOutputCache.h>
 
 #include <DrStageManager.h>
 
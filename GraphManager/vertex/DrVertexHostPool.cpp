@@ -0,0 +1,312 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#include <DrVertexHeaders.h>
+
+DrVertexHostPool::DrVertexHostPool(DrGraphPtr graph)
+    : DrSharedCritSec(graph)
+{
+    m_messagePump = graph->GetCluster()->GetMessagePump();
+    m_maxIdlePerComputer = graph->GetParameters()->m_maxIdleVertexHostsPerComputer;
+    m_idleTimeOut = graph->GetParameters()->m_vertexHostIdleTimeOut;
+    m_shutdown = false;
+
+    m_idle = DrNew DrIdleVertexHostList();
+    m_nextSerial = 1;
+
+    m_coldStartTotal = 0;
+    m_coldStartCount = 0;
+
+    m_hits = 0;
+    m_misses = 0;
+    m_startupTimeSaved = 0;
+}
+
+void DrVertexHostPool::Discard()
+{
+    m_idle = DrNull;
+}
+
+bool DrVertexHostPool::IsEnabled()
+{
+    return (m_maxIdlePerComputer > 0 && m_shutdown == false);
+}
+
+bool DrVertexHostPool::Park(DrLockBox<DrProcess> process, DrProcessTemplatePtr processTemplate,
+                            DrResourcePtr computer)
+{
+    if (IsEnabled() == false)
+    {
+        return false;
+    }
+
+    int onComputer = 0;
+    int i;
+    for (i=0; i<m_idle->Size(); ++i)
+    {
+        if (m_idle[i]->m_computer == computer)
+        {
+            ++onComputer;
+        }
+    }
+
+    if (onComputer >= m_maxIdlePerComputer)
+    {
+        DrLogI("Not keeping vertex host on %s: already %d idle there",
+               computer->GetName().GetChars(), onComputer);
+        return false;
+    }
+
+    DrIdleVertexHostRef host = DrNew DrIdleVertexHost();
+    host->m_process = process;
+    host->m_template = processTemplate;
+    host->m_computer = computer;
+    host->m_serial = m_nextSerial;
+    ++m_nextSerial;
+
+    {
+        DrLockBoxKey<DrProcess> p(process);
+        DrLogI("Keeping idle vertex host %s on %s serial %d",
+               p->GetName().GetChars(), computer->GetName().GetChars(), host->m_serial);
+        /* if the host exits while it is idle we hear about it here */
+        p->AddListener(this);
+    }
+
+    m_idle->Add(host);
+
+    DrVertexHostIdleMessageRef message = DrNew DrVertexHostIdleMessage(this, host->m_serial);
+    m_messagePump->EnQueueDelayed(m_idleTimeOut, message);
+
+    return true;
+}
+
+bool DrVertexHostPool::ScoreComputer(DrResourcePtr computer, DrAffinityListPtr affinity,
+                                     UINT64* pScore)
+{
+    UINT64 score = 0;
+    DrAffinityListRef list = affinity;
+
+    int i;
+    for (i=0; i<list->Size(); ++i)
+    {
+        DrAffinityPtr a = list[i];
+        DrResourceListRef locality = a->GetLocalityArray();
+
+        bool contains = false;
+        int j;
+        for (j=0; j<locality->Size(); ++j)
+        {
+            if (locality[j]->Contains(computer))
+            {
+                contains = true;
+                break;
+            }
+        }
+
+        if (a->GetHardConstraint())
+        {
+            if (contains == false)
+            {
+                return false;
+            }
+        }
+        else if (contains)
+        {
+            score += a->GetWeight();
+        }
+    }
+
+    *pScore = score;
+    return true;
+}
+
+DrLockBox<DrProcess> DrVertexHostPool::Claim(DrProcessTemplatePtr processTemplate,
+                                             DrAffinityListPtr affinity, DrStageManagerPtr stage)
+{
+    DrLockBox<DrProcess> claimed;
+
+    if (IsEnabled() == false)
+    {
+        return claimed;
+    }
+
+    /* a host on a computer holding none of the cohort's data would be a
+       bad trade for the startup time it saves, so if the cohort cares
+       where it runs only take a host somewhere it would like to be */
+    DrAffinityListRef list = affinity;
+    bool wantsLocality = false;
+    int i;
+    for (i=0; i<list->Size(); ++i)
+    {
+        if (list[i]->GetHardConstraint() == false && list[i]->GetWeight() > 0)
+        {
+            wantsLocality = true;
+            break;
+        }
+    }
+
+    /* search from the most recently parked end so the warmest host wins ties */
+    int best = -1;
+    UINT64 bestScore = 0;
+    for (i=m_idle->Size()-1; i>=0; --i)
+    {
+        DrIdleVertexHostPtr host = m_idle[i];
+        if (host->m_template != processTemplate)
+        {
+            continue;
+        }
+
+        UINT64 score;
+        if (ScoreComputer(host->m_computer, affinity, &score) == false)
+        {
+            continue;
+        }
+
+        if (wantsLocality && score == 0)
+        {
+            continue;
+        }
+
+        if (best < 0 || score > bestScore)
+        {
+            best = i;
+            bestScore = score;
+        }
+    }
+
+    if (best < 0)
+    {
+        ++m_misses;
+        DrLogI("Vertex host pool miss for stage %s", stage->GetStageName().GetChars());
+        stage->NotifyVertexHostClaim(false, 0);
+        return claimed;
+    }
+
+    DrIdleVertexHostRef host = m_idle[best];
+    m_idle->RemoveAt(best);
+
+    bool running;
+    {
+        DrLockBoxKey<DrProcess> p(host->m_process);
+        p->CancelListener(this);
+
+        /* the host may have exited with the message telling us so still in
+           the queue */
+        running = (p->GetInfo()->m_state->m_state == DPS_Running);
+        if (running == false)
+        {
+            p->Terminate();
+        }
+    }
+
+    if (running == false)
+    {
+        DrLogI("Idle vertex host on %s exited before it could be reused",
+               host->m_computer->GetName().GetChars());
+        return Claim(processTemplate, affinity, stage);
+    }
+
+    claimed = host->m_process;
+
+    DrTimeInterval saved = 0;
+    if (m_coldStartCount > 0)
+    {
+        saved = m_coldStartTotal / m_coldStartCount;
+    }
+
+    ++m_hits;
+    m_startupTimeSaved += saved;
+
+    DrLogI("Vertex host pool hit for stage %s on %s, about %I64d ms startup saved",
+           stage->GetStageName().GetChars(), host->m_computer->GetName().GetChars(),
+           saved / DrTimeInterval_Millisecond);
+    stage->NotifyVertexHostClaim(true, saved);
+
+    return claimed;
+}
+
+void DrVertexHostPool::NotifyColdStart(DrTimeInterval startupTime)
+{
+    m_coldStartTotal += startupTime;
+    ++m_coldStartCount;
+}
+
+void DrVertexHostPool::Evict(int index, DrString reason)
+{
+    DrIdleVertexHostRef host = m_idle[index];
+    m_idle->RemoveAt(index);
+
+    DrLockBoxKey<DrProcess> p(host->m_process);
+    DrLogI("Terminating idle vertex host %s on %s: %s",
+           p->GetName().GetChars(), host->m_computer->GetName().GetChars(), reason.GetChars());
+    p->CancelListener(this);
+    p->Terminate();
+}
+
+void DrVertexHostPool::Shutdown()
+{
+    m_shutdown = true;
+
+    while (m_idle->Size() > 0)
+    {
+        Evict(m_idle->Size() - 1, "job is stopping");
+    }
+
+    DrLogI("Job reused %d vertex hosts and started %d new ones, about %I64d ms startup saved",
+           m_hits, m_misses, m_startupTimeSaved / DrTimeInterval_Millisecond);
+}
+
+void DrVertexHostPool::ReceiveMessage(DrProcessInfoRef message)
+{
+    if (m_idle == DrNull || message->m_state->m_state <= DPS_Running)
+    {
+        return;
+    }
+
+    int i;
+    for (i=0; i<m_idle->Size(); ++i)
+    {
+        if (m_idle[i]->m_process == message->m_process)
+        {
+            /* Terminate also closes the handle of a process that has already exited */
+            Evict(i, "host exited while idle");
+            return;
+        }
+    }
+}
+
+void DrVertexHostPool::ReceiveMessage(DrVertexHostIdleCheck serial)
+{
+    if (m_idle == DrNull)
+    {
+        /* the graph has been discarded */
+        return;
+    }
+
+    int i;
+    for (i=0; i<m_idle->Size(); ++i)
+    {
+        if (m_idle[i]->m_serial == serial)
+        {
+            Evict(i, "idle too long");
+            return;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+#pragma once
+
+/* Idle-host timer message: the payload is the serial number of the host
+   the timer was set for, so a timer for a host that has since been
+   claimed or has exited is ignored */
+typedef int DrVertexHostIdleCheck;
+
+typedef DrListener<DrVertexHostIdleCheck> DrVertexHostIdleListener;
+DRIREF(DrVertexHostIdleListener);
+
+typedef DrMessage<DrVertexHostIdleCheck> DrVertexHostIdleMessage;
+DRREF(DrVertexHostIdleMessage);
+
+DRBASECLASS(DrIdleVertexHost)
+{
+public:
+    DrLockBox<DrProcess>     m_process;
+    DrProcessTemplateRef     m_template;
+    DrResourceRef            m_computer;
+    int                      m_serial;
+};
+DRREF(DrIdleVertexHost);
+
+typedef DrArrayList<DrIdleVertexHostRef> DrIdleVertexHostList;
+DRAREF(DrIdleVertexHostList,DrIdleVertexHostRef);
+
+/* Vertex hosts whose vertices have all completed successfully are kept
+   running here instead of being terminated, up to a limit per computer
+   and for a limited time, so that a later cohort with the same process
+   template can be sent its start commands straight away rather than
+   waiting for a new process to be scheduled and initialized */
+DRCLASS(DrVertexHostPool) : public DrSharedCritSec, public DrProcessListener, public DrVertexHostIdleListener
+{
+public:
+    DrVertexHostPool(DrGraphPtr graph);
+    void Discard();
+
+    bool IsEnabled();
+
+    /* returns false if the host can't be kept, in which case the caller
+       disposes of it as usual */
+    bool Park(DrLockBox<DrProcess> process, DrProcessTemplatePtr processTemplate,
+              DrResourcePtr computer);
+
+    /* returns an empty box if there is no idle host with the right
+       template on a computer the affinities allow. Either way the
+       outcome is recorded in stage's statistics */
+    DrLockBox<DrProcess> Claim(DrProcessTemplatePtr processTemplate, DrAffinityListPtr affinity,
+                               DrStageManagerPtr stage);
+
+    void NotifyColdStart(DrTimeInterval startupTime);
+
+    /* terminates every idle host and reports what the pool saved */
+    void Shutdown();
+
+    /* DrProcessListener implementation */
+    virtual void ReceiveMessage(DrProcessInfoRef message);
+
+    /* DrVertexHostIdleListener implementation */
+    virtual void ReceiveMessage(DrVertexHostIdleCheck serial);
+
+private:
+    static bool ScoreComputer(DrResourcePtr computer, DrAffinityListPtr affinity, UINT64* pScore);
+    void Evict(int index, DrString reason);
+
+    DrMessagePumpRef               m_messagePump;
+    int                            m_maxIdlePerComputer;
+    DrTimeInterval                 m_idleTimeOut;
+    bool                           m_shutdown;
+
+    DrIdleVertexHostListRef        m_idle;
+    int                            m_nextSerial;
+
+    /* running mean of the time from scheduling a new vertex host to its
+       reporting that it is running, used to estimate what each reused
+       host saved */
+    DrTimeInterval                 m_coldStartTotal;
+    int                            m_coldStartCount;
+
+    /* job-wide totals for the shutdown summary; the per-stage numbers
+       are kept in each stage's DrStageStatistics */
+    int                            m_hits;
+    int                            m_misses;
+    DrTimeInterval                 m_startupTimeSaved;
+};
+DRREF(DrVertexHostPool);
@@ -196,6 +196,7 @@ DrVertexRecord::DrVertexRecord(DrClusterPtr cluster, DrActiveVertexPtr parent,
     m_cohort = cohort;
     m_state = DVS_NotStarted;
     m_lastSeenVersion = 0;
+    m_fingerprint = 0;
 
     m_creationTime = cluster->GetCurrentTimeStamp();
     m_startTime = DrDateTime_Never;
@@ -251,6 +252,14 @@ void DrVertexRecord::MakeGenerator()
     {
         m_generator->SetProcess(DrNull, m_parent->GetId(), m_inputs->GetVersion());
     }
+
+    m_generator->SetFingerprint(m_fingerprint);
+    m_generator->SetPipesUseFiles(m_parent->GetCohort()->GetGang()->PipesUseFiles(m_inputs->GetVersion()));
+}
+
+void DrVertexRecord::SetFingerprint(UINT64 fingerprint)
+{
+    m_fingerprint = fingerprint;
 }
 
 DrActiveVertexOutputGeneratorPtr DrVertexRecord::GetGenerator()
@@ -474,7 +483,9 @@ void DrVertexRecord::SetActiveInput(int inputPort, DrVertexOutputGeneratorPtr ge
     DrAssert(m_inputs->GetGenerator(inputPort) == DrNull);
     m_inputs->SetGenerator(inputPort, generator);
 
-    if (m_inputs->Ready())
+    /* when pipes go through files the writer may complete before our own
+       process has started, in which case ReactToStartedProcess will start us */
+    if (m_inputs->Ready() && m_process.IsEmpty() == false)
     {
         StartRunning();
     }
@@ -815,7 +826,7 @@ void DrVertexRecord::ReceiveMessage(DrPropertyStatusRef prop)
     case DVS_Completed:
     case DVS_Failed:
         DrLogI("Vertex %d.%d completed, state is now %d", m_parent->GetId(), GetVersion(), m_state);
-        m_cohort->NotifyVertexCompletion();
+        m_cohort->NotifyVertexCompletion(m_state == DVS_Completed);
         DrLogI("Vertex %d.%d notified cohort of completion, state is now %d", m_parent->GetId(), GetVersion(), m_state);
 
         m_cohort = DrNull;
@@ -848,6 +859,14 @@ void DrVertexRecord::ReceiveMessage(DrPropertyStatusRef prop)
 
 void DrVertexRecord::RequestStatus()
 {
+    /* the process reports all its vertices in one batch, so let the cohort
+       wait for it on our behalf rather than holding a request of our own */
+    if (m_cohort != DrNull &&
+        m_cohort->RequestVertexStatus(m_parent->GetId(), m_inputs->GetVersion(), m_lastSeenVersion, this))
+    {
+        return;
+    }
+
     DrString label = DrVertexStatus::GetPropertyLabel(m_parent->GetId(), m_inputs->GetVersion());
 
     DrAssert(m_process.IsEmpty() == false);
@@ -865,6 +884,15 @@ void DrVertexRecord::SendStartCommand()
 
     DrVertexCommandBlockRef startCommand = m_parent->MakeVertexStartCommand(m_inputs, m_generator);
 
+    m_startTime = m_parent->GetStageManager()->GetGraph()->GetCluster()->GetCurrentTimeStamp();
+
+    if (m_cohort->AddToStartBatch(startCommand))
+    {
+        /* the cohort is starting several of its vertices at once and will send
+           this command along with the others */
+        return;
+    }
+
     DrPropertyWriterRef writer = DrNew DrPropertyWriter();
     startCommand->Serialize(writer);
     DrByteArrayRef block = writer->GetBuffer();
@@ -874,8 +902,6 @@ void DrVertexRecord::SendStartCommand()
         DrLockBoxKey<DrProcess> process(m_process);
         process->SendCommand(label, description, block);
     }
-
-    m_startTime = m_parent->GetStageManager()->GetGraph()->GetCluster()->GetCurrentTimeStamp();
 }
 
 void DrVertexRecord::SendTerminateCommand(int id, int version, DrLockBox<DrProcess> process)
@@ -202,6 +202,10 @@ public:
     int GetVersion();
     DrActiveVertexOutputGeneratorPtr GetGenerator();
 
+    /* passed on to the output generator so the execution can be stored in
+       the stage output cache when it completes */
+    void SetFingerprint(UINT64 fingerprint);
+
     DrVertexVersionGeneratorPtr NotifyProcessHasStarted(DrLockBox<DrProcess> process);
     void SetActiveInput(int inputPort, DrVertexOutputGeneratorPtr generator);
     void StartRunning();
@@ -230,6 +234,7 @@ private:
 
     DrVertexState                      m_state;
     UINT64                             m_lastSeenVersion;
+    UINT64                             m_fingerprint;
 
     /* the time the record was created */
     DrDateTime                         m_creationTime;
@@ -0,0 +1,285 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using Microsoft.Research.Dryad;
+
+namespace Microsoft.Research.Dryad.GraphManagerBenchmark
+{
+    /// <summary>
+    /// Measures how many vertex transitions per second the graph manager sustains. A layered
+    /// graph of active vertices is run against the in-process simulated cluster, so the stage
+    /// managers, vertex records, cohorts and message pump do all their usual work while no
+    /// vertex hosts, files or network traffic are involved.
+    /// </summary>
+    class Program
+    {
+        class Options
+        {
+            public int width = 100;
+            public int depth = 5;
+            public bool crossProduct = true;
+            public DrLogTypeManaged logLevel = DrLogTypeManaged.Warning;
+            public DrSimulationParameters simulation = new DrSimulationParameters();
+        }
+
+        static void Usage()
+        {
+            Console.Error.WriteLine(
+                "usage: Microsoft.Research.Dryad.GraphManagerBenchmark.exe [options]\n" +
+                "  --width=N              vertices in each stage (100)\n" +
+                "  --depth=N              number of stages (5)\n" +
+                "  --connect=cross|pointwise  edges between adjacent stages (cross)\n" +
+                "  --computers=N          simulated computers (100)\n" +
+                "  --computersPerRack=N   simulated computers in each rack (20)\n" +
+                "  --startLatencyMs=N     process start latency (500)\n" +
+                "  --runTimeMs=N          mean vertex run time (1000)\n" +
+                "  --jitter=F             vertex run times vary by +/- this fraction (0.5)\n" +
+                "  --failureRate=F        fraction of vertex executions that fail (0)\n" +
+                "  --seed=N               random seed (0)\n" +
+                "  --log=OFF|ERROR|WARN|INFO|DEBUG  graph manager logging level (WARN)");
+        }
+
+        static bool ParseArguments(string[] args, Options options)
+        {
+            foreach (string arg in args)
+            {
+                int equals = arg.IndexOf('=');
+                if (!arg.StartsWith("--") || equals < 0)
+                {
+                    return false;
+                }
+
+                string name = arg.Substring(2, equals - 2);
+                string value = arg.Substring(equals + 1);
+
+                try
+                {
+                    switch (name)
+                    {
+                        case "width":
+                            options.width = Int32.Parse(value);
+                            break;
+                        case "depth":
+                            options.depth = Int32.Parse(value);
+                            break;
+                        case "connect":
+                            if (value == "cross")
+                            {
+                                options.crossProduct = true;
+                            }
+                            else if (value == "pointwise")
+                            {
+                                options.crossProduct = false;
+                            }
+                            else
+                            {
+                                return false;
+                            }
+                            break;
+                        case "computers":
+                            options.simulation.m_numberOfComputers = Int32.Parse(value);
+                            break;
+                        case "computersPerRack":
+                            options.simulation.m_computersPerRack = Int32.Parse(value);
+                            break;
+                        case "startLatencyMs":
+                            options.simulation.m_processStartLatency = MillisecondsToTicks(Int64.Parse(value));
+                            break;
+                        case "runTimeMs":
+                            options.simulation.m_vertexRunTime = MillisecondsToTicks(Int64.Parse(value));
+                            break;
+                        case "jitter":
+                            options.simulation.m_vertexRunTimeJitter = Double.Parse(value, CultureInfo.InvariantCulture);
+                            break;
+                        case "failureRate":
+                            options.simulation.m_vertexFailureRate = Double.Parse(value, CultureInfo.InvariantCulture);
+                            break;
+                        case "seed":
+                            options.simulation.m_randomSeed = Int32.Parse(value);
+                            break;
+                        case "log":
+                            switch (value)
+                            {
+                                case "OFF": options.logLevel = DrLogTypeManaged.Off; break;
+                                case "ERROR": options.logLevel = DrLogTypeManaged.Error; break;
+                                case "WARN": options.logLevel = DrLogTypeManaged.Warning; break;
+                                case "INFO": options.logLevel = DrLogTypeManaged.Info; break;
+                                case "DEBUG": options.logLevel = DrLogTypeManaged.Debug; break;
+                                default: return false;
+                            }
+                            break;
+                        default:
+                            return false;
+                    }
+                }
+                catch (FormatException)
+                {
+                    return false;
+                }
+            }
+
+            return (options.width > 0 && options.depth > 0 && options.simulation.m_numberOfComputers > 0);
+        }
+
+        static long MillisecondsToTicks(long milliseconds)
+        {
+            return TimeSpan.FromMilliseconds(milliseconds).Ticks;
+        }
+
+        static double TicksToMilliseconds(long ticks)
+        {
+            return TimeSpan.FromTicks(ticks).TotalMilliseconds;
+        }
+
+        static List<DrVertex> MakeStage(DrGraph graph, DrGraphParameters parameters, int stageNumber, int width)
+        {
+            DrManagerBase stage = new DrManagerBase(graph, String.Format("Stage{0}", stageNumber));
+            DrActiveVertex prototype = new DrActiveVertex(stage, parameters.m_defaultProcessTemplate, parameters.m_defaultVertexTemplate);
+            prototype.AddArgument("benchmark");
+
+            List<DrVertex> vertices = new List<DrVertex>();
+            for (int i = 0; i < width; ++i)
+            {
+                vertices.Add(prototype.MakeCopy(i));
+            }
+
+            return vertices;
+        }
+
+        static void Connect(List<DrVertex> source, List<DrVertex> destination, bool crossProduct)
+        {
+            if (crossProduct)
+            {
+                foreach (DrVertex iv in source)
+                {
+                    iv.GetOutputs().GrowNumberOfEdges(destination.Count);
+                }
+                foreach (DrVertex ov in destination)
+                {
+                    ov.GetInputs().GrowNumberOfEdges(source.Count);
+                }
+
+                for (int i = 0; i < source.Count; ++i)
+                {
+                    for (int j = 0; j < destination.Count; ++j)
+                    {
+                        source[i].ConnectOutput(j, destination[j], i, DrConnectorType.DCT_File);
+                    }
+                }
+            }
+            else
+            {
+                for (int i = 0; i < source.Count; ++i)
+                {
+                    source[i].GetOutputs().GrowNumberOfEdges(1);
+                    destination[i].GetInputs().GrowNumberOfEdges(1);
+                    source[i].ConnectOutput(0, destination[i], 0, DrConnectorType.DCT_File);
+                }
+            }
+        }
+
+        static void Report(Options options, DrSimulationStatistics statistics)
+        {
+            Console.WriteLine("Graph: {0} stages of {1} vertices, {2} edges",
+                              options.depth, options.width, options.crossProduct ? "cross-product" : "pointwise");
+            Console.WriteLine("Elapsed: {0:F1} s, process CPU {1:F1} s (graph manager plus simulator)",
+                              TimeSpan.FromTicks(statistics.GetElapsedTime()).TotalSeconds,
+                              TimeSpan.FromTicks(statistics.GetProcessorTime()).TotalSeconds);
+            Console.WriteLine("Processes scheduled: {0}", statistics.GetNumberOfProcessesScheduled());
+            Console.WriteLine("Vertex executions: {0} started, {1} completed, {2} failed",
+                              statistics.GetNumberOfVerticesStarted(),
+                              statistics.GetNumberOfVerticesCompleted(),
+                              statistics.GetNumberOfVerticesFailed());
+            Console.WriteLine("Vertex transitions: {0:F1} per second", statistics.GetVertexTransitionsPerSecond());
+            Console.WriteLine("CPU per vertex: {0:F3} ms", TicksToMilliseconds(statistics.GetProcessorTimePerVertex()));
+
+            double[] percentiles = { 50.0, 90.0, 99.0, 100.0 };
+            foreach (double p in percentiles)
+            {
+                Console.WriteLine("p{0} latency: process started to vertex start {1:F1} ms, schedule to vertex start {2:F1} ms",
+                                  p, TicksToMilliseconds(statistics.GetStartLatency(p)),
+                                  TicksToMilliseconds(statistics.GetScheduleLatency(p)));
+            }
+
+            Console.WriteLine("Message pump queue depth: mean {0:F1}, max {1}; max delayed messages {2}",
+                              statistics.GetMeanQueueDepth(), statistics.GetMaxQueueDepth(),
+                              statistics.GetMaxDelayedMessages());
+        }
+
+        static int Main(string[] args)
+        {
+            Options options = new Options();
+            if (!ParseArguments(args, options))
+            {
+                Usage();
+                return 1;
+            }
+
+            DrLogging.Initialize("graphmanagerbenchmark", false);
+            DrLogging.SetLoggingLevel(options.logLevel);
+
+            DrGraphParameters parameters = DrDefaultParameters.Make("benchmark.exe", "Benchmark", false);
+            DrSimulationStatistics statistics = new DrSimulationStatistics();
+
+            DrGraphExecutor executor = new DrGraphExecutor();
+            DrGraph graph = executor.InitializeSimulated(parameters, options.simulation, statistics);
+            if (graph == null)
+            {
+                Console.Error.WriteLine("Failed to initialize the graph executor");
+                return 1;
+            }
+
+            List<List<DrVertex>> stages = new List<List<DrVertex>>();
+            for (int s = 0; s < options.depth; ++s)
+            {
+                List<DrVertex> stage = MakeStage(graph, parameters, s, options.width);
+                if (s > 0)
+                {
+                    Connect(stages[s - 1], stage, options.crossProduct);
+                }
+                stages.Add(stage);
+            }
+
+            foreach (List<DrVertex> stage in stages)
+            {
+                foreach (DrVertex v in stage)
+                {
+                    v.GetStageManager().RegisterVertex(v);
+                }
+            }
+
+            executor.Run();
+            DrError exitStatus = executor.Join();
+
+            Report(options, statistics);
+
+            if (exitStatus != null && exitStatus.m_code != 0)
+            {
+                Console.Error.WriteLine("Graph failed: {0}", exitStatus.ToFullTextNative());
+                return exitStatus.m_code;
+            }
+
+            return 0;
+        }
+    }
+}
@@ -52,7 +52,27 @@ namespace Microsoft.Research.DryadLinq
         /// <summary>
         /// Compression using gzip.
         /// </summary>
-        Gzip
+        Gzip = 1,
+
+        /// <summary>
+        /// Framed compression using LZ4. Intermediate data only.
+        /// </summary>
+        Lz4 = 7,
+
+        /// <summary>
+        /// Framed compression using LZ4 at a high-compression level. Intermediate data only.
+        /// </summary>
+        Lz4High = 8,
+
+        /// <summary>
+        /// Framed compression using Zstandard at a fast level. Intermediate data only.
+        /// </summary>
+        ZstdFast = 9,
+
+        /// <summary>
+        /// Framed compression using Zstandard at its default level. Intermediate data only.
+        /// </summary>
+        Zstd = 10
     }
 
     /// <summary>
@@ -756,12 +756,21 @@ namespace Microsoft.Research.DryadLinq
         /// Gets or sets the value specifying the compression scheme for output data.
         /// </summary>
         /// <remarks>
-        /// The default is <see cref="CompressionScheme.None"/>.
+        /// The default is <see cref="CompressionScheme.None"/>. Only <see cref="CompressionScheme.None"/>
+        /// and <see cref="CompressionScheme.Gzip"/> can be read back as output data.
         /// </remarks>
         public CompressionScheme OutputDataCompressionScheme
         {
             get { return this._outputCompressionScheme; }
-            set { this._outputCompressionScheme = value; }
+            set
+            {
+                if (value != CompressionScheme.None && value != CompressionScheme.Gzip)
+                {
+                    throw new DryadLinqException(DryadLinqErrorCode.UnknownCompressionScheme,
+                                                 SR.UnknownCompressionScheme);
+                }
+                this._outputCompressionScheme = value;
+            }
         }
 
         /// <summary>
@@ -132,6 +132,32 @@ namespace Microsoft.Research.DryadLinq.Internal
                                                           IntPtr itemHandle,
                                                           Int32 numBytesToWrite);
 
+        // Read up to maxBlocks data blocks that are already available on the
+        // channel of the specified port number, blocking only if none are.
+        // Returns the number of entries filled in itemHandles, pDataBlocks and
+        // pDataBlockSizes; 0 with *pErrorCode == 0 means the channel has
+        // reached the end. Each returned block is owned by the caller exactly
+        // as if it had come from ReadDataBlock.
+        [DllImport("Microsoft.Research.Dryad.DryadLinq.NativeWrapper.dll", SetLastError = true)]
+        internal unsafe static extern UInt32 ReadDataBlocks(IntPtr vertexInfo,
+                                                            UInt32 portNum,
+                                                            UInt32 maxBlocks,
+                                                            IntPtr* itemHandles,
+                                                            byte** pDataBlocks,
+                                                            Int32* pDataBlockSizes,
+                                                            Int32* pErrorCode);
+
+        // Write numBlocks data blocks, in order, on the channel with the
+        // specified port number as a single channel write. The same rules as
+        // WriteDataBlock apply to each block.
+        [DllImport("Microsoft.Research.Dryad.DryadLinq.NativeWrapper.dll", SetLastError = true)]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        internal unsafe static extern bool WriteDataBlocks(IntPtr vertexInfo,
+                                                           UInt32 portNum,
+                                                           UInt32 numBlocks,
+                                                           IntPtr* itemHandles,
+                                                           Int32* numBytesToWrite);
+
         // Allocate a native Dryad data block with specified size. This data
         // block will not be reclaimed until the client explicitly releases it.
         [DllImport("Microsoft.Research.Dryad.DryadLinq.NativeWrapper.dll", SetLastError = true)]
@@ -219,6 +219,16 @@ namespace Microsoft.Research.DryadLinq.Internal
             else
             {
                 //DryadLinqLog.AddVerbose("  case: cnt >= pcount");
+                List<K> skewAware = SkewAwareSeparators(samples, reservoirCount, comparer, isDescending, pcount);
+                if (skewAware != null)
+                {
+                    foreach (K key in skewAware)
+                    {
+                        yield return key;
+                    }
+                    yield break;
+                }
+
                 int intv = reservoirCount / pcount;
                 if (isDescending)
                 {
@@ -244,5 +254,108 @@ namespace Microsoft.Research.DryadLinq.Internal
                 }
             }
         }
+
+        // Separator selection for samples containing heavy keys. A key whose run in the sorted
+        // samples is at least one partition's worth would otherwise be picked as several
+        // consecutive separators, leaving it on one consumer together with its neighbours and
+        // emptying the partitions after it. Instead each heavy key is given a partition of its
+        // own, and the remaining partitions are spread evenly over the other keys. A key is never
+        // split across partitions, since operators downstream of a range partition rely on equal
+        // keys being co-located. Returns null if there are no heavy keys.
+        private static List<K>
+            SkewAwareSeparators<K>(K[] samples, int count, IComparer<K> comparer, bool isDescending, int pcount)
+        {
+            int heavyThreshold = Math.Max(2, count / pcount);
+
+            // find the runs of equal keys, walking the samples in partition order
+            int step = (isDescending) ? -1 : 1;
+            List<int> runStart = new List<int>();
+            List<int> runLength = new List<int>();
+            int heavyRuns = 0;
+            int heavySamples = 0;
+            int i = (isDescending) ? count - 1 : 0;
+            while (i >= 0 && i < count)
+            {
+                int j = i + step;
+                while (j >= 0 && j < count && comparer.Compare(samples[i], samples[j]) == 0)
+                {
+                    j += step;
+                }
+                int length = (j - i) * step;
+                runStart.Add(i);
+                runLength.Add(length);
+                if (length >= heavyThreshold)
+                {
+                    heavyRuns++;
+                    heavySamples += length;
+                }
+                i = j;
+            }
+
+            if (heavyRuns == 0)
+            {
+                return null;
+            }
+
+            int budget = pcount - 1;
+            int lightTarget = Math.Max(1, (count - heavySamples) / Math.Max(1, pcount - heavyRuns));
+            int heavyRemaining = heavyRuns;
+            int largestPartition = 0;
+            int assigned = 0;
+
+            List<K> separators = new List<K>(budget);
+            int accumulated = 0;
+            for (int r = 0; r < runStart.Count && separators.Count < budget; r++)
+            {
+                bool isLast = (r == runStart.Count - 1);
+                if (runLength[r] >= heavyThreshold)
+                {
+                    heavyRemaining--;
+                    if (accumulated > 0)
+                    {
+                        // close the current partition just before the heavy key
+                        separators.Add(samples[runStart[r - 1]]);
+                        largestPartition = Math.Max(largestPartition, accumulated);
+                        assigned += accumulated;
+                        accumulated = 0;
+                    }
+                    // the partition ending at the heavy key then holds only that key; if it is
+                    // the last key the final partition already does
+                    if (!isLast && separators.Count < budget)
+                    {
+                        separators.Add(samples[runStart[r]]);
+                        largestPartition = Math.Max(largestPartition, runLength[r]);
+                        assigned += runLength[r];
+                    }
+                }
+                else
+                {
+                    accumulated += runLength[r];
+                    // keep two separators in hand for each heavy key still to come
+                    if (accumulated >= lightTarget && !isLast &&
+                        budget - separators.Count > 2 * heavyRemaining)
+                    {
+                        separators.Add(samples[runStart[r]]);
+                        largestPartition = Math.Max(largestPartition, accumulated);
+                        assigned += accumulated;
+                        accumulated = 0;
+                    }
+                }
+            }
+            // everything not yet assigned falls in the final partition
+            largestPartition = Math.Max(largestPartition, count - assigned);
+
+            DryadLinqLog.AddInfo("Range-partition: {0} heavy keys given dedicated partitions; " +
+                                 "largest partition estimated at {1:P1} of the data, an even split is {2:P1}",
+                                 heavyRuns, (double)largestPartition / count, 1.0 / pcount);
+
+            // pad to the expected number of separators; the extra partitions are empty
+            K last = (separators.Count > 0) ? separators[separators.Count - 1] : samples[runStart[0]];
+            while (separators.Count < budget)
+            {
+                separators.Add(last);
+            }
+            return separators;
+        }
     }
 }
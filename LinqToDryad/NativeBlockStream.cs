@@ -79,17 +79,55 @@ namespace Microsoft.Research.DryadLinq.Internal
 
     internal sealed class DryadLinqChannel : NativeBlockStream
     {
+        // Blocks cross the native boundary in batches of up to this many.
+        private const int BlockBatchSize = 16;
+
+        // Output: a port writes its batch early once the blocks waiting on
+        // all output ports add up to this many bytes, so queued blocks don't
+        // hold much memory or delay data reaching a pipelined reader.
+        private const Int64 MaxPendingWriteBytes = 1 << 20;
+        private static Int64 s_pendingWriteBytes = 0;
+
         private IntPtr m_vertexInfo;
         private UInt32 m_portNum;
         private bool m_isInput;
         private bool m_isClosed;
 
+        // Input: blocks fetched by the last ReadDataBlocks call and not yet
+        // handed out. m_readHead indexes the next one.
+        private IntPtr[] m_readHandles;
+        private IntPtr[] m_readBlocks;
+        private Int32[] m_readSizes;
+        private int m_readHead;
+        private int m_readCount;
+        private bool m_readAtEnd;
+
+        // Output: blocks passed to WriteDataBlock but not yet written.
+        // Releases of these blocks are deferred until the batch is written.
+        private IntPtr[] m_writeHandles;
+        private Int32[] m_writeSizes;
+        private int m_writeCount;
+        private Int64 m_writeBytes;
+        private List<IntPtr> m_deferredReleases;
+
         internal DryadLinqChannel(IntPtr vertexInfo, UInt32 portNum, bool isInput)
         {
             this.m_vertexInfo = vertexInfo;
             this.m_portNum = portNum;
             this.m_isInput = isInput;
             this.m_isClosed = false;
+            if (isInput)
+            {
+                this.m_readHandles = new IntPtr[BlockBatchSize];
+                this.m_readBlocks = new IntPtr[BlockBatchSize];
+                this.m_readSizes = new Int32[BlockBatchSize];
+            }
+            else
+            {
+                this.m_writeHandles = new IntPtr[BlockBatchSize];
+                this.m_writeSizes = new Int32[BlockBatchSize];
+                this.m_deferredReleases = new List<IntPtr>(BlockBatchSize);
+            }
         }
 
         ~DryadLinqChannel()
@@ -138,7 +176,14 @@ namespace Microsoft.Research.DryadLinq.Internal
         {
             if (itemHandle != IntPtr.Zero)
             {
-                DryadLinqNative.ReleaseDataBlock(this.m_vertexInfo, itemHandle);
+                if (this.IsPendingWrite(itemHandle))
+                {
+                    this.m_deferredReleases.Add(itemHandle);
+                }
+                else
+                {
+                    DryadLinqNative.ReleaseDataBlock(this.m_vertexInfo, itemHandle);
+                }
             }
             // DryadLinqLog.AddInfo("Released data block {0}.", itemHandle);
         }
@@ -146,12 +191,43 @@ namespace Microsoft.Research.DryadLinq.Internal
         internal override unsafe DataBlockInfo ReadDataBlock()
         {
             DataBlockInfo blockInfo;
+            if (this.m_readHead == this.m_readCount && !this.m_readAtEnd)
+            {
+                this.FetchDataBlocks();
+            }
+            if (this.m_readHead < this.m_readCount)
+            {
+                blockInfo.ItemHandle = this.m_readHandles[this.m_readHead];
+                blockInfo.DataBlock = (byte*)this.m_readBlocks[this.m_readHead];
+                blockInfo.BlockSize = this.m_readSizes[this.m_readHead];
+                this.m_readHandles[this.m_readHead] = IntPtr.Zero;
+                this.m_readHead++;
+            }
+            else
+            {
+                blockInfo.ItemHandle = IntPtr.Zero;
+                blockInfo.DataBlock = null;
+                blockInfo.BlockSize = 0;
+            }
+            return blockInfo;
+        }
+
+        private unsafe void FetchDataBlocks()
+        {
             Int32 errorCode = 0;
-            blockInfo.ItemHandle = DryadLinqNative.ReadDataBlock(this.m_vertexInfo,
-                                                                 this.m_portNum,
-                                                                 &blockInfo.DataBlock,
-                                                                 &blockInfo.BlockSize,
-                                                                 &errorCode);
+            UInt32 numBlocks;
+            fixed (IntPtr* pHandles = this.m_readHandles)
+            fixed (IntPtr* pBlocks = this.m_readBlocks)
+            fixed (Int32* pSizes = this.m_readSizes)
+            {
+                numBlocks = DryadLinqNative.ReadDataBlocks(this.m_vertexInfo,
+                                                           this.m_portNum,
+                                                           (UInt32)BlockBatchSize,
+                                                           pHandles,
+                                                           (byte**)pBlocks,
+                                                           pSizes,
+                                                           &errorCode);
+            }
             if (errorCode != 0)
             {
                 VertexEnv.ErrorCode = errorCode;
@@ -159,28 +235,75 @@ namespace Microsoft.Research.DryadLinq.Internal
                                              String.Format(SR.FailedToReadFromInputChannel,
                                                            this.m_portNum, errorCode));
             }
-            return blockInfo;
+            this.m_readHead = 0;
+            this.m_readCount = (int)numBlocks;
+            this.m_readAtEnd = (numBlocks == 0);
         }
 
         internal override unsafe bool WriteDataBlock(IntPtr itemHandle, Int32 numBytesToWrite)
         {
-            bool success = true;
             if (numBytesToWrite > 0)
             {
-                success = DryadLinqNative.WriteDataBlock(this.m_vertexInfo,
-                                                         this.m_portNum,
-                                                         itemHandle,
-                                                         numBytesToWrite);
-
-                if (!success)
+                this.m_writeHandles[this.m_writeCount] = itemHandle;
+                this.m_writeSizes[this.m_writeCount] = numBytesToWrite;
+                this.m_writeCount++;
+                this.m_writeBytes += numBytesToWrite;
+                Int64 pendingBytes = Interlocked.Add(ref s_pendingWriteBytes, numBytesToWrite);
+                if (this.m_writeCount == BlockBatchSize || pendingBytes >= MaxPendingWriteBytes)
                 {
+                    this.WritePendingBlocks();
+                }
+            }
+            return true;
+        }
 
-                    throw new DryadLinqException(DryadLinqErrorCode.FailedToWriteToOutputChannel,
-                                                 String.Format(SR.FailedToWriteToOutputChannel,
-                                                               this.m_portNum));
+        private bool IsPendingWrite(IntPtr itemHandle)
+        {
+            for (int i = 0; i < this.m_writeCount; i++)
+            {
+                if (this.m_writeHandles[i] == itemHandle)
+                {
+                    return true;
                 }
             }
-            return success;
+            return false;
+        }
+
+        private unsafe void WritePendingBlocks()
+        {
+            if (this.m_writeCount == 0)
+            {
+                return;
+            }
+
+            bool success;
+            fixed (IntPtr* pHandles = this.m_writeHandles)
+            fixed (Int32* pSizes = this.m_writeSizes)
+            {
+                success = DryadLinqNative.WriteDataBlocks(this.m_vertexInfo,
+                                                          this.m_portNum,
+                                                          (UInt32)this.m_writeCount,
+                                                          pHandles,
+                                                          pSizes);
+            }
+            this.m_writeCount = 0;
+            Interlocked.Add(ref s_pendingWriteBytes, -this.m_writeBytes);
+            this.m_writeBytes = 0;
+
+            // The native writer holds its own references now, so the
+            // releases the caller asked for can go through.
+            foreach (IntPtr handle in this.m_deferredReleases)
+            {
+                DryadLinqNative.ReleaseDataBlock(this.m_vertexInfo, handle);
+            }
+            this.m_deferredReleases.Clear();
+
+            if (!success)
+            {
+                throw new DryadLinqException(DryadLinqErrorCode.FailedToWriteToOutputChannel,
+                                             String.Format(SR.FailedToWriteToOutputChannel,
+                                                           this.m_portNum));
+            }
         }
 
         internal override void SetCalcFP()
@@ -211,6 +334,10 @@ namespace Microsoft.Research.DryadLinq.Internal
 
         internal override void Flush()
         {
+            if (!this.m_isInput)
+            {
+                this.WritePendingBlocks();
+            }
             DryadLinqNative.Flush(this.m_vertexInfo, this.m_portNum);
         }
 
@@ -220,6 +347,16 @@ namespace Microsoft.Research.DryadLinq.Internal
             {
                 this.m_isClosed = true;
                 this.Flush();
+                if (this.m_isInput)
+                {
+                    // Release blocks fetched ahead that the reader never consumed.
+                    for (int i = this.m_readHead; i < this.m_readCount; i++)
+                    {
+                        DryadLinqNative.ReleaseDataBlock(this.m_vertexInfo, this.m_readHandles[i]);
+                        this.m_readHandles[i] = IntPtr.Zero;
+                    }
+                    this.m_readHead = this.m_readCount;
+                }
                 DryadLinqNative.Close(this.m_vertexInfo, this.m_portNum);
                 string ctype = (this.m_isInput) ? "Input" : "Output";
                 DryadLinqLog.AddInfo(ctype + " channel {0} was closed.", this.m_portNum);
@@ -19,6 +19,7 @@ limitations under the License.
 */
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.IO;
 using System.Linq;
 using System.Text;
@@ -117,6 +118,12 @@ namespace Microsoft.Research.Dryad.LocalScheduler
         /// </summary>
         private ClusterInterface.ILogger logger;
 
+        /// <summary>
+        /// shared estimate of slot turnover, which this computer updates each time a process finishes.
+        /// This is null for the dummy computer used for canceling
+        /// </summary>
+        private SlotTurnover turnover;
+
         /// <summary>
         /// construct a new Computer object
         /// </summary>
@@ -128,11 +135,14 @@ namespace Microsoft.Research.Dryad.LocalScheduler
         /// <param name="pServer">the address of the daemon's http server for process scheduling</param>
         /// <param name="fServer">the address of the daemon's http server for file proxying</param>
         /// <param name="directory">the daemon's local directory</param>
+        /// <param name="t">the scheduler's estimate of slot turnover</param>
         /// <param name="log">connection to the logging subsystem</param>
         public Computer(string n, string host, string rn, ProcessQueue rack, ProcessQueue cluster,
-                        string pServer, string fServer, string directory, ClusterInterface.ILogger log)
+                        string pServer, string fServer, string directory, SlotTurnover t,
+                        ClusterInterface.ILogger log)
         {
             logger = log;
+            turnover = t;
             name = n;
             localDirectory = directory;
             processServer = pServer;
@@ -398,10 +408,18 @@ namespace Microsoft.Research.Dryad.LocalScheduler
                     {
                         logger.Log("Computer " + name + " reporting match with process " + process.Id);
 
+                        Stopwatch occupancy = Stopwatch.StartNew();
+
                         TaskCompletionSource<Process> thisWaiter = GetAsyncFinishWaiter();
                         await process.OnScheduled(this, nextTask, thisWaiter.Task, null);
                         RemoveAsyncFinishWaiter(thisWaiter);
 
+                        if (turnover != null)
+                        {
+                            // feed the delay scheduling policy with how long this slot was busy
+                            turnover.RecordOccupancy(occupancy.Elapsed);
+                        }
+
                         logger.Log("Computer " + name + " waiting for process " + process.Id + " to complete");
 
                         ++nextTask;
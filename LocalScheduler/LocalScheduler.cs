@@ -49,8 +49,7 @@ namespace Microsoft.Research.Dryad.LocalScheduler
         private ProcessQueue clusterQueue;
 
         private Task flusher;
-        private const int rackDelay = 1000;
-        private const int clusterDelay = 2000;
+        private SlotTurnover turnover;
 
         private ClusterInterface.ILogger logger;
         private PeloponneseInterface clusterInterface;
@@ -67,11 +66,12 @@ namespace Microsoft.Research.Dryad.LocalScheduler
             clusterQueue = new ProcessQueue();
 
             flusher = new Task(() => { });
+            turnover = new SlotTurnover();
 
             clusterInterface = new PeloponneseInterface();
 
             dummyCancelComputer = new Computer("dummy for canceling", "nowhere", "no rack", null, null,
-                                               "no server", "no server", "no directory", logger);
+                                               "no server", "no server", "no directory", null, logger);
 
             l.Log("LocalScheduler created");
         }
@@ -136,15 +136,6 @@ namespace Microsoft.Research.Dryad.LocalScheduler
 
             process.SetCallback(callback);
 
-            Task rackBlocker;
-            Task clusterBlocker;
-
-            lock (this)
-            {
-                rackBlocker = Task.WhenAny(flusher, Task.Delay(rackDelay));
-                clusterBlocker = Task.WhenAny(flusher, Task.Delay(clusterDelay));
-            }
-
             bool isHardConstraint = affinities.Aggregate(false, (a, b) => a || b.isHardContraint);
             if (isHardConstraint)
             {
@@ -157,6 +148,7 @@ namespace Microsoft.Research.Dryad.LocalScheduler
             var computerAffinities = allAffinities.Where(a => a.level == ClusterInterface.AffinityResourceLevel.Host);
 
             bool addedAny = false;
+            int candidateSlots = 0;
 
             // get a snapshot of available computers
             Dictionary<string, List<Computer>> localitySnapshot = new Dictionary<string,List<Computer>>();
@@ -184,6 +176,7 @@ namespace Microsoft.Research.Dryad.LocalScheduler
                     logger.Log("Adding Process " + process.Id + " to queues for computers with locality " + a.locality);
                     foreach (var c in cl)
                     {
+                        ++candidateSlots;
                         logger.Log("Adding Process " + process.Id + " to queue for computer " + c.Name);
                         if (c.LocalQueue.AddProcess(process))
                         {
@@ -200,15 +193,16 @@ namespace Microsoft.Research.Dryad.LocalScheduler
 
             if (addedAny)
             {
-                // hacky delay scheduling; wait until the upper level has finished adding processes in
-                // the current stage, or some time has passed, before relaxing affinities if the process
-                // had affinities for particular computers
-                logger.Log("Process " + process.Id + " delay scheduling for rack");
-                await rackBlocker;
+                // delay scheduling; wait until the upper level has finished adding processes in
+                // the current stage, or until one of the preferred computers could be expected to
+                // have come free, before relaxing affinities if the process had affinities for
+                // particular computers
+                await DelayScheduling(process, "rack", turnover.HostWait(candidateSlots), candidateSlots);
             }
 
-            // reset flag before adding to racks
+            // reset flags before adding to racks
             addedAny = false;
+            candidateSlots = 0;
 
             // get a snapshot of available racks
             Dictionary<string, Rack> rackSnapshot = new Dictionary<string, Rack>();
@@ -232,6 +226,10 @@ namespace Microsoft.Research.Dryad.LocalScheduler
                 if (rackSnapshot.TryGetValue(a, out r))
                 {
                     addedAny = true;
+                    lock (r)
+                    {
+                        candidateSlots += r.computers.Count;
+                    }
                     logger.Log("Adding Process " + process.Id + " to queue for rack " + a);
                     if (r.queue.AddProcess(process))
                     {
@@ -253,11 +251,8 @@ namespace Microsoft.Research.Dryad.LocalScheduler
 
             if (addedAny)
             {
-                // hacky delay scheduling; wait until the upper level has finished adding processes in
-                // the current stage, or some time has passed, before relaxing affinities if the process
-                // had affinities for particular racks
-                logger.Log("Process " + process.Id + " delay scheduling for cluster");
-                await clusterBlocker;
+                // delay scheduling; as above, but waiting for any computer in the preferred racks
+                await DelayScheduling(process, "cluster", turnover.RackWait(candidateSlots), candidateSlots);
             }
 
             logger.Log("Adding Process " + process.Id + " to queue for cluster");
@@ -267,6 +262,18 @@ namespace Microsoft.Research.Dryad.LocalScheduler
             process.FinishedScheduling();
         }
 
+        private Task DelayScheduling(Process process, string nextLevel, int wait, int candidateSlots)
+        {
+            logger.Log("Process " + process.Id + " delay scheduling for " + nextLevel + ": waiting " + wait +
+                       "ms for " + candidateSlots + " candidate slots, mean slot occupancy " +
+                       (int)turnover.MeanOccupancy + "ms");
+
+            lock (this)
+            {
+                return Task.WhenAny(flusher, Task.Delay(wait));
+            }
+        }
+
         public void ScheduleProcess(ClusterInterface.ISchedulerProcess ip,
                                     List<ClusterInterface.Affinity> affinities,
                                     ClusterInterface.RunProcess onScheduled)
@@ -304,7 +311,7 @@ namespace Microsoft.Research.Dryad.LocalScheduler
             }
 
             Computer c = new Computer(computerName, hostName, rackName, rack.queue, clusterQueue,
-                                      processServer, fileServer, localDirectory, logger);
+                                      processServer, fileServer, localDirectory, turnover, logger);
             lock (computers)
             {
                 computers.Add(computerName, c);
@@ -0,0 +1,144 @@
+/*
+Copyright (c) Microsoft Corporation
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in 
+compliance with the License.  You may obtain a copy of the License 
+at http://www.apache.org/licenses/LICENSE-2.0   
+
+
+THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER 
+EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF 
+TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.  
+
+
+See the Apache Version 2.0 License for specific language governing permissions and 
+limitations under the License. 
+
+*/
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Microsoft.Research.Dryad.LocalScheduler
+{
+    /// <summary>
+    /// This keeps a running estimate of how long a computer stays occupied once it has been
+    /// matched to a process, and turns it into the budgets used for delay scheduling. When a
+    /// process prefers a set of N slots and each slot frees up on average every T ms, the first
+    /// of them is expected to become free after about T/N ms, so a process waits a small multiple
+    /// of that before relaxing its affinity to the next level out. Short tasks on a busy cluster
+    /// therefore only wait briefly for a data-local slot, while long-running tasks don't hold up
+    /// a process that is never going to get one
+    /// </summary>
+    internal class SlotTurnover
+    {
+        /// <summary>
+        /// weight given to each new observation in the moving average of slot occupancy
+        /// </summary>
+        private const double smoothing = 0.1;
+
+        /// <summary>
+        /// multiple of the expected wait for a free preferred slot that a process is prepared
+        /// to wait. Under a Poisson model of slot turnover a factor of 2 finds a local slot
+        /// about 86% of the time
+        /// </summary>
+        private const double waitFactor = 2.0;
+
+        /// <summary>
+        /// bounds on the time a process waits at each level, in ms. The defaults are used
+        /// until any slot has turned over, and match the fixed delays previously used
+        /// </summary>
+        private const int minimumWait = 50;
+        private const int defaultHostWait = 1000;
+        private const int defaultRackWait = 1000;
+        private const int maximumHostWait = 5000;
+        private const int maximumRackWait = 5000;
+
+        /// <summary>
+        /// exponentially-weighted moving average of the time between a computer being matched
+        /// to a process and the computer becoming free again, in ms
+        /// </summary>
+        private double meanOccupancy;
+
+        /// <summary>
+        /// number of occupancy intervals that have been observed
+        /// </summary>
+        private long numberOfSamples;
+
+        public SlotTurnover()
+        {
+            meanOccupancy = 0.0;
+            numberOfSamples = 0;
+        }
+
+        /// <summary>
+        /// the current estimate of mean slot occupancy in ms, or 0 if nothing has been observed
+        /// </summary>
+        public double MeanOccupancy
+        {
+            get { lock (this) { return meanOccupancy; } }
+        }
+
+        /// <summary>
+        /// called by a computer each time a process it was running has finished
+        /// </summary>
+        /// <param name="occupancy">the time the computer was occupied by the process</param>
+        public void RecordOccupancy(TimeSpan occupancy)
+        {
+            lock (this)
+            {
+                if (numberOfSamples == 0)
+                {
+                    meanOccupancy = occupancy.TotalMilliseconds;
+                }
+                else
+                {
+                    meanOccupancy += smoothing * (occupancy.TotalMilliseconds - meanOccupancy);
+                }
+                ++numberOfSamples;
+            }
+        }
+
+        /// <summary>
+        /// the time in ms a process should wait in the queues of its preferred computers before
+        /// also being added to their racks' queues
+        /// </summary>
+        /// <param name="candidateSlots">the number of computers the process was queued at</param>
+        public int HostWait(int candidateSlots)
+        {
+            return Budget(candidateSlots, defaultHostWait, maximumHostWait);
+        }
+
+        /// <summary>
+        /// the time in ms a process should wait in the queues of its preferred racks before
+        /// also being added to the cluster queue
+        /// </summary>
+        /// <param name="candidateSlots">the number of computers in the racks the process was queued at</param>
+        public int RackWait(int candidateSlots)
+        {
+            return Budget(candidateSlots, defaultRackWait, maximumRackWait);
+        }
+
+        private int Budget(int candidateSlots, int defaultWait, int maximumWait)
+        {
+            double occupancy;
+
+            lock (this)
+            {
+                if (numberOfSamples == 0)
+                {
+                    return defaultWait;
+                }
+                occupancy = meanOccupancy;
+            }
+
+            double wait = waitFactor * occupancy / Math.Max(candidateSlots, 1);
+            return (int)Math.Max(minimumWait, Math.Min(maximumWait, wait));
+        }
+    }
+}